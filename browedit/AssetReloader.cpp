@@ -0,0 +1,221 @@
+#include <Windows.h>
+#include <glad/glad.h>
+#include "AssetReloader.h"
+#include <browedit/BrowEdit.h>
+#include <browedit/Map.h>
+#include <browedit/Node.h>
+#include <browedit/gl/Texture.h>
+#include <browedit/components/Rsm.h>
+#include <browedit/components/RsmRenderer.h>
+#include <browedit/components/GndRenderer.h>
+#include <browedit/util/ResourceManager.h>
+#include <browedit/util/FileIO.h>
+#include <browedit/util/Profiler.h>
+#include <iostream>
+#include <set>
+
+class AssetReloader::Job
+{
+public:
+	gl::Texture* texture = nullptr;
+	Rsm* rsm = nullptr;
+	std::string fileName;
+	bool flip = false;
+	util::FileIO::Fingerprint fingerprint; //of the file when the asset was loaded
+	bool changed = false;
+	bool decoded = false;
+	gl::Texture::Image image;
+	Rsm* newRsm = nullptr; //loaded on the background thread, moved into rsm on the main thread
+};
+
+AssetReloader::~AssetReloader()
+{
+	if (thread.joinable())
+		thread.join();
+	for (auto job : jobs)
+	{
+		delete job->newRsm;
+		delete job;
+	}
+}
+
+//every asset is loaded once more, so it can't be unloaded while it's being checked. They are unloaded again in apply
+void AssetReloader::begin(bool textures, bool models, bool refreshIndex)
+{
+	if (running)
+	{
+		queued = true;
+		queuedTextures |= textures;
+		queuedModels |= models;
+		queuedRefreshIndex |= refreshIndex;
+		return;
+	}
+	started = lastCheck = std::chrono::steady_clock::now();
+	if (refreshIndex)
+		util::FileIO::refresh();
+	if (textures)
+	{
+		for (auto t : util::ResourceManager<gl::Texture>::loadAll())
+		{
+			heldTextures.insert(t);
+			if (t->fileName.empty() || !t->tryLoaded)
+				continue;
+			auto job = new Job();
+			job->texture = t;
+			job->fileName = t->fileName;
+			job->flip = t->flipSelection;
+			job->fingerprint = t->fingerprint;
+			jobs.push_back(job);
+		}
+	}
+	if (models)
+	{
+		for (auto rsm : util::ResourceManager<Rsm>::loadAll())
+		{
+			heldModels.insert(rsm);
+			if (rsm->fileName.empty())
+				continue;
+			auto job = new Job();
+			job->rsm = rsm;
+			job->fileName = rsm->fileName;
+			job->fingerprint = rsm->fingerprint;
+			jobs.push_back(job);
+		}
+	}
+	done = false;
+	running = true;
+	thread = std::thread(&AssetReloader::check, this);
+}
+
+//runs on the background thread. Nothing here uses GL or changes the assets that are in use
+void AssetReloader::check()
+{
+	std::atomic<int> nextJob(0);
+	auto worker = [&]()
+	{
+		for (int i; (i = nextJob++) < (int)jobs.size();)
+		{
+			auto job = jobs[i];
+			if (util::FileIO::fingerprint(job->fileName) == job->fingerprint)
+				continue;
+			job->changed = true;
+			if (job->texture)
+				job->decoded = gl::Texture::decode(job->fileName, job->flip, job->image);
+			else
+				job->newRsm = new Rsm(job->fileName);
+		}
+	};
+	int threadCount = (int)std::min<std::size_t>(jobs.size() / 16 + 1, std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++)
+		threads.push_back(std::thread(worker));
+	worker();
+	for (auto& t : threads)
+		t.join();
+	done = true;
+}
+
+void AssetReloader::update(BrowEdit* browEdit)
+{
+	if (running)
+	{
+		//the lightmapper reads the models on its own threads, so they can't be swapped until it is done
+		if (!done || browEdit->lightmapper)
+			return;
+		thread.join();
+		apply(browEdit);
+		running = false;
+		if (queued)
+		{
+			queued = false;
+			begin(queuedTextures, queuedModels, queuedRefreshIndex);
+			queuedTextures = queuedModels = queuedRefreshIndex = false;
+		}
+	}
+	else if (browEdit->config.hotReloadWatch && std::chrono::steady_clock::now() - lastCheck > std::chrono::seconds(std::max(1, browEdit->config.hotReloadInterval)))
+		begin(true, true, false);
+}
+
+void AssetReloader::apply(BrowEdit* browEdit)
+{
+	PROFILE_SCOPE("AssetReloader::apply");
+	std::set<gl::Texture*> changedTextures;
+	std::set<Rsm*> changedModels;
+	int failed = 0;
+	for (auto job : jobs)
+	{
+		if (!job->changed)
+			continue;
+		if (job->texture)
+		{
+			if (job->decoded)
+			{
+				job->texture->upload(job->image);
+				changedTextures.insert(job->texture);
+			}
+			else
+			{ //keep the old image, it is tried again when the file changes again
+				job->texture->fingerprint = job->image.fingerprint;
+				failed++;
+			}
+		}
+		else if (job->newRsm)
+		{
+			if (job->newRsm->loaded)
+			{
+				job->rsm->takeFrom(job->newRsm);
+				changedModels.insert(job->rsm);
+			}
+			else
+			{
+				job->rsm->fingerprint = job->newRsm->fingerprint;
+				failed++;
+			}
+			delete job->newRsm;
+			job->newRsm = nullptr;
+		}
+	}
+
+	//the renderers of a model point into its meshes, and the ground keeps copies of its textures in a texture array
+	if (!changedTextures.empty() || !changedModels.empty())
+	{
+		auto restart = [&](Node* n)
+		{
+			auto rsmRenderer = n->getComponent<RsmRenderer>();
+			if (rsmRenderer && changedModels.find(n->getComponent<Rsm>()) != changedModels.end())
+				rsmRenderer->begin();
+			auto gndRenderer = n->getComponent<GndRenderer>();
+			if (gndRenderer)
+				for (auto t : gndRenderer->textures)
+					if (changedTextures.find(t) != changedTextures.end())
+						gndRenderer->textureArrayDirty = true;
+		};
+		for (auto m : browEdit->maps)
+			m->rootNode->traverse(restart);
+		for (auto& mv : browEdit->modelEditor.models)
+		{
+			if (changedModels.find(mv.node->getComponent<Rsm>()) != changedModels.end())
+				mv.selectedMesh = nullptr;
+			mv.node->traverse(restart);
+		}
+		//renderers outside of the maps and model editor (like the object browser previews) still share the old vertex buffer,
+		//rebuilding it bumps its version so they re-init their render info before drawing the new meshes
+		for (auto rsm : changedModels)
+		{
+			auto it = RsmRenderer::meshDataCache.find(rsm);
+			if (it != RsmRenderer::meshDataCache.end())
+				it->second->build(rsm);
+		}
+	}
+
+	util::ResourceManager<gl::Texture>::unloadAll(heldTextures);
+	util::ResourceManager<Rsm>::unloadAll(heldModels);
+	heldTextures.clear();
+	heldModels.clear();
+	for (auto job : jobs)
+		delete job;
+	if (!changedTextures.empty() || !changedModels.empty() || failed > 0)
+		std::cout << "AssetReloader: checked " << jobs.size() << " assets, reloaded " << changedTextures.size() << " textures and " << changedModels.size() << " models in "
+			<< std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count() << "ms" << (failed > 0 ? ", " + std::to_string(failed) + " could not be loaded" : "") << std::endl;
+	jobs.clear();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <set>
+
+class BrowEdit;
+class Rsm;
+namespace gl { class Texture; }
+
+//Reloads the textures and models whose files changed since they were loaded. Every loaded asset keeps a fingerprint of its file,
+//these are compared on a background thread, and the changed files are decoded there too. The results are swapped in
+//on the main thread in update(), all in the same frame. When config.hotReloadWatch is on, a check is started every couple of seconds
+class AssetReloader
+{
+	class Job;
+	std::vector<Job*> jobs;
+	std::set<gl::Texture*> heldTextures; //referenced in begin, released together in apply
+	std::set<Rsm*> heldModels;
+	bool queued = false; //a reload that was asked for while a check was running, started when that one is done
+	bool queuedTextures = false;
+	bool queuedModels = false;
+	bool queuedRefreshIndex = false;
+	std::thread thread;
+	std::atomic<bool> done = false;
+	bool running = false;
+	std::chrono::steady_clock::time_point started;
+	std::chrono::steady_clock::time_point lastCheck = std::chrono::steady_clock::now();
+
+	void check();
+	void apply(BrowEdit* browEdit);
+public:
+	~AssetReloader();
+	void begin(bool textures, bool models, bool refreshIndex); //refreshIndex also finds files that were added to a data directory
+	void update(BrowEdit* browEdit); //call every frame from the main thread
+	bool busy() const { return running; }
+};
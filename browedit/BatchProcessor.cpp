@@ -0,0 +1,336 @@
+#include "BatchProcessor.h"
+#include <browedit/Config.h>
+#include <browedit/Node.h>
+#include <browedit/components/Rsw.h>
+#include <browedit/components/Gnd.h>
+#include <browedit/components/Gat.h>
+#include <browedit/components/Rsm.h>
+#include <browedit/util/FileIO.h>
+#include <browedit/util/ResourceManager.h>
+#include <browedit/util/MemoryTracker.h>
+#include <browedit/util/Util.h>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <set>
+#include <algorithm>
+
+using json = nlohmann::json;
+
+static const std::vector<std::pair<std::string, BatchProcessor::Pass>> passNames = {
+	{ "cleantiles", BatchProcessor::CleanTiles },
+	{ "cleanlightmaps", BatchProcessor::CleanLightmaps },
+	{ "lightmapborders", BatchProcessor::LightmapBorders },
+	{ "quadtree", BatchProcessor::Quadtree },
+	{ "validate", BatchProcessor::Validate },
+};
+
+static std::size_t fileSize(const std::string& fileName)
+{
+	auto is = util::FileIO::open(fileName);
+	if (!is)
+		return 0;
+	is->seekg(0, std::ios_base::end);
+	std::size_t size = (std::size_t)is->tellg();
+	delete is;
+	return size;
+}
+
+//accepts prontera, prontera.rsw and data\prontera.rsw
+static std::string mapFileName(std::string name)
+{
+	std::replace(name.begin(), name.end(), '/', '\\');
+	if (name.size() < 4 || name.substr(name.size() - 4) != ".rsw")
+		name += ".rsw";
+	if (name.substr(0, 5) != "data\\")
+		name = "data\\" + name;
+	return name;
+}
+
+void BatchProcessor::printUsage()
+{
+	std::cout << "Usage: BrowEdit3 --batch [options] [maps]" << std::endl;
+	std::cout << "  --data <directory>  RO data directory to read from, can be used multiple times" << std::endl;
+	std::cout << "  --grf <file>        grf to read from, can be used multiple times" << std::endl;
+	std::cout << "                      without --data or --grf, the paths from config.json are used" << std::endl;
+	std::cout << "  --passes <list>     comma separated: cleantiles, cleanlightmaps, lightmapborders, quadtree, validate (default validate)" << std::endl;
+	std::cout << "  --threads <n>       amount of maps to process at the same time (default the amount of cores)" << std::endl;
+	std::cout << "  --out <directory>   where to save the maps (default the first data directory)" << std::endl;
+	std::cout << "  --report <file>     json report with the sizes, missing files and timings (default batch-report.json)" << std::endl;
+	std::cout << "  --dry-run           run the passes, but don't save anything" << std::endl;
+	std::cout << "  --all               process all maps that can be found" << std::endl;
+}
+
+bool BatchProcessor::parseArguments(int argc, char** argv)
+{
+	for (int i = 2; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--data" && hasValue)
+			dataDirectories.push_back(argv[++i]);
+		else if (arg == "--grf" && hasValue)
+			grfs.push_back(argv[++i]);
+		else if (arg == "--threads" && hasValue)
+			threadCount = atoi(argv[++i]);
+		else if (arg == "--out" && hasValue)
+			outputDirectory = argv[++i];
+		else if (arg == "--report" && hasValue)
+			reportFile = argv[++i];
+		else if (arg == "--dry-run")
+			dryRun = true;
+		else if (arg == "--all")
+			allMaps = true;
+		else if (arg == "--passes" && hasValue)
+		{
+			passes = 0;
+			for (const auto& name : util::split(argv[++i], ","))
+			{
+				auto it = std::find_if(passNames.begin(), passNames.end(), [&](const std::pair<std::string, Pass>& p) { return p.first == name; });
+				if (it == passNames.end())
+				{
+					std::cerr << "Batch: unknown pass " << name << std::endl;
+					return false;
+				}
+				passes |= it->second;
+			}
+		}
+		else if (arg.substr(0, 2) == "--")
+		{
+			std::cerr << "Batch: unknown option " << arg << std::endl;
+			return false;
+		}
+		else
+			maps.push_back(arg);
+	}
+	return allMaps || !maps.empty();
+}
+
+int BatchProcessor::run(int argc, char** argv)
+{
+	if (!parseArguments(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+
+	if (dataDirectories.empty() && grfs.empty())
+	{
+		std::ifstream configFile("config.json");
+		if (!configFile.is_open())
+		{
+			std::cerr << "Batch: no --data or --grf given, and no config.json to read them from" << std::endl;
+			return 1;
+		}
+		Config config;
+		try {
+			json configJson;
+			configFile >> configJson;
+			config = configJson.get<Config>();
+		}
+		catch (...) {
+			std::cerr << "Batch: config.json is invalid" << std::endl;
+			return 1;
+		}
+		dataDirectories.push_back(config.ropath);
+		grfs = config.grfs;
+		util::MemoryTracker::setBudgets(config.memoryBudgets);
+		config.setupFileIO();
+	}
+	else
+	{
+		util::FileIO::begin();
+		for (const auto& dir : dataDirectories)
+			util::FileIO::addDirectory(util::utf8_to_iso_8859_1(dir));
+		for (const auto& grf : grfs)
+			util::FileIO::addGrf(util::utf8_to_iso_8859_1(grf));
+		util::FileIO::end();
+	}
+
+	if (outputDirectory.empty() && !dryRun)
+	{
+		if (dataDirectories.empty())
+		{
+			std::cerr << "Batch: maps from a grf can't be saved in place, use --out" << std::endl;
+			return 1;
+		}
+		outputDirectory = dataDirectories.front();
+	}
+	if (!outputDirectory.empty() && outputDirectory.back() != '\\' && outputDirectory.back() != '/')
+		outputDirectory += "\\";
+
+	if (allMaps)
+		for (const auto& file : util::FileIO::listFiles("data"))
+			if (file.size() > 4 && file.substr(file.size() - 4) == ".rsw")
+				maps.push_back(file);
+	for (auto& map : maps)
+		map = mapFileName(map);
+	std::sort(maps.begin(), maps.end());
+	maps.erase(std::unique(maps.begin(), maps.end()), maps.end());
+	std::cout << "Batch: processing " << maps.size() << " maps" << std::endl;
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<json> results(maps.size());
+	std::atomic<int> nextMap(0);
+	auto worker = [&]()
+	{
+		for (int i; (i = nextMap++) < (int)maps.size();)
+			results[i] = processMap(maps[i]);
+	};
+	int threads = threadCount > 0 ? threadCount : (int)std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, (int)maps.size());
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.push_back(std::thread(worker));
+	worker();
+	for (auto& t : workers)
+		t.join();
+	auto totalTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	json report;
+	report["passes"] = json::array();
+	for (const auto& p : passNames)
+		if (passes & p.second)
+			report["passes"].push_back(p.first);
+	report["dryRun"] = dryRun;
+	report["threads"] = threads;
+	report["totalMs"] = totalTime;
+	report["maps"] = results;
+	int failed = 0;
+	for (const auto& r : results)
+		if (r.find("error") != r.end())
+			failed++;
+	report["failed"] = failed;
+	report["memory"] = util::MemoryTracker::toJson();
+	util::MemoryTracker::dump(std::cout);
+
+	std::string reportData = report.dump(2);
+	if (!util::FileIO::writeFileAtomic(reportFile, reportData.data(), reportData.size()))
+		std::cerr << "Batch: unable to write report to " << reportFile << std::endl;
+	std::cout << "Batch: done with " << maps.size() << " maps in " << totalTime << "ms, " << failed << " failed. Report written to " << reportFile << std::endl;
+	return failed > 0 ? 2 : 0;
+}
+
+//Loads a map without any of the renderers, as there is no opengl context, runs the passes on it and saves it
+json BatchProcessor::processMap(const std::string& fileName)
+{
+	json report;
+	report["map"] = fileName;
+	auto timed = [&](const std::string& name, const std::function<void()>& callback)
+	{
+		auto start = std::chrono::steady_clock::now();
+		callback();
+		report["timings"][name] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	Node* rootNode = new Node(fileName);
+	try
+	{
+		if (!util::FileIO::exists(fileName))
+			throw std::runtime_error("map not found");
+		auto rsw = new Rsw();
+		rootNode->addComponent(rsw);
+		Gnd* gnd = nullptr;
+		Gat* gat = nullptr;
+		std::string directory = fileName.substr(0, fileName.rfind("\\") + 1);
+		timed("load", [&]()
+		{
+			rsw->load(fileName, nullptr, nullptr, false, false);
+			gnd = new Gnd(directory + rsw->gndFile);
+			rootNode->addComponent(gnd);
+			gat = new Gat(directory + rsw->gatFile);
+			rootNode->addComponent(gat);
+		});
+		if (gnd->width == 0 || gnd->height == 0)
+			throw std::runtime_error("unable to load " + rsw->gndFile);
+
+		report["sizeBefore"]["rsw"] = fileSize(fileName);
+		report["sizeBefore"]["gnd"] = fileSize(directory + rsw->gndFile);
+		report["sizeBefore"]["gat"] = fileSize(directory + rsw->gatFile);
+		report["before"]["tiles"] = gnd->tiles.size();
+		report["before"]["lightmaps"] = gnd->lightmaps.size();
+
+		if (passes & Validate)
+			timed("validate", [&]()
+			{
+				std::set<std::string> missingTextures;
+				for (auto t : gnd->textures)
+					if (!util::FileIO::exists("data\\texture\\" + t->file))
+						missingTextures.insert(t->file);
+				std::set<std::string> missingModels;
+				rootNode->traverse([&](Node* n)
+				{
+					auto rswModel = n->getComponent<RswModel>();
+					if (rswModel && !util::FileIO::exists("data\\model\\" + util::utf8_to_iso_8859_1(rswModel->fileName)))
+						missingModels.insert(rswModel->fileName);
+				});
+				report["missingTextures"] = missingTextures;
+				report["missingModels"] = missingModels;
+				report["gatSizeValid"] = gat->width == gnd->width * 2 && gat->height == gnd->height * 2;
+				if (!report["gatSizeValid"])
+					std::cerr << "Batch: " << fileName << " has a gat of " << gat->width << "x" << gat->height << ", expected " << gnd->width * 2 << "x" << gnd->height * 2 << std::endl;
+			});
+		if (passes & CleanTiles)
+			timed("cleantiles", [&]() { gnd->cleanTiles(); });
+		if (passes & CleanLightmaps)
+			timed("cleanlightmaps", [&]() { gnd->cleanLightmaps(); });
+		if (passes & LightmapBorders)
+			timed("lightmapborders", [&]() { gnd->makeLightmapBorders(nullptr); });
+		if ((passes & Quadtree) && rsw->quadtree)
+			timed("quadtree", [&]()
+			{
+				rootNode->traverse([&](Node* n)
+				{
+					auto rswModel = n->getComponent<RswModel>();
+					if (rswModel && !n->getComponent<Rsm>())
+						n->addComponent(util::ResourceManager<Rsm>::load("data\\model\\" + util::utf8_to_iso_8859_1(rswModel->fileName)));
+				});
+				rsw->recalculateQuadtree();
+			});
+
+		report["after"]["tiles"] = gnd->tiles.size();
+		report["after"]["lightmaps"] = gnd->lightmaps.size();
+
+		std::map<std::string, std::vector<char>> files;
+		timed("serialize", [&]()
+		{
+			std::string target = outputDirectory + fileName;
+			std::string targetDirectory = target.substr(0, target.rfind("\\") + 1);
+			if (rsw->quadtree) //the rsw can't be saved without a quadtree
+				rsw->serialize(target, nullptr, files);
+			files[targetDirectory + rsw->gndFile] = gnd->serialize();
+			files[targetDirectory + rsw->gatFile] = gat->serialize();
+			report["sizeAfter"]["rsw"] = files.find(target) != files.end() ? files[target].size() : 0;
+			report["sizeAfter"]["gnd"] = files[targetDirectory + rsw->gndFile].size();
+			report["sizeAfter"]["gat"] = files[targetDirectory + rsw->gatFile].size();
+		});
+
+		if (!dryRun)
+			timed("write", [&]()
+			{
+				for (const auto& file : files)
+				{
+					std::filesystem::create_directories(std::filesystem::path(file.first).parent_path());
+					if (!util::FileIO::writeFileAtomic(file.first, file.second.data(), file.second.size()))
+						throw std::runtime_error("unable to write " + file.first);
+				}
+			});
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Batch: error processing " << fileName << ": " << e.what() << std::endl;
+		report["error"] = e.what();
+	}
+	catch (const char* e) //the loaders throw strings for unsupported versions
+	{
+		std::cerr << "Batch: error processing " << fileName << ": " << e << std::endl;
+		report["error"] = e;
+	}
+	delete rootNode;
+	return report;
+}
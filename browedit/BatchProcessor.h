@@ -0,0 +1,36 @@
+#pragma once
+
+#include <json.hpp>
+#include <string>
+#include <vector>
+
+//Runs maintenance passes over a list of maps, without opening a window. Started with BrowEdit3.exe --batch.
+//Every map is loaded, processed and saved on its own, so the maps are spread over a couple of threads
+class BatchProcessor
+{
+public:
+	enum Pass
+	{
+		CleanTiles = 1,
+		CleanLightmaps = 2,
+		LightmapBorders = 4,
+		Quadtree = 8,
+		Validate = 16,
+	};
+
+	std::vector<std::string> dataDirectories;
+	std::vector<std::string> grfs;
+	std::vector<std::string> maps;
+	int passes = Validate;
+	int threadCount = 0; //0 for the amount of cores
+	std::string outputDirectory; //empty to save over the maps in the first data directory
+	std::string reportFile = "batch-report.json";
+	bool allMaps = false;
+	bool dryRun = false;
+
+	int run(int argc, char** argv);
+private:
+	bool parseArguments(int argc, char** argv);
+	void printUsage();
+	nlohmann::json processMap(const std::string& fileName);
+};
@@ -8,12 +8,16 @@
 #include <fstream>
 #include <thread>
 #include <filesystem>
+#include <chrono>
+#include <future>
+#include <unordered_map>
 
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <misc/cpp/imgui_stdlib.h>
 
 #include <browedit/Map.h>
+#include <browedit/BatchProcessor.h>
 #include <browedit/HotkeyRegistry.h>
 #include <browedit/gl/FBO.h>
 #include <browedit/gl/Texture.h>
@@ -28,7 +32,10 @@
 #include <browedit/components/RsmRenderer.h>
 #include <browedit/util/FileIO.h>
 #include <browedit/util/Util.h>
+#include <browedit/util/ByteStream.h>
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/Profiler.h>
+#include <browedit/util/MemoryTracker.h>
 #include <browedit/util/glfw_keycodes_to_string.h>
 
 #define Q(x) #x
@@ -56,11 +63,13 @@ static void SetupExceptionHandler()
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
 #ifndef _DEBUG
 	SetupExceptionHandler();
 #endif
+	if (argc > 1 && std::string(argv[1]) == "--batch")
+		return BatchProcessor().run(argc, argv);
 
 	std::cout << R"V0G0N(                                  ';cllllllc:,                                  
                                 ,lodddddddddddoc,                               
@@ -204,6 +213,7 @@ void BrowEdit::run()
 	{
 		if (!glfwLoopBegin())
 			break;
+		PROFILE_FRAME();
 		imguiLoopBegin();
 
 		if (cursor != nullptr)
@@ -218,6 +228,9 @@ void BrowEdit::run()
 		double deltaTime = newTime - time;
 		time = newTime;
 
+		assetReloader.update(this);
+		updatePendingSaves();
+
 		menuBar();
 		toolbar();
 
@@ -244,11 +257,18 @@ void BrowEdit::run()
 		if (windowData.undoVisible)
 			showUndoWindow();
 		if (windowData.objectWindowVisible && editMode == EditMode::Object)
+		{
+			PROFILE_SCOPE("Object Picker");
 			showObjectWindow();
+		}
 		if (editMode == EditMode::Object)
 			showObjectEditToolsWindow();
 		if (windowData.demoWindowVisible)
 			ImGui::ShowDemoWindow(&windowData.demoWindowVisible);
+		if (windowData.profilerVisible)
+			showProfilerWindow();
+		if (windowData.memoryVisible)
+			showMemoryWindow();
 		if (windowData.helpWindowVisible)
 			showHelpWindow();
 		if (editMode == EditMode::Texture)
@@ -329,6 +349,7 @@ void BrowEdit::run()
 				if (count == 0)
 				{
 					std::erase_if(maps, [map](Map* m) { return m == map;  });
+					std::erase_if(pendingSaves, [map](const PendingSave& s) { return s.map == map; });
 					delete map;
 				}
 			}
@@ -428,9 +449,19 @@ void BrowEdit::run()
 		glTexCoord2f(1, 0);		glVertex3f(1, 1, 0);
 		glTexCoord2f(0, 0);		glVertex3f(-1, 1, 0);
 		glEnd();
-		imguiLoopEnd();
-		glfwLoopEnd();
+		{
+			PROFILE_SCOPE("ImGui render");
+			PROFILE_GPU_SCOPE("ImGui render");
+			imguiLoopEnd();
+		}
+		{
+			PROFILE_SCOPE("Swap buffers");
+			glfwLoopEnd();
+		}
+		util::MemoryTracker::enforceBudgets(); //after rendering, as imgui can still use the textures that get freed
 	}
+	if (saveTask.valid())
+		saveTask.wait();
 	
 	NodeRenderer::end();
 	imguiEnd();
@@ -452,6 +483,7 @@ void BrowEdit::configBegin()
 			std::cerr << "Config file invalid, resetting config" << std::endl;
 			config.defaultHotkeys();
 		}
+		util::MemoryTracker::setBudgets(config.memoryBudgets);
 		if (config.isValid() != "")
 		{
 			windowData.configVisible = true;
@@ -548,17 +580,25 @@ void BrowEdit::showMapWindow(MapView& mapView, float deltaTime)
 		auto size = ImGui::GetContentRegionAvail();
 		if (mapView.map->rootNode->getComponent<Gnd>())
 		{
-			mapView.update(this, size, deltaTime);
+			{
+				PROFILE_SCOPE("MapView::update");
+				mapView.update(this, size, deltaTime);
+			}
 			if (firstRender.find(mapView.map) != firstRender.end()) //TODO: THIS IS A DIRTY HACK
 			{
 				mapView.nodeRenderContext.renderers = firstRender[mapView.map]->nodeRenderContext.renderers;
 				mapView.nodeRenderContext.ordered = firstRender[mapView.map]->nodeRenderContext.ordered;
 			}
-			mapView.render(this);
+			{
+				PROFILE_SCOPE("MapView::render");
+				PROFILE_GPU_SCOPE("MapView::render");
+				mapView.render(this);
+			}
 			bool cameraWidgetClicked = mapView.drawCameraWidget();
 			firstRender[mapView.map] = &mapView;
 			if (!cameraWidgetClicked)
 			{
+				PROFILE_SCOPE("MapView::postRender");
 				if (editMode == EditMode::Height)
 					mapView.postRenderHeightMode(this);
 				else if (editMode == EditMode::Object)
@@ -673,19 +713,36 @@ void BrowEdit::saveMap(Map* map)
 	}
 
 
+	std::vector<std::pair<std::string, std::string>> backups;
 	if (config.backup)
 	{
-		fixBackup(rswName, backupRswName);
-		fixBackup(gndName, backupGndName);
-		fixBackup(gatName, backupGndName);
-		fixBackup(lubName, backupGndName);
+		backups.push_back(std::pair<std::string, std::string>(rswName, backupRswName));
+		backups.push_back(std::pair<std::string, std::string>(gndName, backupGndName));
+		backups.push_back(std::pair<std::string, std::string>(gatName, backupGatName));
+		backups.push_back(std::pair<std::string, std::string>(lubName, backupLubName));
 	}
 
-	map->rootNode->getComponent<Rsw>()->save(rswName, this);
-	map->rootNode->getComponent<Gnd>()->save(gndName);
-	map->rootNode->getComponent<Gat>()->save(gatName);
+	saveMapFiles(map, rswName, gndName, gatName, backups);
+	//the map only counts as saved once the files are written, see updatePendingSaves
+	pendingSaves.push_back(PendingSave{ map, map->changeCount, saveTask });
+}
 
-	map->changed = false;
+//marks maps as unchanged once their background save succeeded, unless they were edited again in the meantime
+void BrowEdit::updatePendingSaves()
+{
+	for (auto it = pendingSaves.begin(); it != pendingSaves.end(); )
+	{
+		if (it->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			it++;
+			continue;
+		}
+		if (!it->result.get())
+			std::cerr << "Saving " << it->map->name << " failed, the map is still marked as changed" << std::endl;
+		else if (it->map->changeCount == it->changeCount)
+			it->map->changed = false;
+		it = pendingSaves.erase(it);
+	}
 }
 
 void BrowEdit::saveAsMap(Map* map)
@@ -733,19 +790,56 @@ void BrowEdit::saveAsMap(Map* map)
 	std::string backupGatName = "backups\\" + map->name.substr(0, map->name.size() - 4) + ".gat";
 	std::string backupLubName = "backups\\data\\luafiles514\\lua files\\effecttool\\" + mapName + ".lub";
 
+	std::vector<std::pair<std::string, std::string>> backups;
 	if (config.backup)
 	{
-		fixBackup(rswName, backupRswName);
-		fixBackup(gndName, backupGndName);
-		fixBackup(gatName, backupGatName);
-//		fixBackup(lubName, backupGndName);
+		backups.push_back(std::pair<std::string, std::string>(rswName, backupRswName));
+		backups.push_back(std::pair<std::string, std::string>(gndName, backupGndName));
+		backups.push_back(std::pair<std::string, std::string>(gatName, backupGatName));
+//		backups.push_back(std::pair<std::string, std::string>(lubName, backupLubName));
 	}
 
 	map->rootNode->getComponent<Rsw>()->gatFile = mapName + ".gat";
 	map->rootNode->getComponent<Rsw>()->gndFile = mapName + ".gnd";
-	map->rootNode->getComponent<Rsw>()->save(rswName, this);
-	map->rootNode->getComponent<Gnd>()->save(gndName);
-	map->rootNode->getComponent<Gat>()->save(gatName);
+	saveMapFiles(map, rswName, gndName, gatName, backups);
+}
+
+//Serializes the map to memory and writes it to disk on a background thread. The serializing has to happen here,
+//as the map can be edited as soon as this returns. The GND and GAT don't depend on the node tree, so they can be serialized in parallel with the RSW
+void BrowEdit::saveMapFiles(Map* map, const std::string& rswName, const std::string& gndName, const std::string& gatName, const std::vector<std::pair<std::string, std::string>>& backups)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto gnd = map->rootNode->getComponent<Gnd>();
+	auto gat = map->rootNode->getComponent<Gat>();
+	auto gndData = std::async(std::launch::async, [gnd]() { return gnd->serialize(); });
+	auto gatData = std::async(std::launch::async, [gat]() { return gat->serialize(); });
+
+	PROFILE_SCOPE("BrowEdit::saveMapFiles");
+	auto files = std::make_shared<std::map<std::string, std::vector<char>>>();
+	map->rootNode->getComponent<Rsw>()->serialize(rswName, this, *files);
+	(*files)[gndName] = gndData.get();
+	(*files)[gatName] = gatData.get();
+	std::cout << "Map serialized in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << "ms, writing in background" << std::endl;
+
+	//chain on the previous save, so saving twice in a row can't write the files out of order
+	auto previousSave = saveTask;
+	saveTask = std::async(std::launch::async, [previousSave, files, backups]()
+	{
+		if (previousSave.valid())
+			previousSave.wait();
+		PROFILE_SCOPE("Writing map files");
+		for (const auto& backup : backups)
+			fixBackup(backup.first, backup.second);
+		bool success = true;
+		for (const auto& file : *files)
+			if (!util::FileIO::writeFileAtomic(file.first, file.second.data(), file.second.size()))
+			{
+				std::cerr << "Unable to write " << file.first << std::endl;
+				success = false;
+			}
+		std::cout << (success ? "Done saving" : "Saving failed") << std::endl;
+		return success;
+	}).share();
 }
 
 void BrowEdit::loadMap(const std::string file)
@@ -777,15 +871,27 @@ void BrowEdit::loadMap(const std::string file)
 }
 
 
-void BrowEdit::copyTiles()
+//Binary clipboard format for tiles. The clipboard text is tileClipboardHeader followed by a base64 encoded block:
+//	int version, int flags, unsigned int bodySize, body (zlib compressed if flags & TileClipboardCompressed)
+//The body stores the cubes as packed arrays, followed by the deduplicated tiles, textures and lightmaps that the cubes refer to
+static const std::string tileClipboardHeader = "BrowEdit3Tiles:";
+static const int tileClipboardVersion = 1;
+static const int TileClipboardCompressed = 1 << 0;
+
+#pragma pack(push, 1)
+struct TileClipboardTile
+{
+	glm::vec2 texCoords[4];
+	int texture;
+	int lightmap;
+	unsigned char color[4];
+};
+#pragma pack(pop)
+
+static std::string copyTilesJson(Gnd* gnd, const std::vector<glm::ivec2>& selection, const glm::ivec2& center)
 {
-	auto gnd = activeMapView->map->rootNode->getComponent<Gnd>();
 	json clipboard;
-	glm::ivec2 center(0);
-	for (auto n : activeMapView->map->tileSelection)
-		center += n;
-	center /= activeMapView->map->tileSelection.size();
-	for (auto n : activeMapView->map->tileSelection)
+	for (auto n : selection)
 	{
 		auto c = gnd->cubes[n.x][n.y];
 		json cube = *c;
@@ -795,10 +901,6 @@ void BrowEdit::copyTiles()
 			if (c->tileIds[i] != -1)
 			{
 				auto tile = gnd->tiles[c->tileIds[i]];
-				for (int ii = 0; ii < 4; ii++)
-					for (int iii = 0; iii < 2; iii++)
-						if (std::isnan(tile->texCoords[ii][iii]))
-							tile->texCoords[ii][iii] = 0;
 				clipboard["tiles"][std::to_string(c->tileIds[i])] = json(*tile);
 				clipboard["textures"][std::to_string(tile->textureIndex)] = json(*gnd->textures[tile->textureIndex]);
 				if (tile->lightmapIndex > -1)
@@ -809,7 +911,148 @@ void BrowEdit::copyTiles()
 				}
 			}
 	}
-	ImGui::SetClipboardText(clipboard.dump(1).c_str());
+	return clipboard.dump(1);
+}
+
+static std::string copyTilesBinary(Gnd* gnd, const std::vector<glm::ivec2>& selection, const glm::ivec2& center)
+{
+	const int lightmapSize = gnd->lightmapWidth * gnd->lightmapHeight * 4;
+
+	std::vector<TileClipboardTile> tiles;
+	std::vector<Gnd::Texture*> textures;
+	std::vector<Gnd::Lightmap*> lightmaps;
+	std::map<int, int> tileLookup; //gnd tile index => clipboard tile index
+	std::map<int, int> textureLookup;
+	std::map<int, int> lightmapLookup;
+	std::unordered_map<uint64_t, std::vector<int>> lightmapHashes; //lightmaps with different indices can still have the same content
+
+	auto addLightmap = [&](int index) -> int
+	{
+		auto it = lightmapLookup.find(index);
+		if (it != lightmapLookup.end())
+			return it->second;
+		auto lightmap = gnd->lightmaps[index];
+		auto& bucket = lightmapHashes[lightmap->hash()];
+		for (auto i : bucket)
+			if (*lightmaps[i] == *lightmap)
+				return lightmapLookup[index] = i;
+		int ret = (int)lightmaps.size();
+		bucket.push_back(ret);
+		lightmaps.push_back(lightmap);
+		return lightmapLookup[index] = ret;
+	};
+	auto addTile = [&](int index) -> int
+	{
+		auto it = tileLookup.find(index);
+		if (it != tileLookup.end())
+			return it->second;
+		auto tile = gnd->tiles[index];
+		TileClipboardTile t;
+		for (int i = 0; i < 4; i++)
+			t.texCoords[i] = tile->texCoords[i];
+		t.texture = -1;
+		if (tile->textureIndex > -1)
+		{
+			auto tit = textureLookup.find(tile->textureIndex);
+			if (tit == textureLookup.end())
+			{
+				tit = textureLookup.insert({ tile->textureIndex, (int)textures.size() }).first;
+				textures.push_back(gnd->textures[tile->textureIndex]);
+			}
+			t.texture = tit->second;
+		}
+		t.lightmap = tile->lightmapIndex > -1 ? addLightmap(tile->lightmapIndex) : -1;
+		t.color[0] = tile->color.r;
+		t.color[1] = tile->color.g;
+		t.color[2] = tile->color.b;
+		t.color[3] = tile->color.a;
+		tiles.push_back(t);
+		return tileLookup[index] = (int)tiles.size() - 1;
+	};
+
+	std::vector<glm::ivec2> positions;
+	std::vector<glm::vec4> heights;
+	std::vector<glm::ivec3> tileIds;
+	std::vector<glm::vec3> normals; //1 face normal and 4 corner normals per cube
+	positions.reserve(selection.size());
+	heights.reserve(selection.size());
+	tileIds.reserve(selection.size());
+	normals.reserve(selection.size() * 5);
+	for (auto n : selection)
+	{
+		auto c = gnd->cubes[n.x][n.y];
+		positions.push_back(n - center);
+		heights.push_back(glm::vec4(c->h1, c->h2, c->h3, c->h4));
+		glm::ivec3 ids(-1);
+		for (int i = 0; i < 3; i++)
+			if (c->tileIds[i] != -1)
+				ids[i] = addTile(c->tileIds[i]);
+		tileIds.push_back(ids);
+		normals.push_back(c->normal);
+		for (int i = 0; i < 4; i++)
+			normals.push_back(c->normals[i]);
+	}
+
+	util::ByteWriter body(selection.size() * 96 + lightmaps.size() * lightmapSize + tiles.size() * sizeof(TileClipboardTile) + 1024);
+	body.write(gnd->lightmapWidth);
+	body.write(gnd->lightmapHeight);
+	body.write((int)selection.size());
+	body.writeArray(positions);
+	body.writeArray(heights);
+	body.writeArray(tileIds);
+	body.writeArray(normals);
+	body.write((int)tiles.size());
+	body.writeArray(tiles);
+	body.write((int)textures.size());
+	for (auto t : textures)
+	{
+		body.writeStringDyn(t->file);
+		body.writeStringDyn(t->name);
+	}
+	body.write((int)lightmaps.size());
+	for (auto l : lightmaps)
+		body.write(l->data, lightmapSize);
+
+	auto compressed = util::compress(body.data.data(), body.size());
+	util::ByteWriter envelope(compressed.size() + 12);
+	envelope.write(tileClipboardVersion);
+	envelope.write(TileClipboardCompressed);
+	envelope.write((unsigned int)body.size());
+	envelope.writeArray(compressed);
+	return tileClipboardHeader + util::base64Encode(envelope.data.data(), envelope.size());
+}
+
+void BrowEdit::copyTiles()
+{
+	auto gnd = activeMapView->map->rootNode->getComponent<Gnd>();
+	const auto& selection = activeMapView->map->tileSelection;
+	if (selection.empty())
+		return;
+	auto start = std::chrono::steady_clock::now();
+	glm::ivec2 center(0);
+	for (auto n : selection)
+		center += n;
+	center /= selection.size();
+	for (auto n : selection)
+	{
+		auto c = gnd->cubes[n.x][n.y];
+		for (int i = 0; i < 3; i++)
+			if (c->tileIds[i] != -1)
+			{
+				auto tile = gnd->tiles[c->tileIds[i]];
+				for (int ii = 0; ii < 4; ii++)
+					for (int iii = 0; iii < 2; iii++)
+						if (std::isnan(tile->texCoords[ii][iii]))
+							tile->texCoords[ii][iii] = 0;
+			}
+	}
+	std::string clipboard;
+	if (config.copyTilesAsJson)
+		clipboard = copyTilesJson(gnd, selection, center);
+	else
+		clipboard = copyTilesBinary(gnd, selection, center);
+	ImGui::SetClipboardText(clipboard.c_str());
+	std::cout << "Copied " << selection.size() << " tiles to clipboard, " << clipboard.size() << " bytes in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << "ms" << std::endl;
 }
 void BrowEdit::copyGat()
 {
@@ -828,50 +1071,170 @@ void BrowEdit::copyGat()
 	}
 	ImGui::SetClipboardText(clipboard.dump(1).c_str());
 }
-void BrowEdit::pasteTiles()
+static void pasteTilesJson(const std::string& cb, Gnd* gnd, std::vector<CopyCube*>& newCubes)
 {
-	try
+	json clipboard = json::parse(cb);
+	bool lightmapSizeWarned = false;
+	if (clipboard.size() > 0)
 	{
-		auto c = ImGui::GetClipboardText();
-		if (c == nullptr)
-			return;
-		std::string cb = c;
-		if (cb == "")
-			return;
-		json clipboard = json::parse(cb);
-		pasteData = clipboard; //TODO: don't make a copy
-		if (clipboard.size() > 0)
+		for (auto jsonCube : clipboard["cubes"])
 		{
-			for (auto jsonCube : clipboard["cubes"])
+			auto cube = new CopyCube();
+			from_json(jsonCube, *cube);
+			for (int i = 0; i < 3; i++)
 			{
-				auto cube = new CopyCube();
-				from_json(jsonCube, *cube);
-				for (int i = 0; i < 3; i++)
+				if (cube->tileIds[i] > -1)
 				{
-					if (cube->tileIds[i] > -1)
-					{
-						try {
-							from_json(clipboard["tiles"][std::to_string(cube->tileIds[i])], cube->tile[i]);
-							if (cube->tile[i].lightmapIndex > -1)
+					try {
+						from_json(clipboard["tiles"][std::to_string(cube->tileIds[i])], cube->tile[i]);
+						if (cube->tile[i].lightmapIndex > -1)
+						{
+							cube->lightmap[i].gnd = gnd;
+							from_json(clipboard["lightmaps"][std::to_string(cube->tile[i].lightmapIndex)], cube->lightmap[i]);
+							if (cube->lightmap[i].width != gnd->lightmapWidth || cube->lightmap[i].height != gnd->lightmapHeight)
 							{
-								cube->lightmap[i].gnd = activeMapView->map->rootNode->getComponent<Gnd>();
-								from_json(clipboard["lightmaps"][std::to_string(cube->tile[i].lightmapIndex)], cube->lightmap[i]);
+								if (!lightmapSizeWarned)
+									std::cerr << "Lightmap resolution on clipboard (" << cube->lightmap[i].width << "x" << cube->lightmap[i].height << ") does not match the map, not pasting lightmaps" << std::endl;
+								lightmapSizeWarned = true;
+								delete[] cube->lightmap[i].data;
+								cube->lightmap[i].data = nullptr;
+								cube->tile[i].lightmapIndex = -1;
 							}
-							if (cube->tile[i].textureIndex > -1)
-								from_json(clipboard["textures"][std::to_string(cube->tile[i].textureIndex)], cube->texture[i]);
-						}
-						catch (const std::exception &ex)
-						{
-							std::cout << ex.what() << std::endl;
-							cube->tile[i].textureIndex = 0;
-							cube->tile[i].lightmapIndex = 0; //wtf
 						}
+						if (cube->tile[i].textureIndex > -1)
+							from_json(clipboard["textures"][std::to_string(cube->tile[i].textureIndex)], cube->texture[i]);
+					}
+					catch (const std::exception &ex)
+					{
+						std::cout << ex.what() << std::endl;
+						cube->tile[i].textureIndex = 0;
+						cube->tile[i].lightmapIndex = 0; //wtf
 					}
 				}
-				newCubes.push_back(cube); //only used here, so when pasting it's safe to assume tile[i] has been filled
 			}
+			newCubes.push_back(cube); //only used here, so when pasting it's safe to assume tile[i] has been filled
 		}
 	}
+}
+
+static void pasteTilesBinary(const std::string& cb, Gnd* gnd, std::vector<CopyCube*>& newCubes)
+{
+	auto envelopeData = util::base64Decode(cb.substr(tileClipboardHeader.size()));
+	util::ByteReader envelope(envelopeData);
+	int version = envelope.read<int>();
+	if (version > tileClipboardVersion)
+		throw std::runtime_error("Clipboard data was made by a newer version of browedit");
+	int flags = envelope.read<int>();
+	unsigned int bodySize = envelope.read<unsigned int>();
+	std::vector<char> bodyData;
+	if ((flags & TileClipboardCompressed) != 0)
+	{
+		if (bodySize > 1024 * 1024 * 1024)
+			throw std::runtime_error("Clipboard data too large");
+		bodyData = util::decompress(envelope.ptr(), envelope.remaining(), bodySize);
+	}
+	else
+		bodyData.assign(envelope.ptr(), envelope.ptr() + envelope.remaining());
+	util::ByteReader body(bodyData);
+
+	int lightmapWidth = body.read<int>();
+	int lightmapHeight = body.read<int>();
+	int cubeCount = body.read<int>();
+	if (cubeCount < 0)
+		throw std::runtime_error("Invalid cube count in clipboard");
+	std::vector<glm::ivec2> positions;
+	std::vector<glm::vec4> heights;
+	std::vector<glm::ivec3> tileIds;
+	std::vector<glm::vec3> normals;
+	body.readArray(positions, cubeCount);
+	body.readArray(heights, cubeCount);
+	body.readArray(tileIds, cubeCount);
+	body.readArray(normals, cubeCount * (std::size_t)5);
+
+	std::vector<TileClipboardTile> tiles;
+	body.readArray(tiles, body.read<int>());
+	int textureCount = body.read<int>();
+	if (textureCount < 0 || (std::size_t)textureCount > body.remaining() / 8)
+		throw std::runtime_error("Invalid texture count in clipboard");
+	std::vector<Gnd::Texture> textures(textureCount);
+	for (auto& t : textures)
+	{
+		t.file = body.readStringDyn();
+		t.name = body.readStringDyn();
+	}
+	int lightmapCount = body.read<int>();
+	const std::size_t lightmapSize = (std::size_t)lightmapWidth * lightmapHeight * 4;
+	if (lightmapCount < 0 || lightmapWidth < 0 || lightmapHeight < 0 || (lightmapSize > 0 && (std::size_t)lightmapCount > body.remaining() / lightmapSize))
+		throw std::runtime_error("Invalid lightmaps in clipboard");
+	const char* lightmaps = body.ptr();
+	bool lightmapSizeMatches = lightmapWidth == gnd->lightmapWidth && lightmapHeight == gnd->lightmapHeight;
+	if (!lightmapSizeMatches)
+		std::cerr << "Lightmap resolution on clipboard (" << lightmapWidth << "x" << lightmapHeight << ") does not match the map, not pasting lightmaps" << std::endl;
+
+	newCubes.reserve(newCubes.size() + cubeCount);
+	for (int c = 0; c < cubeCount; c++)
+	{
+		auto cube = new CopyCube();
+		cube->pos = positions[c];
+		for (int i = 0; i < 4; i++)
+			cube->heights[i] = heights[c][i];
+		cube->normal = normals[c * 5];
+		for (int i = 0; i < 4; i++)
+			cube->normals[i] = normals[c * 5 + 1 + i];
+		for (int i = 0; i < 3; i++)
+		{
+			cube->tileIds[i] = tileIds[c][i];
+			if (cube->tileIds[i] < 0)
+				continue;
+			if (cube->tileIds[i] >= (int)tiles.size())
+			{
+				delete cube;
+				throw std::runtime_error("Invalid tile index in clipboard");
+			}
+			const auto& t = tiles[cube->tileIds[i]];
+			for (int ii = 0; ii < 4; ii++)
+				cube->tile[i].texCoords[ii] = t.texCoords[ii];
+			cube->tile[i].color = glm::ivec4(t.color[0], t.color[1], t.color[2], t.color[3]);
+			cube->tile[i].textureIndex = -1;
+			if (t.texture > -1 && t.texture < (int)textures.size())
+			{
+				cube->tile[i].textureIndex = (short)t.texture;
+				cube->texture[i] = textures[t.texture];
+			}
+			cube->tile[i].lightmapIndex = -1;
+			if (lightmapSizeMatches && t.lightmap > -1 && t.lightmap < lightmapCount)
+			{
+				cube->tile[i].lightmapIndex = t.lightmap;
+				cube->lightmap[i].gnd = gnd;
+				cube->lightmap[i].width = lightmapWidth;
+				cube->lightmap[i].height = lightmapHeight;
+				cube->lightmap[i].data = new unsigned char[lightmapSize];
+				memcpy(cube->lightmap[i].data, lightmaps + t.lightmap * lightmapSize, lightmapSize);
+			}
+		}
+		newCubes.push_back(cube);
+	}
+}
+
+void BrowEdit::pasteTiles()
+{
+	try
+	{
+		auto c = ImGui::GetClipboardText();
+		if (c == nullptr)
+			return;
+		std::string cb = c;
+		if (cb == "")
+			return;
+		auto start = std::chrono::steady_clock::now();
+		auto gnd = activeMapView->map->rootNode->getComponent<Gnd>();
+		std::size_t count = newCubes.size();
+		if (cb.compare(0, tileClipboardHeader.size(), tileClipboardHeader) == 0)
+			pasteTilesBinary(cb, gnd, newCubes);
+		else
+			pasteTilesJson(cb, gnd, newCubes);
+		std::cout << "Read " << (newCubes.size() - count) << " tiles from clipboard in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << "ms" << std::endl;
+	}
 	catch (const std::exception &e)
 	{
 		std::cerr << e.what() << std::endl;
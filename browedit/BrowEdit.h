@@ -6,10 +6,12 @@
 #include <imgui.h>
 #include <string_view>
 #include <mutex>
+#include <future>
 #include <browedit/util/FileIO.h>
 #include <browedit/components/Gnd.h>
 #include <browedit/components/Gat.h>
 #include <browedit/ModelEditor.h>
+#include <browedit/AssetReloader.h>
 class Action;
 class Lightmapper;
 using json = nlohmann::json;
@@ -103,6 +105,7 @@ public:
 	gl::Texture* iconsTexture;
 	gl::Texture* gatTexture;
 	Lightmapper* lightmapper = nullptr;
+	AssetReloader assetReloader;
 
 	struct WindowData
 	{
@@ -149,6 +152,8 @@ public:
 		std::string objectWindowScrollToModel;
 
 		bool demoWindowVisible = false;
+		bool profilerVisible = false;
+		bool memoryVisible = false;
 
 		bool hotkeyEditWindowVisible = false;
 		std::map<std::string, Hotkey> hotkeys;
@@ -262,7 +267,6 @@ public:
 	std::vector<CopyCube*> newCubes;
 	std::vector<CopyCubeGat*> newGatCubes;
 	int pasteOptions = -1;
-	json pasteData;
 
 	MapView* activeMapView = nullptr;
 	float statusBarHeight = 10;
@@ -301,6 +305,17 @@ public:
 	void loadMap(const std::string file);
 	void saveMap(Map* map);
 	void saveAsMap(Map* map);
+	void saveMapFiles(Map* map, const std::string& rswName, const std::string& gndName, const std::string& gatName, const std::vector<std::pair<std::string, std::string>>& backups);
+	std::shared_future<bool> saveTask; //true when all files were written
+	class PendingSave
+	{
+	public:
+		Map* map;
+		unsigned int changeCount; //of the map when it was serialized
+		std::shared_future<bool> result;
+	};
+	std::vector<PendingSave> pendingSaves;
+	void updatePendingSaves();
 	void exportMap(Map* map);
 	void showMapWindow(MapView& map, float deltaTime);
 
@@ -314,7 +329,6 @@ public:
 	void showExportWindow();
 	void openWindow();
 	void showObjectTree();
-	void buildObjectTree(Node* node, Map* map);
 	void showObjectEditToolsWindow();
 	void showObjectProperties();
 	void showUndoWindow();
@@ -329,6 +343,8 @@ public:
 	void showHotkeyEditorWindow();
 	void showColorEditWindow();
 	void showCinematicModeWindow();
+	void showProfilerWindow();
+	void showMemoryWindow();
 
 	void copyTiles();
 	void copyGat();
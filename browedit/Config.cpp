@@ -179,6 +179,12 @@ bool Config::showWindow(BrowEdit* browEdit)
 
 		ImGui::DragFloat("Field of View", &fov, 0.1f, 1.0f, 180.0f);
 		ImGui::DragFloat("Camera Mouse Speed", &cameraMouseSpeed, 0.05f, 0.01f, 3.0f);
+		ImGui::Checkbox("Don't draw objects outside of the view", &culling);
+		ImGui::DragFloat("Minimum object size on screen", &cullScreenSize, 0.001f, 0.0f, 0.1f);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Objects and icons that are smaller than this, relative to the height of the view, are not drawn. 0 to always draw them");
+		ImGui::Checkbox("Reload textures and models when their files change", &hotReloadWatch);
+		ImGui::DragInt("Check for changed files every (seconds)", &hotReloadInterval, 1, 1, 60);
 
 		if (ImGui::Combo("Skin", &style, "Dark\0Light\0Classic\0Tarq\0"))
 		{
@@ -215,6 +221,7 @@ bool Config::showWindow(BrowEdit* browEdit)
 
 		ImGui::Checkbox("Save a backup of maps when saving", &backup);
 		ImGui::Checkbox("Recalculate quadtree on save", &recalculateQuadtreeOnSave);
+		ImGui::Checkbox("Copy tiles as json (slow, but readable)", &copyTilesAsJson);
 
 		ImGui::Text("Grid Sizes");
 		if (ImGui::BeginListBox("Translate Grid Sizes"))
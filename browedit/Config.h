@@ -51,6 +51,15 @@ public:
 	float toolbarHeight() { return toolbarButtonSize + 8; }
 	int lightmapperThreadCount = 4;
 	int lightmapperRefreshTimer = 2;
+	bool lightmapperAdaptive = false; //only supersample lumels where the light changes
+	float lightmapperMaxError = 2.0f; //difference in the corners of a lumel before it's supersampled, 0-255
+	bool lightmapperCompare = false; //also does full supersampling to report the error of adaptive mode
+	bool copyTilesAsJson = false;
+	bool culling = true;
+	float cullScreenSize = 0.01f;
+	std::map<std::string, int> memoryBudgets; //in MB, per memory tracker tag
+	bool hotReloadWatch = false; //reload textures and models when their files change
+	int hotReloadInterval = 2; //in seconds
 	std::string isValid() const;
 	bool showWindow(BrowEdit* browEdit);
 	void setupFileIO();
@@ -86,5 +95,14 @@ public:
 		colorPresets,
 		ffmpegPath,
 		lightmapperThreadCount,
-		lightmapperRefreshTimer);
+		lightmapperRefreshTimer,
+		lightmapperAdaptive,
+		lightmapperMaxError,
+		lightmapperCompare,
+		copyTilesAsJson,
+		culling,
+		cullScreenSize,
+		memoryBudgets,
+		hotReloadWatch,
+		hotReloadInterval);
 };
\ No newline at end of file
@@ -45,17 +45,8 @@ void BrowEdit::registerActions()
 	HotkeyRegistry::registerAction(HotkeyAction::Global_Redo,			[this]() { activeMapView->map->redo(this); }, hasActiveMapView);
 
 	HotkeyRegistry::registerAction(HotkeyAction::Global_Settings,		[this]() { windowData.configVisible = true; });
-	HotkeyRegistry::registerAction(HotkeyAction::Global_ReloadTextures, [this]() { for (auto t : util::ResourceManager<gl::Texture>::getAll()) { t->reload(); } });
-	HotkeyRegistry::registerAction(HotkeyAction::Global_ReloadModels,	[this]() { 
-		for (auto rsm : util::ResourceManager<Rsm>::getAll())
-			rsm->reload();
-		for (auto m : maps)
-			m->rootNode->traverse([](Node* n) {
-			auto rsmRenderer = n->getComponent<RsmRenderer>();
-			if (rsmRenderer)
-				rsmRenderer->begin();
-				});
-		});
+	HotkeyRegistry::registerAction(HotkeyAction::Global_ReloadTextures, [this]() { assetReloader.begin(true, false, true); });
+	HotkeyRegistry::registerAction(HotkeyAction::Global_ReloadModels,	[this]() { assetReloader.begin(false, true, true); });
 	HotkeyRegistry::registerAction(HotkeyAction::Global_CloseTab,				[this]() { activeMapView->opened = false; }, hasActiveMapView);
 	HotkeyRegistry::registerAction(HotkeyAction::Global_ModelEditor_Open,		[this]() { modelEditor.opened = !modelEditor.opened; });
 	HotkeyRegistry::registerAction(HotkeyAction::Global_Copy, [this]() {
@@ -44,10 +44,31 @@ void Lightmapper::begin()
 
 	setProgressText("Cleaning tiles");
 	gnd->cleanTiles();
-	setProgressText("Making lightmaps unique");
-	std::cout << "Before:\t" << gnd->tiles.size() << " tiles, " << gnd->lightmaps.size() << " lightmaps" << std::endl;
-	gnd->makeLightmapsUnique();
-	std::cout << "After:\t" << gnd->tiles.size() << " tiles, " << gnd->lightmaps.size() << " lightmaps" << std::endl;
+	setProgressText("Preparing lightmaps");
+	std::cout << "Before:\t" << gnd->tiles.size() << " tiles, " << gnd->lightmaps.size() << " lightmaps, " << gnd->lightmapMemoryUsage() / 1024 << " KB" << std::endl;
+	lightmapMemoryBefore = gnd->lightmapMemoryUsage();
+	//only the tiles that are calculated get their own lightmap, shared lightmaps are copied on write
+	auto& settings = rsw->lightmapSettings;
+	gnd->makeTilesUnique();
+	gnd->countLightmapRefs();
+	for (int x = settings.rangeX[0]; x < settings.rangeX[1]; x++)
+		for (int y = settings.rangeY[0]; y < settings.rangeY[1]; y++)
+		{
+			if (settings.heightSelectionOnly && std::find(map->tileSelection.begin(), map->tileSelection.end(), glm::ivec2(x, y)) == map->tileSelection.end())
+				continue;
+			for (int i = 0; i < 3; i++)
+				if (gnd->cubes[x][y]->tileIds[i] != -1)
+					gnd->getWritableLightmap(gnd->tiles[gnd->cubes[x][y]->tileIds[i]]);
+		}
+	std::cout << "After:\t" << gnd->tiles.size() << " tiles, " << gnd->lightmaps.size() << " lightmaps, " << gnd->lightmapMemoryUsage() / 1024 << " KB" << std::endl;
+	tilesCalculated = 0;
+	samplesCalculated = 0;
+	lumelsCalculated = 0;
+	lumelsRefined = 0;
+	compareSquaredError = 0;
+	shadowRayTests = 0;
+	occluderCacheHits = 0;
+	occluderCacheLookups = 0;
 	map->rootNode->getComponent<GndRenderer>()->setChunksDirty();
 
 	map->rootNode->getComponent<GndRenderer>()->gndShadowDirty = true;
@@ -172,9 +193,12 @@ void Lightmapper::run()
 	{
 		threads.push_back(std::thread([&, t]()
 			{
+				OccluderCache cache;
+				cache.lastOccluder.resize(lights.size(), nullptr);
 				for (int x; (x = finishedX++) < settings.rangeX[1] && running;)
 				{
 					std::cout << "Row " << x << std::endl;
+					cache.clear(); //rows are handed out to any thread, so the last occluder of the previous row is far away
 
 					progressMutex.lock();
 					browEdit->windowData.progressWindowProgres = x / (float)gnd->width;
@@ -188,9 +212,15 @@ void Lightmapper::run()
 
 						for (int i = 0; i < 3; i++)
 							if (cube->tileIds[i] != -1)
-								calcPos(i, cube->tileIds[i], x, y);
+							{
+								calcPos(i, cube->tileIds[i], x, y, cache);
+								tilesCalculated++;
+							}
 					}
 				}
+				shadowRayTests += cache.rayTests;
+				occluderCacheHits += cache.hits;
+				occluderCacheLookups += cache.lookups;
 				std::cout << "Thread " << t << " finished" << std::endl;
 				finishedThreadCount++;
 			}));
@@ -212,7 +242,7 @@ bool Lightmapper::collidesMap(const math::Ray& ray, float maxDistance)
 };
 
 
-std::pair<glm::vec3, int> Lightmapper::calculateLight(const glm::vec3& groundPos, const glm::vec3& normal)
+std::pair<glm::vec3, int> Lightmapper::calculateLight(const glm::vec3& groundPos, const glm::vec3& normal, OccluderCache& cache)
 {
 	int intensity = 0;
 	glm::vec3 colorInc(0.0f);
@@ -222,8 +252,9 @@ std::pair<glm::vec3, int> Lightmapper::calculateLight(const glm::vec3& groundPos
 	if (rsw->light.lightmapAmbient > 0)
 		intensity = (int)(rsw->light.lightmapAmbient * 255);
 
-	for (auto light : lights)
+	for (std::size_t lightIndex = 0; lightIndex < lights.size(); lightIndex++)
 	{
+		auto light = lights[lightIndex];
 		auto rswObject = light->getComponent<RswObject>();
 		auto rswLight = light->getComponent<RswLight>();
 		if (!rswLight->enabled)
@@ -292,22 +323,42 @@ std::pair<glm::vec3, int> Lightmapper::calculateLight(const glm::vec3& groundPos
 			math::Ray ray(groundPos, lightDirection2);
 			if (rswLight->givesShadow && attenuation > 0)
 			{
+				Node*& lastOccluder = cache.lastOccluder[lightIndex];
+				auto collidesModel = [&](Node* n)
+				{
+					cache.rayTests++;
+					if (!n->getComponent<RswModelCollider>()->collidesTexture(ray, 0, distance - rswLight->minShadowDistance))
+						return false;
+					collides = true;
+					shadowStrength += n->getComponent<RswModel>()->shadowStrength;
+					return true;
+				};
+				Node* cached = lastOccluder;
+				if (cached)
+				{
+					cache.lookups++;
+					if (collidesModel(cached))
+						cache.hits++;
+					else
+						lastOccluder = nullptr;
+				}
 				for(auto& n : models) {
 					if (collides && shadowStrength >= 1)
+						break;
+					if (n == cached)
 						continue;
-					auto rswModel = n->getComponent<RswModel>();
-					auto collider = n->getComponent<RswModelCollider>();
-					if (collider->collidesTexture(ray, 0, distance- rswLight->minShadowDistance))
-					{
-						collides = true;
-						shadowStrength += rswModel->shadowStrength;
-					}
+					if (collidesModel(n))
+						lastOccluder = n;
 				}
 			}
-			if (!collides && shadowStrength < 1 && collidesMap(math::Ray(groundPos, lightDirection2), distance))
+			if (!collides && shadowStrength < 1)
 			{
-				collides = true;
-				shadowStrength = 1;
+				cache.rayTests++;
+				if (collidesMap(math::Ray(groundPos, lightDirection2), distance))
+				{
+					collides = true;
+					shadowStrength = 1;
+				}
 			}
 		}
 		if (shadowStrength > 1)
@@ -347,7 +398,7 @@ bool TriangleContainsPoint(const glm::vec2 &a, const glm::vec2& b, const glm::ve
 }
 
 
-void Lightmapper::calcPos(int direction, int tileId, int x, int y)
+void Lightmapper::calcPos(int direction, int tileId, int x, int y, OccluderCache& cache)
 {
 	auto rsw = map->rootNode->getComponent<Rsw>();
 	auto& settings = rsw->lightmapSettings;
@@ -363,112 +414,200 @@ void Lightmapper::calcPos(int direction, int tileId, int x, int y)
 	Gnd::Lightmap* lightmap = gnd->lightmaps[tile->lightmapIndex];
 
 	Gnd::Cube* cube = gnd->cubes[x][y];
+	std::int64_t samples = 0;
 
-	for (int xx = 1; xx < gnd->lightmapWidth - 1; xx++)
+	//light at a point on the tile, in lumel coordinates
+	auto sample = [&](float lx, float ly)
 	{
-		for (int yy = 1; yy < gnd->lightmapHeight - 1; yy++)
+		glm::vec3 groundPos(0,0,0);
+		glm::vec3 normal(0,1,0);
+
+		if (direction == 0)
 		{
-			glm::vec3 totalColor(0.0f);
-			int totalIntensity = 0;
-			int count = 0;
-			for (float xxx = 0; xxx < 1; xxx += qualityStep)
-			{
-				for (float yyy = 0; yyy < 1; yyy += qualityStep)
-				{
-					if (!running)
-						return;
-					glm::vec3 groundPos(0,0,0);
-					glm::vec3 normal(0,1,0);
+			glm::vec2 v1((x + 0) * 10, 10 * height - (y + 1) * 10 + 10);//1 , -cube->heights[2]
+			glm::vec2 v2((x + 0) * 10, 10 * height - (y + 0) * 10 + 10);//2 , -cube->heights[0]
+			glm::vec2 v3((x + 1) * 10, 10 * height - (y + 0) * 10 + 10);//3 , -cube->heights[1]
+			glm::vec2 v4((x + 1) * 10, 10 * height - (y + 1) * 10 + 10);//4 , -cube->heights[3]
+			glm::vec2 p(10 * x + sx * (lx - 1), 10 * height + 10 - 10 * y - sy * (ly - 1));
 
-					if (direction == 0)
-					{
-						glm::vec2 v1((x + 0) * 10, 10 * height - (y + 1) * 10 + 10);//1 , -cube->heights[2]
-						glm::vec2 v2((x + 0) * 10, 10 * height - (y + 0) * 10 + 10);//2 , -cube->heights[0]
-						glm::vec2 v3((x + 1) * 10, 10 * height - (y + 0) * 10 + 10);//3 , -cube->heights[1]
-						glm::vec2 v4((x + 1) * 10, 10 * height - (y + 1) * 10 + 10);//4 , -cube->heights[3]
-						glm::vec2 p(10 * x + sx * ((xx + xxx) - 1), 10 * height + 10 - 10 * y - sy * ((yy + yyy) - 1));
-
-						float h = (v1.y + v2.y + v3.y + v4.y) / 4.0f;
-
-						if (TriangleContainsPoint(v1, v2, v3, p))
-						{
-							float u, v, w;
-							TriangleBarycentricCoords(v1, v2, v3, p, u, v, w);
-							h = u * -cube->heights[2] + v * -cube->heights[0] + w * -cube->heights[1];
-							normal = u * cube->normals[2] + v * cube->normals[0] + w * cube->normals[1];
-						}
-						else if (TriangleContainsPoint(v3, v4, v1, p))
-						{
-							float u, v, w;
-							TriangleBarycentricCoords(v3, v4, v1, p, u, v, w);
-							h = u * -cube->heights[1] + v * -cube->heights[3] + w * -cube->heights[2];
-							normal = u * cube->normals[1] + v * cube->normals[3] + w * cube->normals[2];
-						}
-						else
-						{
-							std::cout << "uhoh";
-						}
-						normal.y *= -1;
-						normal = glm::normalize(normal);
-						groundPos = glm::vec3(p.x, h, p.y);
-					}
-					else if (direction == 1 && y < gnd->height - 1) //side
-					{
-						auto otherCube = gnd->cubes[x][y + 1];
-						float h1 = glm::mix(cube->h3, cube->h4, ((xx + xxx) - 1) / 6.0f);
-						float h2 = glm::mix(otherCube->h1, otherCube->h2, ((xx + xxx) - 1) / 6.0f);
-						float h = glm::mix(h1, h2, ((yy + yyy) - 1) / 6.0f);
+			float h = (v1.y + v2.y + v3.y + v4.y) / 4.0f;
 
-						groundPos = glm::vec3(10 * x + sx * ((xx + xxx) - 1), -h, 10 * height - 10 * y);
-						normal = glm::vec3(0, 0, 1);
+			if (TriangleContainsPoint(v1, v2, v3, p))
+			{
+				float u, v, w;
+				TriangleBarycentricCoords(v1, v2, v3, p, u, v, w);
+				h = u * -cube->heights[2] + v * -cube->heights[0] + w * -cube->heights[1];
+				normal = u * cube->normals[2] + v * cube->normals[0] + w * cube->normals[1];
+			}
+			else if (TriangleContainsPoint(v3, v4, v1, p))
+			{
+				float u, v, w;
+				TriangleBarycentricCoords(v3, v4, v1, p, u, v, w);
+				h = u * -cube->heights[1] + v * -cube->heights[3] + w * -cube->heights[2];
+				normal = u * cube->normals[1] + v * cube->normals[3] + w * cube->normals[2];
+			}
+			else
+			{
+				std::cout << "uhoh";
+			}
+			normal.y *= -1;
+			normal = glm::normalize(normal);
+			groundPos = glm::vec3(p.x, h, p.y);
+		}
+		else if (direction == 1 && y < gnd->height - 1) //side
+		{
+			auto otherCube = gnd->cubes[x][y + 1];
+			float h1 = glm::mix(cube->h3, cube->h4, (lx - 1) / 6.0f);
+			float h2 = glm::mix(otherCube->h1, otherCube->h2, (lx - 1) / 6.0f);
+			float h = glm::mix(h1, h2, (ly - 1) / 6.0f);
 
-						if (h1 < h2)
-							normal = -normal;
+			groundPos = glm::vec3(10 * x + sx * (lx - 1), -h, 10 * height - 10 * y);
+			normal = glm::vec3(0, 0, 1);
 
-					}
-					else if (direction == 2 && x < gnd->width - 1) //front
-					{
-						auto otherCube = gnd->cubes[x + 1][y];
-						float h1 = glm::mix(cube->h4, cube->h2, ((xx + xxx) - 1) / 6.0f);
-						float h2 = glm::mix(otherCube->h3, otherCube->h1, ((xx + xxx) - 1) / 6.0f);
-						float h = glm::mix(h1, h2, ((yy + yyy) - 1) / 6.0f);
+			if (h1 < h2)
+				normal = -normal;
 
-						groundPos = glm::vec3(10 * x + 10, -h, 10 * height - 10 * y + sy * ((xx + xxx) - 1));
-						normal = glm::vec3(-1, 0, 0);
+		}
+		else if (direction == 2 && x < gnd->width - 1) //front
+		{
+			auto otherCube = gnd->cubes[x + 1][y];
+			float h1 = glm::mix(cube->h4, cube->h2, (lx - 1) / 6.0f);
+			float h2 = glm::mix(otherCube->h3, otherCube->h1, (lx - 1) / 6.0f);
+			float h = glm::mix(h1, h2, (ly - 1) / 6.0f);
 
-						if (h1 < h2)
-							normal = -normal;
-					}
-					else
-						throw "wtf";
-					if (buildDebugPoints)
-					{
-						debugPointMutex.lock();
-						debugPoints[1].push_back(groundPos);
-						debugPointMutex.unlock();
-					}
+			groundPos = glm::vec3(10 * x + 10, -h, 10 * height - 10 * y + sy * (lx - 1));
+			normal = glm::vec3(-1, 0, 0);
 
-					auto light = calculateLight(groundPos, normal);
-					totalIntensity += glm::min(255, light.second);
-					totalColor += glm::min(glm::vec3(1.0f, 1.0f, 1.0f), light.first);
-					count++;
-				}
+			if (h1 < h2)
+				normal = -normal;
+		}
+		else
+			throw "wtf";
+		if (buildDebugPoints)
+		{
+			debugPointMutex.lock();
+			debugPoints[1].push_back(groundPos);
+			debugPointMutex.unlock();
+		}
+
+		auto light = calculateLight(groundPos, normal, cache);
+		samples++;
+		return std::pair<glm::vec3, int>(glm::min(glm::vec3(1.0f, 1.0f, 1.0f), light.first), glm::min(255, light.second));
+	};
+	//full supersampling of a lumel, quality*quality samples
+	auto supersample = [&](int xx, int yy)
+	{
+		glm::vec3 totalColor(0.0f);
+		int totalIntensity = 0;
+		int count = 0;
+		for (float xxx = 0; xxx < 1; xxx += qualityStep)
+		{
+			for (float yyy = 0; yyy < 1; yyy += qualityStep)
+			{
+				auto light = sample(xx + xxx, yy + yyy);
+				totalIntensity += light.second;
+				totalColor += light.first;
+				count++;
 			}
+		}
+		return std::pair<glm::vec3, int>(totalColor / (float)count, totalIntensity / count);
+	};
+	auto store = [&](int xx, int yy, const std::pair<glm::vec3, int>& light)
+	{
+		int intensity = glm::clamp(light.second, 0, 255);
+		glm::vec3 color = light.first;
 
-			int intensity = totalIntensity / count;
-			if (intensity > 255)
-				intensity = 255;
-			if (intensity < 0)
-				intensity = 0;
+		lightmap->data[xx + gnd->lightmapWidth * yy] = intensity;
+		lightmap->data[gnd->lightmapOffset() + 3 * (xx + gnd->lightmapWidth * yy) + 0] = glm::min(255, (int)(color.r * 255));
+		lightmap->data[gnd->lightmapOffset() + 3 * (xx + gnd->lightmapWidth * yy) + 1] = glm::min(255, (int)(color.g * 255));
+		lightmap->data[gnd->lightmapOffset() + 3 * (xx + gnd->lightmapWidth * yy) + 2] = glm::min(255, (int)(color.b * 255));
+	};
 
-			glm::vec3 color = totalColor / (float)count;
+	if (!browEdit->config.lightmapperAdaptive || settings.quality <= 1)
+	{
+		for (int xx = 1; xx < gnd->lightmapWidth - 1; xx++)
+		{
+			for (int yy = 1; yy < gnd->lightmapHeight - 1; yy++)
+			{
+				if (!running)
+					return;
+				store(xx, yy, supersample(xx, yy));
+			}
+		}
+		samplesCalculated += samples;
+		lumelsCalculated += (gnd->lightmapWidth - 2) * (gnd->lightmapHeight - 2);
+		return;
+	}
 
-			lightmap->data[xx + gnd->lightmapWidth * yy] = intensity;
-			lightmap->data[gnd->lightmapOffset() + 3 * (xx + gnd->lightmapWidth * yy) + 0] = glm::min(255, (int)(color.r * 255));
-			lightmap->data[gnd->lightmapOffset() + 3 * (xx + gnd->lightmapWidth * yy) + 1] = glm::min(255, (int)(color.g * 255));
-			lightmap->data[gnd->lightmapOffset() + 3 * (xx + gnd->lightmapWidth * yy) + 2] = glm::min(255, (int)(color.b * 255));
+	//adaptive: the light is calculated on the corners of the lumels first, the corners are shared by the neighbouring lumels.
+	//Only lumels where the corners of the lumel or its neighbours differ more than the max error are supersampled,
+	//the neighbours are checked too to catch thin shadows that fall between the corners
+	const int cornersWidth = gnd->lightmapWidth - 1; //corners 1 to lightmapWidth-1
+	const int cornersHeight = gnd->lightmapHeight - 1;
+	std::vector<std::pair<glm::vec3, int>> corners(cornersWidth * cornersHeight);
+	for (int cx = 1; cx <= cornersWidth; cx++)
+	{
+		for (int cy = 1; cy <= cornersHeight; cy++)
+		{
+			if (!running)
+				return;
+			//the far edge is moved in a tiny bit, so it doesn't fall just outside of the tile because of rounding
+			corners[(cx - 1) + cornersWidth * (cy - 1)] = sample(cx == cornersWidth ? cx - 0.001f : (float)cx, cy == cornersHeight ? cy - 0.001f : (float)cy);
 		}
 	}
+	const float maxError = browEdit->config.lightmapperMaxError;
+	int refined = 0;
+	std::int64_t squaredError = 0;
+	for (int xx = 1; xx < gnd->lightmapWidth - 1; xx++)
+	{
+		for (int yy = 1; yy < gnd->lightmapHeight - 1; yy++)
+		{
+			if (!running)
+				return;
+			glm::vec4 minLight(999), maxLight(-999); //intensity and color, both 0-255
+			for (int cx = glm::max(1, xx - 1); cx <= glm::min(cornersWidth, xx + 2); cx++)
+			{
+				for (int cy = glm::max(1, yy - 1); cy <= glm::min(cornersHeight, yy + 2); cy++)
+				{
+					const auto& c = corners[(cx - 1) + cornersWidth * (cy - 1)];
+					glm::vec4 light((float)c.second, c.first * 255.0f);
+					minLight = glm::min(minLight, light);
+					maxLight = glm::max(maxLight, light);
+				}
+			}
+			glm::vec4 range = maxLight - minLight;
+			std::pair<glm::vec3, int> light;
+			if (glm::max(glm::max(range.x, range.y), glm::max(range.z, range.w)) > maxError)
+			{
+				light = supersample(xx, yy);
+				refined++;
+			}
+			else
+			{
+				const auto& c1 = corners[(xx - 1) + cornersWidth * (yy - 1)];
+				const auto& c2 = corners[(xx + 0) + cornersWidth * (yy - 1)];
+				const auto& c3 = corners[(xx - 1) + cornersWidth * (yy + 0)];
+				const auto& c4 = corners[(xx + 0) + cornersWidth * (yy + 0)];
+				light.first = (c1.first + c2.first + c3.first + c4.first) / 4.0f;
+				light.second = (c1.second + c2.second + c3.second + c4.second) / 4;
+				if (browEdit->config.lightmapperCompare)
+				{
+					std::int64_t before = samples;
+					auto full = supersample(xx, yy);
+					samples = before; //the comparison doesn't count as work
+					glm::ivec4 a(glm::clamp(light.second, 0, 255), glm::min(glm::ivec3(255), glm::ivec3(light.first * 255.0f)));
+					glm::ivec4 b(glm::clamp(full.second, 0, 255), glm::min(glm::ivec3(255), glm::ivec3(full.first * 255.0f)));
+					glm::ivec4 diff = a - b;
+					squaredError += diff.x * diff.x + diff.y * diff.y + diff.z * diff.z + diff.w * diff.w;
+				}
+			}
+			store(xx, yy, light);
+		}
+	}
+	samplesCalculated += samples;
+	lumelsCalculated += (gnd->lightmapWidth - 2) * (gnd->lightmapHeight - 2);
+	lumelsRefined += refined;
+	compareSquaredError += squaredError;
 };
 
 
@@ -476,9 +615,27 @@ void Lightmapper::calcPos(int direction, int tileId, int x, int y)
 void Lightmapper::onDone()
 {
 	std::cout << "Done!" << std::endl;
+	double bakeTime = ImGui::GetTime() - startTime;
 	gnd->makeLightmapBorders(browEdit);
 	gnd->cleanLightmaps();
 	gnd->cleanTiles();
+	std::cout << "Lightmapper: " << tilesCalculated << " tiles in " << bakeTime << " seconds, " << (int)(tilesCalculated / glm::max(bakeTime, 0.001)) << " tiles/s" << std::endl;
+	std::cout << "Lightmapper: " << gnd->lightmaps.size() << " lightmaps, " << gnd->lightmapMemoryUsage() / 1024 << " KB (was " << lightmapMemoryBefore / 1024 << " KB)" << std::endl;
+	auto& settings = map->rootNode->getComponent<Rsw>()->lightmapSettings;
+	std::int64_t fullSamples = lumelsCalculated * settings.quality * settings.quality;
+	std::cout << "Lightmapper: " << samplesCalculated << " light samples for " << lumelsCalculated << " lumels, " << (100 * samplesCalculated / glm::max(fullSamples, (std::int64_t)1)) << "% of full supersampling";
+	if (browEdit->config.lightmapperAdaptive && settings.quality > 1)
+		std::cout << ", " << lumelsRefined << " lumels refined";
+	std::cout << std::endl;
+	std::cout << "Lightmapper: " << shadowRayTests << " shadow ray tests, last occluder cache hit " << occluderCacheHits << " of " << occluderCacheLookups << " times (" << (100 * occluderCacheHits / glm::max((std::int64_t)occluderCacheLookups, (std::int64_t)1)) << "%)" << std::endl;
+	if (browEdit->config.lightmapperAdaptive && browEdit->config.lightmapperCompare && settings.quality > 1 && lumelsCalculated > 0)
+	{
+		double mse = compareSquaredError / (4.0 * lumelsCalculated);
+		if (mse > 0)
+			std::cout << "Lightmapper: PSNR against full supersampling " << 10 * glm::log(255.0 * 255.0 / mse) / glm::log(10.0) << " dB" << std::endl;
+		else
+			std::cout << "Lightmapper: identical to full supersampling" << std::endl;
+	}
 	map->rootNode->getComponent<GndRenderer>()->gndShadowDirty = true;
 	map->rootNode->getComponent<GndRenderer>()->setChunksDirty();
 	util::ResourceManager<Image>::clear();
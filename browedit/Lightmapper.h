@@ -1,8 +1,11 @@
 #pragma once
 
 #include <thread>
+#include <atomic>
 #include <vector>
+#include <algorithm>
 #include <string>
+#include <cstdint>
 #include <glm/glm.hpp>
 
 class Map;
@@ -13,12 +16,32 @@ class Node;
 namespace math { class Ray; }
 class Lightmapper
 {
+	//the model that blocked the last shadow ray of every light. Neighbouring lumels are usually blocked by the same model,
+	//so that one is tested first. Every thread has its own cache
+	class OccluderCache
+	{
+	public:
+		std::vector<Node*> lastOccluder; //by light index
+		std::int64_t rayTests = 0;
+		std::int64_t hits = 0; //rays that were blocked by the cached occluder
+		std::int64_t lookups = 0;
+		void clear() { std::fill(lastOccluder.begin(), lastOccluder.end(), nullptr); }
+	};
 	BrowEdit* browEdit;
 	Gnd* gnd;
 	Rsw* rsw;
 	std::vector<Node*> lights;
 	std::vector<Node*> models;
 	glm::vec3 lightDirection;
+	std::atomic<int> tilesCalculated = 0;
+	std::atomic<std::int64_t> samplesCalculated = 0; //calls to calculateLight
+	std::atomic<std::int64_t> lumelsCalculated = 0;
+	std::atomic<std::int64_t> lumelsRefined = 0; //lumels that were supersampled in adaptive mode
+	std::atomic<std::int64_t> compareSquaredError = 0; //against full supersampling, when config.lightmapperCompare is on
+	std::atomic<std::int64_t> shadowRayTests = 0;
+	std::atomic<std::int64_t> occluderCacheHits = 0;
+	std::atomic<std::int64_t> occluderCacheLookups = 0;
+	std::size_t lightmapMemoryBefore = 0;
 
 	std::thread mainThread;
 public:
@@ -33,8 +56,8 @@ private:
 	void onDone();
 
 	bool collidesMap(const math::Ray& ray, float maxDistance);
-	std::pair<glm::vec3, int> calculateLight(const glm::vec3& groundPos, const glm::vec3& normal);
-	void calcPos(int direction, int tileId, int x, int y);
+	std::pair<glm::vec3, int> calculateLight(const glm::vec3& groundPos, const glm::vec3& normal, OccluderCache& cache);
+	void calcPos(int direction, int tileId, int x, int y, OccluderCache& cache);
 
 	void setProgressText(const std::string& text);
 	void setProgress(float);
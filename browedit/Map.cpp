@@ -28,15 +28,18 @@ using json = nlohmann::json;
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <chrono>
 
 
 Map::Map(const std::string& name, BrowEdit* browEdit) : name(name)
 {
+	auto start = std::chrono::steady_clock::now();
 	rootNode = new Node(name);
 	auto rsw = new Rsw();
 	rootNode->addComponent(rsw);	
 	rsw->load(name, this, browEdit);
 	changed = false;
+	std::cout << "Map: loaded " << name << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << "ms, " << util::ResourceManager<Rsm>::count() << " models in memory" << std::endl;
 }
 
 Map::Map(const std::string& name, int width, int height, BrowEdit* browEdit) : name(name)
@@ -46,6 +49,7 @@ Map::Map(const std::string& name, int width, int height, BrowEdit* browEdit) : n
 	rootNode->addComponent(rsw);
 	rsw->newMap(name, width, height, this, browEdit);
 	changed = true;
+	changeCount++;
 }
 
 
@@ -116,12 +120,25 @@ void Map::doAction(Action* action, BrowEdit* browEdit)
 	}
 
 	changed = true;
+	changeCount++;
 	action->perform(this, browEdit);
 	undoStack.push_back(action);
 
 	for (auto a : redoStack)
 		delete a;
 	redoStack.clear();
+	updateUndoMemory();
+}
+
+//recounted from both stacks, actions can store more or less after they are performed or undone
+void Map::updateUndoMemory()
+{
+	std::size_t size = 0;
+	for (auto a : undoStack)
+		size += a->memoryUsage();
+	for (auto a : redoStack)
+		size += a->memoryUsage();
+	undoMemory.set(size);
 }
 
 void Map::redo(BrowEdit* browEdit)
@@ -131,6 +148,7 @@ void Map::redo(BrowEdit* browEdit)
 		redoStack.front()->perform(this, browEdit);
 		undoStack.push_back(redoStack.front());
 		redoStack.erase(redoStack.begin());
+		updateUndoMemory();
 	}
 }
 void Map::beginGroupAction(const std::string &title)
@@ -152,6 +170,7 @@ void Map::undo(BrowEdit* browEdit)
 		undoStack.back()->undo(this, browEdit);
 		redoStack.insert(redoStack.begin(), undoStack.back());
 		undoStack.pop_back();
+		updateUndoMemory();
 	}
 }
 
@@ -581,6 +600,8 @@ void Map::importShadowMap(BrowEdit* browEdit, bool exportWalls, bool exportBorde
 				dst[(x + tilePadding) + 8 * (y + tilePadding)] = src[(srcx + x) + w * (srcy + y)];
 	};
 	auto gnd = rootNode->getComponent<Gnd>();
+	gnd->makeTilesUnique();
+	gnd->countLightmapRefs();
 	int w, h,c;
 	unsigned char* img = stbi_load((browEdit->config.ropath + name + ".shadowmap.png").c_str(), &w, &h, &c, 1);
 	if (w != gnd->width * wallMultiplier * tileSize ||
@@ -599,16 +620,17 @@ void Map::importShadowMap(BrowEdit* browEdit, bool exportWalls, bool exportBorde
 			int yy = wallMultiplier * tileSize * y;
 
 			if (cube->tileUp > -1 && gnd->tiles[cube->tileUp]->lightmapIndex > -1)
-				shadowmapcpy(gnd->lightmaps[gnd->tiles[cube->tileUp]->lightmapIndex]->data, img, xx, yy, wallMultiplier * tileSize * gnd->width);
+				shadowmapcpy(gnd->getWritableLightmap(gnd->tiles[cube->tileUp])->data, img, xx, yy, wallMultiplier * tileSize * gnd->width);
 			if (exportWalls)
 			{
 				if (cube->tileSide > -1 && gnd->tiles[cube->tileSide]->lightmapIndex > -1)
-					shadowmapcpy(gnd->lightmaps[gnd->tiles[cube->tileSide]->lightmapIndex]->data, img, xx, yy + tileSize, wallMultiplier * tileSize * gnd->width);
+					shadowmapcpy(gnd->getWritableLightmap(gnd->tiles[cube->tileSide])->data, img, xx, yy + tileSize, wallMultiplier * tileSize * gnd->width);
 				if (cube->tileFront > -1 && gnd->tiles[cube->tileFront]->lightmapIndex > -1)
-					shadowmapcpy(gnd->lightmaps[gnd->tiles[cube->tileFront]->lightmapIndex]->data, img, xx + tileSize, yy, wallMultiplier * tileSize * gnd->width);
+					shadowmapcpy(gnd->getWritableLightmap(gnd->tiles[cube->tileFront])->data, img, xx + tileSize, yy, wallMultiplier * tileSize * gnd->width);
 			}
 		}
 	}
+	gnd->cleanLightmaps();
 	rootNode->getComponent<GndRenderer>()->gndShadowDirty = true;
 	stbi_image_free(img);
 }
@@ -679,7 +701,8 @@ void Map::importLightMap(BrowEdit* browEdit, bool exportWalls, bool exportBorder
 					dst[64 + ((x + tilePadding) + 8 * (y + tilePadding)) * 3 + c] = src[((srcx + x) + w * (srcy + y)) * 3 + c];
 	};
 	auto gnd = rootNode->getComponent<Gnd>();
-	gnd->makeLightmapsUnique();
+	gnd->makeTilesUnique();
+	gnd->countLightmapRefs();
 	int w, h, c;
 	unsigned char* img = stbi_load((browEdit->config.ropath + name + ".colormap.png").c_str(), &w, &h, &c, 3);
 	if (w != gnd->width * wallMultiplier*tileSize ||
@@ -698,37 +721,22 @@ void Map::importLightMap(BrowEdit* browEdit, bool exportWalls, bool exportBorder
 
 			if (cube->tileUp > -1)
 			{
-				if (gnd->tiles[cube->tileUp]->lightmapIndex == -1)
-				{
-					gnd->tiles[cube->tileUp]->lightmapIndex = (int)gnd->lightmaps.size();
-					gnd->lightmaps.push_back(new Gnd::Lightmap(gnd));
-				}
-				lightmapcpy(gnd->lightmaps[gnd->tiles[cube->tileUp]->lightmapIndex]->data, img, xx, yy, tileSize * wallMultiplier * gnd->width);
+				lightmapcpy(gnd->getWritableLightmap(gnd->tiles[cube->tileUp])->data, img, xx, yy, tileSize * wallMultiplier * gnd->width);
 			}
 			if (exportWalls)
 			{
 				if (cube->tileSide > -1)
 				{
-					if (gnd->tiles[cube->tileSide]->lightmapIndex == -1)
-					{
-						gnd->tiles[cube->tileSide]->lightmapIndex = (int)gnd->lightmaps.size();
-						gnd->lightmaps.push_back(new Gnd::Lightmap(gnd));
-					}
-					lightmapcpy(gnd->lightmaps[gnd->tiles[cube->tileSide]->lightmapIndex]->data, img, xx, yy + tileSize, tileSize * wallMultiplier * gnd->width);
+					lightmapcpy(gnd->getWritableLightmap(gnd->tiles[cube->tileSide])->data, img, xx, yy + tileSize, tileSize * wallMultiplier * gnd->width);
 				}
 				if (cube->tileFront > -1)
 				{
-					if (gnd->tiles[cube->tileFront]->lightmapIndex == -1)
-					{
-						gnd->tiles[cube->tileFront]->lightmapIndex = (int)gnd->lightmaps.size();
-						gnd->lightmaps.push_back(new Gnd::Lightmap(gnd));
-					}
-					lightmapcpy(gnd->lightmaps[gnd->tiles[cube->tileFront]->lightmapIndex]->data, img, xx + tileSize, yy, tileSize * wallMultiplier * gnd->width);
+					lightmapcpy(gnd->getWritableLightmap(gnd->tiles[cube->tileFront])->data, img, xx + tileSize, yy, tileSize * wallMultiplier * gnd->width);
 				}
 			}
 		}
 	}
-	gnd->makeLightmapsUnique();
+	gnd->cleanLightmaps();
 	rootNode->getComponent<GndRenderer>()->gndShadowDirty = true;
 
 	stbi_image_free(img);
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <browedit/gl/Shader.h>
+#include <browedit/util/MemoryTracker.h>
 class Node;
 class Action;
 class Rsw;
@@ -18,11 +19,13 @@ public:
 	Node* rootNode = nullptr;
 	std::vector<Action*> undoStack;
 	std::vector<Action*> redoStack;
+	util::TrackedMemory undoMemory{ "Undo history" };
 	std::vector<Node*> selectedNodes;
 	std::vector<glm::ivec2> tileSelection;
 	std::vector<glm::ivec2> gatSelection;
 
 	bool changed = false;
+	unsigned int changeCount = 0; //increased on every edit, so a save that finishes later knows if the map was edited while it was being written
 
 	std::vector<glm::ivec2> getSelectionAroundTiles();
 
@@ -36,6 +39,7 @@ public:
 	void doAction(Action* action, BrowEdit* browEdit);
 	void undo(BrowEdit* browEdit);
 	void redo(BrowEdit* browEdit);
+	void updateUndoMemory(); //call after changing undoStack or redoStack
 
 	GroupAction* tempGroupAction = nullptr;
 	void beginGroupAction(const std::string &title = "");
@@ -12,6 +12,7 @@
 #include <browedit/components/Gnd.h>
 #include <browedit/components/GndRenderer.h>
 #include <browedit/math/Polygon.h>
+#include <browedit/util/HeightField.h>
 #include <browedit/actions/GroupAction.h>
 #include <browedit/actions/TileSelectAction.h>
 #include <browedit/actions/CubeHeightChangeAction.h>
@@ -171,11 +172,11 @@ void MapView::postRenderHeightMode(BrowEdit* browEdit)
 					if ((browEdit->pasteOptions & PasteOptions::Colors) != 0)
 						newTile->color = cube->tile[i].color;
 					if ((browEdit->pasteOptions & PasteOptions::Lightmaps) != 0)
-					{ //TODO: check if cube->lightmap can be null?
-						auto lm = new Gnd::Lightmap(cube->lightmap[i]);
-						newTile->lightmapIndex = (int)gnd->lightmaps.size();
-						gnd->lightmaps.push_back(lm);
-						//TODO: check if the lightmap already exists on the map.. not super important if lightmap deduplication is done at saving
+					{ //the clipboard has no lightmap for tiles without one, or when the lightmap resolution didn't match this map
+						if (cube->tile[i].lightmapIndex < 0 || !cube->lightmap[i].data)
+							newTile->lightmapIndex = gnd->lightmaps.empty() ? -1 : 0;
+						else
+							newTile->lightmapIndex = gnd->addLightmap(cube->lightmap[i].data);
 					}
 
 
@@ -247,6 +248,7 @@ void MapView::postRenderHeightMode(BrowEdit* browEdit)
 	if (browEdit->heightDoodle && hovered)
 	{
 		static std::map<Gnd::Cube*, float[4]> originalHeights;
+		static glm::ivec2 doodleMin, doodleMax;
 
 		glm::vec2 tileHoveredOffset((mouse3D.x / 10) - tileHovered.x, tileHovered.y - (gnd->height - mouse3D.z / 10));
 		int index = 0;
@@ -288,6 +290,16 @@ void MapView::postRenderHeightMode(BrowEdit* browEdit)
 		ImGui::Text("Change Height, hold shift to lower, hold Ctrl to snap");
 		ImGui::End();
 
+		glm::ivec2 changedMin(gnd->width, gnd->height);
+		glm::ivec2 changedMax(-1);
+		if (originalHeights.empty())
+		{
+			doodleMin = changedMin;
+			doodleMax = changedMax;
+		}
+		glUseProgram(0);
+		glPointSize(10.0);
+		glBegin(GL_POINTS);
 		for (int x = 0; x <= browEdit->windowData.heightEdit.doodleSize; x++)
 		{
 			for (int y = 0; y <= browEdit->windowData.heightEdit.doodleSize; y++)
@@ -305,24 +317,29 @@ void MapView::postRenderHeightMode(BrowEdit* browEdit)
 						if (originalHeights.find(gnd->cubes[tt.x][tt.y]) == originalHeights.end())
 							for (int i = 0; i < 4; i++)
 								originalHeights[gnd->cubes[tt.x][tt.y]][i] = gnd->cubes[tt.x][tt.y]->heights[i];
+						changedMin = glm::min(changedMin, tt);
+						changedMax = glm::max(changedMax, tt);
 
 						if (ImGui::GetIO().KeyShift)
 							snapHeight = glm::min(minMax, snapHeight + browEdit->windowData.heightEdit.doodleSpeed * (glm::mix(1.0f, glm::max(0.0f, 1.0f - glm::length(glm::vec2(x - browEdit->windowData.heightEdit.doodleSize / 2.0f, y - browEdit->windowData.heightEdit.doodleSize / 2.0f))/ browEdit->windowData.heightEdit.doodleSize), browEdit->windowData.heightEdit.doodleHardness)));
 						else
 							snapHeight = glm::max(minMax, snapHeight - browEdit->windowData.heightEdit.doodleSpeed * (glm::mix(1.0f, glm::max(0.0f, 1.0f - glm::length(glm::vec2(x - browEdit->windowData.heightEdit.doodleSize / 2.0f, y - browEdit->windowData.heightEdit.doodleSize / 2.0f)) / browEdit->windowData.heightEdit.doodleSize), browEdit->windowData.heightEdit.doodleHardness)));
-						gnd->cubes[tt.x][tt.y]->calcNormal();
-						gndRenderer->setChunkDirty(tt.x, tt.y);
 					}
-					glUseProgram(0);
-					glPointSize(10.0);
-					glBegin(GL_POINTS);
 					glVertex3f(tt.x * 10.0f + ((ti % 2) == 1 ? 10.0f : 0.0f),
 						-snapHeight + 1,
 						(gnd->height - tt.y) * 10.0f + ((ti / 2) == 0 ? 10.0f : 0.0f));
-					glEnd();
 				}
 			}
 		}
+		glEnd();
+		if (changedMax.x >= changedMin.x)
+		{
+			//normals are only updated once per frame, for the area under the brush
+			gnd->recalculateNormals(changedMin, changedMax);
+			gndRenderer->setChunksDirty(changedMin - 1, changedMax + 1);
+			doodleMin = glm::min(doodleMin, changedMin);
+			doodleMax = glm::max(doodleMax, changedMax);
+		}
 
 		if (ImGui::IsMouseReleased(ImGuiMouseButton_Left))
 		{
@@ -333,7 +350,7 @@ void MapView::postRenderHeightMode(BrowEdit* browEdit)
 					for (int i = 0; i < 4; i++)
 						newHeights[kv.first][i] = kv.first->heights[i];
 
-				map->doAction(new CubeHeightChangeAction<Gnd, Gnd::Cube>(originalHeights, newHeights), browEdit);
+				map->doAction(new CubeHeightChangeAction<Gnd, Gnd::Cube>(originalHeights, newHeights, doodleMin, doodleMax), browEdit);
 			}
 			originalHeights.clear();
 		}
@@ -471,7 +488,8 @@ void MapView::postRenderHeightMode(BrowEdit* browEdit)
 					for (auto& t : originalValues)
 						for (int ii = 0; ii < 4; ii++)
 							newValues[t.first][ii] = t.first->heights[ii];
-					map->doAction(new CubeHeightChangeAction<Gnd, Gnd::Cube>(originalValues, newValues), browEdit);
+					util::HeightField selection(map->tileSelection, glm::ivec2(gnd->width, gnd->height), 1);
+					map->doAction(new CubeHeightChangeAction<Gnd, Gnd::Cube>(originalValues, newValues, selection.min, selection.max), browEdit);
 				}
 				else if (gadgetHeight[i].axisDragged)
 				{
@@ -561,7 +579,9 @@ void MapView::postRenderHeightMode(BrowEdit* browEdit)
 					}
 
 					std::vector<glm::ivec2> tilesAround;
-					auto isTileSelected = [&](int x, int y) { return std::find(map->tileSelection.begin(), map->tileSelection.end(), glm::ivec2(x, y)) != map->tileSelection.end(); };
+					util::HeightField selection(map->tileSelection, glm::ivec2(gnd->width, gnd->height), 1);
+					std::vector<std::uint8_t> isTileAround(selection.mask.size(), 0);
+					auto isTileSelected = [&](int x, int y) { return selection.selected(x, y); };
 
 					for (auto& t : map->tileSelection)
 					{
@@ -591,9 +611,12 @@ void MapView::postRenderHeightMode(BrowEdit* browEdit)
 								for (int xx = -1; xx <= 1; xx++)
 									for (int yy = -1; yy <= 1; yy++)
 										if (t.x + xx >= 0 && t.x + xx < gnd->width && t.y + yy >= 0 && t.y + yy < gnd->height &&
-											std::find(tilesAround.begin(), tilesAround.end(), glm::ivec2(t.x + xx, t.y + yy)) == tilesAround.end() &&
+											!isTileAround[selection.index(t.x + xx, t.y + yy)] &&
 											!isTileSelected(t.x+xx, t.y+yy))
+										{
+											isTileAround[selection.index(t.x + xx, t.y + yy)] = 1;
 											tilesAround.push_back(glm::ivec2(t.x + xx, t.y + yy));
+										}
 							}
 						}
 						gnd->cubes[t.x][t.y]->calcNormal();
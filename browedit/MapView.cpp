@@ -54,7 +54,6 @@ MapView::MapView(Map* map, const std::string &viewName) : map(map), viewName(vie
 		cameraCenter.y = 0;
 		cameraCenter.z = gnd->height * 5.0f;
 	}
-	billboardShader = util::ResourceManager<gl::Shader>::load<BillboardRenderer::BillboardShader>();
 	whiteTexture = util::ResourceManager<gl::Texture>::load("data\\texture\\white.png");
 	if (!sphereMesh.vbo)
 		sphereMesh.init();
@@ -390,35 +389,20 @@ void MapView::render(BrowEdit* browEdit)
 		nodeRenderContext.viewMatrix = glm::translate(nodeRenderContext.viewMatrix, -cameraCenter);
 	}
 
-	//TODO: fix this, don't want to individually set settings
-	map->rootNode->getComponent<GndRenderer>()->viewLightmapShadow = viewLightmapShadow;
-	map->rootNode->getComponent<GndRenderer>()->viewLightmapColor = viewLightmapColor;
-	map->rootNode->getComponent<GndRenderer>()->viewColors = viewColors;
-	map->rootNode->getComponent<GndRenderer>()->viewLighting = viewLighting;
-	map->rootNode->getComponent<GndRenderer>()->viewTextures = viewTextures;
-	map->rootNode->getComponent<GndRenderer>()->viewFog = viewFog;
-	if (map->rootNode->getComponent<GndRenderer>()->viewEmptyTiles != viewEmptyTiles)
-	{
-		map->rootNode->getComponent<GndRenderer>()->viewEmptyTiles = viewEmptyTiles;
-		auto gnd = map->rootNode->getComponent<Gnd>();
-		for (int x = 0; x < gnd->width; x++)
-			for (int y = 0; y < gnd->height - 15; y++)
-				map->rootNode->getComponent<GndRenderer>()->setChunkDirty(x,y);
-	}
-	if (map->rootNode->getComponent<GndRenderer>()->smoothColors != smoothColors)
-	{
-		map->rootNode->getComponent<GndRenderer>()->smoothColors = smoothColors;
-		map->rootNode->getComponent<GndRenderer>()->gndShadowDirty = true;
-	}
-	map->rootNode->getComponent<WaterRenderer>()->viewFog = viewFog;
+	//the renderers read these from the render context, so other views can use different settings without rebuilding anything
+	nodeRenderContext.settings.viewLightmapShadow = viewLightmapShadow;
+	nodeRenderContext.settings.viewLightmapColor = viewLightmapColor;
+	nodeRenderContext.settings.viewColors = viewColors;
+	nodeRenderContext.settings.viewLighting = viewLighting;
+	nodeRenderContext.settings.smoothColors = smoothColors;
+	nodeRenderContext.settings.viewTextures = viewTextures;
+	nodeRenderContext.settings.viewEmptyTiles = viewEmptyTiles;
+	nodeRenderContext.settings.viewFog = viewFog;
 
-	RsmRenderer::RsmRenderContext::getInstance()->viewLighting = viewLighting;
-	RsmRenderer::RsmRenderContext::getInstance()->viewTextures = viewTextures;
-	RsmRenderer::RsmRenderContext::getInstance()->viewFog = viewFog;
-
-	map->rootNode->getComponent<GatRenderer>()->cameraDistance = cameraDistance;
-	map->rootNode->getComponent<GatRenderer>()->enabled = browEdit->editMode == BrowEdit::EditMode::Gat ? viewGatGat : viewGat;
-	map->rootNode->getComponent<GatRenderer>()->opacity = gatOpacity;
+	auto gatRenderer = map->rootNode->getComponent<GatRenderer>();
+	gatRenderer->cameraDistance = cameraDistance;
+	gatRenderer->enabled = browEdit->editMode == BrowEdit::EditMode::Gat ? viewGatGat : viewGat;
+	gatRenderer->opacity = gatOpacity;
 
 
 	//TODO: this does not seem so efficient
@@ -437,6 +421,8 @@ void MapView::render(BrowEdit* browEdit)
 		}
 	}
 	map->rootNode->getComponent<WaterRenderer>()->enabled = viewWater;
+	nodeRenderContext.settings.culling = browEdit->config.culling;
+	nodeRenderContext.cullScreenSize = browEdit->config.cullScreenSize;
 
 	NodeRenderer::render(map->rootNode, nodeRenderContext);
 
@@ -842,23 +828,26 @@ void MapView::drawLight(Node* n)
 		}
 		else
 		{
-			std::vector<VertexP3T2> vertsCircle;
+			std::vector<VertexP3T2N3> vertsCircle;
 			for (float f = 0; f < 2 * glm::pi<float>(); f += glm::pi<float>() / 50)
-				vertsCircle.push_back(VertexP3T2(glm::vec3(rswLight->range * glm::cos(f), rswLight->range * glm::sin(f), 0), glm::vec2(glm::cos(f), glm::sin(f))));
-			billboardShader->use();
-			billboardShader->setUniform(BillboardRenderer::BillboardShader::Uniforms::cameraMatrix, nodeRenderContext.viewMatrix);
-			billboardShader->setUniform(BillboardRenderer::BillboardShader::Uniforms::projectionMatrix, nodeRenderContext.projectionMatrix);
-			billboardShader->setUniform(BillboardRenderer::BillboardShader::Uniforms::modelMatrix, modelMatrix);
-			billboardShader->setUniform(BillboardRenderer::BillboardShader::Uniforms::color, glm::vec4(rswLight->color, 1));
-			whiteTexture->bind();
+				vertsCircle.push_back(VertexP3T2N3(glm::vec3(rswLight->range * glm::cos(f), rswLight->range * glm::sin(f), 0), glm::vec2(glm::cos(f), glm::sin(f)), glm::vec3(1.0f)));
+			//facing the camera: the circle is drawn in view space, around the position of the light in view space
+			glm::vec3 center(nodeRenderContext.viewMatrix * modelMatrix * glm::vec4(0, 0, 0, 1));
+			simpleShader->use();
+			simpleShader->setUniform(SimpleShader::Uniforms::projectionMatrix, nodeRenderContext.projectionMatrix);
+			simpleShader->setUniform(SimpleShader::Uniforms::viewMatrix, nodeRenderContext.viewMatrix);
+			simpleShader->setUniform(SimpleShader::Uniforms::modelMatrix, glm::inverse(nodeRenderContext.viewMatrix) * glm::translate(glm::mat4(1.0f), center));
+			simpleShader->setUniform(SimpleShader::Uniforms::textureFac, 0.0f);
+			simpleShader->setUniform(SimpleShader::Uniforms::color, glm::vec4(rswLight->color, 1));
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 			glEnableVertexAttribArray(0);
 			glEnableVertexAttribArray(1);
-			glDisableVertexAttribArray(2);
+			glEnableVertexAttribArray(2);
 			glDisableVertexAttribArray(3);
 			glDisableVertexAttribArray(4); //TODO: vao
-			glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexP3T2), vertsCircle[0].data);
-			glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2), vertsCircle[0].data + 3);
+			glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexP3T2N3), vertsCircle[0].data);
+			glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2N3), vertsCircle[0].data + 3);
+			glVertexAttribPointer(2, 3, GL_FLOAT, false, sizeof(VertexP3T2N3), vertsCircle[0].data + 5);
 			glLineWidth(4.0f);
 			glDrawArrays(GL_LINE_LOOP, 0, (int)vertsCircle.size());
 			glUseProgram(0);
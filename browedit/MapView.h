@@ -64,7 +64,6 @@ public:
 	NodeRenderContext nodeRenderContext;
 	Gadget gadget;
 	Gadget gadgetHeight[9];
-	BillboardRenderer::BillboardShader* billboardShader;
 	SimpleShader* simpleShader = nullptr;
 	static inline SphereMesh sphereMesh;
 	static inline CubeMesh cubeMesh;
@@ -217,9 +217,9 @@ void ModelEditor::run(BrowEdit* browEdit)
 
 
 
-				RsmRenderer::RsmRenderContext::getInstance()->viewLighting = false;
-				RsmRenderer::RsmRenderContext::getInstance()->viewTextures = true;
-				RsmRenderer::RsmRenderContext::getInstance()->viewFog = false;
+				nodeRenderContext.settings.viewLighting = false;
+				nodeRenderContext.settings.viewTextures = true;
+				nodeRenderContext.settings.viewFog = false;
 				auto rsmRenderer = m.node->getComponent<RsmRenderer>();
 				for (auto i = 0; i < rsmRenderer->renderInfo.size(); i++)
 					rsmRenderer->renderInfo[i].selected = m.selectedMesh && i == m.selectedMesh->index;
@@ -417,12 +417,15 @@ void ModelEditor::run(BrowEdit* browEdit)
 	{
 		if (selectedFrame != nullptr)
 		{
-			ImGui::InputInt("Time", &selectedFrame->time);
+			if (ImGui::InputInt("Time", &selectedFrame->time))
+				rsm->invalidatePose();
 			auto rotFrame = dynamic_cast<Rsm::Mesh::RotFrame*>(selectedFrame);
 			if (rotFrame)
 			{
-				ImGui::InputFloat4("Quaternion", glm::value_ptr(rotFrame->quaternion));
-				ImGui::gizmo3D("Rotation", rotFrame->quaternion);
+				if (ImGui::InputFloat4("Quaternion", glm::value_ptr(rotFrame->quaternion)))
+					rsm->invalidatePose();
+				if (ImGui::gizmo3D("Rotation", rotFrame->quaternion))
+					rsm->invalidatePose();
 			}
 		}
 	}
@@ -15,6 +15,7 @@ Node::Node(const std::string& name, Node* parent) : name(name), parent(parent)
 		this->root = parent->root;
 	}
 	root->dirty = true;
+	root->structureVersion++;
 }
 
 Node::~Node()
@@ -34,6 +35,7 @@ void Node::addComponent(Component* component)
 	component->node = this;
 	components.push_back(component);
 	root->dirty = true;
+	root->structureVersion++;
 }
 
 void Node::makeNameUnique(Node* rootNode)
@@ -167,6 +169,7 @@ void Node::onRename(Map* map)
 					//TODO: check if it can safely be removed
 					//delete n->children[ii]; //MEMORY LEAK
 					n->children.erase(n->children.begin() + ii);
+					n->root->structureVersion++;
 					map->selectedNodes.clear(); //just remove this
 				}
 				else
@@ -181,6 +184,7 @@ void Node::onRename(Map* map)
 void Node::setParent(Node* newParent)
 {
 	root->dirty = true;
+	root->structureVersion++;
 	if (parent)
 	{
 		if(std::find(parent->children.begin(), parent->children.end(), this) != parent->children.end())
@@ -195,12 +199,14 @@ void Node::setParent(Node* newParent)
 	else
 		this->root = this;
 	root->dirty = true;
+	root->structureVersion++;
 }
 
 void Node::removeChild(Node* child)
 {
 	children.erase(std::remove_if(children.begin(), children.end(), [&child](Node* n) { return n == child; }));
 	root->dirty = true;
+	root->structureVersion++;
 }
 
 void Node::traverse(const std::function<void(Node*)>& callBack)
@@ -14,6 +14,7 @@ class Node
 {
 public:
 	bool dirty = true;
+	int structureVersion = 0; //only used on the root, increased when nodes or components are added, moved or removed
 	std::vector<Component*> components;
 	std::vector<Node*> children;
 	Node* parent = nullptr;
@@ -65,6 +66,11 @@ public:
 			else
 				it++;
 		}
+		if (!ret.empty())
+		{
+			root->dirty = true;
+			root->structureVersion++;
+		}
 		return ret;
 	}
 
@@ -73,7 +79,11 @@ public:
 		for (auto it = components.begin(); it != components.end(); )
 		{
 			if (*it == component)
+			{
 				it = components.erase(it);
+				root->dirty = true;
+				root->structureVersion++;
+			}
 			else
 				it++;
 		}
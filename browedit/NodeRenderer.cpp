@@ -4,6 +4,9 @@
 #include <vector>
 #include <algorithm>
 #include "Node.h"
+#include "math/Frustum.h"
+#include "util/Profiler.h"
+#include <typeinfo>
 
 void NodeRenderer::begin()
 {
@@ -40,13 +43,54 @@ void NodeRenderer::render(Node* rootNode, NodeRenderContext& context)
 		std::sort(ordered.begin(), ordered.end(), [](Renderer::RenderContext* a, Renderer::RenderContext* b) { return a->order < b->order; });
 	}
 
+	PROFILE_SCOPE("NodeRenderer::render");
+	math::Frustum frustum(context.projectionMatrix * context.viewMatrix);
+	context.visibleCount = 0;
+	context.culledCount = 0;
+	context.stats = RenderStats();
 	for (auto r : ordered)
 	{
+		{
+			PROFILE_SCOPE("Culling");
+			context.visible.clear();
+			for (auto renderer : renderers[r])
+			{
+				if (!renderer->enabled)
+					continue;
+				glm::vec3 min, max;
+				if (context.settings.culling && renderer->getBounds(min, max))
+				{
+					if (!frustum.intersects(min, max))
+					{
+						context.culledCount++;
+						continue;
+					}
+					if (context.cullScreenSize > 0)
+					{
+						glm::vec4 center = context.projectionMatrix * context.viewMatrix * glm::vec4((min + max) / 2.0f, 1.0f);
+						float radius = glm::length(max - min) / 2.0f;
+						if (radius * context.projectionMatrix[1][1] / glm::max(center.w, 0.0001f) < context.cullScreenSize)
+						{
+							context.culledCount++;
+							continue;
+						}
+					}
+				}
+				context.visibleCount++;
+				context.visible.push_back(renderer);
+			}
+		}
+
+		PROFILE_SCOPE(typeid(*r).name());
+		PROFILE_GPU_SCOPE(typeid(*r).name());
+		r->settings = &context.settings;
+		r->stats = &context.stats;
 		r->preFrame(context.projectionMatrix, context.viewMatrix);
 		for(int phase = 0; phase < r->phases; phase++)
-			for (auto renderer : renderers[r])
-				if(renderer->enabled && renderer->shouldRender(phase))
+			for (auto renderer : context.visible)
+				if(renderer->shouldRender(phase))
 					renderer->render();
+		r->postFrame();
 	}
 
 
@@ -20,8 +20,15 @@ class NodeRenderContext
 public:
 	glm::mat4 viewMatrix;
 	glm::mat4 projectionMatrix;
+	RenderSettings settings;
+	RenderStats stats;
 
 	std::map<Node*, std::map<Renderer::RenderContext*, std::vector<Renderer*>>> renderers;
 	std::map<Node*, std::vector<Renderer::RenderContext*>> ordered;
+	std::vector<Renderer*> visible;
+
+	float cullScreenSize = 0.0f; //objects that are smaller than this on screen (relative to the viewport height) are not drawn
+	int visibleCount = 0;
+	int culledCount = 0;
 
 };
\ No newline at end of file
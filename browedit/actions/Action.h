@@ -11,4 +11,5 @@ public:
 	virtual void perform(Map* map, BrowEdit* browEdit) = 0;
 	virtual void undo(Map* map, BrowEdit* browEdit) = 0;
 	virtual std::string str() = 0;
+	virtual std::size_t memoryUsage() { return sizeof(Action); } //estimate, for the memory window
 };
\ No newline at end of file
@@ -6,40 +6,57 @@
 #include <browedit/components/Gat.h>
 
 template<class T, class TC>
-CubeHeightChangeAction<T, TC>::CubeHeightChangeAction(const std::map<TC*, float[4]>& oldValues, const std::map<TC*, float[4]>& newValues)
+CubeHeightChangeAction<T, TC>::CubeHeightChangeAction(const std::map<TC*, float[4]>& oldValues, const std::map<TC*, float[4]>& newValues, const glm::ivec2& dirtyMin, const glm::ivec2& dirtyMax)
 {
 	this->oldValues = oldValues;
 	this->newValues = newValues;
+	this->dirtyMin = dirtyMin;
+	this->dirtyMax = dirtyMax;
 }
 
 template<class T, class TC>
 CubeHeightChangeAction<T, TC>::CubeHeightChangeAction(T* gnd, const std::vector<glm::ivec2>& startSelection)
 {
+	dirtyMin = glm::ivec2(gnd->width, gnd->height);
 	for (auto t : startSelection)
+	{
 		for (int i = 0; i < 4; i++)
 			oldValues[gnd->cubes[t.x][t.y]][i] = gnd->cubes[t.x][t.y]->heights[i];
+		dirtyMin = glm::min(dirtyMin, t);
+		dirtyMax = glm::max(dirtyMax, t);
+	}
 }
 
 template<class T, class TC>
 void CubeHeightChangeAction<T, TC>::setNewHeights(T* gnd, const std::vector<glm::ivec2>& endSelection)
 {
 	for (auto t : endSelection)
+	{
 		for (int i = 0; i < 4; i++)
 			newValues[gnd->cubes[t.x][t.y]][i] = gnd->cubes[t.x][t.y]->heights[i];
+		dirtyMin = glm::min(dirtyMin, t);
+		dirtyMax = glm::max(dirtyMax, t);
+	}
 }
 
 template<class T, class TC>
-void CubeHeightChangeAction<T, TC>::perform(Map* map, BrowEdit* browEdit)
+void CubeHeightChangeAction<T, TC>::updateTerrain(Map* map)
 {
-	for (auto kv : newValues)
-		for (int i = 0; i < 4; i++)
-			kv.first->heights[i] = kv.second[i];
-	auto gnd = map->rootNode->getComponent<Gnd>();
-	if (gnd)
-		gnd->recalculateNormals();
+	bool all = dirtyMax.x < dirtyMin.x || dirtyMax.y < dirtyMin.y;
+	if (std::is_same<T, Gnd>::value)
+	{
+		auto gnd = map->rootNode->getComponent<Gnd>();
+		if (gnd && all)
+			gnd->recalculateNormals();
+		else if (gnd)
+			gnd->recalculateNormals(dirtyMin, dirtyMax);
+	}
+	//the normals and walls of the tiles next to the changed tiles change as well
 	auto gndRenderer = map->rootNode->getComponent<GndRenderer>();
-	if (gndRenderer)
+	if (gndRenderer && (all || !std::is_same<T, Gnd>::value))
 		gndRenderer->setChunksDirty();
+	else if (gndRenderer)
+		gndRenderer->setChunksDirty(dirtyMin - 1, dirtyMax + 1);
 	if (std::is_same<T, Gat>::value)
 	{
 		auto gatRenderer = map->rootNode->getComponent<GatRenderer>();
@@ -48,24 +65,22 @@ void CubeHeightChangeAction<T, TC>::perform(Map* map, BrowEdit* browEdit)
 	}
 }
 
+template<class T, class TC>
+void CubeHeightChangeAction<T, TC>::perform(Map* map, BrowEdit* browEdit)
+{
+	for (auto kv : newValues)
+		for (int i = 0; i < 4; i++)
+			kv.first->heights[i] = kv.second[i];
+	updateTerrain(map);
+}
+
 template<class T, class TC>
 void CubeHeightChangeAction<T, TC>::undo(Map* map, BrowEdit* browEdit)
 {
 	for (auto kv : oldValues)
 		for (int i = 0; i < 4; i++)
 			kv.first->heights[i] = kv.second[i];
-	auto gnd = map->rootNode->getComponent<Gnd>();
-	if (gnd)
-		gnd->recalculateNormals();
-	auto gndRenderer = map->rootNode->getComponent<GndRenderer>();
-	if (gndRenderer)
-		gndRenderer->setChunksDirty();
-	if (std::is_same<T, Gat>::value)
-	{
-		auto gatRenderer = map->rootNode->getComponent<GatRenderer>();
-		if (gatRenderer)
-			gatRenderer->setChunksDirty();
-	}
+	updateTerrain(map);
 }
 
 template<class T, class TC>
@@ -9,12 +9,16 @@ class CubeHeightChangeAction : public Action
 {
 	std::map<TC*, float[4]> oldValues;
 	std::map<TC*, float[4]> newValues;
+	glm::ivec2 dirtyMin = glm::ivec2(0); //tiles that changed, normals and chunks are only updated in this area. When dirtyMax < dirtyMin, the whole map is updated
+	glm::ivec2 dirtyMax = glm::ivec2(-1);
+	void updateTerrain(Map* map);
 public:
-	CubeHeightChangeAction(const std::map<TC*, float[4]>& oldValues, const std::map<TC*, float[4]>& newValues);
+	CubeHeightChangeAction(const std::map<TC*, float[4]>& oldValues, const std::map<TC*, float[4]>& newValues, const glm::ivec2& dirtyMin = glm::ivec2(0), const glm::ivec2& dirtyMax = glm::ivec2(-1));
 	CubeHeightChangeAction(T* gnd, const std::vector<glm::ivec2>& startSelection);
 	void setNewHeights(T* gnd, const std::vector<glm::ivec2>& endSelection);
 
 	virtual void perform(Map* map, BrowEdit* browEdit);
 	virtual void undo(Map* map, BrowEdit* browEdit);
 	virtual std::string str();;
+	virtual std::size_t memoryUsage() override { return sizeof(*this) + (oldValues.size() + newValues.size()) * (sizeof(std::pair<TC*, float[4]>) + 32); } //32 for the map node
 };
\ No newline at end of file
@@ -17,4 +17,5 @@ public:
 	virtual void perform(Map* map, BrowEdit* browEdit);
 	virtual void undo(Map* map, BrowEdit* browEdit);
 	virtual std::string str();;
+	virtual std::size_t memoryUsage() override { return sizeof(*this) + (oldValues.size() + newValues.size()) * (sizeof(std::pair<Gnd::Cube*, int[3]>) + 32); } //32 for the map node
 };
\ No newline at end of file
@@ -36,6 +36,13 @@ public:
 		for (auto it = actions.rbegin(); it != actions.rend(); it++)
 			(*it)->undo(map, browEdit);
 	}
+	virtual std::size_t memoryUsage() override
+	{
+		std::size_t size = sizeof(GroupAction) + actions.size() * sizeof(Action*);
+		for (auto a : actions)
+			size += a->memoryUsage();
+		return size;
+	}
 	virtual std::string str()
 	{
 		if (title != "")
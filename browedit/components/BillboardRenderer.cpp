@@ -1,5 +1,6 @@
 #include "BillboardRenderer.h"
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/Profiler.h>
 #include <browedit/Node.h>
 #include <browedit/components/Rsw.h>
 #include <browedit/components/Gnd.h>
@@ -8,21 +9,12 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
-static std::vector<VertexP3T2> verts;
-
 BillboardRenderer::BillboardRenderer(const std::string& textureFile, const std::string& textureFile_selected)
 {
 	texture = util::ResourceManager<gl::Texture>::load(textureFile);
 	if(textureFile_selected != "")
 		textureSelected = util::ResourceManager<gl::Texture>::load(textureFile_selected);
 	renderContext = BillboardRenderContext::getInstance();
-	if (verts.size() == 0)
-	{
-		verts.push_back(VertexP3T2(glm::vec3(-5, -5, 0), glm::vec2(0, 0)));
-		verts.push_back(VertexP3T2(glm::vec3(-5, 5, 0), glm::vec2(0, 1)));
-		verts.push_back(VertexP3T2(glm::vec3(5, 5, 0), glm::vec2(1, 1)));
-		verts.push_back(VertexP3T2(glm::vec3(5, -5, 0), glm::vec2(1, 0)));
-	}
 }
 
 BillboardRenderer::~BillboardRenderer()
@@ -42,25 +34,20 @@ void BillboardRenderer::render()
 	if (!rswObject)
 		return;
 
-	auto shader = dynamic_cast<BillboardRenderContext*>(renderContext)->shader;//TODO: don't cast
-
-	glm::mat4 modelMatrix(1.0f);
-	modelMatrix = glm::scale(modelMatrix, glm::vec3(1, 1, -1));
-	modelMatrix = glm::translate(modelMatrix, glm::vec3(5 * gnd->width + rswObject->position.x, -rswObject->position.y, -10 - 5 * gnd->height + rswObject->position.z));
-	shader->setUniform(BillboardShader::Uniforms::modelMatrix, modelMatrix);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	if (selected)
-		textureSelected->bind();
-	else
-		texture->bind();
-	glDepthMask(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexP3T2), verts[0].data);
-	glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2), verts[0].data + 3);
-	glDrawArrays(GL_QUADS, 0, 4);
-	glDepthMask(1);
-
+	auto context = dynamic_cast<BillboardRenderContext*>(renderContext);//TODO: don't cast
+	glm::vec3 position(5 * gnd->width + rswObject->position.x, -rswObject->position.y, 10 + 5 * gnd->height - rswObject->position.z);
+	context->batches[std::pair<gl::Texture*, gl::Texture*>(texture, textureSelected ? textureSelected : texture)].push_back(BillboardRenderContext::Instance{ position, selected ? 1.0f : 0.0f });
+}
 
+bool BillboardRenderer::getBounds(glm::vec3& min, glm::vec3& max)
+{
+	if (!rswObject || !gnd)
+		return false;
+	glm::vec3 center(5 * gnd->width + rswObject->position.x, -rswObject->position.y, 10 + 5 * gnd->height - rswObject->position.z);
+	//the billboard is a 10x10 quad that turns to the camera
+	min = center - glm::vec3(7.5f);
+	max = center + glm::vec3(7.5f);
+	return true;
 }
 
 void BillboardRenderer::setTexture(const std::string &texture)
@@ -78,7 +65,34 @@ BillboardRenderer::BillboardRenderContext::BillboardRenderContext() : shader(uti
 {
 	shader->use();
 	shader->setUniform(BillboardShader::Uniforms::s_texture, 0);
+	shader->setUniform(BillboardShader::Uniforms::s_textureSelected, 1);
 	order = 3;
+
+	std::vector<VertexP3T2> verts;
+	verts.push_back(VertexP3T2(glm::vec3(-5, -5, 0), glm::vec2(0, 0)));
+	verts.push_back(VertexP3T2(glm::vec3(-5, 5, 0), glm::vec2(0, 1)));
+	verts.push_back(VertexP3T2(glm::vec3(5, 5, 0), glm::vec2(1, 1)));
+	verts.push_back(VertexP3T2(glm::vec3(5, -5, 0), glm::vec2(1, 0)));
+	quad.setData(verts, GL_STATIC_DRAW);
+	quad.memory.setTag("GL billboard buffers");
+	instanceVbo.memory.setTag("GL billboard buffers");
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	quad.bind();
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexP3T2), (void*)(0 * sizeof(float)));
+	glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2), (void*)(3 * sizeof(float)));
+	instanceVbo.bind();
+	glEnableVertexAttribArray(2);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(2, 3, GL_FLOAT, false, sizeof(Instance), (void*)offsetof(Instance, position));
+	glVertexAttribPointer(3, 1, GL_FLOAT, false, sizeof(Instance), (void*)offsetof(Instance, selected));
+	glVertexAttribDivisor(2, 1);
+	glVertexAttribDivisor(3, 1);
+	glBindVertexArray(0);
+	instanceVbo.unBind();
 }
 
 void BillboardRenderer::BillboardRenderContext::preFrame(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix)
@@ -90,10 +104,37 @@ void BillboardRenderer::BillboardRenderContext::preFrame(const glm::mat4& projec
 	shader->setUniform(BillboardShader::Uniforms::projectionMatrix, projectionMatrix);
 	shader->setUniform(BillboardShader::Uniforms::cameraMatrix, viewMatrix);
 	shader->setUniform(BillboardShader::Uniforms::color, glm::vec4(1,1,1,1));
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	glDisableVertexAttribArray(3);
-	glDisableVertexAttribArray(4); //TODO: vao
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	for (auto& b : batches)
+		b.second.clear();
+}
+
+//all billboards are put in 1 instance buffer, and every texture is drawn with 1 call
+void BillboardRenderer::BillboardRenderContext::postFrame()
+{
+	instances.clear();
+	for (const auto& b : batches)
+		instances.insert(instances.end(), b.second.begin(), b.second.end());
+	if (instances.empty())
+		return;
+	instanceVbo.setData(instances, GL_STREAM_DRAW);
+	instanceVbo.unBind();
+
+	glDepthMask(0);
+	glBindVertexArray(vao);
+	int first = 0;
+	for (const auto& b : batches)
+	{
+		if (b.second.empty())
+			continue;
+		glActiveTexture(GL_TEXTURE1);
+		b.first.second->bind();
+		glActiveTexture(GL_TEXTURE0);
+		b.first.first->bind();
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLE_FAN, 0, 4, (int)b.second.size(), first);
+		PROFILE_COUNT("Draw calls", 1);
+		PROFILE_COUNT("Billboards", (int)b.second.size());
+		first += (int)b.second.size();
+	}
+	glBindVertexArray(0);
+	glDepthMask(1);
 }
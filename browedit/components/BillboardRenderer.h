@@ -3,6 +3,10 @@
 #include "Renderer.h"
 #include <browedit/gl/Shader.h>
 #include <browedit/util/Singleton.h>
+#include <browedit/gl/VBO.h>
+#include <browedit/gl/Vertex.h>
+#include <map>
+#include <vector>
 
 namespace gl { class Texture; }
 class RswObject;
@@ -21,10 +25,9 @@ public:
 			{
 				projectionMatrix,
 				cameraMatrix,
-				modelMatrix,
 				s_texture,
+				s_textureSelected,
 				color,
-				billboard,
 				End
 			};
 		};
@@ -33,31 +36,43 @@ public:
 			bindUniform(Uniforms::projectionMatrix, "projectionMatrix");
 			bindUniform(Uniforms::cameraMatrix, "cameraMatrix");
 			bindUniform(Uniforms::s_texture, "s_texture");
-			bindUniform(Uniforms::modelMatrix, "modelMatrix");
+			bindUniform(Uniforms::s_textureSelected, "s_textureSelected");
 			bindUniform(Uniforms::color, "color");
 		}
 	};
 private:
-	RswObject* rswObject;
+	RswObject* rswObject = nullptr;
 	gl::Texture* texture;
 	gl::Texture* textureSelected = nullptr;
 
 public:
-	Gnd* gnd;
+	Gnd* gnd = nullptr;
+	//The billboards don't draw themselves, they are collected per texture and drawn instanced in postFrame
 	class BillboardRenderContext : public Renderer::RenderContext, public util::Singleton<BillboardRenderContext>
 	{
 	public:
+		class Instance
+		{
+		public:
+			glm::vec3 position;
+			float selected;
+		};
 		BillboardShader* shader = nullptr;
-		glm::mat4 viewMatrix = glm::mat4(1.0f);
-		bool viewLighting = true;
+		std::map<std::pair<gl::Texture*, gl::Texture*>, std::vector<Instance>> batches; //per texture and selected texture
+		std::vector<Instance> instances;
+		gl::VBO<VertexP3T2> quad;
+		gl::VBO<Instance> instanceVbo;
+		GLuint vao = 0;
 
 		BillboardRenderContext();
 		virtual void preFrame(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix) override;
+		virtual void postFrame() override;
 	};
 
 	BillboardRenderer(const std::string& texture, const std::string& texture_selected = "");
 	~BillboardRenderer();
 	virtual void render();
+	virtual bool getBounds(glm::vec3& min, glm::vec3& max) override;
 	bool selected = false;
 
 	void setTexture(const std::string &texture);
@@ -1,6 +1,7 @@
 #include "Gat.h"
 #include <browedit/util/Util.h>
 #include <browedit/util/FileIO.h>
+#include <browedit/util/ByteStream.h>
 #include <browedit/math/AABB.h>
 #include <browedit/Node.h>
 #include <browedit/Map.h>
@@ -12,10 +13,18 @@
 #include <FastNoiseLite.h>
 #include <glm/gtc/type_ptr.hpp>
 
+//on-disk layout of a cube, so the cubes can be read in one go
+struct GatFileCube
+{
+	float heights[4];
+	int gatType;
+};
+static_assert(sizeof(GatFileCube) == 20, "GAT cubes are 20 bytes");
+
 Gat::Gat(const std::string& fileName)
 {
-	auto file = util::FileIO::open(fileName);
-	if (!file)
+	std::vector<char> data;
+	if (!util::FileIO::read(fileName, data))
 	{
 		width = 0;
 		height = 0;
@@ -23,37 +32,52 @@ Gat::Gat(const std::string& fileName)
 		return;
 	}
 	std::cout<< "GAT: Reading gat file" << std::endl;
-	char header[4];
-	file->read(header, 4);
-	if (!(header[0] == 'G' && header[1] == 'R' && header[2] == 'A' && header[3] == 'T'))
+	util::ByteReader file(data);
+	std::vector<GatFileCube> fileCubes;
+	try
 	{
-		version = 0;
-		std::cerr << "GAT: Invalid GAT file, attempting to load" << std::endl;
-		return;
-	}
+		char header[4];
+		file.read(header, 4);
+		if (!(header[0] == 'G' && header[1] == 'R' && header[2] == 'A' && header[3] == 'T'))
+		{
+			version = 0;
+			width = 0;
+			height = 0;
+			std::cerr << "GAT: Invalid GAT file, attempting to load" << std::endl;
+			return;
+		}
 
-	file->read(reinterpret_cast<char*>(&version), sizeof(short));
-	file->read(reinterpret_cast<char*>(&width), sizeof(int));
-	file->read(reinterpret_cast<char*>(&height), sizeof(int));
+		file.read(version);
+		file.read(width);
+		file.read(height);
 
-	std::cout << std::hex << "Gat: Version 0x" << version << std::dec << ", width "<<width<<", height "<<height << std::endl;
+		std::cout << std::hex << "Gat: Version 0x" << version << std::dec << ", width "<<width<<", height "<<height << std::endl;
+		if (width < 0 || height < 0)
+			throw std::out_of_range("invalid map size");
+		file.readArray(fileCubes, (std::size_t)width * height);
+	}
+	catch (const std::out_of_range& e)
+	{
+		std::cerr << "GAT: Error reading gat file " << fileName << ": " << e.what() << std::endl;
+		width = 0;
+		height = 0;
+		return;
+	}
 
 	cubes.resize(width, std::vector<Cube*>(height, NULL));
 	for (int y = 0; y < height; y++)
 	{
 		for (int x = 0; x < width; x++)
 		{
+			const GatFileCube& c = fileCubes[x + y * width];
 			Cube* cube = new Cube();
-			file->read(reinterpret_cast<char*>(&cube->h1), sizeof(float));
-			file->read(reinterpret_cast<char*>(&cube->h2), sizeof(float));
-			file->read(reinterpret_cast<char*>(&cube->h3), sizeof(float));
-			file->read(reinterpret_cast<char*>(&cube->h4), sizeof(float));
-			file->read(reinterpret_cast<char*>(&cube->gatType), sizeof(int));
+			for (int i = 0; i < 4; i++)
+				cube->heights[i] = c.heights[i];
+			cube->gatType = c.gatType;
 			cube->calcNormal();
 			cubes[x][y] = cube;
 		}
 	}
-	delete file;
 	std::cout << "GAT: Done reading gat file" << std::endl;
 }
 
@@ -86,31 +110,31 @@ Gat::~Gat()
 
 void Gat::save(const std::string& fileName)
 {
-	std::ofstream file(fileName.c_str(), std::ios_base::binary | std::ios_base::out);
-	if (!file.is_open())
-	{
-		std::cerr << "GAT: Unable to open gat file: " << fileName << std::endl;
-		return;
-	}
+	auto data = serialize();
+	if (!util::FileIO::writeFileAtomic(fileName, data.data(), data.size()))
+		std::cerr << "GAT: Unable to write gat file: " << fileName << std::endl;
+}
+
+std::vector<char> Gat::serialize()
+{
 	std::cout << "GAT: writing gat file" << std::endl;
+	util::ByteWriter file(14 + width * height * 20);
 	char header[4] = { 'G', 'R', 'A', 'T'};
 	file.write(header, 4);
-	file.write(reinterpret_cast<char*>(&version), sizeof(short));
-	file.write(reinterpret_cast<char*>(&width), sizeof(int));
-	file.write(reinterpret_cast<char*>(&height), sizeof(int));
+	file.write(version);
+	file.write(width);
+	file.write(height);
 	for (int y = 0; y < height; y++)
 	{
 		for (int x = 0; x < width; x++)
 		{
 			Cube* cube = cubes[x][y];
-			file.write(reinterpret_cast<char*>(&cube->h1), sizeof(float));
-			file.write(reinterpret_cast<char*>(&cube->h2), sizeof(float));
-			file.write(reinterpret_cast<char*>(&cube->h3), sizeof(float));
-			file.write(reinterpret_cast<char*>(&cube->h4), sizeof(float));
-			file.write(reinterpret_cast<char*>(&cube->gatType), sizeof(int));
+			file.write(cube->heights, sizeof(float) * 4);
+			file.write(cube->gatType);
 		}
 	}
 	std::cout << "GAT: Done saving gat" << std::endl;
+	return std::move(file.data);
 }
 
 void Gat::Cube::calcNormal()
@@ -19,6 +19,7 @@ public:
 	Gat(int width, int height);
 	~Gat();
 	void save(const std::string &fileName);
+	std::vector<char> serialize();
 	glm::vec3 rayCast(const math::Ray& ray, int xMin = 0, int yMin = 0, int xMax = -1, int yMax = -1, float offset = 0.0f);
 	void buildImGui(BrowEdit* browEdit);
 
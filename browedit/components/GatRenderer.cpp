@@ -1,6 +1,7 @@
 #include "GatRenderer.h"
 #include "Gat.h"
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/Profiler.h>
 #include <browedit/Node.h>
 #include <browedit/shaders/SimpleShader.h>
 #include <browedit/gl/Texture.h>
@@ -114,6 +115,7 @@ void GatRenderer::Chunk::render()
 		glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2N3), (void*)(3 * sizeof(float)));
 		glVertexAttribPointer(2, 3, GL_FLOAT, false, sizeof(VertexP3T2N3), (void*)(5 * sizeof(float)));
 		glDrawArrays(GL_TRIANGLES, 0, (int)vbo.size());
+		PROFILE_COUNT("Draw calls", 1);
 		vbo.unBind();
 		shader->setUniform(SimpleShader::Uniforms::colorMult, glm::vec4(1, 1, 1, 1.0f));
 	}
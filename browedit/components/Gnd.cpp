@@ -2,6 +2,10 @@
 #include <browedit/BrowEdit.h>
 #include <browedit/util/Util.h>
 #include <browedit/util/FileIO.h>
+#include <browedit/util/ByteStream.h>
+#include <browedit/util/Profiler.h>
+#include <browedit/util/HeightField.h>
+#include <browedit/util/MemoryTracker.h>
 #include <browedit/math/AABB.h>
 #include <browedit/Node.h>
 #include <browedit/Map.h>
@@ -13,10 +17,34 @@
 #include <FastNoiseLite.h>
 #include <glm/gtc/type_ptr.hpp>
 
+//on-disk layouts of the tile and cube sections, so they can be read in one go
+struct GndFileTile
+{
+	float u[4];
+	float v[4];
+	short textureIndex;
+	unsigned short lightmapIndex;
+	unsigned char color[4]; //bgra
+};
+static_assert(sizeof(GndFileTile) == 40, "GND tiles are 40 bytes");
+struct GndFileCube
+{
+	float heights[4];
+	int tileUp, tileFront, tileSide;
+};
+static_assert(sizeof(GndFileCube) == 28, "GND cubes are 28 bytes");
+struct GndFileCubeOld //before 0x0106
+{
+	float heights[4];
+	short tileUp, tileFront, tileSide, unknown;
+};
+static_assert(sizeof(GndFileCubeOld) == 24, "old GND cubes are 24 bytes");
+
 Gnd::Gnd(const std::string& fileName)
 {
-	auto file = util::FileIO::open(fileName);
-	if (!file)
+	trackMemory();
+	std::vector<char> data;
+	if (!util::FileIO::read(fileName, data))
 	{
 		width = 0;
 		height = 0;
@@ -24,231 +52,228 @@ Gnd::Gnd(const std::string& fileName)
 		return;
 	}
 	std::cout<< "GND: Reading gnd file" << std::endl;
-	char header[4];
-	file->read(header, 4);
-	if (header[0] == 'G' && header[1] == 'R' && header[2] == 'G' && header[3] == 'N')
-	{
-		file->read(reinterpret_cast<char*>(&version), sizeof(short));
-		version = util::swapShort(version);
-	}
-	else
-	{
-		version = 0;
-		std::cerr<< "GND: Invalid GND file, attempting to load" << std::endl;
-	}
-	std::cout << std::hex << "Gnd: Version 0x" << version << std::endl << std::dec;
-
-	int textureCount = 0;
-
-	if (version > 0)
+	util::ByteReader file(data);
+	try
 	{
-		file->read(reinterpret_cast<char*>(&width), sizeof(int));
-		file->read(reinterpret_cast<char*>(&height), sizeof(int));
-		file->read(reinterpret_cast<char*>(&tileScale), sizeof(float));
-		file->read(reinterpret_cast<char*>(&textureCount), sizeof(int));
-		file->read(reinterpret_cast<char*>(&maxTexName), sizeof(int)); //80
-	}
-	else
-	{
-		file->seekg(0, std::ios_base::beg);//TODO: test this
-		file->read(reinterpret_cast<char*>(&textureCount), sizeof(int));
-		file->read(reinterpret_cast<char*>(&width), sizeof(int));
-		file->read(reinterpret_cast<char*>(&height), sizeof(int));
-	}
-
-	textures.reserve(textureCount);
-	for (int i = 0; i < textureCount; i++)
-	{
-		Texture* texture = new Texture();
-		texture->file = util::FileIO::readString(file, 40);
-		texture->name = util::FileIO::readString(file, 40);
-		//texture->texture = new Texture("data/texture/" + texture->file); //TODO: cached loader
-		textures.push_back(texture);
-	}
+		char header[4];
+		file.read(header, 4);
+		if (header[0] == 'G' && header[1] == 'R' && header[2] == 'G' && header[3] == 'N')
+			version = util::swapShort(file.read<short>());
+		else
+		{
+			version = 0;
+			std::cerr<< "GND: Invalid GND file, attempting to load" << std::endl;
+		}
+		std::cout << std::hex << "Gnd: Version 0x" << version << std::endl << std::dec;
 
+		int textureCount = 0;
 
-	if (version > 0)
-	{
-		int lightmapCount;
-		file->read(reinterpret_cast<char*>(&lightmapCount), sizeof(int));
-		file->read(reinterpret_cast<char*>(&lightmapWidth), sizeof(int));
-		file->read(reinterpret_cast<char*>(&lightmapHeight), sizeof(int));
-		file->read(reinterpret_cast<char*>(&gridSizeCell), sizeof(int));
-
-		//Fix lightmap format if it was invalid. by Henko
-		if (lightmapWidth == 0 || lightmapHeight == 0 || gridSizeCell == 0)
+		if (version > 0)
 		{
-			std::cerr << "GND: Invalid Lightmap Format in " << fileName << ".gnd" << std::endl;
-			lightmapWidth = 8;
-			lightmapHeight = 8;
-			gridSizeCell = 1;
+			file.read(width);
+			file.read(height);
+			file.read(tileScale);
+			file.read(textureCount);
+			file.read(maxTexName); //80
 		}
-
-		lightmaps.reserve(lightmapCount);
-		for (int i = 0; i < lightmapCount; i++)
+		else
+		{
+			file.seek(0);//TODO: test this
+			file.read(textureCount);
+			file.read(width);
+			file.read(height);
+		}
+		//the counts are checked against the size of the file before anything is allocated for them
+		if (textureCount < 0 || (std::size_t)textureCount > file.remaining() / 80)
+			throw std::out_of_range("invalid texture count");
+		if (width < 0 || height < 0 || (std::size_t)width * height > file.remaining() / sizeof(GndFileCubeOld))
+			throw std::out_of_range("invalid map size");
+
+		textures.reserve(textureCount);
+		for (int i = 0; i < textureCount; i++)
 		{
-			Lightmap* lightmap = new Lightmap(this);
-			file->read((char*)lightmap->data, lightmapWidth*lightmapHeight*4);
-			lightmaps.push_back(lightmap);
+			Texture* texture = new Texture();
+			textures.push_back(texture);
+			texture->file = file.readString(40);
+			texture->name = file.readString(40);
 		}
 
-		int tileCount;
-		file->read(reinterpret_cast<char*>(&tileCount), sizeof(int));
-		std::cout << "GND: Tilecount: " << tileCount << std::endl;
-		tiles.reserve(tileCount);
-		for (int i = 0; i < tileCount; i++)
+
+		if (version > 0)
 		{
-			Tile* tile = new Tile();
-
-			file->read(reinterpret_cast<char*>(&tile->v1.x), sizeof(float));
-			file->read(reinterpret_cast<char*>(&tile->v2.x), sizeof(float));
-			file->read(reinterpret_cast<char*>(&tile->v3.x), sizeof(float));
-			file->read(reinterpret_cast<char*>(&tile->v4.x), sizeof(float));
-			file->read(reinterpret_cast<char*>(&tile->v1.y), sizeof(float));
-			file->read(reinterpret_cast<char*>(&tile->v2.y), sizeof(float));
-			file->read(reinterpret_cast<char*>(&tile->v3.y), sizeof(float));
-			file->read(reinterpret_cast<char*>(&tile->v4.y), sizeof(float));
-
-			file->read(reinterpret_cast<char*>(&tile->textureIndex), sizeof(short));
-			unsigned short lightmapIndex;
-			file->read(reinterpret_cast<char*>(&lightmapIndex), sizeof(unsigned short));
-			tile->lightmapIndex = lightmapIndex;
+			int lightmapCount = file.read<int>();
+			file.read(lightmapWidth);
+			file.read(lightmapHeight);
+			file.read(gridSizeCell);
 
-			if (tile->lightmapIndex < 0 || tile->lightmapIndex == (unsigned short)-1)
+			//Fix lightmap format if it was invalid. by Henko
+			if (lightmapWidth <= 0 || lightmapHeight <= 0 || gridSizeCell == 0 || lightmapWidth * lightmapHeight > 256 * 256)
 			{
-				std::cout << "GND: Lightmapindex < 0" << std::endl;
-				tile->lightmapIndex = 0;
+				std::cerr << "GND: Invalid Lightmap Format in " << fileName << ".gnd" << std::endl;
+				lightmapWidth = 8;
+				lightmapHeight = 8;
+				gridSizeCell = 1;
 			}
-
-			if (tile->textureIndex < 0 || tile->textureIndex >= textureCount)
+			const std::size_t lightmapSize = lightmapWidth * lightmapHeight * 4;
+			if (lightmapCount < 0 || (std::size_t)lightmapCount > file.remaining() / lightmapSize)
+				throw std::out_of_range("invalid lightmap count");
+
+			//identical lightmaps are merged while loading, lightmapRemap maps the indices in the file to the merged ones
+			//the lightmaps are copied straight from the file buffer
+			std::vector<int> lightmapRemap(lightmapCount);
+			const unsigned char* lightmapData = reinterpret_cast<const unsigned char*>(file.ptr());
+			file.skip(lightmapCount * lightmapSize);
+			for (int i = 0; i < lightmapCount; i++)
+				lightmapRemap[i] = addLightmap(lightmapData + i * lightmapSize);
+			std::cout << "GND: " << lightmapCount << " lightmaps, " << lightmaps.size() << " unique" << std::endl;
+
+			int tileCount = file.read<int>();
+			std::cout << "GND: Tilecount: " << tileCount << std::endl;
+			if (tileCount < 0)
+				throw std::out_of_range("invalid tile count");
+			std::vector<GndFileTile> fileTiles;
+			file.readArray(fileTiles, tileCount);
+			tiles.reserve(tileCount);
+			for (const auto& t : fileTiles)
 			{
-				std::cout << "GND: TextureIndex < 0" << std::endl;
-				tile->textureIndex = 0;
-			}
+				Tile* tile = new Tile();
+				tile->v1 = glm::vec2(t.u[0], t.v[0]);
+				tile->v2 = glm::vec2(t.u[1], t.v[1]);
+				tile->v3 = glm::vec2(t.u[2], t.v[2]);
+				tile->v4 = glm::vec2(t.u[3], t.v[3]);
 
-			tile->color.b = (unsigned char)file->get();
-			tile->color.g = (unsigned char)file->get();
-			tile->color.r = (unsigned char)file->get();
-			tile->color.a = (unsigned char)file->get();
-			tiles.push_back(tile);
-		}
-		std::cout << "At " << file->tellg() << std::endl;
-		cubes.resize(width, std::vector<Cube*>(height, NULL));
-		for (int y = 0; y < height; y++)
-		{
-			for (int x = 0; x < width; x++)
-			{
-				Cube* cube = new Cube();
-				file->read(reinterpret_cast<char*>(&cube->h1), sizeof(float));
-				file->read(reinterpret_cast<char*>(&cube->h2), sizeof(float));
-				file->read(reinterpret_cast<char*>(&cube->h3), sizeof(float));
-				file->read(reinterpret_cast<char*>(&cube->h4), sizeof(float));
-				cube->calcNormal();
+				tile->textureIndex = t.textureIndex;
+				tile->lightmapIndex = t.lightmapIndex < lightmapRemap.size() ? lightmapRemap[t.lightmapIndex] : t.lightmapIndex;
 
-				
+				if (tile->lightmapIndex < 0 || tile->lightmapIndex == (unsigned short)-1)
+				{
+					std::cout << "GND: Lightmapindex < 0" << std::endl;
+					tile->lightmapIndex = 0;
+				}
 
-				if (version >= 0x0106)
+				if (tile->textureIndex < 0 || tile->textureIndex >= textureCount)
 				{
-					file->read(reinterpret_cast<char*>(&cube->tileUp), sizeof(int));
-					file->read(reinterpret_cast<char*>(&cube->tileFront), sizeof(int));
-					file->read(reinterpret_cast<char*>(&cube->tileSide), sizeof(int));
-					for (int i = 0; i < 3; i++)
-						if (cube->tileIds[i] < 0)
-							cube->tileIds[i] = -1;
+					std::cout << "GND: TextureIndex < 0" << std::endl;
+					tile->textureIndex = 0;
 				}
-				else
+
+				tile->color.b = t.color[0];
+				tile->color.g = t.color[1];
+				tile->color.r = t.color[2];
+				tile->color.a = t.color[3];
+				tiles.push_back(tile);
+			}
+			std::cout << "At " << file.tell() << std::endl;
+
+			std::vector<GndFileCube> fileCubes;
+			if (version >= 0x0106)
+				file.readArray(fileCubes, (std::size_t)width * height);
+			else
+			{
+				std::vector<GndFileCubeOld> fileCubesOld;
+				file.readArray(fileCubesOld, (std::size_t)width * height);
+				fileCubes.reserve(fileCubesOld.size());
+				for (const auto& c : fileCubesOld)
+					fileCubes.push_back(GndFileCube{ { c.heights[0], c.heights[1], c.heights[2], c.heights[3] }, c.tileUp, c.tileFront, c.tileSide });
+			}
+
+			cubes.resize(width, std::vector<Cube*>(height, NULL));
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
 				{
-					short up, side, front, unknown;
-					file->read(reinterpret_cast<char*>(&up), sizeof(short));
-					file->read(reinterpret_cast<char*>(&front), sizeof(short));
-					file->read(reinterpret_cast<char*>(&side), sizeof(short));
-					file->read(reinterpret_cast<char*>(&unknown), sizeof(short));
-
-					cube->tileUp = up;
-					cube->tileSide = side;
-					cube->tileFront = front;
-					for(int i = 0; i < 3; i++)
+					const GndFileCube& c = fileCubes[x + y * width];
+					Cube* cube = new Cube();
+					for (int i = 0; i < 4; i++)
+						cube->heights[i] = c.heights[i];
+					cube->calcNormal();
+
+					cube->tileUp = c.tileUp;
+					cube->tileFront = c.tileFront;
+					cube->tileSide = c.tileSide;
+					for (int i = 0; i < 3; i++)
 						if (cube->tileIds[i] < 0)
 							cube->tileIds[i] = -1;
-				}
 
-				if (cube->tileUp >= (int)tiles.size() || cube->tileUp < -1)
-				{
-					std::cout << "GND: Wrong value for tileup at " << x << ", " << y << ", Found " << cube->tileUp << ", but only " << tiles.size() << " tiles found" << std::endl;
-					cube->tileUp = -1;
-				}
-				if (cube->tileSide >= (int)tiles.size() || cube->tileSide < -1)
-				{
-					std::cout << "GND: Wrong value for tileside at " << x << ", " << y << std::endl;
-					cube->tileSide = -1;
-				}
-				if (cube->tileFront >= (int)tiles.size() || cube->tileFront < -1)
-				{
-					std::cout << "GND: Wrong value for tilefront at " << x << ", " << y << std::endl;
-					cube->tileFront = -1;
-				}
+					if (cube->tileUp >= (int)tiles.size() || cube->tileUp < -1)
+					{
+						std::cout << "GND: Wrong value for tileup at " << x << ", " << y << ", Found " << cube->tileUp << ", but only " << tiles.size() << " tiles found" << std::endl;
+						cube->tileUp = -1;
+					}
+					if (cube->tileSide >= (int)tiles.size() || cube->tileSide < -1)
+					{
+						std::cout << "GND: Wrong value for tileside at " << x << ", " << y << std::endl;
+						cube->tileSide = -1;
+					}
+					if (cube->tileFront >= (int)tiles.size() || cube->tileFront < -1)
+					{
+						std::cout << "GND: Wrong value for tilefront at " << x << ", " << y << std::endl;
+						cube->tileFront = -1;
+					}
 
-				cubes[x][y] = cube;
+					cubes[x][y] = cube;
+				}
 			}
 		}
-	}
-	else
-	{
-		cubes.resize(width, std::vector<Cube*>(height, NULL));
-		for (int y = 0; y < height; y++)
+		else
 		{
-			for (int x = 0; x < width; x++)
+			cubes.resize(width, std::vector<Cube*>(height, NULL));
+			for (int y = 0; y < height; y++)
 			{
-				Cube* cube = new Cube();
-
-				int textureUp = -1;
-				int textureFront = -1;
-				int textureSide = -1;
+				for (int x = 0; x < width; x++)
+				{
+					Cube* cube = new Cube();
+					cubes[x][y] = cube;
 
-				file->read(reinterpret_cast<char*>(&textureUp), sizeof(int));
-				file->read(reinterpret_cast<char*>(&textureFront), sizeof(int));
-				file->read(reinterpret_cast<char*>(&textureSide), sizeof(int));
+					int textureUp = file.read<int>();
+					int textureFront = file.read<int>();
+					int textureSide = file.read<int>();
 
-				file->read(reinterpret_cast<char*>(&cube->h1), sizeof(float));
-				file->read(reinterpret_cast<char*>(&cube->h2), sizeof(float));
-				file->read(reinterpret_cast<char*>(&cube->h3), sizeof(float));
-				file->read(reinterpret_cast<char*>(&cube->h4), sizeof(float));
+					file.read(cube->heights, sizeof(float) * 4);
 
-				char buf[132];
-				file->read(buf, 4); // dunno?
+					file.skip(4); // dunno?
 
-				if (textureUp > -1)
-				{
-					cube->tileUp = (int)tiles.size();
-					Tile* t = new Tile();
-					tiles.push_back(t);
-					for(int i = 0; i < 4; i++)
-						file->read(reinterpret_cast<char*>(glm::value_ptr(t->texCoords[i])), 2 * sizeof(float));
-					t->textureIndex = textureUp;
-				}
-				if (textureSide > -1)
-				{
-					cube->tileSide = (int)tiles.size();
-					Tile* t = new Tile();
-					tiles.push_back(t);
-					for (int i = 0; i < 4; i++)
-						file->read(reinterpret_cast<char*>(glm::value_ptr(t->texCoords[i])), 2 * sizeof(float));
-					t->textureIndex = textureSide;
-				}
-				if (textureFront > -1)
-				{
-					cube->tileFront = (int)tiles.size();
-					Tile* t = new Tile();
-					tiles.push_back(t);
-					for (int i = 0; i < 4; i++)
-						file->read(reinterpret_cast<char*>(glm::value_ptr(t->texCoords[i])), 2 * sizeof(float));
-					t->textureIndex = textureFront;
+					auto readTile = [&](int textureIndex)
+					{
+						Tile* t = new Tile();
+						tiles.push_back(t);
+						file.read(t->texCoords, sizeof(glm::vec2) * 4);
+						t->textureIndex = textureIndex;
+						return (int)tiles.size() - 1;
+					};
+					if (textureUp > -1)
+						cube->tileUp = readTile(textureUp);
+					if (textureSide > -1)
+						cube->tileSide = readTile(textureSide);
+					if (textureFront > -1)
+						cube->tileFront = readTile(textureFront);
 				}
-				cubes[x][y] = cube;
 			}
 		}
 	}
-	delete file;
+	catch (const std::out_of_range& e)
+	{
+		std::cerr << "GND: Error reading gnd file " << fileName << ": " << e.what() << std::endl;
+		for (auto t : textures)
+			delete t;
+		textures.clear();
+		for (auto l : lightmaps)
+			delete l;
+		lightmaps.clear();
+		lightmapLookup.clear();
+		lightmapLookupCount = 0;
+		lightmapRefs.clear();
+		for (auto t : tiles)
+			delete t;
+		tiles.clear();
+		for (auto r : cubes)
+			for (auto c : r)
+				delete c;
+		cubes.clear();
+		width = 0;
+		height = 0;
+		return;
+	}
 	std::cout << "GND: Done reading gnd file" << std::endl;
 
 	for (int x = 0; x < width; x++)
@@ -259,6 +284,7 @@ Gnd::Gnd(const std::string& fileName)
 
 Gnd::Gnd(int width, int height)
 {
+	trackMemory();
 	this->width = width;
 	this->height = height;
 	this->version = 0x0107;
@@ -292,6 +318,7 @@ Gnd::Gnd(int width, int height)
 
 Gnd::~Gnd()
 {
+	util::MemoryTracker::remove(this);
 	for (auto t : textures)
 		delete t;
 	for (auto l : lightmaps)
@@ -305,72 +332,70 @@ Gnd::~Gnd()
 
 void Gnd::save(const std::string& fileName)
 {
-	std::ofstream file(fileName.c_str(), std::ios_base::binary | std::ios_base::out);
-	if (!file.is_open())
-	{
-		std::cerr << "GND: Unable to open gnd file: " << fileName << std::endl;
-		return;
-	}
-	std::cout << "GND: Reading gnd file" << std::endl;
+	auto data = serialize();
+	if (!util::FileIO::writeFileAtomic(fileName, data.data(), data.size()))
+		std::cerr << "GND: Unable to write gnd file: " << fileName << std::endl;
+}
+
+std::vector<char> Gnd::serialize()
+{
+	std::cout << "GND: Writing gnd file" << std::endl;
+	const int lightmapSize = lightmapWidth * lightmapHeight * 4;
+	util::ByteWriter file(26 + textures.size() * 80 + 16 + lightmaps.size() * lightmapSize + 4 + tiles.size() * 40 + width * height * 28);
 	char header[4] = { 'G', 'R', 'G', 'N'};
 	file.write(header, 4);
-	version = util::swapShort(version);
-	file.write(reinterpret_cast<char*>(&version), sizeof(short));
-	version = util::swapShort(version);
+	file.write(util::swapShort(version));
 
 	int textureCount = (int)textures.size();
 	if (version > 0)
 	{
-		file.write(reinterpret_cast<char*>(&width), sizeof(int));
-		file.write(reinterpret_cast<char*>(&height), sizeof(int));
-		file.write(reinterpret_cast<char*>(&tileScale), sizeof(float));
-		file.write(reinterpret_cast<char*>(&textureCount), sizeof(int));
-		file.write(reinterpret_cast<char*>(&maxTexName), sizeof(int)); //80
+		file.write(width);
+		file.write(height);
+		file.write(tileScale);
+		file.write(textureCount);
+		file.write(maxTexName); //80
 	}
 	else
 	{
-		file.put(0); file.put(0); file.put(0); file.put(0); file.put(0); file.put(0);
-		file.write(reinterpret_cast<char*>(&width), sizeof(int));
-		file.write(reinterpret_cast<char*>(&height), sizeof(int));
-		file.write(reinterpret_cast<char*>(&textureCount), sizeof(int));
+		file.write("\0\0\0\0\0\0", 6);
+		file.write(width);
+		file.write(height);
+		file.write(textureCount);
 	}
 
 	for (auto texture : textures)
 	{
-		util::FileIO::writeString(file, texture->file, 40);
-		util::FileIO::writeString(file, texture->name, 40);
+		file.writeString(texture->file, 40);
+		file.writeString(texture->name, 40);
 	}
 
 	if (version > 0)
 	{
-		int lightmapCount = (int)lightmaps.size();
-		file.write(reinterpret_cast<char*>(&lightmapCount), sizeof(int));
-		file.write(reinterpret_cast<char*>(&lightmapWidth), sizeof(int));
-		file.write(reinterpret_cast<char*>(&lightmapHeight), sizeof(int));
-		file.write(reinterpret_cast<char*>(&gridSizeCell), sizeof(int));
-
-		for (auto lightmap : lightmaps)
-			file.write((char*)lightmap->data, lightmapWidth*lightmapHeight*4);
+		//only write the lightmaps that are used, and each distinct lightmap once
+		std::vector<Lightmap*> uniqueLightmaps;
+		std::vector<int> lightmapRemap = dedupLightmaps(uniqueLightmaps);
+		int lightmapCount = (int)uniqueLightmaps.size();
+		file.write(lightmapCount);
+		file.write(lightmapWidth);
+		file.write(lightmapHeight);
+		file.write(gridSizeCell);
+
+		for (auto lightmap : uniqueLightmaps)
+			file.write(lightmap->data, lightmapSize);
 
 		int tileCount = (int)tiles.size();
-		file.write(reinterpret_cast<char*>(&tileCount), sizeof(int));
+		file.write(tileCount);
 		for (auto tile : tiles)
 		{
-			file.write(reinterpret_cast<char*>(&tile->v1.x), sizeof(float));
-			file.write(reinterpret_cast<char*>(&tile->v2.x), sizeof(float));
-			file.write(reinterpret_cast<char*>(&tile->v3.x), sizeof(float));
-			file.write(reinterpret_cast<char*>(&tile->v4.x), sizeof(float));
-			file.write(reinterpret_cast<char*>(&tile->v1.y), sizeof(float));
-			file.write(reinterpret_cast<char*>(&tile->v2.y), sizeof(float));
-			file.write(reinterpret_cast<char*>(&tile->v3.y), sizeof(float));
-			file.write(reinterpret_cast<char*>(&tile->v4.y), sizeof(float));
-
-			file.write(reinterpret_cast<char*>(&tile->textureIndex), sizeof(short));
+			float texCoords[8] = { tile->v1.x, tile->v2.x, tile->v3.x, tile->v4.x, tile->v1.y, tile->v2.y, tile->v3.y, tile->v4.y };
+			file.write(texCoords, sizeof(texCoords));
+
+			file.write(tile->textureIndex);
 			unsigned short lightmapIndex;
 			if (tile->lightmapIndex < -1 || tile->lightmapIndex > std::numeric_limits<unsigned short>::max())
 				std::cout << "ERROR, LIGHTMAP INDEX OUT OF BOUNDS" << std::endl;
-			lightmapIndex = tile->lightmapIndex;
-			file.write(reinterpret_cast<char*>(&lightmapIndex), sizeof(unsigned short));
+			lightmapIndex = tile->lightmapIndex >= 0 && tile->lightmapIndex < (int)lightmapRemap.size() ? lightmapRemap[tile->lightmapIndex] : tile->lightmapIndex;
+			file.write(lightmapIndex);
 
 
 			if (tile->lightmapIndex < 0 || tile->lightmapIndex == (unsigned short)-1)
@@ -379,10 +404,8 @@ void Gnd::save(const std::string& fileName)
 				tile->lightmapIndex = 0;
 			}
 
-			file.put(tile->color.b);
-			file.put(tile->color.g);
-			file.put(tile->color.r);
-			file.put(tile->color.a);
+			unsigned char color[4] = { (unsigned char)tile->color.b, (unsigned char)tile->color.g, (unsigned char)tile->color.r, (unsigned char)tile->color.a };
+			file.write(color, 4);
 		}
 
 		for (int y = 0; y < height; y++)
@@ -390,17 +413,10 @@ void Gnd::save(const std::string& fileName)
 			for (int x = 0; x < width; x++)
 			{
 				Cube* cube = cubes[x][y];
-				file.write(reinterpret_cast<char*>(&cube->h1), sizeof(float));
-				file.write(reinterpret_cast<char*>(&cube->h2), sizeof(float));
-				file.write(reinterpret_cast<char*>(&cube->h3), sizeof(float));
-				file.write(reinterpret_cast<char*>(&cube->h4), sizeof(float));
+				file.write(cube->heights, sizeof(float) * 4);
 
 				if (version >= 0x0106)
-				{
-					file.write(reinterpret_cast<char*>(&cube->tileUp), sizeof(int));
-					file.write(reinterpret_cast<char*>(&cube->tileFront), sizeof(int));
-					file.write(reinterpret_cast<char*>(&cube->tileSide), sizeof(int));
-				}
+					file.write(cube->tileIds, sizeof(int) * 3);
 				else
 				{
 					unsigned short up, side, front;
@@ -409,9 +425,9 @@ void Gnd::save(const std::string& fileName)
 					side = cube->tileSide;
 
 
-					file.write(reinterpret_cast<char*>(&up), sizeof(unsigned short));
-					file.write(reinterpret_cast<char*>(&front), sizeof(unsigned short));
-					file.write(reinterpret_cast<char*>(&side), sizeof(unsigned short));
+					file.write(up);
+					file.write(front);
+					file.write(side);
 
 				}
 			}
@@ -422,12 +438,14 @@ void Gnd::save(const std::string& fileName)
 		//TODO: port code...too lazy for now
 	}
 	std::cout << "GND: Done saving GND" << std::endl;
+	return std::move(file.data);
 }
 
 
 
 glm::vec3 Gnd::rayCast(const math::Ray& ray, bool emptyTiles, int xMin, int yMin, int xMax, int yMax, float rayOffset)
 {
+	PROFILE_COUNT("Rays cast", 1);
 	if (cubes.size() == 0)
 		return glm::vec3(std::numeric_limits<float>::max());
 
@@ -539,22 +557,9 @@ void Gnd::makeLightmapsUnique()
 {
 	makeTilesUnique();
 	cleanLightmaps(); 
-	std::set<int> taken;
+	countLightmapRefs();
 	for (Tile* t : tiles)
-	{
-		if (t->lightmapIndex != -1 && taken.find(t->lightmapIndex) == taken.end())
-			taken.insert(t->lightmapIndex);
-		else
-		{
-			Lightmap* l;
-			if(t->lightmapIndex == -1)
-				l = new Lightmap(this);
-			else
-				l = new Lightmap(*lightmaps[t->lightmapIndex]);
-			t->lightmapIndex = (int)lightmaps.size();
-			lightmaps.push_back(l);
-		}
-	}
+		getWritableLightmap(t);
 	node->getComponent<GndRenderer>()->setChunksDirty();
 	node->getComponent<GndRenderer>()->gndShadowDirty = true;
 
@@ -562,7 +567,12 @@ void Gnd::makeLightmapsUnique()
 
 void Gnd::makeLightmapsClear()
 {
+	for (auto l : lightmaps)
+		delete l;
 	lightmaps.clear();
+	lightmapLookup.clear();
+	lightmapLookupCount = 0;
+	lightmapRefs.clear();
 	Lightmap* l = new Lightmap(this);
 	lightmaps.push_back(l);
 
@@ -580,6 +590,9 @@ void Gnd::makeLightmapsDiffRes(int rx, int ry)
 	for (auto l : lightmaps)
 		delete l;
 	lightmaps.clear();
+	lightmapLookup.clear();
+	lightmapLookupCount = 0;
+	lightmapRefs.clear();
 	Lightmap* l = new Lightmap(this);
 	lightmaps.push_back(l);
 
@@ -762,13 +775,15 @@ void Gnd::buildImGui(BrowEdit* browEdit)
 	ImGui::LabelText("lightmapWidth", "%d", lightmapWidth);
 	ImGui::LabelText("lightmapHeight", "%d", gridSizeCell);
 	ImGui::LabelText("gridSizeCell", "%d", lightmapHeight);
+	ImGui::LabelText("Lightmaps", "%zu (%.2f MB)", lightmaps.size(), lightmapMemoryUsage() / (1024.0f * 1024.0f));
 
 }
 
 
 void Gnd::makeLightmapBorders(BrowEdit* browEdit)
 {
-	makeLightmapsUnique();
+	makeTilesUnique();
+	countLightmapRefs();
 	std::cout<< "Fixing borders" << std::endl;
 
 	for (int x = 0; x < width; x++)
@@ -784,9 +799,7 @@ void Gnd::makeLightmapBorders(BrowEdit* browEdit)
 				if (cube->tileIds[i] == -1)
 					continue;
 				auto tile = tiles[cube->tileIds[i]];
-				if (tile->lightmapIndex == -1)
-					continue;
-				auto &lightmap = *lightmaps[tile->lightmapIndex];
+				auto &lightmap = *getWritableLightmap(tile);
 				//first just expand the texture in case there's no neighbour
 				lightmap.expandBorders();
 
@@ -830,61 +843,152 @@ void Gnd::makeLightmapBorders(BrowEdit* browEdit)
 			}
 		}
 	}
-	node->getComponent<GndRenderer>()->setChunksDirty();
-	node->getComponent<GndRenderer>()->gndShadowDirty = true;
+	auto gndRenderer = node->getComponent<GndRenderer>();
+	if (gndRenderer) //there is no renderer in batch mode
+	{
+		gndRenderer->setChunksDirty();
+		gndRenderer->gndShadowDirty = true;
+	}
 }
 
 
 void Gnd::cleanLightmaps()
 {
 	std::cout<< "Lightmap cleanup, starting with " << lightmaps.size() << " lightmaps" <<std::endl;
-	std::map<unsigned char, std::vector<std::size_t>> lookup;
+	std::vector<Lightmap*> uniqueLightmaps;
+	std::vector<int> remap = dedupLightmaps(uniqueLightmaps);
+	if (uniqueLightmaps.empty() && !lightmaps.empty())
+	{ //keep at least 1 lightmap
+		uniqueLightmaps.push_back(lightmaps[0]);
+		remap[0] = 0;
+	}
+	for (std::size_t i = 0; i < lightmaps.size(); i++)
+		if (remap[i] == -1 || uniqueLightmaps[remap[i]] != lightmaps[i])
+			delete lightmaps[i];
+	for (auto tile : tiles)
+		if (tile->lightmapIndex >= 0 && tile->lightmapIndex < (int)remap.size())
+			tile->lightmapIndex = remap[tile->lightmapIndex];
+	lightmaps = std::move(uniqueLightmaps);
+	lightmapLookup.clear();
+	lightmapLookupCount = 0;
+	lightmapRefs.clear();
 
-	for (int i = 0; i < (int)lightmaps.size(); i++)
+	std::cout<< "Lightmap cleanup, ending with " << lightmaps.size() << " lightmaps" << std::endl;
+	auto gndRenderer = node->getComponent<GndRenderer>();
+	if (gndRenderer)
 	{
-		unsigned char hash = lightmaps[i]->hash();
-		bool found = false;
-		if (lookup.find(hash) != lookup.end())
-		{
-			for (const auto ii : lookup[hash])
+		gndRenderer->setChunksDirty();
+		gndRenderer->gndShadowDirty = true;
+	}
+
+}
+
+//Finds the lightmaps that are used by tiles, and merges the ones with the same data. unique gets the remaining lightmaps,
+//the returned vector has the new index for every lightmap, or -1 if it is not used
+std::vector<int> Gnd::dedupLightmaps(std::vector<Lightmap*>& unique)
+{
+	std::vector<int> remap(lightmaps.size(), -1);
+	std::vector<bool> used(lightmaps.size(), false);
+	for (auto tile : tiles)
+		if (tile->lightmapIndex >= 0 && tile->lightmapIndex < (int)lightmaps.size())
+			used[tile->lightmapIndex] = true;
+
+	std::unordered_map<std::uint64_t, std::vector<int>> lookup;
+	lookup.reserve(lightmaps.size());
+	for (std::size_t i = 0; i < lightmaps.size(); i++)
+	{
+		if (!used[i])
+			continue;
+		auto& bucket = lookup[lightmaps[i]->hash()];
+		for (int ii : bucket)
+			if (*unique[ii] == *lightmaps[i])
 			{
-				if ((*lightmaps[i]) == (*lightmaps[ii]))
-				{// if it is found
-					assert(i > (int)ii);
-					//change all tiles with lightmap i to ii
-					for (auto tile : tiles)
-						if (tile->lightmapIndex == i)
-							tile->lightmapIndex = (unsigned short)ii;
-						else if (tile->lightmapIndex > i)
-							tile->lightmapIndex--;
-					//remove lightmap i
-					delete lightmaps[i];
-					lightmaps.erase(lightmaps.begin() + i);
-					i--;
-					found = true;
-					break;
-				}
+				remap[i] = ii;
+				break;
 			}
-		}
-		if (!found)
+		if (remap[i] == -1)
 		{
-			lookup[hash].push_back(i);
+			remap[i] = (int)unique.size();
+			bucket.push_back(remap[i]);
+			unique.push_back(lightmaps[i]);
 		}
+	}
+	return remap;
+}
 
+int Gnd::addLightmap(const unsigned char* data)
+{
+	const std::size_t size = lightmapWidth * lightmapHeight * 4;
+	//lightmaps can also be added directly to the lightmaps vector, those are added to the lookup here
+	if (lightmapLookupCount > lightmaps.size())
+	{
+		lightmapLookup.clear();
+		lightmapLookupCount = 0;
 	}
+	for (; lightmapLookupCount < lightmaps.size(); lightmapLookupCount++)
+		lightmapLookup[lightmaps[lightmapLookupCount]->hash()].push_back((int)lightmapLookupCount);
+
+	auto& bucket = lightmapLookup[Lightmap::hash(data, size)];
+	for (int i : bucket)
+		if (i < (int)lightmaps.size() && memcmp(lightmaps[i]->data, data, size) == 0)
+			return i;
+
+	Lightmap* lightmap = new Lightmap(this);
+	memcpy(lightmap->data, data, size);
+	bucket.push_back((int)lightmaps.size());
+	lightmaps.push_back(lightmap);
+	lightmapLookupCount++;
+	return (int)lightmaps.size() - 1;
+}
 
-	std::cout<< "Lightmap cleanup, ending with " << lightmaps.size() << " lightmaps" << std::endl;
-	node->getComponent<GndRenderer>()->setChunksDirty();
-	node->getComponent<GndRenderer>()->gndShadowDirty = true;
+void Gnd::countLightmapRefs()
+{
+	lightmapRefs.assign(lightmaps.size(), 0);
+	for (auto tile : tiles)
+		if (tile->lightmapIndex >= 0 && tile->lightmapIndex < (int)lightmaps.size())
+			lightmapRefs[tile->lightmapIndex]++;
+}
+
+Gnd::Lightmap* Gnd::getWritableLightmap(Tile* tile)
+{
+	lightmapRefs.resize(lightmaps.size(), 0);
+	int index = tile->lightmapIndex;
+	bool valid = index >= 0 && index < (int)lightmaps.size();
+	if (valid && lightmapRefs[index] <= 1)
+	{
+		lightmapRefs[index] = 1;
+		return lightmaps[index];
+	}
+	//shared (or no lightmap yet), so give this tile its own copy
+	Lightmap* lightmap = valid ? new Lightmap(*lightmaps[index]) : new Lightmap(this);
+	if (valid)
+		lightmapRefs[index]--;
+	tile->lightmapIndex = (int)lightmaps.size();
+	lightmaps.push_back(lightmap);
+	lightmapRefs.push_back(1);
+	return lightmap;
+}
 
+void Gnd::trackMemory()
+{
+	util::MemoryTracker::addSource(this, "GND lightmaps", util::MemoryTracker::Type::Cpu, [this]() { return lightmapMemoryUsage(); });
+	util::MemoryTracker::addSource(this, "GND tiles", util::MemoryTracker::Type::Cpu, [this]() { return tiles.size() * (sizeof(Tile) + sizeof(Tile*)) + (std::size_t)width * height * (sizeof(Cube) + sizeof(Cube*)); });
+}
+
+std::size_t Gnd::lightmapMemoryUsage()
+{
+	std::size_t size = lightmapSlab.memoryUsage();
+	size += (lightmaps.size() - glm::min(lightmaps.size(), lightmapSlab.recordCount())) * lightmapWidth * lightmapHeight * 4; //lightmaps that are not in the slab
+	size += lightmaps.size() * (sizeof(Lightmap) + sizeof(Lightmap*));
+	return size;
 }
 
 
 void Gnd::makeLightmapsSmooth(BrowEdit* browEdit)
 {
 	makeTilesUnique();
-	makeLightmapsUnique();
 	makeLightmapBorders(browEdit);
+	countLightmapRefs();
 	std::cout << "Smoothing..." << std::endl;
 	for (int x = 0; x < width; x++)
 	{
@@ -895,8 +999,7 @@ void Gnd::makeLightmapsSmooth(BrowEdit* browEdit)
 			if (tileId == -1)
 				continue;
 			Gnd::Tile* tile = tiles[tileId];
-			assert(tile && tile->lightmapIndex != -1);
-			Gnd::Lightmap* lightmap = lightmaps[tile->lightmapIndex];
+			Gnd::Lightmap* lightmap = getWritableLightmap(tile);
 
 			char newData[64];
 
@@ -932,124 +1035,77 @@ void Gnd::cleanTiles()
 					used.insert(cubes[x][y]->tileIds[i]);
 	std::cout << "Made list of used tiles..." <<used.size()<< std::endl;
 
-	std::list<std::size_t> toRemove;
+	//new index for every tile, so the cubes only have to be updated once instead of once for every removed tile
+	std::vector<int> remap(tiles.size(), -1);
+	std::vector<Tile*> usedTiles;
+	usedTiles.reserve(used.size());
 	for (std::size_t i = 0; i < tiles.size(); i++)
-		if (used.find((int)i) == used.end())
-			toRemove.push_back(i);
-	toRemove.reverse();
-	std::cout << "Made list of unused tiles..." << toRemove.size()<<std::endl;
-
-	//TODO: make an array of tiles.size() long, initialize at 0. loop through toRemove, and increase values in array to be the amount to lower. Then use as lookup
-
-	for (std::size_t i : toRemove)
 	{
-		tiles.erase(tiles.begin() + i);
-		for (int y = 0; y < height; y++)
-			for (int x = 0; x < width; x++)
-				for(int ii = 0; ii < 3; ii++)
-					if (cubes[x][y]->tileIds[ii] > (int)i)
-						cubes[x][y]->tileIds[ii]--;
+		if (used.find((int)i) == used.end())
+			continue; //not deleted, undo actions can still point to it
+		remap[i] = (int)usedTiles.size();
+		usedTiles.push_back(tiles[i]);
 	}
+	std::cout << "Removing " << tiles.size() - usedTiles.size() << " unused tiles..." << std::endl;
+	tiles = std::move(usedTiles);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			for (int ii = 0; ii < 3; ii++)
+				if (cubes[x][y]->tileIds[ii] >= 0 && cubes[x][y]->tileIds[ii] < (int)remap.size())
+					cubes[x][y]->tileIds[ii] = remap[cubes[x][y]->tileIds[ii]];
 	std::cout<< "Tiles cleanup, ending with " << tiles.size() << " tiles" << std::endl;
 }
 
 void Gnd::recalculateNormals()
 {
-	for (int x = 0; x < width; x++)
-		for (int y = 0; y < height; y++)
+	recalculateNormals(glm::ivec2(0, 0), glm::ivec2(width - 1, height - 1));
+}
+
+void Gnd::recalculateNormals(const glm::ivec2& min, const glm::ivec2& max)
+{
+	//the smoothed normals also use the cubes around the changed ones, so those need to be updated as well
+	glm::ivec2 from = glm::max(glm::ivec2(0, 0), min);
+	glm::ivec2 to = glm::min(glm::ivec2(width - 1, height - 1), max);
+	for (int x = from.x; x <= to.x; x++)
+		for (int y = from.y; y <= to.y; y++)
 			cubes[x][y]->calcNormal();
 
-	for (int x = 0; x < width; x++)
-		for (int y = 0; y < height; y++)
+	from = glm::max(glm::ivec2(0, 0), min - 1);
+	to = glm::min(glm::ivec2(width - 1, height - 1), max + 1);
+	for (int x = from.x; x <= to.x; x++)
+		for (int y = from.y; y <= to.y; y++)
 			cubes[x][y]->calcNormals(this, x, y);
 }
 
 void Gnd::flattenTiles(Map* map, BrowEdit* browEdit, const std::vector<glm::ivec2>& tiles)
 {
 	auto action = new CubeHeightChangeAction<Gnd, Gnd::Cube>(this, tiles);
-	float avg = 0;
-	for (auto& t : map->tileSelection)
-		for (int i = 0; i < 4; i++)
-			avg += cubes[t.x][t.y]->heights[i];
-	avg /= map->tileSelection.size() * 4;
-	for (auto& t : map->tileSelection)
-		for (int i = 0; i < 4; i++)
-			cubes[t.x][t.y]->heights[i] = avg;
+	util::HeightField field(tiles, glm::ivec2(width, height));
+	field.read(cubes);
+	field.flatten();
+	field.write(cubes);
 	action->setNewHeights(this, tiles);
 	map->doAction(action, browEdit);
-	node->getComponent<GndRenderer>()->setChunksDirty();
 }
 
 void Gnd::smoothTiles(Map* map, BrowEdit* browEdit, const std::vector<glm::ivec2>& tiles, int axis)
 {
+	PROFILE_SCOPE("Gnd::smoothTiles");
 	auto action = new CubeHeightChangeAction<Gnd, Gnd::Cube>(this, tiles);
-	glm::ivec2 offsets[] = {glm::ivec2(0, 0), glm::ivec2(1, 0) ,glm::ivec2(0, 1), glm::ivec2(1, 1)};
-
-
-	auto gndRenderer = node->getComponent<GndRenderer>();
-	std::vector<std::vector<std::pair<float,int>>> heights;
-	heights.resize(width + 1, std::vector<std::pair<float, int>>());
-	for (int x = 0; x <= width; x++)
-		heights[x].resize(height + 1);
-	for (int x = 0; x < width; x++)
-		for (int y = 0; y < height; y++)
-			for (auto i = 0; i < 4; i++)
-			{
-				if (std::find(tiles.begin(), tiles.end(), glm::ivec2(x, y)) == tiles.end())
-					continue;
-
-				heights[x + offsets[i].x][y + offsets[i].y].first += cubes[x][y]->heights[i];
-				heights[x + offsets[i].x][y + offsets[i].y].second++;
-			}
-
-
-	for (auto t : tiles)
-	{
-		for(int i = 0; i < 4; i++)
-		{
-			cubes[t.x][t.y]->heights[i] = 0;
-			int count = 0;
-			for (int x = -1; x <= 1; x++)
-			{
-				for (int y = -1; y <= 1; y++)
-				{
-					if ((axis & 1) == 0 && x != 0)
-						continue;
-					if ((axis & 2) == 0 && y != 0)
-						continue;
-					if (t.x + x + offsets[i].x >= 0 && t.x + x +offsets[i].x <= width && t.y + y + offsets[i].y >= 0 && t.y + y + offsets[i].y <= height)
-					{
-						//if (std::find(tiles.begin(), tiles.end(), glm::ivec2(t.x + x + offsets[i].x, t.y + y + offsets[i].y)) == tiles.end())
-						//	continue;
-
-						if (heights[t.x + x + offsets[i].x][t.y + y + offsets[i].y].second > 0)
-						{
-							cubes[t.x][t.y]->heights[i] += heights[t.x + x + offsets[i].x][t.y + y + offsets[i].y].first / heights[t.x + x + offsets[i].x][t.y + y + offsets[i].y].second;
-							count++;
-						}
-					}
-				}
-			}
-			if(count > 0)
-				cubes[t.x][t.y]->heights[i] /= count;
-		}
-	}
-	node->getComponent<GndRenderer>()->setChunksDirty();
+	util::HeightField field(tiles, glm::ivec2(width, height));
+	field.read(cubes);
+	field.smooth(axis);
+	field.write(cubes);
 	action->setNewHeights(this, tiles);
 	map->doAction(action, browEdit);
-	node->getComponent<GndRenderer>()->setChunksDirty();
 }
 
 void Gnd::addRandomHeight(Map* map, BrowEdit* browEdit, const std::vector<glm::ivec2>& tiles, float min, float max)
 {
 	auto action = new CubeHeightChangeAction<Gnd, Gnd::Cube>(this, tiles);
-	auto gndRenderer = node->getComponent<GndRenderer>();
 	for (auto tile : tiles)
-	{
 		for (int i = 0; i < 4; i++)
 			cubes[tile.x][tile.y]->heights[i] -= min + (rand() / (RAND_MAX / (max-min)));
-		gndRenderer->setChunkDirty(tile.x, tile.y);
-	}
 	action->setNewHeights(this, tiles);
 	map->doAction(action, browEdit);
 }
@@ -1057,17 +1113,10 @@ void Gnd::addRandomHeight(Map* map, BrowEdit* browEdit, const std::vector<glm::i
 void Gnd::connectHigh(Map* map, BrowEdit* browEdit, const std::vector<glm::ivec2>& tiles)
 {
 	auto action = new CubeHeightChangeAction<Gnd, Gnd::Cube>(this, tiles);
-	auto gndRenderer = node->getComponent<GndRenderer>();
-	for (auto t : tiles)
-		for (int i = 0; i < 4; i++)
-		{
-			float h = 9999999;
-			for (int ii = 0; ii < 4; ii++)
-				if(inMap(glm::ivec2(t.x + connectInfo[i][ii].x, t.y + connectInfo[i][ii].y)))
-					h = glm::min(h, cubes[t.x + connectInfo[i][ii].x][t.y + connectInfo[i][ii].y]->heights[connectInfo[i][ii].z]);
-			cubes[t.x][t.y]->heights[connectInfo[i][0].z] = h;
-			gndRenderer->setChunkDirty(t.x, t.y);
-		}
+	util::HeightField field(tiles, glm::ivec2(width, height), 1);
+	field.read(cubes);
+	field.connect(true);
+	field.write(cubes);
 	action->setNewHeights(this, tiles);
 	map->doAction(action, browEdit);
 }
@@ -1075,17 +1124,10 @@ void Gnd::connectHigh(Map* map, BrowEdit* browEdit, const std::vector<glm::ivec2
 void Gnd::connectLow(Map* map, BrowEdit* browEdit, const std::vector<glm::ivec2>& tiles)
 {
 	auto action = new CubeHeightChangeAction<Gnd, Gnd::Cube>(this, tiles);
-	auto gndRenderer = node->getComponent<GndRenderer>();
-	for (auto t : tiles)
-		for (int i = 0; i < 4; i++)
-		{
-			float h = -9999999;
-			for (int ii = 0; ii < 4; ii++)
-				if (inMap(glm::ivec2(t.x + connectInfo[i][ii].x, t.y + connectInfo[i][ii].y)))
-					h = glm::max(h, cubes[t.x + connectInfo[i][ii].x][t.y + connectInfo[i][ii].y]->heights[connectInfo[i][ii].z]);
-			cubes[t.x][t.y]->heights[connectInfo[i][0].z] = h;
-			gndRenderer->setChunkDirty(t.x, t.y);
-		}
+	util::HeightField field(tiles, glm::ivec2(width, height), 1);
+	field.read(cubes);
+	field.connect(false);
+	field.write(cubes);
 	action->setNewHeights(this, tiles);
 	map->doAction(action, browEdit);
 }
@@ -1102,16 +1144,19 @@ void Gnd::perlinNoise(const std::vector<glm::ivec2>& tiles)
 	noise.SetFractalOctaves(5);
 	noise.SetSeed(0);
 
-	for (auto tile : tiles)
-	{
-		for (int i = 0; i < 4; i++)
-		{
-			float x = (float)(tile.x + i % 2);
-			float y = (float)(tile.y + i / 2);
-			cubes[tile.x][tile.y]->heights[i] -= 1000 * noise.GetNoise(x,y);
-		}
-		gndRenderer->setChunkDirty(tile.x, tile.y);
-	}
+	util::HeightField field(tiles, glm::ivec2(width, height));
+	if (field.empty())
+		return;
+	//the noise is sampled once per corner point, instead of once for every cube touching it
+	std::vector<float> values((field.width + 1) * (field.height + 1));
+	for (int y = 0; y <= field.height; y++)
+		for (int x = 0; x <= field.width; x++)
+			values[x + y * (field.width + 1)] = noise.GetNoise((float)(field.min.x + x), (float)(field.min.y + y));
+	field.read(cubes);
+	field.add(values, -1000);
+	field.write(cubes);
+	recalculateNormals(field.min, field.max);
+	gndRenderer->setChunksDirty(field.min - 1, field.max + 1);
 	action->setNewHeights(this, tiles);
 //	map->doAction(action, browEdit);
 }
@@ -1274,16 +1319,62 @@ std::vector<glm::vec3> Gnd::getMapQuads()
 	return quads;
 }
 
-const unsigned char Gnd::Lightmap::hash() const //actually a crc, but will work
+std::uint64_t Gnd::Lightmap::hash() const
 {
-#define POLY 0x82f63b78
-	unsigned char crc = ~0;
-	for (int i = 0; i < gnd->lightmapWidth*gnd->lightmapHeight*4; i++) {
-		crc ^= data[i];
-		for (int k = 0; k < 8; k++)
-			crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
+	return hash(data, gnd->lightmapWidth * gnd->lightmapHeight * 4);
+}
+
+std::uint64_t Gnd::Lightmap::hash(const unsigned char* data, std::size_t size) //FNV-1a
+{
+	std::uint64_t ret = 14695981039346656037ull;
+	for (std::size_t i = 0; i < size; i++)
+		ret = (ret ^ data[i]) * 1099511628211ull;
+	return ret;
+}
+
+void Gnd::Lightmap::allocData()
+{
+	const std::size_t size = gnd->lightmapWidth * gnd->lightmapHeight * 4;
+	slab = &gnd->lightmapSlab;
+	data = slab->alloc(size);
+	if (!data)
+	{
+		slab = nullptr;
+		data = new unsigned char[size];
+	}
+}
+
+unsigned char* Gnd::LightmapSlab::alloc(std::size_t size)
+{
+	if (size != recordSize)
+	{
+		if (used > 0)
+			return nullptr;
+		blocks.clear();
+		freeRecords.clear();
+		recordSize = size;
+	}
+	if (freeRecords.empty())
+	{
+		blocks.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[recordsPerBlock * recordSize]));
+		for (std::size_t i = recordsPerBlock; i > 0; i--)
+			freeRecords.push_back(blocks.back().get() + (i - 1) * recordSize);
+	}
+	unsigned char* record = freeRecords.back();
+	freeRecords.pop_back();
+	used++;
+	return record;
+}
+
+void Gnd::LightmapSlab::free(unsigned char* record)
+{
+	freeRecords.push_back(record);
+	used--;
+	if (used == 0)
+	{ //give the memory back when everything is freed, like when the lightmaps are cleared
+		blocks.clear();
+		freeRecords.clear();
 	}
-	return ~crc;
 }
 
 
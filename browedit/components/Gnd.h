@@ -5,6 +5,9 @@
 #include <browedit/components/ImguiProps.h>
 #include <string>
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <browedit/math/Ray.h>
 #include <json.hpp>
@@ -23,6 +26,7 @@ public:
 	Gnd(int width, int height);
 	~Gnd();
 	void save(const std::string &fileName);
+	std::vector<char> serialize();
 	glm::vec3 rayCast(const math::Ray& ray, bool emptyTiles = false, int xMin = 0, int yMin = 0, int xMax = -1, int yMax = -1, float offset = 0.0f);
 	void makeLightmapsUnique();
 	void makeLightmapsClear();
@@ -34,6 +38,7 @@ public:
 	void removeZeroHeightWalls();
 	void cleanTiles();
 	void recalculateNormals();
+	void recalculateNormals(const glm::ivec2& min, const glm::ivec2& max); //only the cubes in this (inclusive) rectangle changed height
 
 	void flattenTiles(Map* map, BrowEdit* browEdit, const std::vector<glm::ivec2>& tiles);
 	void smoothTiles(Map* map, BrowEdit* browEdit, const std::vector<glm::ivec2>& tiles, int axis);
@@ -69,13 +74,32 @@ public:
 		bool operator == (const Texture& other) { return this->name == other.name && this->file == other.file; }
 	};
 
+	//Storage for the lightmap data, hands out records of a fixed size from big blocks, so every lightmap doesn't need its own allocation.
+	//The record size can only change when all records are freed. Not thread safe
+	class LightmapSlab
+	{
+		std::size_t recordSize = 0;
+		std::size_t used = 0;
+		std::vector<std::unique_ptr<unsigned char[]>> blocks;
+		std::vector<unsigned char*> freeRecords;
+	public:
+		static const std::size_t recordsPerBlock = 1024;
+		unsigned char* alloc(std::size_t size); //returns nullptr if size doesn't match the records that are in use
+		void free(unsigned char* record);
+		std::size_t memoryUsage() const { return blocks.size() * recordsPerBlock * recordSize; }
+		std::size_t recordCount() const { return used; }
+	};
+
 	class Lightmap
 	{
 	protected:
 		Lightmap() {
 			gnd = nullptr;
 			data = nullptr;
+			slab = nullptr;
 		}
+		LightmapSlab* slab; //where data came from, nullptr if it was allocated with new[]
+		void allocData();
 		friend class CopyCube;
 
 	public:
@@ -107,27 +131,30 @@ public:
 
 		Lightmap(Gnd* gnd) {
 			this->gnd = gnd;
-			this->data = new unsigned char[gnd->lightmapWidth * gnd->lightmapHeight * 4];
+			allocData();
 			memset(data, 255, gnd->lightmapWidth*gnd->lightmapHeight);
 			memset(data + gnd->lightmapWidth * gnd->lightmapHeight, 0, gnd->lightmapWidth * gnd->lightmapHeight * 3);
 		};
 		Lightmap(const Lightmap& other)
 		{
 			gnd = other.gnd;
-			this->data = new unsigned char[gnd->lightmapWidth * gnd->lightmapHeight * 4];
+			allocData();
 			if(other.data)
 				memcpy(data, other.data, gnd->lightmapWidth * gnd->lightmapHeight * 4 * sizeof(unsigned char));
 		}
 		~Lightmap()
 		{
-			if(data)
+			if (data && slab)
+				slab->free(data);
+			else if(data)
 				delete[] data;
 			data = nullptr;
 		}
 		unsigned char* data;
 		Gnd* gnd;
 		void expandBorders();
-		const unsigned char hash() const;
+		std::uint64_t hash() const;
+		static std::uint64_t hash(const unsigned char* data, std::size_t size);
 		bool operator == (const Lightmap& other) const;
 		LightmapRow operator [] (int x) { return LightmapRow{ this, x }; }
 		friend void to_json(nlohmann::json& nlohmann_json_j, const Lightmap& nlohmann_json_t) {
@@ -229,10 +256,19 @@ public:
 	inline int lightmapOffset() { return lightmapWidth * lightmapHeight; }
 	std::vector<Texture*> textures;
 	std::vector<Lightmap*> lightmaps;
+	LightmapSlab lightmapSlab;
+	std::vector<int> lightmapRefs; //amount of tiles using each lightmap, filled by countLightmapRefs and kept up to date by getWritableLightmap
 	std::vector<Tile*> tiles;
 	std::vector<std::vector<Cube*> > cubes;
 
 
+	//Lightmaps are shared between tiles with the same lightmap. addLightmap returns the index of an existing lightmap with the same data if there is one,
+	//getWritableLightmap gives a tile its own copy of its lightmap if it is shared (call countLightmapRefs before a batch of getWritableLightmap calls)
+	int addLightmap(const unsigned char* data);
+	void countLightmapRefs();
+	Lightmap* getWritableLightmap(Tile* tile);
+	std::size_t lightmapMemoryUsage();
+
 	Lightmap* getLightmapLeft(const glm::ivec3& pos, int& side);
 	Lightmap* getLightmapRight(const glm::ivec3& pos, int& side);
 	Lightmap* getLightmapTop(const glm::ivec3& pos, int& side);
@@ -247,5 +283,9 @@ public:
 
 
 	virtual void buildImGui(BrowEdit* browEdit) override;
-
+private:
+	std::unordered_map<std::uint64_t, std::vector<int>> lightmapLookup; //content hash -> lightmap indices, entries are checked on lookup as lightmaps can be changed in place
+	std::size_t lightmapLookupCount = 0; //lightmaps below this index are in lightmapLookup
+	std::vector<int> dedupLightmaps(std::vector<Lightmap*>& unique);
+	void trackMemory();
 };
\ No newline at end of file
@@ -2,12 +2,18 @@
 #include "Gnd.h"
 #include "Rsw.h"
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/Profiler.h>
+#include <browedit/util/WorkerPool.h>
 #include <browedit/Node.h>
 #include <browedit/shaders/GndShader.h>
 #include <browedit/gl/Texture.h>
+#include <browedit/gl/TextureArray.h>
 #include <stb/stb_image_write.h>
-#include <map>
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <map>
 
 
 
@@ -16,15 +22,15 @@ GndRenderer::GndRenderer()
 {
 	renderContext = GndRenderContext::getInstance();
 
-	white = util::ResourceManager<gl::Texture>::load("data\\texture\\white.png");
-	gndShadow = new gl::Texture(shadowmapSize, shadowmapSize);
 	gndShadowDirty = true;
 }
 
 GndRenderer::~GndRenderer()
 {
-	util::ResourceManager<gl::Texture>::unload(white);
-	delete gndShadow;
+	delete gndShadow[0];
+	delete gndShadow[1];
+	for (auto a : textureArrays)
+		delete a;
 	for(auto t : textures)
 		util::ResourceManager<gl::Texture>::unload(t);
 	for (auto r : chunks)
@@ -58,57 +64,22 @@ void GndRenderer::render()
 		for (std::size_t i = first; i < gnd->textures.size(); i++)
 			textures.push_back(util::ResourceManager<gl::Texture>::load("data\\texture\\" + gnd->textures[i]->file));
 	}
+	if (textureArrayDirty || textureArrayTextures != textures)
+		buildTextureArray();
 
+	const RenderSettings& settings = *renderContext->settings;
 	if (gndShadowDirty)
 	{
-		char* data = new char[shadowmapSize * shadowmapSize * 4];
-		int x = 0; int y = 0;
-		for (size_t i = 0; i < gnd->lightmaps.size(); i++)
-		{
-			Gnd::Lightmap* lightMap = gnd->lightmaps[i];
-			const int off = gnd->lightmapOffset();
-			for (int xx = 0; xx < gnd->lightmapWidth; xx++)
-			{
-				for (int yy = 0; yy < gnd->lightmapHeight; yy++)
-				{
-					int xxx = gnd->lightmapWidth * x + xx;
-					int yyy = gnd->lightmapHeight * y + yy;
-					if (!smoothColors)
-					{
-						data[4 * (xxx + shadowmapSize * yyy) + 0] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 0] >> 4) << 4;
-						data[4 * (xxx + shadowmapSize * yyy) + 1] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 1] >> 4) << 4;
-						data[4 * (xxx + shadowmapSize * yyy) + 2] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 2] >> 4) << 4;
-						data[4 * (xxx + shadowmapSize * yyy) + 3] = lightMap->data[xx + gnd->lightmapWidth * yy];
-					}
-					else
-					{
-						data[4 * (xxx + shadowmapSize * yyy) + 0] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 0]);
-						data[4 * (xxx + shadowmapSize * yyy) + 1] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 1]);
-						data[4 * (xxx + shadowmapSize * yyy) + 2] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 2]);
-						data[4 * (xxx + shadowmapSize * yyy) + 3] = lightMap->data[xx + gnd->lightmapWidth * yy];
-					}
-				}
-			}
-			x++;
-			if (x * gnd->lightmapWidth >= shadowmapSize)
-			{
-				x = 0;
-				y++;
-				if (y * gnd->lightmapHeight >= shadowmapSize)
-				{
-					std::cerr<< "Lightmap too big!" << std::endl;
-					y = 0;
-				}
-			}
-		}
-		gndShadow->setSubImage(data, 0, 0, shadowmapSize, shadowmapSize);
-		delete[] data;
+		gndShadowUploaded[0] = gndShadowUploaded[1] = false;
 		gndShadowDirty = false;
 	}
+	int shadowIndex = settings.smoothColors ? 1 : 0;
+	if (!gndShadowUploaded[shadowIndex])
+		uploadShadowmap(settings.smoothColors);
 
 
 	glActiveTexture(GL_TEXTURE1);
-	gndShadow->bind();
+	gndShadow[shadowIndex]->bind();
 	glActiveTexture(GL_TEXTURE0);
 	auto shader = dynamic_cast<GndRenderContext*>(renderContext)->shader;
 	shader->setUniform(GndShader::Uniforms::ModelViewMatrix, dynamic_cast<GndRenderContext*>(renderContext)->viewMatrix);
@@ -123,13 +94,13 @@ void GndRenderer::render()
 	shader->setUniform(GndShader::Uniforms::lightDirection, lightDirection);
 	shader->setUniform(GndShader::Uniforms::lightIntensity, rsw->light.intensity);
 
-	shader->setUniform(GndShader::Uniforms::shadowMapToggle, viewLightmapShadow? 0.0f : 1.0f);
-	shader->setUniform(GndShader::Uniforms::lightColorToggle, viewLightmapColor ? 1.0f : 0.0f);
-	shader->setUniform(GndShader::Uniforms::lightToggle, viewLighting ? 0.0f : 1.0f);
-	shader->setUniform(GndShader::Uniforms::colorToggle, viewColors ? 0.0f : 1.0f);
-	shader->setUniform(GndShader::Uniforms::viewTextures, viewTextures ? 1.0f : 0.0f);
+	shader->setUniform(GndShader::Uniforms::shadowMapToggle, settings.viewLightmapShadow ? 0.0f : 1.0f);
+	shader->setUniform(GndShader::Uniforms::lightColorToggle, settings.viewLightmapColor ? 1.0f : 0.0f);
+	shader->setUniform(GndShader::Uniforms::lightToggle, settings.viewLighting ? 0.0f : 1.0f);
+	shader->setUniform(GndShader::Uniforms::colorToggle, settings.viewColors ? 0.0f : 1.0f);
+	shader->setUniform(GndShader::Uniforms::viewTextures, settings.viewTextures ? 1.0f : 0.0f);
 
-	shader->setUniform(GndShader::Uniforms::fogEnabled, viewFog);
+	shader->setUniform(GndShader::Uniforms::fogEnabled, settings.viewFog);
 	shader->setUniform(GndShader::Uniforms::fogNear, rsw->fog.nearPlane * 240*2.5f);
 	shader->setUniform(GndShader::Uniforms::fogFar, rsw->fog.farPlane * 240*2.5f);
 	shader->setUniform(GndShader::Uniforms::fogExp, rsw->fog.factor);
@@ -137,16 +108,185 @@ void GndRenderer::render()
 
 
 
+	rebuildChunks();
+	auto& frustum = dynamic_cast<GndRenderContext*>(renderContext)->frustum;
+	RenderStats& stats = *renderContext->stats;
+	std::vector<Chunk*> visibleChunks;
+	for (auto r : chunks)
+	{
+		for (auto c : r)
+		{
+			if (settings.culling && !frustum.intersects(c->aabbMin, c->aabbMax))
+			{
+				stats.culledChunks++;
+				continue;
+			}
+			stats.visibleChunks++;
+			visibleChunks.push_back(c);
+		}
+	}
+	for (std::size_t i = 0; i < textureArrays.size(); i++)
+	{
+		textureArrays[i]->bind();
+		for (auto c : visibleChunks)
+			c->render((int)i);
+	}
+	if (settings.viewEmptyTiles)
+		for (auto c : visibleChunks)
+			c->renderEmptyTiles();
+}
+
+//Copies all lightmaps into the lightmap atlas. There are 2 atlases, as the colors are rounded when smooth colors are off
+void GndRenderer::uploadShadowmap(bool smooth)
+{
+	int index = smooth ? 1 : 0;
+	if (!gndShadow[index])
+	{
+		gndShadow[index] = new gl::Texture(shadowmapSize, shadowmapSize);
+		gndShadow[index]->memory.setTag("GL ground shadowmaps");
+	}
+	PROFILE_SCOPE("GndRenderer shadowmap upload");
+	char* data = new char[shadowmapSize * shadowmapSize * 4];
+	int x = 0; int y = 0;
+	for (size_t i = 0; i < gnd->lightmaps.size(); i++)
+	{
+		Gnd::Lightmap* lightMap = gnd->lightmaps[i];
+		const int off = gnd->lightmapOffset();
+		for (int xx = 0; xx < gnd->lightmapWidth; xx++)
+		{
+			for (int yy = 0; yy < gnd->lightmapHeight; yy++)
+			{
+				int xxx = gnd->lightmapWidth * x + xx;
+				int yyy = gnd->lightmapHeight * y + yy;
+				if (!smooth)
+				{
+					data[4 * (xxx + shadowmapSize * yyy) + 0] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 0] >> 4) << 4;
+					data[4 * (xxx + shadowmapSize * yyy) + 1] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 1] >> 4) << 4;
+					data[4 * (xxx + shadowmapSize * yyy) + 2] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 2] >> 4) << 4;
+					data[4 * (xxx + shadowmapSize * yyy) + 3] = lightMap->data[xx + gnd->lightmapWidth * yy];
+				}
+				else
+				{
+					data[4 * (xxx + shadowmapSize * yyy) + 0] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 0]);
+					data[4 * (xxx + shadowmapSize * yyy) + 1] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 1]);
+					data[4 * (xxx + shadowmapSize * yyy) + 2] = (lightMap->data[off + 3 * (xx + gnd->lightmapWidth * yy) + 2]);
+					data[4 * (xxx + shadowmapSize * yyy) + 3] = lightMap->data[xx + gnd->lightmapWidth * yy];
+				}
+			}
+		}
+		x++;
+		if (x * gnd->lightmapWidth >= shadowmapSize)
+		{
+			x = 0;
+			y++;
+			if (y * gnd->lightmapHeight >= shadowmapSize)
+			{
+				std::cerr<< "Lightmap too big!" << std::endl;
+				y = 0;
+			}
+		}
+	}
+	gndShadow[index]->setSubImage(data, 0, 0, shadowmapSize, shadowmapSize);
+	delete[] data;
+	gndShadowUploaded[index] = true;
+}
+
+//Builds the meshes of all dirty chunks on the worker pool, then uploads them from the render thread.
+//The gnd can't be changed while this runs, as the main thread waits for the workers
+void GndRenderer::rebuildChunks()
+{
+	PROFILE_SCOPE("GndRenderer::rebuildChunks");
+	std::vector<Chunk*> dirtyChunks;
 	for (auto r : chunks)
 	{
 		for (auto c : r)
 		{
 			if (allDirty)
 				c->dirty = true;
-			c->render();
+			if (c->dirty && !c->rebuilding)
+			{
+				c->rebuilding = true;
+				dirtyChunks.push_back(c);
+			}
 		}
 	}
 	allDirty = false;
+	if (dirtyChunks.empty())
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+	util::WorkerPool::getInstance()->parallelFor((int)dirtyChunks.size(), [&](int i) { dirtyChunks[i]->buildMesh(); });
+
+	lastRebuild = RebuildStats();
+	for (auto c : dirtyChunks)
+	{
+		c->upload();
+		lastRebuild.cpuTime += c->rebuildTime;
+		lastRebuild.bytes += c->bytes;
+	}
+	lastRebuild.chunkCount = (int)dirtyChunks.size();
+	lastRebuild.wallTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Copies the textures of the map into texture arrays, 1 per texture size, so a single big texture doesn't make all layers big.
+//A size with more textures than fit in 1 array is split over more arrays. Textures that could not be loaded are white
+void GndRenderer::buildTextureArray()
+{
+	PROFILE_SCOPE("GndRenderer::buildTextureArray");
+	GLint maxSize, maxLayers;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	std::map<int, std::vector<int>> sizes; //texture indices by the size of their layer
+	for (int i = 0; i < (int)textures.size(); i++)
+	{
+		textures[i]->bind(); //loads the texture if it was not loaded yet
+		int size = textures[i]->loaded ? std::min(std::max(textures[i]->width, textures[i]->height), (int)maxSize) : 1;
+		sizes[size].push_back(i);
+	}
+
+	for (auto a : textureArrays)
+		delete a;
+	textureArrays.clear();
+	std::vector<TextureSlot> slots(textures.size());
+	for (const auto& size : sizes)
+	{
+		for (std::size_t first = 0; first < size.second.size(); first += maxLayers)
+		{
+			int layers = (int)std::min(size.second.size() - first, (std::size_t)maxLayers);
+			auto textureArray = new gl::TextureArray(size.first, size.first, layers);
+			textureArray->memory.setTag("GL ground textures");
+			for (int layer = 0; layer < layers; layer++)
+			{
+				int i = size.second[first + layer];
+				if (textures[i]->loaded)
+					textureArray->copyLayer(layer, textures[i]->id(), textures[i]->width, textures[i]->height);
+				else
+					textureArray->fillLayer(layer, glm::vec4(1.0f));
+				slots[i] = TextureSlot{ (int)textureArrays.size(), layer };
+			}
+			textureArray->generateMipmaps();
+			textureArrays.push_back(textureArray);
+		}
+	}
+	if (textureArrays.size() > 1)
+		std::cout << "GndRenderer: " << textures.size() << " textures in " << textureArrays.size() << " texture arrays" << std::endl;
+
+	//the vertices store the array and layer, so the chunks have to be rebuilt when a texture moved
+	if (!std::equal(slots.begin(), slots.end(), textureSlots.begin(), textureSlots.end(), [](const TextureSlot& a, const TextureSlot& b) { return a.array == b.array && a.layer == b.layer; }))
+		allDirty = true;
+	textureSlots = std::move(slots);
+	textureArrayTextures = textures;
+	textureArrayDirty = false;
+}
+
+std::size_t GndRenderer::chunkBytes()
+{
+	std::size_t total = 0;
+	for (auto r : chunks)
+		for (auto c : r)
+			total += c->bytes;
+	return total;
 }
 
 
@@ -163,11 +303,7 @@ void GndRenderer::GndRenderContext::preFrame(const glm::mat4& projectionMatrix,
 	shader->use();
 	shader->setUniform(GndShader::Uniforms::ProjectionMatrix, projectionMatrix);
 	this->viewMatrix = viewMatrix;
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glEnableVertexAttribArray(3);
-	glEnableVertexAttribArray(4); //TODO: vao
+	this->frustum = math::Frustum(projectionMatrix * viewMatrix);
 }
 
 
@@ -180,61 +316,70 @@ GndRenderer::Chunk::Chunk(int x, int y, Gnd* gnd, GndRenderer* renderer)
 	this->y = y;
 	this->gnd = gnd;
 	this->renderer = renderer;
+	vbo.memory.setTag("GL ground buffers");
+	vio.memory.setTag("GL ground buffers");
+	glGenVertexArrays(1, &vao);
 }
 
 GndRenderer::Chunk::~Chunk()
 {
+	glDeleteVertexArrays(1, &vao);
 }
 
 
-void GndRenderer::Chunk::render()
+//the textures are in texture arrays, and the vertices have their layer, so a chunk is 1 draw call per texture array it uses
+void GndRenderer::Chunk::render(int array)
 {
-	if ((dirty || vbo.size() == 0) && !rebuilding)
+	if (dirty && !rebuilding)
 		rebuild();
+	if (array >= (int)arrayIndexCounts.size() || arrayIndexCounts[array] == 0)
+		return;
+	std::size_t first = 0;
+	for (int i = 0; i < array; i++)
+		first += arrayIndexCounts[i];
+	glBindVertexArray(vao);
+	glDrawElements(GL_TRIANGLES, (int)arrayIndexCounts[array], vio.type(), (void*)(first * sizeof(unsigned short)));
+	glBindVertexArray(0);
+	PROFILE_COUNT("Draw calls", 1);
+}
 
-	if (vbo.size() > 0)
-	{
-		auto shader = dynamic_cast<GndRenderContext*>(renderer->renderContext)->shader;
-
-		//TODO: vao
-		vbo.bind();
-		for (VboIndex& it : vertIndices)
-		{
-			if(it.texture != -1)
-				renderer->textures[it.texture]->bind();
-			else
-			{
-				shader->setUniform(GndShader::Uniforms::shadowMapToggle, 1.0f);
-				shader->setUniform(GndShader::Uniforms::lightColorToggle, 0.0f);
-				shader->setUniform(GndShader::Uniforms::colorToggle, 1.0f);
-				shader->setUniform(GndShader::Uniforms::viewTextures, 0.0f);
-				renderer->white->bind();
-			}
-			//VertexP3T2T2C4N3
-			glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexP3T2T2C4N3), (void*)(0 * sizeof(float)));
-			glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2T2C4N3), (void*)(3 * sizeof(float)));
-			glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(VertexP3T2T2C4N3), (void*)(5 * sizeof(float)));
-			glVertexAttribPointer(3, 4, GL_FLOAT, false, sizeof(VertexP3T2T2C4N3), (void*)(7 * sizeof(float)));
-			glVertexAttribPointer(4, 3, GL_FLOAT, false, sizeof(VertexP3T2T2C4N3), (void*)(11 * sizeof(float)));
-			glDrawArrays(GL_TRIANGLES, (int)it.begin, (int)it.count);
-			if (it.texture == -1)
-			{
-				shader->setUniform(GndShader::Uniforms::shadowMapToggle, renderer->viewLightmapShadow ? 0.0f : 1.0f);
-				shader->setUniform(GndShader::Uniforms::lightColorToggle, renderer->viewLightmapColor ? 1.0f : 0.0f);
-				shader->setUniform(GndShader::Uniforms::colorToggle, renderer->viewColors ? 0.0f : 1.0f);
-				shader->setUniform(GndShader::Uniforms::viewTextures, renderer->viewTextures ? 1.0f : 0.0f);
-			}
-		}
-		vbo.unBind();
-	}
+void GndRenderer::Chunk::renderEmptyTiles()
+{
+	if (dirty && !rebuilding)
+		rebuild();
+	if (vio.size() <= tileIndexCount)
+		return;
+	glBindVertexArray(vao);
+	glDrawElements(GL_TRIANGLES, (int)(vio.size() - tileIndexCount), vio.type(), (void*)(tileIndexCount * sizeof(unsigned short)));
+	glBindVertexArray(0);
+	PROFILE_COUNT("Draw calls", 1);
 }
 
 
 void GndRenderer::Chunk::rebuild()
 {
-	std::vector<VertexP3T2T2C4N3> vertices;
-	std::map<int, std::vector<VertexP3T2T2C4N3> > verts;
-	vertIndices.clear();
+	rebuilding = true;
+	buildMesh();
+	upload();
+}
+
+//Only reads from the gnd, so this can run on any thread, as long as the gnd is not being edited
+void GndRenderer::Chunk::buildMesh()
+{
+	PROFILE_SCOPE("GndRenderer::Chunk::buildMesh");
+	auto start = std::chrono::steady_clock::now();
+
+	//quads are collected with their texture, which is stored in the vertices as the layer in its texture array
+	struct Quad
+	{
+		int texture;
+		VertexP3T2T2C4N3L1Packed v[4];
+		const unsigned short* indices;
+	};
+	static const unsigned short topIndices[6] = { 3, 1, 0, 3, 0, 2 };
+	static const unsigned short wallIndices[6] = { 2, 1, 0, 3, 1, 2 };
+	std::vector<Quad> quads;
+	quads.reserve(CHUNKSIZE * CHUNKSIZE * 2);
 
 	const float lmsx = (float)gnd->lightmapWidth;
 	const float lmsy = (float)gnd->lightmapHeight;
@@ -269,23 +414,21 @@ void GndRenderer::Chunk::rebuild()
 				if (x < gnd->width - 1 && gnd->cubes[x + 1][y]->tileUp != -1)
 					c4 = glm::vec4(gnd->tiles[gnd->cubes[x+1][y]->tileUp]->color) / 255.0f;
 
-				VertexP3T2T2C4N3 v1(glm::vec3(10 * x, -cube->h3, 10 * gnd->height - 10 * y),			tile->v3, glm::vec2(lm1.x, lm2.y), c1,		cube->normals[2]);
-				VertexP3T2T2C4N3 v2(glm::vec3(10 * x + 10, -cube->h4, 10 * gnd->height - 10 * y),		tile->v4, glm::vec2(lm2.x, lm2.y), c2,		cube->normals[3]);
-				VertexP3T2T2C4N3 v3(glm::vec3(10 * x, -cube->h1, 10 * gnd->height - 10 * y + 10),		tile->v1, glm::vec2(lm1.x, lm1.y), c3,		cube->normals[0]);
-				VertexP3T2T2C4N3 v4(glm::vec3(10 * x + 10, -cube->h2, 10 * gnd->height - 10 * y + 10),	tile->v2, glm::vec2(lm2.x, lm1.y), c4,		cube->normals[1]);
+				VertexP3T2T2C4N3L1Packed v1(glm::vec3(10 * x, -cube->h3, 10 * gnd->height - 10 * y),			tile->v3, glm::vec2(lm1.x, lm2.y), c1,		cube->normals[2]);
+				VertexP3T2T2C4N3L1Packed v2(glm::vec3(10 * x + 10, -cube->h4, 10 * gnd->height - 10 * y),		tile->v4, glm::vec2(lm2.x, lm2.y), c2,		cube->normals[3]);
+				VertexP3T2T2C4N3L1Packed v3(glm::vec3(10 * x, -cube->h1, 10 * gnd->height - 10 * y + 10),		tile->v1, glm::vec2(lm1.x, lm1.y), c3,		cube->normals[0]);
+				VertexP3T2T2C4N3L1Packed v4(glm::vec3(10 * x + 10, -cube->h2, 10 * gnd->height - 10 * y + 10),	tile->v2, glm::vec2(lm2.x, lm1.y), c4,		cube->normals[1]);
 
-				verts[tile->textureIndex].push_back(v4); verts[tile->textureIndex].push_back(v2); verts[tile->textureIndex].push_back(v1);
-				verts[tile->textureIndex].push_back(v4); verts[tile->textureIndex].push_back(v1); verts[tile->textureIndex].push_back(v3);
+				quads.push_back(Quad{ tile->textureIndex, { v1, v2, v3, v4 }, topIndices });
 			}
-			else if (renderer->viewEmptyTiles)
+			else
 			{
-				VertexP3T2T2C4N3 v1(glm::vec3(10 * x, -cube->h3, 10 * gnd->height - 10 * y),			glm::vec2(0), glm::vec2(0), glm::vec4(1.0f),	cube->normals[2]);
-				VertexP3T2T2C4N3 v2(glm::vec3(10 * x + 10, -cube->h4, 10 * gnd->height - 10 * y),		glm::vec2(0), glm::vec2(0), glm::vec4(1.0f),	cube->normals[3]);
-				VertexP3T2T2C4N3 v3(glm::vec3(10 * x, -cube->h1, 10 * gnd->height - 10 * y + 10),		glm::vec2(0), glm::vec2(0), glm::vec4(1.0f),	cube->normals[0]);
-				VertexP3T2T2C4N3 v4(glm::vec3(10 * x + 10, -cube->h2, 10 * gnd->height - 10 * y + 10),	glm::vec2(0), glm::vec2(0), glm::vec4(1.0f),	cube->normals[1]);
+				VertexP3T2T2C4N3L1Packed v1(glm::vec3(10 * x, -cube->h3, 10 * gnd->height - 10 * y),			glm::vec2(0), glm::vec2(0), glm::vec4(1.0f),	cube->normals[2]);
+				VertexP3T2T2C4N3L1Packed v2(glm::vec3(10 * x + 10, -cube->h4, 10 * gnd->height - 10 * y),		glm::vec2(0), glm::vec2(0), glm::vec4(1.0f),	cube->normals[3]);
+				VertexP3T2T2C4N3L1Packed v3(glm::vec3(10 * x, -cube->h1, 10 * gnd->height - 10 * y + 10),		glm::vec2(0), glm::vec2(0), glm::vec4(1.0f),	cube->normals[0]);
+				VertexP3T2T2C4N3L1Packed v4(glm::vec3(10 * x + 10, -cube->h2, 10 * gnd->height - 10 * y + 10),	glm::vec2(0), glm::vec2(0), glm::vec4(1.0f),	cube->normals[1]);
 
-				verts[-1].push_back(v3); verts[-1].push_back(v2); verts[-1].push_back(v1);
-				verts[-1].push_back(v4); verts[-1].push_back(v2); verts[-1].push_back(v3);
+				quads.push_back(Quad{ -1, { v1, v2, v3, v4 }, wallIndices });
 			}
 			if (cube->tileSide != -1 && x < gnd->width - 1)
 			{
@@ -305,16 +448,15 @@ void GndRenderer::Chunk::rebuild()
 
 
 				//up front
-				VertexP3T2T2C4N3 v1(glm::vec3(10 * x + 10, -cube->h2, 10 * gnd->height - 10 * y + 10),					tile->v2, glm::vec2(lm2.x, lm1.y), c1, glm::vec3(1, 0, 0));
+				VertexP3T2T2C4N3L1Packed v1(glm::vec3(10 * x + 10, -cube->h2, 10 * gnd->height - 10 * y + 10),					tile->v2, glm::vec2(lm2.x, lm1.y), c1, glm::vec3(1, 0, 0));
 				//up back
-				VertexP3T2T2C4N3 v2(glm::vec3(10 * x + 10, -cube->h4, 10 * gnd->height - 10 * y),						tile->v1, glm::vec2(lm1.x, lm1.y), c2, glm::vec3(1, 0, 0));
+				VertexP3T2T2C4N3L1Packed v2(glm::vec3(10 * x + 10, -cube->h4, 10 * gnd->height - 10 * y),						tile->v1, glm::vec2(lm1.x, lm1.y), c2, glm::vec3(1, 0, 0));
 				//down front
-				VertexP3T2T2C4N3 v3(glm::vec3(10 * x + 10, -gnd->cubes[x + 1][y]->h1, 10 * gnd->height - 10 * y + 10),	tile->v4, glm::vec2(lm2.x, lm2.y), c1, glm::vec3(1, 0, 0));
+				VertexP3T2T2C4N3L1Packed v3(glm::vec3(10 * x + 10, -gnd->cubes[x + 1][y]->h1, 10 * gnd->height - 10 * y + 10),	tile->v4, glm::vec2(lm2.x, lm2.y), c1, glm::vec3(1, 0, 0));
 				//down back
-				VertexP3T2T2C4N3 v4(glm::vec3(10 * x + 10, -gnd->cubes[x + 1][y]->h3, 10 * gnd->height - 10 * y),		tile->v3, glm::vec2(lm1.x, lm2.y), c2, glm::vec3(1, 0, 0));
+				VertexP3T2T2C4N3L1Packed v4(glm::vec3(10 * x + 10, -gnd->cubes[x + 1][y]->h3, 10 * gnd->height - 10 * y),		tile->v3, glm::vec2(lm1.x, lm2.y), c2, glm::vec3(1, 0, 0));
 
-				verts[tile->textureIndex].push_back(v3); verts[tile->textureIndex].push_back(v2); verts[tile->textureIndex].push_back(v1);
-				verts[tile->textureIndex].push_back(v4); verts[tile->textureIndex].push_back(v2); verts[tile->textureIndex].push_back(v3);
+				quads.push_back(Quad{ tile->textureIndex, { v1, v2, v3, v4 }, wallIndices });
 			}
 			if (cube->tileFront != -1 && y < gnd->height - 1)
 			{
@@ -331,24 +473,81 @@ void GndRenderer::Chunk::rebuild()
 				if (x < gnd->width - 1 && y < gnd->height - 1 && gnd->cubes[x + 1][y + 1]->tileUp != -1)
 					c2 = glm::vec4(gnd->tiles[gnd->cubes[x + 1][y + 1]->tileUp]->color) / 255.0f;
 
-				VertexP3T2T2C4N3 v1(glm::vec3(10 * x, -cube->h3, 10 * gnd->height - 10 * y),						tile->v1, glm::vec2(lm1.x, lm1.y), c1, glm::vec3(0, 0, 1));
-				VertexP3T2T2C4N3 v2(glm::vec3(10 * x + 10, -cube->h4, 10 * gnd->height - 10 * y),					tile->v2, glm::vec2(lm2.x, lm1.y), c2, glm::vec3(0, 0, 1));
-				VertexP3T2T2C4N3 v4(glm::vec3(10 * x + 10, -gnd->cubes[x][y + 1]->h2, 10 * gnd->height - 10 * y),	tile->v4, glm::vec2(lm2.x, lm2.y), c2, glm::vec3(0, 0, 1));
-				VertexP3T2T2C4N3 v3(glm::vec3(10 * x, -gnd->cubes[x][y + 1]->h1, 10 * gnd->height - 10 * y),		tile->v3, glm::vec2(lm1.x, lm2.y), c1, glm::vec3(0, 0, 1));
+				VertexP3T2T2C4N3L1Packed v1(glm::vec3(10 * x, -cube->h3, 10 * gnd->height - 10 * y),						tile->v1, glm::vec2(lm1.x, lm1.y), c1, glm::vec3(0, 0, 1));
+				VertexP3T2T2C4N3L1Packed v2(glm::vec3(10 * x + 10, -cube->h4, 10 * gnd->height - 10 * y),					tile->v2, glm::vec2(lm2.x, lm1.y), c2, glm::vec3(0, 0, 1));
+				VertexP3T2T2C4N3L1Packed v4(glm::vec3(10 * x + 10, -gnd->cubes[x][y + 1]->h2, 10 * gnd->height - 10 * y),	tile->v4, glm::vec2(lm2.x, lm2.y), c2, glm::vec3(0, 0, 1));
+				VertexP3T2T2C4N3L1Packed v3(glm::vec3(10 * x, -gnd->cubes[x][y + 1]->h1, 10 * gnd->height - 10 * y),		tile->v3, glm::vec2(lm1.x, lm2.y), c1, glm::vec3(0, 0, 1));
 
-				verts[tile->textureIndex].push_back(v3); verts[tile->textureIndex].push_back(v2); verts[tile->textureIndex].push_back(v1);
-				verts[tile->textureIndex].push_back(v4); verts[tile->textureIndex].push_back(v2); verts[tile->textureIndex].push_back(v3);
+				quads.push_back(Quad{ tile->textureIndex, { v1, v2, v3, v4 }, wallIndices });
 			}
 		}
 	}
 
-	for (auto it : verts)
+	//sorted on texture array, so every array is 1 range of the index buffer. Empty tiles (and tiles with an invalid texture) go last,
+	//so views that hide them can draw less of the index buffer
+	const auto& slots = renderer->textureSlots;
+	auto arrayOf = [&slots](const Quad& q) { return q.texture >= 0 && q.texture < (int)slots.size() ? slots[q.texture].array : std::numeric_limits<int>::max(); };
+	std::stable_sort(quads.begin(), quads.end(), [&arrayOf](const Quad& a, const Quad& b) { return arrayOf(a) < arrayOf(b); });
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	mesh.vertices.reserve(quads.size() * 4);
+	mesh.indices.reserve(quads.size() * 6);
+	mesh.tileIndexCount = 0;
+	mesh.arrayIndexCounts.assign(renderer->textureArrays.size(), 0);
+	for (const auto& quad : quads)
 	{
-		vertIndices.push_back(VboIndex(it.first, vertices.size(), it.second.size()));
-		vertices.insert(vertices.end(), it.second.begin(), it.second.end());
+		int array = arrayOf(quad);
+		bool empty = array == std::numeric_limits<int>::max();
+		if (!empty)
+		{
+			mesh.tileIndexCount += 6;
+			mesh.arrayIndexCounts[array] += 6;
+		}
+		unsigned short base = (unsigned short)mesh.vertices.size();
+		mesh.vertices.insert(mesh.vertices.end(), quad.v, quad.v + 4);
+		for (int i = 0; i < 4; i++)
+			mesh.vertices[base + i].layer = empty ? emptyTileLayer : slots[quad.texture].layer;
+		for (int i = 0; i < 6; i++)
+			mesh.indices.push_back(base + quad.indices[i]);
+	}
+	if (!mesh.vertices.empty())
+	{
+		mesh.aabbMin = glm::vec3(std::numeric_limits<float>::max());
+		mesh.aabbMax = glm::vec3(-std::numeric_limits<float>::max());
+		for (const auto& v : mesh.vertices)
+		{
+			glm::vec3 pos(v.position[0], v.position[1], v.position[2]);
+			mesh.aabbMin = glm::min(mesh.aabbMin, pos);
+			mesh.aabbMax = glm::max(mesh.aabbMax, pos);
+		}
 	}
 
-	vbo.setData(vertices, GL_STATIC_DRAW);
+	bytes = mesh.vertices.size() * sizeof(VertexP3T2T2C4N3L1Packed) + mesh.indices.size() * sizeof(unsigned short);
+	rebuildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//uploads the mesh made by buildMesh. Has to be called on the thread with the GL context
+void GndRenderer::Chunk::upload()
+{
+	glBindVertexArray(vao); //the index buffer binding is part of the vao
+	vbo.setData(mesh.vertices, GL_STATIC_DRAW);
+	vio.setData(mesh.indices, GL_STATIC_DRAW);
+	tileIndexCount = mesh.tileIndexCount;
+	arrayIndexCounts = mesh.arrayIndexCounts;
+	for (int i = 0; i < 6; i++)
+		glEnableVertexAttribArray(i);
+	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexP3T2T2C4N3L1Packed), (void*)offsetof(VertexP3T2T2C4N3L1Packed, position));
+	glVertexAttribPointer(1, 2, GL_HALF_FLOAT, false, sizeof(VertexP3T2T2C4N3L1Packed), (void*)offsetof(VertexP3T2T2C4N3L1Packed, texCoord));
+	glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, true, sizeof(VertexP3T2T2C4N3L1Packed), (void*)offsetof(VertexP3T2T2C4N3L1Packed, lightmapCoord));
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, true, sizeof(VertexP3T2T2C4N3L1Packed), (void*)offsetof(VertexP3T2T2C4N3L1Packed, color));
+	glVertexAttribPointer(4, 4, GL_INT_2_10_10_10_REV, true, sizeof(VertexP3T2T2C4N3L1Packed), (void*)offsetof(VertexP3T2T2C4N3L1Packed, normal));
+	glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(VertexP3T2T2C4N3L1Packed), (void*)offsetof(VertexP3T2T2C4N3L1Packed, layer));
+	glBindVertexArray(0);
+	vbo.unBind();
+	aabbMin = mesh.aabbMin;
+	aabbMax = mesh.aabbMax;
+	mesh = ChunkMesh();
 	dirty = false;
 	rebuilding = false;
 }
@@ -361,4 +560,15 @@ void GndRenderer::setChunkDirty(int x, int y)
 void GndRenderer::setChunksDirty()
 {
 	allDirty = true;
+}
+
+void GndRenderer::setChunksDirty(const glm::ivec2& min, const glm::ivec2& max)
+{
+	if (chunks.empty())
+		return;
+	glm::ivec2 from = glm::max(glm::ivec2(0), min) / CHUNKSIZE;
+	glm::ivec2 to = glm::min(glm::ivec2((int)chunks[0].size(), (int)chunks.size()) * CHUNKSIZE - 1, max) / CHUNKSIZE;
+	for (int y = from.y; y <= to.y; y++)
+		for (int x = from.x; x <= to.x; x++)
+			chunks[y][x]->dirty = true;
 }
\ No newline at end of file
@@ -5,12 +5,15 @@
 #include <browedit/util/Singleton.h>
 #include <browedit/gl/Vertex.h>
 #include <browedit/gl/VBO.h>
+#include <browedit/gl/VIO.h>
+#include <browedit/math/Frustum.h>
 
 #include <vector>
 
 namespace gl
 {
 	class Texture;
+	class TextureArray;
 }
 class Gnd;
 class Rsw;
@@ -22,29 +25,29 @@ class GndRenderer : public Renderer
 {
 public:
 	inline static const int shadowmapSize = 4096;
+	inline static const unsigned int emptyTileLayer = 0xffff; //layer of the vertices of tiles without a texture, drawn white and unlit
 
 	class GndRenderContext : public Renderer::RenderContext, public util::Singleton<GndRenderContext>
 	{
 	public:
 		GndShader* shader = nullptr;
 		glm::mat4 viewMatrix = glm::mat4(1.0f);
+		math::Frustum frustum;
 
 		GndRenderContext();
 		virtual void preFrame(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix) override;
 	};
 
-	class VboIndex
+	//CPU side geometry of a chunk. Built on worker threads, uploaded on the main thread
+	class ChunkMesh
 	{
 	public:
-		int texture;
-		std::size_t begin;
-		std::size_t count;
-		VboIndex(int texture, std::size_t begin, std::size_t count)
-		{
-			this->texture = texture;
-			this->begin = begin;
-			this->count = count;
-		}
+		std::vector<VertexP3T2T2C4N3L1Packed> vertices;
+		std::vector<unsigned short> indices;
+		std::size_t tileIndexCount = 0; //the empty tiles are at the end of the indices, so they can be skipped
+		std::vector<std::size_t> arrayIndexCounts; //the textured tiles are sorted by texture array, this is the amount of indices per array
+		glm::vec3 aabbMin = glm::vec3(0.0f);
+		glm::vec3 aabbMax = glm::vec3(0.0f);
 	};
 
 	class Chunk
@@ -52,43 +55,71 @@ public:
 	public:
 		bool dirty;
 		bool rebuilding;
-		gl::VBO<VertexP3T2T2C4N3> vbo;
-		std::vector<VboIndex> vertIndices;
+		gl::VBO<VertexP3T2T2C4N3L1Packed> vbo;
+		gl::VIO<unsigned short> vio;
+		GLuint vao = 0;
+		std::size_t tileIndexCount = 0;
+		std::vector<std::size_t> arrayIndexCounts;
+		ChunkMesh mesh;
+		glm::vec3 aabbMin = glm::vec3(0.0f);
+		glm::vec3 aabbMax = glm::vec3(0.0f);
 		int x, y;
 		GndRenderer* renderer;
 		Gnd* gnd;
 
+		float rebuildTime = 0; //in ms
+		std::size_t bytes = 0;
+
 		Chunk(int x, int y, Gnd* gnd, GndRenderer* renderer);
 		~Chunk();
-		void render();
+		void render(int array); //draws the tiles that use the given texture array
+		void renderEmptyTiles();
 		void rebuild();
+		void buildMesh();
+		void upload();
+	};
+
+	class RebuildStats
+	{
+	public:
+		int chunkCount = 0;
+		float cpuTime = 0; //total time spent building meshes, over all threads, in ms
+		float wallTime = 0; //in ms
+		std::size_t bytes = 0;
+	};
+
+	//where a texture of the gnd is in the texture arrays
+	class TextureSlot
+	{
+	public:
+		int array;
+		int layer;
 	};
 
-	gl::Texture* white;
 	std::vector<gl::Texture*> textures;
+	std::vector<gl::TextureArray*> textureArrays; //the textures of the map grouped by size, so a chunk is drawn in 1 call per array
+	std::vector<TextureSlot> textureSlots; //by texture index of the gnd
+	std::vector<gl::Texture*> textureArrayTextures; //the textures that are in textureArrays, to see if they have to be rebuilt
+	bool textureArrayDirty = true; //for when a texture is reloaded
 	std::vector<std::vector<Chunk*> > chunks; //TODO: remove pointer?
 	bool allDirty = true;
 	Gnd* gnd;
 	Rsw* rsw; //for lighting
 
-	gl::Texture* gndShadow;
+	gl::Texture* gndShadow[2] = { nullptr, nullptr }; //lightmap atlas with the colors rounded like the client does, and with smooth colors. Made when a view uses it
+	bool gndShadowUploaded[2] = { false, false };
+	void uploadShadowmap(bool smooth);
 
 	void setChunkDirty(int x, int y);
 	void setChunksDirty();
+	void setChunksDirty(const glm::ivec2& min, const glm::ivec2& max); //in tiles, inclusive
+	void rebuildChunks();
+	void buildTextureArray();
+	std::size_t chunkBytes();
 	bool gndShadowDirty = true;
+	RebuildStats lastRebuild;
 
 	GndRenderer();
 	~GndRenderer();
 	void render() override;
-
-
-	bool viewLightmapShadow = true;
-	bool viewLightmapColor = true;
-	bool viewColors = true;
-	bool viewLighting = true;
-	bool smoothColors = false;
-	bool viewTextures = true;
-	bool viewFog = true;
-
-	bool viewEmptyTiles = true;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "LubRenderer.h"
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/Profiler.h>
 #include <browedit/Node.h>
 #include <browedit/components/Rsw.h>
 #include <browedit/components/Gnd.h>
@@ -122,6 +123,7 @@ void LubRenderer::render()
 		glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2A1), verts[0].data + 3);
 		glVertexAttribPointer(2, 1, GL_FLOAT, false, sizeof(VertexP3T2A1), verts[0].data + 5);
 		glDrawArrays(GL_QUADS, 0, (int)verts.size());
+		PROFILE_COUNT("Draw calls", 1);
 	}
 	glDepthMask(1);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
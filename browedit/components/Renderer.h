@@ -3,6 +3,29 @@
 #include "Component.h"
 #include <glm/glm.hpp>
 
+//View options of a single view. Every NodeRenderContext has its own, so views with different settings don't change shared renderer state
+class RenderSettings
+{
+public:
+	bool viewLightmapShadow = true;
+	bool viewLightmapColor = true;
+	bool viewColors = true;
+	bool viewLighting = true;
+	bool smoothColors = false;
+	bool viewTextures = true;
+	bool viewEmptyTiles = true;
+	bool viewFog = false;
+	bool culling = true; //don't draw objects and ground chunks outside of the view
+};
+
+//Statistics of a single view, filled by the renderers while it is being drawn
+class RenderStats
+{
+public:
+	int visibleChunks = 0;
+	int culledChunks = 0;
+};
+
 class Renderer : public Component
 {
 public:
@@ -13,11 +36,16 @@ public:
 	public:
 		int order = 0;
 		int phases = 1;
+		const RenderSettings* settings = nullptr; //settings of the view that is being drawn, set by the NodeRenderer before preFrame
+		RenderStats* stats = nullptr; //statistics of the view that is being drawn, set together with settings
 		virtual void preFrame(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix) = 0;
+		virtual void postFrame() {} //called after all renderers of this context are rendered, for contexts that batch their draws
 	};
 
 	RenderContext* renderContext;
 	virtual void render() = 0;
 	virtual bool shouldRender(int phase) { return true; }
+	//world space bounds, used for culling. Renderers without bounds return false, and are always rendered
+	virtual bool getBounds(glm::vec3& min, glm::vec3& max) { return false; }
 	bool enabled = true;
 };
\ No newline at end of file
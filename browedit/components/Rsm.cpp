@@ -2,7 +2,11 @@
 
 #include <browedit/util/Util.h>
 #include <browedit/util/FileIO.h>
+#include <browedit/util/ByteStream.h>
+#include <browedit/util/Profiler.h>
+#include <browedit/util/MemoryTracker.h>
 #include <iostream>
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/quaternion.hpp>
 
@@ -12,10 +16,21 @@ Rsm::Rsm(const std::string& fileName)
 	rootMesh = NULL;
 	loaded = false;
 	reload();
+	util::MemoryTracker::addSource(this, "RSM models", util::MemoryTracker::Type::Cpu, [this]()
+	{
+		std::size_t size = sizeof(Rsm);
+		if (rootMesh)
+			rootMesh->foreach([&size](Mesh* mesh)
+			{
+				size += sizeof(Mesh) + mesh->vertices.size() * sizeof(glm::vec3) + mesh->texCoords.size() * sizeof(glm::vec2) + mesh->faces.size() * sizeof(Mesh::Face);
+			});
+		return size;
+	});
 }
 
 Rsm::~Rsm()
 {
+	util::MemoryTracker::remove(this);
 	if(rootMesh)
 		delete rootMesh;
 }
@@ -23,110 +38,109 @@ Rsm::~Rsm()
 
 void Rsm::reload()
 {
-	rootMesh = NULL;
 	loaded = false;
+	poseDirty = true;
 	textures.clear();
 	if (rootMesh)
 		delete rootMesh;
 	rootMesh = nullptr;
 
 
-	std::istream* rsmFile = util::FileIO::open(fileName);
-	if (!rsmFile)
+	fingerprint = util::FileIO::fingerprint(fileName);
+	std::vector<char> data;
+	if (!util::FileIO::read(fileName, data))
 	{
 		std::cerr << "RSM: Unable to open " << fileName << std::endl;
 		return;
 	}
+	contentHash = util::hash(data.data(), data.size());
+	reloadCount++;
+	util::ByteReader rsmFile(data);
 
-	char header[4];
-	rsmFile->read(header, 4);
-	if (header[0] == 'G' && header[1] == 'R' && header[2] == 'G' && header[3] == 'M')
-	{
-		std::cerr<< "RSM: Unknown RSM header in file " << fileName << ", stopped loading" << std::endl;
-		delete rsmFile;
-		return;
-	}
-
-	//std::cout << "RSM: loading " << fileName << std::endl;
-	
-	rsmFile->read(reinterpret_cast<char*>(&version), sizeof(short));
-	version = util::swapShort(version);
-	rsmFile->read(reinterpret_cast<char*>(&animLen), sizeof(int));
-	rsmFile->read(reinterpret_cast<char*>(&shadeType), sizeof(int));
-
-	if (version >= 0x0104)
-		alpha = rsmFile->get();
-	else
-		alpha = 0;
-	
 	std::string mainNodeName;
-
-	if (version >= 0x0203)
+	try
 	{
-		rsmFile->read(reinterpret_cast<char*>(&fps), sizeof(float));
-		animLen = (int)ceil(animLen * fps);
-		int rootMeshCount;
-		rsmFile->read(reinterpret_cast<char*>(&rootMeshCount), sizeof(int));
-		if (rootMeshCount > 1)
-			std::cerr << "RSM "<<fileName<<" Warning: multiple root meshes, this is not supported yet" << std::endl;
-		for (int i = 0; i < rootMeshCount; i++)
+		char header[4];
+		rsmFile.read(header, 4);
+		if (header[0] == 'G' && header[1] == 'R' && header[2] == 'G' && header[3] == 'M')
 		{
-			auto rootMeshName = util::FileIO::readStringDyn(rsmFile);
-			mainNodeName = rootMeshName;
-		}
-		rsmFile->read(reinterpret_cast<char*>(&meshCount), sizeof(int));		
-	}
-	else if (version >= 0x0202)
-	{
-		float fps;
-		rsmFile->read(reinterpret_cast<char*>(&fps), sizeof(float));
-
-		int textureCount;
-		rsmFile->read(reinterpret_cast<char*>(&textureCount), sizeof(int));;
-		if (textureCount > 100 || textureCount < 0)
-		{
-			std::cerr << "Invalid textureCount, aborting" << std::endl;
-			delete rsmFile;
+			std::cerr<< "RSM: Unknown RSM header in file " << fileName << ", stopped loading" << std::endl;
 			return;
 		}
 
-		for (int i = 0; i < textureCount; i++)
-			textures.push_back(util::FileIO::readStringDyn(rsmFile));
+		//std::cout << "RSM: loading " << fileName << std::endl;
 
-		int rootMeshCount;
-		rsmFile->read(reinterpret_cast<char*>(&rootMeshCount), sizeof(int));
-		if (rootMeshCount > 1)
-			std::cerr << "Warning: multiple root meshes, this is not supported yet" << std::endl;
-		for (int i = 0; i < rootMeshCount; i++)
-		{
-			auto rootMeshName = util::FileIO::readStringDyn(rsmFile);
-			mainNodeName = rootMeshName;
-		}
-		rsmFile->read(reinterpret_cast<char*>(&meshCount), sizeof(int));
-	}
-	else
-	{
-		rsmFile->read(unknown, 16);
-		for (int i = 0; i < 16; i++)
-			assert(unknown[i] == 0);
+		version = util::swapShort(rsmFile.read<short>());
+		animLen = rsmFile.read<int>();
+		shadeType = (ShadeType)rsmFile.read<int>();
 
-		int textureCount;
-		rsmFile->read(reinterpret_cast<char*>(&textureCount), sizeof(int));;
-		if (textureCount > 100 || textureCount < 0)
+		if (version >= 0x0104)
+			alpha = rsmFile.read<char>();
+		else
+			alpha = 0;
+
+		if (version >= 0x0203)
 		{
-			std::cerr << "Invalid textureCount, aborting" << std::endl;
-			delete rsmFile;
-			return;
+			fps = rsmFile.read<float>();
+			animLen = (int)ceil(animLen * fps);
+			int rootMeshCount = rsmFile.read<int>();
+			if (rootMeshCount > 1)
+				std::cerr << "RSM "<<fileName<<" Warning: multiple root meshes, this is not supported yet" << std::endl;
+			for (int i = 0; i < rootMeshCount; i++)
+			{
+				auto rootMeshName = rsmFile.readStringDyn();
+				mainNodeName = rootMeshName;
+			}
+			rsmFile.read(meshCount);
 		}
-
-		for (int i = 0; i < textureCount; i++)
+		else if (version >= 0x0202)
 		{
-			std::string textureFileName = util::FileIO::readString(rsmFile, 40);;
-			textures.push_back(textureFileName);
+			rsmFile.skip(sizeof(float)); //fps
+
+			int textureCount = rsmFile.read<int>();
+			if (textureCount > 100 || textureCount < 0)
+			{
+				std::cerr << "Invalid textureCount, aborting" << std::endl;
+				return;
+			}
+
+			for (int i = 0; i < textureCount; i++)
+				textures.push_back(rsmFile.readStringDyn());
+
+			int rootMeshCount = rsmFile.read<int>();
+			if (rootMeshCount > 1)
+				std::cerr << "Warning: multiple root meshes, this is not supported yet" << std::endl;
+			for (int i = 0; i < rootMeshCount; i++)
+			{
+				auto rootMeshName = rsmFile.readStringDyn();
+				mainNodeName = rootMeshName;
+			}
+			rsmFile.read(meshCount);
 		}
+		else
+		{
+			rsmFile.read(unknown, 16);
+			for (int i = 0; i < 16; i++)
+				assert(unknown[i] == 0);
+
+			int textureCount = rsmFile.read<int>();
+			if (textureCount > 100 || textureCount < 0)
+			{
+				std::cerr << "Invalid textureCount, aborting" << std::endl;
+				return;
+			}
 
-		mainNodeName = util::FileIO::readString(rsmFile, 40);
-		rsmFile->read(reinterpret_cast<char*>(&meshCount), sizeof(int));
+			for (int i = 0; i < textureCount; i++)
+				textures.push_back(rsmFile.readString(40));
+
+			mainNodeName = rsmFile.readString(40);
+			rsmFile.read(meshCount);
+		}
+	}
+	catch (const std::out_of_range& e)
+	{
+		std::cerr << "RSM: Error reading " << fileName << ": " << e.what() << std::endl;
+		return;
 	}
 
 	std::map<std::string, Mesh* > meshes;
@@ -144,7 +158,9 @@ void Rsm::reload()
 		}
 		catch (const std::exception& e)
 		{
-			std::cerr << e.what() << std::endl;
+			std::cerr << "RSM: Error reading " << fileName << ": " << e.what() << std::endl;
+			for (auto& m : meshes)
+				delete m.second;
 			loaded = false;
 			return;
 		}
@@ -175,34 +191,28 @@ void Rsm::reload()
 
 	updateMatrices();
 
-	if (version < 0x0106)
+	//the keyframes and volume boxes at the end are not used, a file that stops before them is still loaded
+	try
 	{
-		int numKeyFrames;
-		rsmFile->read(reinterpret_cast<char*>(&numKeyFrames), sizeof(int));
-		for (int i = 0; i < numKeyFrames; i++)
+		if (version < 0x0106)
 		{
-			int frame;
-			glm::vec3 scale;
-			float data;
-
-			rsmFile->read(reinterpret_cast<char*>(&frame), sizeof(int));
-			rsmFile->read(reinterpret_cast<char*>(glm::value_ptr(scale)), sizeof(float) * 3);
-			rsmFile->read(reinterpret_cast<char*>(&data), sizeof(float));
+			int numKeyFrames = rsmFile.read<int>();
+			if (numKeyFrames < 0)
+				throw std::out_of_range("invalid keyframe count");
+			rsmFile.skip(numKeyFrames * (sizeof(int) + sizeof(float) * 4)); //frame, scale, data
 		}
-	}
 
-	int numVolumeBox;
-	rsmFile->read(reinterpret_cast<char*>(&numVolumeBox), sizeof(int));
-//	if (numVolumeBox != 0)
-//		std::cerr << "WARNING! This model has " << numVolumeBox << " volume boxes!" << std::endl;
+		int numVolumeBox = rsmFile.read<int>();
+	//	if (numVolumeBox != 0)
+	//		std::cerr << "WARNING! This model has " << numVolumeBox << " volume boxes!" << std::endl;
+	}
+	catch (const std::out_of_range&)
+	{
+	}
 
 	loaded = true;
-
-
-	delete rsmFile;
 }
 
-
 void Rsm::updateMatrices()
 {
 	bbmin = glm::vec3(999999, 999999, 999999);
@@ -212,6 +222,7 @@ void Rsm::updateMatrices()
 
 	rootMesh->calcMatrix1(0);
 	rootMesh->calcMatrix2();
+	poseDirty = true;
 
 	realbbmax = glm::vec3(-999999, -999999, -999999);
 	realbbmin = glm::vec3(999999, 999999, 999999);
@@ -221,32 +232,141 @@ void Rsm::updateMatrices()
 	maxRange = glm::max(glm::max(realbbmax.x, -realbbmin.x), glm::max(glm::max(realbbmax.y, -realbbmin.y), glm::max(realbbmax.z, -realbbmin.z)));
 }
 
+//the other model is loaded on a worker thread, this is called on the main thread once it is done,
+//so the renderers of this model never see a half loaded model. Renderers have to be restarted with begin() after this
+void Rsm::takeFrom(Rsm* other)
+{
+	if (rootMesh)
+		delete rootMesh;
+	rootMesh = other->rootMesh;
+	other->rootMesh = nullptr;
+	if (rootMesh)
+		rootMesh->foreach([this](Mesh* mesh) { mesh->model = this; });
+
+	fingerprint = other->fingerprint;
+	contentHash = other->contentHash;
+	reloadCount++;
+	loaded = other->loaded;
+	version = other->version;
+	if (version >= 0x0104)
+		alpha = other->alpha;
+	if (version >= 0x0202)
+		fps = other->fps;
+	std::copy(std::begin(other->unknown), std::end(other->unknown), unknown);
+	animLen = other->animLen;
+	textures = std::move(other->textures);
+	meshCount = other->meshCount;
+	shadeType = other->shadeType;
+	realbbmin = other->realbbmin;
+	realbbmax = other->realbbmax;
+	realbbrange = other->realbbrange;
+	bbmin = other->bbmin;
+	bbmax = other->bbmax;
+	bbrange = other->bbrange;
+	maxRange = other->maxRange;
+	other->loaded = false;
+	poseDirty = true;
+}
+
+//flattens the mesh tree, and precalculates everything that is not animated
+void Rsm::buildPose()
+{
+	poseMeshes.clear();
+	animated = false;
+	std::size_t count = 0;
+	std::function<void(Mesh*, int)> addMesh;
+	addMesh = [&](Mesh* mesh, int parent)
+	{
+		mesh->rotFramesSorted = std::is_sorted(mesh->rotFrames.begin(), mesh->rotFrames.end(), [](const Mesh::RotFrame& a, const Mesh::RotFrame& b) { return a.time < b.time; });
+		bool meshAnimated = mesh->isAnimated() || (parent != -1 && poseMeshes[parent].animated);
+		animated |= meshAnimated;
+		count = glm::max(count, (std::size_t)mesh->index + 1);
+		poseMeshes.push_back(PoseMesh{ mesh, parent, meshAnimated });
+		int index = (int)poseMeshes.size() - 1;
+		for (auto child : mesh->children)
+			addMesh(child, index);
+	};
+	if (rootMesh)
+		addMesh(rootMesh, -1);
+
+	pose.matrix.resize(count);
+	pose.matrixSub.resize(count);
+	for (const auto& pm : poseMeshes)
+	{
+		if (!pm.mesh->isAnimated())
+			pm.mesh->matrix1Static = pm.mesh->calcLocalMatrix1(0);
+		if (pm.animated)
+			continue;
+		glm::mat4 parentMatrix = pm.parent == -1 ? glm::mat4(1.0f) : pose.matrixSub[poseMeshes[pm.parent].mesh->index];
+		pose.matrixSub[pm.mesh->index] = parentMatrix * pm.mesh->matrix1Static;
+		pose.matrix[pm.mesh->index] = pose.matrixSub[pm.mesh->index] * pm.mesh->matrix2;
+	}
+	pose.tick = -1;
+	pose.version++;
+	poseDirty = false;
+}
+
+//Evaluates the animation of all meshes at the given time. Only the meshes that are animated (or have an animated parent) are recalculated,
+//and the result is kept until a different tick is requested, so all instances of the model rendered in the same frame share 1 evaluation
+const Rsm::Pose& Rsm::getPose(int tick)
+{
+	if (poseDirty)
+		buildPose();
+	if (!animated || pose.tick == tick)
+		return pose;
+	for (const auto& pm : poseMeshes)
+	{
+		if (!pm.animated)
+			continue;
+		glm::mat4 parentMatrix = pm.parent == -1 ? glm::mat4(1.0f) : pose.matrixSub[poseMeshes[pm.parent].mesh->index];
+		pose.matrixSub[pm.mesh->index] = parentMatrix * (pm.mesh->isAnimated() ? pm.mesh->calcLocalMatrix1(tick) : pm.mesh->matrix1Static);
+		pose.matrix[pm.mesh->index] = pose.matrixSub[pm.mesh->index] * pm.mesh->matrix2;
+	}
+	pose.tick = tick;
+	pose.version++;
+	PROFILE_COUNT("Rsm poses evaluated", 1);
+	return pose;
+}
+
 Rsm::Mesh::Mesh(Rsm* model)
 {
 	this->model = model;
 }
 
-Rsm::Mesh::Mesh(Rsm* model, std::istream* rsmFile)
+//on-disk layouts of the arrays in a mesh, so they can be read in one go
+struct RsmFileTexCoord
+{
+	float color; //??
+	glm::vec2 texCoord;
+};
+static_assert(sizeof(RsmFileTexCoord) == 12, "RSM texture coordinates are 12 bytes");
+struct RsmFileFrame
+{
+	int time;
+	float data[4]; //scale + data, position + data, or a quaternion
+};
+static_assert(sizeof(RsmFileFrame) == 20, "RSM frames are 20 bytes");
+
+Rsm::Mesh::Mesh(Rsm* model, util::ByteReader& rsmFile)
 {
 	this->model = model;
 	if (model->version >= 0x0202)
 	{
-		name = util::FileIO::readStringDyn(rsmFile);
-		parentName = util::FileIO::readStringDyn(rsmFile);
+		name = rsmFile.readStringDyn();
+		parentName = rsmFile.readStringDyn();
 	}
 	else
 	{
-		name = util::FileIO::readString(rsmFile, 40);
-		parentName = util::FileIO::readString(rsmFile, 40);
+		name = rsmFile.readString(40);
+		parentName = rsmFile.readString(40);
 	}
 
 	if (model->version >= 0x0203)
 	{
-		int textureCount;
-		rsmFile->read(reinterpret_cast<char*>(&textureCount), sizeof(int));
+		int textureCount = rsmFile.read<int>();
 		for (int i = 0; i < textureCount; i++)
 		{
-			std::string textureFile = util::FileIO::readStringDyn(rsmFile);
+			std::string textureFile = rsmFile.readStringDyn();
 			auto it = std::find(model->textures.begin(), model->textures.end(), textureFile);
 			if (it != model->textures.end())
 			{
@@ -261,43 +381,15 @@ Rsm::Mesh::Mesh(Rsm* model, std::istream* rsmFile)
 	}
 	else
 	{
-		int textureCount;
-		rsmFile->read(reinterpret_cast<char*>(&textureCount), sizeof(int));
-		for (int i = 0; i < textureCount; i++)
-		{
-			int textureId;
-			rsmFile->read(reinterpret_cast<char*>(&textureId), sizeof(int));
-			textures.push_back(textureId);
-		}
+		int textureCount = rsmFile.read<int>();
+		rsmFile.readArray(textures, textureCount);
 	}
-#if 1
-	offset = glm::mat4(1.0f);
-	rsmFile->read(reinterpret_cast<char*>(&offset[0][0]), sizeof(float));
-	rsmFile->read(reinterpret_cast<char*>(&offset[0][1]), sizeof(float));
-	rsmFile->read(reinterpret_cast<char*>(&offset[0][2]), sizeof(float));
-
-	rsmFile->read(reinterpret_cast<char*>(&offset[1][0]), sizeof(float));
-	rsmFile->read(reinterpret_cast<char*>(&offset[1][1]), sizeof(float));
-	rsmFile->read(reinterpret_cast<char*>(&offset[1][2]), sizeof(float));
-
-	rsmFile->read(reinterpret_cast<char*>(&offset[2][0]), sizeof(float));
-	rsmFile->read(reinterpret_cast<char*>(&offset[2][1]), sizeof(float));
-	rsmFile->read(reinterpret_cast<char*>(&offset[2][2]), sizeof(float));
-#else
-	offset[0][0] = rsmFile->readFloat();//rotation
-	offset[1][0] = rsmFile->readFloat();
-	offset[2][0] = rsmFile->readFloat();
-
-	offset[0][1] = rsmFile->readFloat();
-	offset[1][1] = rsmFile->readFloat();
-	offset[2][1] = rsmFile->readFloat();
 
-	offset[0][2] = rsmFile->readFloat();
-	offset[1][2] = rsmFile->readFloat();
-	offset[2][2] = rsmFile->readFloat();
-#endif
+	offset = glm::mat4(1.0f);
+	for (int i = 0; i < 3; i++)
+		rsmFile.read(&offset[i][0], sizeof(float) * 3);
 
-	rsmFile->read(reinterpret_cast<char*>(glm::value_ptr(pos_)), sizeof(float) * 3);
+	rsmFile.read(pos_);
 
 	if (model->version >= 0x0202)
 	{
@@ -308,34 +400,29 @@ Rsm::Mesh::Mesh(Rsm* model, std::istream* rsmFile)
 	}
 	else
 	{
-		rsmFile->read(reinterpret_cast<char*>(glm::value_ptr(pos)), sizeof(float) * 3);
-		rsmFile->read(reinterpret_cast<char*>(&rotangle), sizeof(float));
-		rsmFile->read(reinterpret_cast<char*>(glm::value_ptr(rotaxis)), sizeof(float) * 3);
-		rsmFile->read(reinterpret_cast<char*>(glm::value_ptr(scale)), sizeof(float) * 3);
+		rsmFile.read(pos);
+		rsmFile.read(rotangle);
+		rsmFile.read(rotaxis);
+		rsmFile.read(scale);
 	}
-	int vertexCount;
-	rsmFile->read(reinterpret_cast<char*>(&vertexCount), sizeof(int));
-	vertices.resize(vertexCount);
-	for (int i = 0; i < vertexCount; i++)
-		rsmFile->read(reinterpret_cast<char*>(glm::value_ptr(vertices[i])), sizeof(float) * 3);
-
-	int texCoordCount;
-	rsmFile->read(reinterpret_cast<char*>(&texCoordCount), sizeof(int));
-	texCoords.resize(texCoordCount);
-	for (int i = 0; i < texCoordCount; i++)
+	int vertexCount = rsmFile.read<int>();
+	rsmFile.readArray(vertices, vertexCount);
+
+	int texCoordCount = rsmFile.read<int>();
+	if (model->version >= 0x0102)
 	{
-		float todo = 0;
-		if (model->version >= 0x0102)
-		{
-			rsmFile->read(reinterpret_cast<char*>(&todo), sizeof(float)); //color??
-			//assert(todo == 0);
-		}
-		rsmFile->read(reinterpret_cast<char*>(glm::value_ptr(texCoords[i])), sizeof(float) * 2);
-//		texCoords[i].y = texCoords[i].y;
+		std::vector<RsmFileTexCoord> fileTexCoords;
+		rsmFile.readArray(fileTexCoords, texCoordCount);
+		texCoords.resize(fileTexCoords.size());
+		for (std::size_t i = 0; i < fileTexCoords.size(); i++)
+			texCoords[i] = fileTexCoords[i].texCoord;
 	}
+	else
+		rsmFile.readArray(texCoords, texCoordCount);
 
-	int faceCount;
-	rsmFile->read(reinterpret_cast<char*>(&faceCount), sizeof(int));
+	int faceCount = rsmFile.read<int>();
+	if (faceCount < 0 || (std::size_t)faceCount > rsmFile.remaining() / 20) //a face is at least 20 bytes
+		throw std::out_of_range("invalid face count");
 	faces.resize(faceCount);
 	for (int i = 0; i < faceCount; i++)
 	{
@@ -343,26 +430,26 @@ Rsm::Mesh::Mesh(Rsm* model, std::istream* rsmFile)
 		int len = -1;
 
 		if(model->version >= 0x0202)
-			rsmFile->read(reinterpret_cast<char*>(&len), sizeof(int));
+			rsmFile.read(len);
 
-		rsmFile->read(reinterpret_cast<char*>(f->vertexIds), sizeof(short) * 3);
-		rsmFile->read(reinterpret_cast<char*>(f->texCoordIds), sizeof(short) * 3);
-		rsmFile->read(reinterpret_cast<char*>(&f->texId), sizeof(short));
-		rsmFile->read(reinterpret_cast<char*>(&f->padding), sizeof(short));
+		rsmFile.read(f->vertexIds, sizeof(short) * 3);
+		rsmFile.read(f->texCoordIds, sizeof(short) * 3);
+		rsmFile.read(f->texId);
+		rsmFile.read(f->padding);
 
-		rsmFile->read(reinterpret_cast<char*>(&f->twoSided), sizeof(int));
+		rsmFile.read(f->twoSided);
 		if (model->version >= 0x0102)
 		{
-			rsmFile->read(reinterpret_cast<char*>(&f->smoothGroups[0]), sizeof(int));
+			rsmFile.read(f->smoothGroups[0]);
 			if (len > 24)
-				rsmFile->read(reinterpret_cast<char*>(&f->smoothGroups[1]), sizeof(int));
+				rsmFile.read(f->smoothGroups[1]);
 			if (len > 28)
-				rsmFile->read(reinterpret_cast<char*>(&f->smoothGroups[2]), sizeof(int));
-			for(int i = 32; i < len; i+=4)
+				rsmFile.read(f->smoothGroups[2]);
+			if (len > 32)
 			{
 				std::cout << "Model " << model->fileName << " has too many smooth groups. Please contact borf" << std::endl;
-				int tmp;
-				rsmFile->read(reinterpret_cast<char*>(&tmp), sizeof(int));
+				for (int i = 32; i < len; i += 4)
+					rsmFile.skip(sizeof(int));
 			}
 		}
 		bool ok = true;
@@ -379,6 +466,7 @@ Rsm::Mesh::Mesh(Rsm* model, std::istream* rsmFile)
 		}
 	}
 
+	//the vertex buffers made from these normals are cached on disk, increase Rsm::meshGeneratorVersion when changing this
 	if (model->shadeType == ShadeType::SHADE_FLAT)
 		for (auto& f : faces)
 			for (int ii = 0; ii < 3; ii++)
@@ -413,74 +501,58 @@ Rsm::Mesh::Mesh(Rsm* model, std::istream* rsmFile)
 
 	if (model->version >= 0x0106)
 	{
-		int scaleFrameCount;
-		rsmFile->read(reinterpret_cast<char*>(&scaleFrameCount), sizeof(int));
-		scaleFrames.resize(scaleFrameCount);
-		for (int i = 0; i < scaleFrameCount; i++)
+		std::vector<RsmFileFrame> fileFrames;
+		rsmFile.readArray(fileFrames, rsmFile.read<int>());
+		scaleFrames.resize(fileFrames.size());
+		for (std::size_t i = 0; i < fileFrames.size(); i++)
 		{
-			rsmFile->read(reinterpret_cast<char*>(&scaleFrames[i].time), sizeof(int));
-			rsmFile->read(reinterpret_cast<char*>(glm::value_ptr(scaleFrames[i].scale)), sizeof(float) * 3);
-			rsmFile->read(reinterpret_cast<char*>(&scaleFrames[i].data), sizeof(float));
+			scaleFrames[i].time = fileFrames[i].time;
+			scaleFrames[i].scale = glm::vec3(fileFrames[i].data[0], fileFrames[i].data[1], fileFrames[i].data[2]);
+			scaleFrames[i].data = fileFrames[i].data[3];
 			if (model->version > 0x0202)
 				scaleFrames[i].time = (int)ceil(scaleFrames[i].time * model->fps); //TODO: remove this
 		}
 	}
 
 
-	int rotFrameCount;
-	rsmFile->read(reinterpret_cast<char*>(&rotFrameCount), sizeof(int));
-	rotFrames.resize(rotFrameCount);
-	for (int i = 0; i < rotFrameCount; i++)
 	{
-		rsmFile->read(reinterpret_cast<char*>(&rotFrames[i].time), sizeof(int));
-		float x, y, z, w;
-		rsmFile->read(reinterpret_cast<char*>(&x), sizeof(float));
-		rsmFile->read(reinterpret_cast<char*>(&y), sizeof(float));
-		rsmFile->read(reinterpret_cast<char*>(&z), sizeof(float));
-		rsmFile->read(reinterpret_cast<char*>(&w), sizeof(float));
-		rotFrames[i].quaternion = glm::quat(w, x, y, z);
-		if (model->version > 0x0202)
-			rotFrames[i].time = (int)ceil(rotFrames[i].time * model->fps); //TODO: remove this
-
+		std::vector<RsmFileFrame> fileFrames;
+		rsmFile.readArray(fileFrames, rsmFile.read<int>());
+		rotFrames.resize(fileFrames.size());
+		for (std::size_t i = 0; i < fileFrames.size(); i++)
+		{
+			rotFrames[i].time = fileFrames[i].time;
+			rotFrames[i].quaternion = glm::quat(fileFrames[i].data[3], fileFrames[i].data[0], fileFrames[i].data[1], fileFrames[i].data[2]);
+			if (model->version > 0x0202)
+				rotFrames[i].time = (int)ceil(rotFrames[i].time * model->fps); //TODO: remove this
+		}
 	}
 
 	if (model->version >= 0x0202)
 	{
-		int posKeyFrameCount;
-		rsmFile->read(reinterpret_cast<char*>(&posKeyFrameCount), sizeof(int));
-		posFrames.resize(posKeyFrameCount);
-		for (int i = 0; i < posKeyFrameCount; i++)
+		std::vector<RsmFileFrame> fileFrames;
+		rsmFile.readArray(fileFrames, rsmFile.read<int>());
+		posFrames.resize(fileFrames.size());
+		for (std::size_t i = 0; i < fileFrames.size(); i++)
 		{
-			rsmFile->read(reinterpret_cast<char*>(&posFrames[i].time), sizeof(int));
-			rsmFile->read(reinterpret_cast<char*>(glm::value_ptr(posFrames[i].position)), sizeof(float) * 3);
-			rsmFile->read(reinterpret_cast<char*>(&posFrames[i].data), sizeof(float));
-			posFrames[i].time = (int)ceil(posFrames[i].time * model->fps); //TODO: remove this
+			posFrames[i].time = (int)ceil(fileFrames[i].time * model->fps); //TODO: remove this
+			posFrames[i].position = glm::vec3(fileFrames[i].data[0], fileFrames[i].data[1], fileFrames[i].data[2]);
+			posFrames[i].data = fileFrames[i].data[3];
 		}
 		if (model->version >= 0x0203)
 		{
-			int textureAnimCount;
-			rsmFile->read(reinterpret_cast<char*>(&textureAnimCount), sizeof(int));
+			int textureAnimCount = rsmFile.read<int>();
 			for (int i = 0; i < textureAnimCount; i++)
 			{
-				int textureId;
-				rsmFile->read(reinterpret_cast<char*>(&textureId), sizeof(int));
-
-				int textureIdAnimationCount;
-				rsmFile->read(reinterpret_cast<char*>(&textureIdAnimationCount), sizeof(int));
-
+				rsmFile.skip(sizeof(int)); //textureId
+				int textureIdAnimationCount = rsmFile.read<int>();
 				for (int i = 0; i < textureIdAnimationCount; i++)
 				{
-					int type, amountFrames;
-					rsmFile->read(reinterpret_cast<char*>(&type), sizeof(int));
-					rsmFile->read(reinterpret_cast<char*>(&amountFrames), sizeof(int));
-
-					for (int ii = 0; ii < amountFrames; ii++)
-					{
-						int frame;
-						rsmFile->read(reinterpret_cast<char*>(&frame), sizeof(int));
-						float offset;
-						rsmFile->read(reinterpret_cast<char*>(&offset), sizeof(float));
-					}
+					rsmFile.skip(sizeof(int)); //type
+					int amountFrames = rsmFile.read<int>();
+					if (amountFrames < 0)
+						throw std::out_of_range("invalid texture animation frame count");
+					rsmFile.skip(amountFrames * (sizeof(int) + sizeof(float))); //frame, offset
 				}
 			}
 
@@ -515,7 +587,15 @@ void Rsm::Mesh::fetchChildren(std::map<std::string, Mesh* > meshes)
 
 void Rsm::Mesh::calcMatrix1(int time)
 {
-	matrix1 = glm::mat4(1.0f);
+	matrix1 = calcLocalMatrix1(time);
+	for (unsigned int i = 0; i < children.size(); i++)
+		children[i]->calcMatrix1(time);
+}
+
+//calculates matrix1 of only this mesh, without changing anything, so it can be used by multiple instances
+glm::mat4 Rsm::Mesh::calcLocalMatrix1(int time) const
+{
+	glm::mat4 matrix1 = glm::mat4(1.0f);
 
 	if (parent == NULL)
 	{
@@ -538,12 +618,21 @@ void Rsm::Mesh::calcMatrix1(int time)
 		{
 			int tick = time % rotFrames[rotFrames.size() - 1].time;
 			int current = 0;
-			for (unsigned int i = 0; i < rotFrames.size(); i++)
+			if (rotFramesSorted)
+			{
+				auto it = std::upper_bound(rotFrames.begin(), rotFrames.end(), tick, [](int tick, const RotFrame& frame) { return tick < frame.time; });
+				if (it != rotFrames.end())
+					current = (int)(it - rotFrames.begin()) - 1;
+			}
+			else
 			{
-				if (rotFrames[i].time > tick)
+				for (unsigned int i = 0; i < rotFrames.size(); i++)
 				{
-					current = i - 1;
-					break;
+					if (rotFrames[i].time > tick)
+					{
+						current = i - 1;
+						break;
+					}
 				}
 			}
 			if (current < 0)
@@ -578,9 +667,7 @@ void Rsm::Mesh::calcMatrix1(int time)
 	matrix1 = glm::scale(matrix1, scale);
 	//	if(nAnimationFrames == 0)
 	//		cache1 = true;
-
-	for (unsigned int i = 0; i < children.size(); i++)
-		children[i]->calcMatrix1(time);
+	return matrix1;
 }
 
 void Rsm::Mesh::calcMatrix2()
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Component.h"
+#include <browedit/util/FileIO.h>
 #include <string>
 #include <map>
 #include <vector>
@@ -9,6 +10,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+namespace util { class ByteReader; }
+
 #ifdef _DEBUG
 #define VERSIONLIMIT(min, max, type, name) \
 private:\
@@ -98,7 +101,7 @@ public:
 			float						data; //???????
 		};
 
-		Mesh(Rsm* model, std::istream* rsmFile);
+		Mesh(Rsm* model, util::ByteReader& rsmFile);
 		Mesh(Rsm* model);
 		~Mesh();
 
@@ -148,8 +151,12 @@ public:
 
 		float maxRange;
 		void calcMatrix1(int time);
+		glm::mat4 calcLocalMatrix1(int time) const;
 		void calcMatrix2();
 		bool matrixDirty = true;
+		bool isAnimated() const { return !rotFrames.empty() && rotFrames.back().time != 0; }
+		bool rotFramesSorted = true; //the keyframe lookup uses a binary search when the frames are sorted on time
+		glm::mat4 matrix1Static; //matrix1 without the parents, for meshes that are not animated
 
 		void setBoundingBox(glm::vec3& bbmin, glm::vec3& bbmax);
 		void setBoundingBox2(glm::mat4& mat, glm::vec3& realbbmin, glm::vec3& realbbmax);
@@ -157,12 +164,42 @@ public:
 
 
 	void updateMatrices();
+
+	//The evaluated animation of all meshes at 1 point in time. Shared by all instances of this model
+	class Pose
+	{
+	public:
+		int tick = -1;
+		unsigned int version = 0; //increased every time the pose gets evaluated, so renderers know when to copy the matrices
+		std::vector<glm::mat4> matrix; //per mesh index, the parent matrices * matrix1 * matrix2
+		std::vector<glm::mat4> matrixSub; //per mesh index, the parent matrices * matrix1, the base for the children
+	};
+	const Pose& getPose(int tick);
+	void invalidatePose() { poseDirty = true; }
+private:
+	class PoseMesh
+	{
+	public:
+		Mesh* mesh;
+		int parent; //index in poseMeshes, -1 for the root
+		bool animated; //this mesh or one of its parents is animated
+	};
+	Pose pose;
+	std::vector<PoseMesh> poseMeshes; //in tree order, parents before their children
+	bool poseDirty = true;
+	bool animated = false;
+	void buildPose();
 public:
 	Rsm(const std::string& fileName);
 	~Rsm();
 	void reload();
+	void takeFrom(Rsm* other); //moves the loaded model of other into this one, for reloading on another thread
 
 	std::string fileName;
+	util::FileIO::Fingerprint fingerprint; //of the file when it was loaded, for hot reloading
+	std::uint64_t contentHash = 0; //of the file contents, for the vertex buffer cache. 0 when the meshes were edited after loading
+	unsigned int reloadCount = 0; //increased every time the model is (re)loaded, so renderers know to rebuild
+	static constexpr int meshGeneratorVersion = 1; //increase when the faces, normals or vertex buffers made from a file change, so old cached vertex buffers aren't used
 	bool loaded;
 	short version;
 	Mesh* rootMesh;
@@ -4,10 +4,23 @@
 #include "Gnd.h"
 #include <browedit/Node.h>
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/Profiler.h>
 #include <browedit/gl/Texture.h>
 #include <browedit/shaders/RsmShader.h>
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/ByteStream.h>
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 RsmRenderer::RsmRenderer()
 {
@@ -36,12 +49,12 @@ void RsmRenderer::begin()
 	textures.clear();
 	for (auto ri : renderInfo)
 	{
-		delete ri.vbo;
 		if(ri.textures.size() > 0)
 			for(auto t : ri.textures)
 				util::ResourceManager<gl::Texture>::unload(t);
 	}
 	renderInfo.clear();
+	releaseMeshData();
 }
 
 void RsmRenderer::render()
@@ -53,8 +66,7 @@ void RsmRenderer::render()
 		{//init
 			for (const auto& textureFilename : rsm->textures)
 				textures.push_back(util::ResourceManager<gl::Texture>::load("data\\texture\\" + textureFilename));
-			renderInfo.resize(rsm->meshCount);
-			initMeshInfo(rsm->rootMesh);
+			initMeshData();
 		}
 	}
 	if (!this->rswModel)
@@ -73,46 +85,31 @@ void RsmRenderer::render()
 		this->rsm = RsmRenderer::errorModel;
 		for (const auto& textureFilename : rsm->textures)
 			textures.push_back(util::ResourceManager<gl::Texture>::load("data\\texture\\" + textureFilename));
-		renderInfo.resize(rsm->meshCount);
-		initMeshInfo(rsm->rootMesh);
+		initMeshData();
 	}
 
 
-	if (meshDirty)
+	if (meshDirty && meshData)
 	{
-		for (auto ri : renderInfo)
-		{
-			delete ri.vbo;
-			if (ri.textures.size() > 0)
-				for (auto t : ri.textures)
-					util::ResourceManager<gl::Texture>::unload(t);
-		}
-		renderInfo.clear();
-		renderInfo.resize(rsm->meshCount);
-		initMeshInfo(rsm->rootMesh);
+		//the rsm itself was changed, so the buffer of all renderers of this rsm has to be rebuilt
+		meshData->build(rsm);
+		meshDirty = false;
+	}
+	if (meshData && meshDataRsm == rsm && rsmReloadCount != rsm->reloadCount)
+	{//the rsm was reloaded, so the textures and the placement can be different too
+		for (auto t : textures)
+			util::ResourceManager<gl::Texture>::unload(t);
+		textures.clear();
+		matrixCached = false;
 	}
+	if (!meshData || meshDataRsm != rsm || meshDataVersion != meshData->version || rsmReloadCount != rsm->reloadCount)
+		initMeshData();
 
 
 
 	if (!matrixCached && this->rswModel && this->gnd && this->rsw)
 	{
-		matrixCache = glm::mat4(1.0f);
-		matrixCache = glm::scale(matrixCache, glm::vec3(1, 1, -1));
-		matrixCache = glm::translate(matrixCache, glm::vec3(5 * gnd->width + rswObject->position.x, -rswObject->position.y, -10 - 5 * gnd->height + rswObject->position.z));
-		matrixCache = glm::rotate(matrixCache, -glm::radians(rswObject->rotation.z), glm::vec3(0, 0, 1));
-		matrixCache = glm::rotate(matrixCache, -glm::radians(rswObject->rotation.x), glm::vec3(1, 0, 0));
-		matrixCache = glm::rotate(matrixCache, glm::radians(rswObject->rotation.y), glm::vec3(0, 1, 0));
-		if (rswModel)
-		{
-			matrixCache = glm::scale(matrixCache, glm::vec3(rswObject->scale.x, -rswObject->scale.y, rswObject->scale.z));
-			matrixCache = glm::translate(matrixCache, glm::vec3(-rsm->realbbrange.x, rsm->realbbmin.y, -rsm->realbbrange.z));
-			if (rsm->version >= 0x0202)
-			{
-				matrixCache = glm::scale(matrixCache, glm::vec3(1, -1, 1));
-				matrixCache = glm::translate(matrixCache, glm::vec3(0, rsm->realbbmax.y, 0));
-			}
-
-		}
+		matrixCache = calcModelMatrix(rsm, rswObject, gnd);
 		matrixCached = true;
 
 		if (rswModel)
@@ -157,6 +154,27 @@ void RsmRenderer::render()
 	}
 	shader->setUniform(RsmShader::Uniforms::lightDirection, lightDirection);
 
+	{
+		auto context = dynamic_cast<RsmRenderContext*>(renderContext);
+		const Rsm::Pose& pose = rsm->getPose(time < 0 ? context->tick : (int)floor(time * 1000));
+		if (pose.version != poseVersion)
+		{
+			for (std::size_t i = 0; i < renderInfo.size() && i < pose.matrix.size(); i++)
+			{
+				renderInfo[i].matrix = pose.matrix[i];
+				renderInfo[i].matrixSub = pose.matrixSub[i];
+			}
+			poseVersion = pose.version;
+		}
+	}
+
+	if (!meshData->vbo)
+		return;
+	meshData->vbo->bind();
+	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexP3T2N3), (void*)(0 * sizeof(float)));
+	glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2N3), (void*)(3 * sizeof(float)));
+	glVertexAttribPointer(2, 3, GL_FLOAT, false, sizeof(VertexP3T2N3), (void*)(5 * sizeof(float)));
+
 	if (selected)
 	{
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -175,27 +193,373 @@ void RsmRenderer::render()
 		renderMesh(rsm->rootMesh, glm::mat4(1.0f));
 }
 
+//matrix that places the model on the map. Doesn't need a renderer, so it can also be used without an opengl context
+glm::mat4 RsmRenderer::calcModelMatrix(Rsm* rsm, RswObject* rswObject, Gnd* gnd)
+{
+	glm::mat4 matrix(1.0f);
+	matrix = glm::scale(matrix, glm::vec3(1, 1, -1));
+	matrix = glm::translate(matrix, glm::vec3(5 * gnd->width + rswObject->position.x, -rswObject->position.y, -10 - 5 * gnd->height + rswObject->position.z));
+	matrix = glm::rotate(matrix, -glm::radians(rswObject->rotation.z), glm::vec3(0, 0, 1));
+	matrix = glm::rotate(matrix, -glm::radians(rswObject->rotation.x), glm::vec3(1, 0, 0));
+	matrix = glm::rotate(matrix, glm::radians(rswObject->rotation.y), glm::vec3(0, 1, 0));
+	matrix = glm::scale(matrix, glm::vec3(rswObject->scale.x, -rswObject->scale.y, rswObject->scale.z));
+	matrix = glm::translate(matrix, glm::vec3(-rsm->realbbrange.x, rsm->realbbmin.y, -rsm->realbbrange.z));
+	if (rsm->version >= 0x0202)
+	{
+		matrix = glm::scale(matrix, glm::vec3(1, -1, 1));
+		matrix = glm::translate(matrix, glm::vec3(0, rsm->realbbmax.y, 0));
+	}
+	return matrix;
+}
+
+//the aabb of the rswModel is only valid after the matrix is calculated in render
+bool RsmRenderer::getBounds(glm::vec3& min, glm::vec3& max)
+{
+	if (!matrixCached || !rswModel)
+		return false;
+	min = rswModel->aabb.min;
+	max = rswModel->aabb.max;
+	return true;
+}
 
-void RsmRenderer::initMeshInfo(Rsm::Mesh* mesh, const glm::mat4 &matrix)
+RsmRenderer::MeshData::~MeshData()
+{
+	delete vbo;
+}
+
+//cache files are only valid for the same file contents, vertex layout, format and version of the code that made the vertices (Rsm::meshGeneratorVersion)
+static const char meshCacheMagic[4] = { 'B', 'E', 'M', 'C' };
+static const int meshCacheFormat = 2;
+static const std::uintmax_t meshCacheMaxSize = 256 * 1024 * 1024; //when the cache directory grows over this, the files that were used longest ago are removed
+static const std::size_t meshCacheMaxQueued = 64 * 1024 * 1024; //files that are not written yet, more than this are dropped
+
+//writes the cache files on its own thread, so building the vertex buffers doesn't wait for the disk
+class MeshCacheWriter
 {
-	std::map<int, std::vector<VertexP3T2N3> > verts;
-	for (size_t i = 0; i < mesh->faces.size(); i++)
+	class Request
 	{
-		for (int ii = 0; ii < 3; ii++)
-			verts[mesh->faces[i].texId].push_back(VertexP3T2N3(mesh->vertices[mesh->faces[i].vertexIds[ii]], mesh->texCoords[mesh->faces[i].texCoordIds[ii]], mesh->faces[i].vertexNormals[ii]));
+	public:
+		std::string fileName;
+		std::vector<char> data; //empty to only mark an existing file as used
+	};
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Request> queue;
+	std::size_t queuedBytes = 0;
+	bool stopping = false;
+	std::uintmax_t cacheSize = 0; //of the cache directory, only used on the writer thread
+
+	void run();
+	void write(const Request& request);
+	void evict();
+	void add(Request&& request);
+public:
+	~MeshCacheWriter();
+	void save(const std::string& fileName, std::vector<char>&& data) { add(Request{ fileName, std::move(data) }); }
+	void touch(const std::string& fileName) { add(Request{ fileName, {} }); }
+};
+static MeshCacheWriter meshCacheWriter;
+
+MeshCacheWriter::~MeshCacheWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
 	}
+	wake.notify_one();
+	if (thread.joinable())
+		thread.join();
+}
 
+void MeshCacheWriter::add(Request&& request)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queuedBytes + request.data.size() > meshCacheMaxQueued)
+			return;
+		queuedBytes += request.data.size();
+		queue.push_back(std::move(request));
+		if (!thread.joinable())
+			thread = std::thread(&MeshCacheWriter::run, this);
+	}
+	wake.notify_one();
+}
+
+void MeshCacheWriter::run()
+{
+	std::error_code ec;
+	std::filesystem::create_directories("cache\\rsm", ec);
+	for (const auto& entry : std::filesystem::directory_iterator("cache\\rsm", ec))
+		if (entry.is_regular_file(ec))
+			cacheSize += entry.file_size(ec);
+	while (true)
+	{
+		Request request;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+			if (stopping) //the cache is optional, files that are not written yet are dropped
+				return;
+			request = std::move(queue.front());
+			queue.pop_front();
+			queuedBytes -= request.data.size();
+		}
+		write(request);
+		if (cacheSize > meshCacheMaxSize)
+			evict();
+	}
+}
+
+//the cache is optional, so failing to write it is not an error
+void MeshCacheWriter::write(const Request& request)
+{
+	std::error_code ec;
+	if (request.data.empty())
+	{
+		std::filesystem::last_write_time(request.fileName, std::filesystem::file_time_type::clock::now(), ec);
+		return;
+	}
+	auto oldSize = std::filesystem::file_size(request.fileName, ec);
+	if (ec)
+		oldSize = 0;
+	{
+		std::ofstream file(request.fileName + ".tmp", std::ios_base::binary);
+		if (!file)
+			return;
+		file.write(request.data.data(), request.data.size());
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(request.fileName + ".tmp", ec);
+			return;
+		}
+	}
+	std::filesystem::rename(request.fileName + ".tmp", request.fileName, ec);
+	if (!ec)
+		cacheSize += request.data.size() - oldSize;
+}
+
+//removes the files that were used longest ago, until the cache is at 3/4 of the maximum size, so this doesn't run after every file
+void MeshCacheWriter::evict()
+{
+	class CacheFile
+	{
+	public:
+		std::filesystem::path path;
+		std::uintmax_t size;
+		std::filesystem::file_time_type time;
+	};
+	std::vector<CacheFile> files;
+	std::error_code ec;
+	cacheSize = 0;
+	for (const auto& entry : std::filesystem::directory_iterator("cache\\rsm", ec))
+	{
+		if (!entry.is_regular_file(ec))
+			continue;
+		files.push_back(CacheFile{ entry.path(), entry.file_size(ec), entry.last_write_time(ec) });
+		cacheSize += files.back().size;
+	}
+	std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.time < b.time; });
+	int removed = 0;
+	for (const auto& file : files)
+	{
+		if (cacheSize <= meshCacheMaxSize / 4 * 3)
+			break;
+		if (std::filesystem::remove(file.path, ec))
+		{
+			cacheSize -= file.size;
+			removed++;
+		}
+	}
+	std::cout << "RsmRenderer: removed " << removed << " old files from the vertex buffer cache" << std::endl;
+}
+
+static std::string meshCacheFileName(Rsm* rsm)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)rsm->contentHash);
+	return std::string("cache\\rsm\\") + name;
+}
+
+void RsmRenderer::MeshData::build(Rsm* rsm)
+{
+	PROFILE_SCOPE("Rsm mesh data");
+	PROFILE_COUNT("Rsm mesh data built", 1);
+	auto start = std::chrono::steady_clock::now();
+	reloadCount = rsm->reloadCount;
+	builtCount++;
+	version++;
+	//a contentHash of 0 means the meshes were edited, so they don't match the file anymore
+	if (rsm->contentHash != 0 && loadCache(rsm))
+	{
+		PROFILE_COUNT("Rsm mesh cache hits", 1);
+		cachedCount++;
+		buildTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return;
+	}
+	indices.clear();
+	indices.resize(rsm->meshCount);
 	std::vector<VertexP3T2N3> allVerts;
-	for (std::map<int, std::vector<VertexP3T2N3> >::iterator it2 = verts.begin(); it2 != verts.end(); it2++)
+	if (rsm->rootMesh)
+		rsm->rootMesh->foreach([&](Rsm::Mesh* mesh)
+		{
+			if (mesh->index >= (int)indices.size())
+				indices.resize(mesh->index + 1);
+			std::vector<std::size_t> order(mesh->faces.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [mesh](std::size_t a, std::size_t b) { return mesh->faces[a].texId < mesh->faces[b].texId; });
+			for (auto i : order)
+			{
+				const auto& face = mesh->faces[i];
+				if (indices[mesh->index].empty() || indices[mesh->index].back().texture != face.texId)
+					indices[mesh->index].push_back(VboIndex(face.texId, (int)allVerts.size(), 0));
+				for (int ii = 0; ii < 3; ii++)
+					allVerts.push_back(VertexP3T2N3(mesh->vertices[face.vertexIds[ii]], mesh->texCoords[face.texCoordIds[ii]], face.vertexNormals[ii]));
+				indices[mesh->index].back().count += 3;
+			}
+		});
+	upload(allVerts.data(), allVerts.size());
+	if (rsm->contentHash != 0)
 	{
-		renderInfo[mesh->index].indices.push_back(VboIndex(it2->first, (int)allVerts.size(), (int)it2->second.size()));
-		allVerts.insert(allVerts.end(), it2->second.begin(), it2->second.end());
+		PROFILE_COUNT("Rsm mesh cache misses", 1);
+		saveCache(rsm, allVerts);
 	}
-	if (!allVerts.empty())
+	buildTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RsmRenderer::MeshData::upload(const VertexP3T2N3* verts, std::size_t count)
+{
+	if (count == 0)
 	{
-		renderInfo[mesh->index].vbo = new gl::VBO<VertexP3T2N3>();
-		renderInfo[mesh->index].vbo->setData(allVerts, GL_STATIC_DRAW);
+		delete vbo;
+		vbo = nullptr;
+		return;
 	}
+	if (!vbo)
+	{
+		vbo = new gl::VBO<VertexP3T2N3>();
+		vbo->memory.setTag("GL model buffers");
+	}
+	vbo->setData(count, const_cast<VertexP3T2N3*>(verts), GL_STATIC_DRAW);
+}
+
+bool RsmRenderer::MeshData::loadCache(Rsm* rsm)
+{
+	std::ifstream file(meshCacheFileName(rsm), std::ios_base::binary);
+	if (!file)
+		return false;
+	std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	try
+	{
+		util::ByteReader reader(data);
+		char magic[4];
+		reader.read(magic, 4);
+		if (memcmp(magic, meshCacheMagic, 4) != 0 || reader.read<int>() != meshCacheFormat || reader.read<int>() != Rsm::meshGeneratorVersion ||
+			reader.read<std::uint64_t>() != rsm->contentHash || reader.read<int>() != (int)sizeof(VertexP3T2N3))
+			return false;
+		int meshCount = reader.read<int>();
+		if (meshCount < rsm->meshCount)
+			return false;
+		std::vector<std::vector<VboIndex>> cachedIndices(meshCount);
+		for (auto& ranges : cachedIndices)
+		{
+			int rangeCount = reader.read<int>();
+			if (rangeCount < 0 || (std::size_t)rangeCount > reader.remaining() / (3 * sizeof(int)))
+				return false;
+			for (int i = 0; i < rangeCount; i++)
+			{
+				int texture = reader.read<int>();
+				int begin = reader.read<int>();
+				int count = reader.read<int>();
+				ranges.push_back(VboIndex(texture, begin, count));
+			}
+		}
+		int vertexCount = reader.read<int>();
+		if (vertexCount < 0 || reader.remaining() != vertexCount * sizeof(VertexP3T2N3))
+			return false;
+		for (const auto& ranges : cachedIndices)
+			for (const auto& range : ranges)
+				if (range.begin < 0 || range.count < 0 || range.begin + range.count > vertexCount)
+					return false;
+		indices = std::move(cachedIndices);
+		upload(reinterpret_cast<const VertexP3T2N3*>(reader.ptr()), vertexCount);
+		meshCacheWriter.touch(meshCacheFileName(rsm));
+		return true;
+	}
+	catch (const std::out_of_range&)
+	{
+		return false;
+	}
+}
+
+void RsmRenderer::MeshData::saveCache(Rsm* rsm, const std::vector<VertexP3T2N3>& verts)
+{
+	util::ByteWriter writer(64 + verts.size() * sizeof(VertexP3T2N3));
+	writer.write(meshCacheMagic, 4);
+	writer.write(meshCacheFormat);
+	writer.write(Rsm::meshGeneratorVersion);
+	writer.write(rsm->contentHash);
+	writer.write((int)sizeof(VertexP3T2N3));
+	writer.write((int)indices.size());
+	for (const auto& ranges : indices)
+	{
+		writer.write((int)ranges.size());
+		for (const auto& range : ranges)
+		{
+			writer.write(range.texture);
+			writer.write(range.begin);
+			writer.write(range.count);
+		}
+	}
+	writer.write((int)verts.size());
+	writer.write(verts.data(), verts.size() * sizeof(VertexP3T2N3));
+	meshCacheWriter.save(meshCacheFileName(rsm), std::move(writer.data));
+}
+
+//takes the shared mesh data of the current rsm, and resets the matrices of this renderer
+void RsmRenderer::initMeshData()
+{
+	if (meshDataRsm != rsm)
+	{
+		releaseMeshData();
+		auto& data = meshDataCache[rsm];
+		if (!data)
+		{
+			data = new MeshData();
+			data->build(rsm);
+		}
+		data->users++;
+		meshData = data;
+		meshDataRsm = rsm;
+	}
+	if (meshData->reloadCount != rsm->reloadCount)
+		meshData->build(rsm); //the rsm was reloaded in place, so the shared buffer is outdated
+	rsmReloadCount = rsm->reloadCount;
+	renderInfo.clear();
+	renderInfo.resize(std::max((std::size_t)rsm->meshCount, meshData->indices.size()));
+	if (rsm->rootMesh)
+		initMeshInfo(rsm->rootMesh);
+	meshDirty = false;
+	meshDataVersion = meshData->version;
+}
+
+void RsmRenderer::releaseMeshData()
+{
+	if (!meshData)
+		return;
+	if (--meshData->users == 0)
+	{
+		meshDataCache.erase(meshDataRsm);
+		delete meshData;
+	}
+	meshData = nullptr;
+	meshDataRsm = nullptr;
+	meshDataVersion = -1;
+}
+
+void RsmRenderer::initMeshInfo(Rsm::Mesh* mesh, const glm::mat4 &matrix)
+{
 	renderInfo[mesh->index].matrix = matrix * mesh->matrix1 * mesh->matrix2;
 	renderInfo[mesh->index].matrixSub = matrix * mesh->matrix1;
 
@@ -206,6 +570,7 @@ void RsmRenderer::initMeshInfo(Rsm::Mesh* mesh, const glm::mat4 &matrix)
 	for (size_t i = 0; i < mesh->children.size(); i++)
 		initMeshInfo(mesh->children[i], renderInfo[mesh->index].matrixSub);
 	meshDirty = false;
+	poseVersion = 0;
 }
 
 void RsmRenderer::renderMesh(Rsm::Mesh* mesh, const glm::mat4& matrix, bool selectionPhase)
@@ -216,23 +581,11 @@ void RsmRenderer::renderMesh(Rsm::Mesh* mesh, const glm::mat4& matrix, bool sele
 			textures.push_back(util::ResourceManager<gl::Texture>::load("data\\texture\\" + textureFilename));
 	}
 
-	if (mesh && (!mesh->rotFrames.empty() || mesh->matrixDirty))
-	{
-		mesh->matrixDirty = false;
-		if(time < 0)
-			mesh->calcMatrix1((int)floor(glfwGetTime() * 1000));
-		else
-			mesh->calcMatrix1((int)floor(time * 1000));
-		renderInfo[mesh->index].matrix = matrix * mesh->matrix1 * mesh->matrix2;
-		renderInfo[mesh->index].matrixSub = matrix * mesh->matrix1;
-	}
-
 	auto shader = dynamic_cast<RsmRenderContext*>(renderContext)->shader;
 
 	RenderInfo& ri = renderInfo[mesh->index];
-	if (ri.vbo != nullptr)
+	if (mesh->index < (int)meshData->indices.size() && !meshData->indices[mesh->index].empty())
 	{
-		ri.vbo->bind();
 		shader->setUniform(RsmShader::Uniforms::modelMatrix, ri.matrix);
 		if (ri.selected || selectionPhase)
 			shader->setUniform(RsmShader::Uniforms::selection, 1.0f);
@@ -243,17 +596,14 @@ void RsmRenderer::renderMesh(Rsm::Mesh* mesh, const glm::mat4& matrix, bool sele
 		if (ri.selected)
 			glDisable(GL_DEPTH_TEST);
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexP3T2N3), (void*)(0 * sizeof(float)));
-		glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2N3), (void*)(3 * sizeof(float)));
-		glVertexAttribPointer(2, 3, GL_FLOAT, false, sizeof(VertexP3T2N3), (void*)(5 * sizeof(float)));
-
-		for (const VboIndex& it : ri.indices)
+		for (const VboIndex& it : meshData->indices[mesh->index])
 		{
 			if(ri.textures.size() > 0)
 				ri.textures[mesh->textures[it.texture]]->bind();
 			else
 				textures[mesh->textures[it.texture]]->bind();
 			glDrawArrays(GL_TRIANGLES, (int)it.begin, (int)it.count);
+			PROFILE_COUNT("Draw calls", 1);
 		}
 		if (ri.selected)
 			glEnable(GL_DEPTH_TEST);
@@ -265,6 +615,7 @@ void RsmRenderer::renderMesh(Rsm::Mesh* mesh, const glm::mat4& matrix, bool sele
 
 void RsmRenderer::setMeshesDirty() {
 	this->meshDirty = true;
+	rsm->contentHash = 0; //the meshes don't match the file anymore, so don't use or fill the disk cache for them
 	this->matrixCached = false;
 	rsm->updateMatrices();
 	for (auto t : textures)
@@ -285,12 +636,13 @@ RsmRenderer::RsmRenderContext::RsmRenderContext() : shader(util::ResourceManager
 
 void RsmRenderer::RsmRenderContext::preFrame(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix)
 {
+	tick = (int)floor(glfwGetTime() * 1000);
 	shader->use();
 	shader->setUniform(RsmShader::Uniforms::projectionMatrix, projectionMatrix);
 	shader->setUniform(RsmShader::Uniforms::cameraMatrix, viewMatrix);
-	shader->setUniform(RsmShader::Uniforms::lightToggle, viewLighting);
-	shader->setUniform(RsmShader::Uniforms::viewTextures, viewTextures);
-	shader->setUniform(RsmShader::Uniforms::fogEnabled, viewFog);
+	shader->setUniform(RsmShader::Uniforms::lightToggle, settings->viewLighting);
+	shader->setUniform(RsmShader::Uniforms::viewTextures, settings->viewTextures);
+	shader->setUniform(RsmShader::Uniforms::fogEnabled, settings->viewFog);
 
 
 	glEnableVertexAttribArray(0);
@@ -298,4 +650,14 @@ void RsmRenderer::RsmRenderContext::preFrame(const glm::mat4& projectionMatrix,
 	glEnableVertexAttribArray(2);
 	glDisableVertexAttribArray(3);
 	glDisableVertexAttribArray(4); //TODO: vao
+}
+
+void RsmRenderer::RsmRenderContext::postFrame()
+{
+	if (MeshData::builtCount == 0)
+		return;
+	std::cout << "RsmRenderer: built vertex buffers of " << MeshData::builtCount << " models (" << MeshData::cachedCount << " from the disk cache) in " << MeshData::buildTime << "ms" << std::endl;
+	MeshData::builtCount = 0;
+	MeshData::cachedCount = 0;
+	MeshData::buildTime = 0;
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <browedit/util/Singleton.h>
 #include <browedit/components/Rsm.h>
 #include <vector>
+#include <map>
 
 namespace gl { class Texture; }
 class RswModel;
@@ -23,12 +24,11 @@ public:
 	public:
 		RsmShader* shader = nullptr;
 		glm::mat4 viewMatrix = glm::mat4(1.0f);
-		bool viewLighting = true;
-		bool viewTextures = true;
-		bool viewFog = true;
+		int tick = 0; //animation time of this frame in ms, the same for all models so they can share their pose
 
 		RsmRenderContext();
 		virtual void preFrame(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix) override;
+		virtual void postFrame() override;
 	};
 	class VboIndex
 	{
@@ -43,11 +43,31 @@ public:
 			this->count = count;
 		}
 	};
+	//The vertices of a model only depend on the rsm, so they are built once and shared by all renderers of the same rsm.
+	//All meshes are in one buffer, sorted by mesh and then by texture. The flattened buffer is also cached on disk by the hash of the rsm file
+	class MeshData
+	{
+	public:
+		gl::VBO<VertexP3T2N3>* vbo = nullptr;
+		std::vector<std::vector<VboIndex>> indices; //draw ranges of every mesh, by mesh index
+		int version = 0; //increased when the buffer is rebuilt, so the other renderers know the meshes changed
+		unsigned int reloadCount = 0; //reloadCount of the rsm this was built from
+		int users = 0;
+
+		inline static int builtCount = 0; //statistics since the last log line, for comparing cold and warm loads
+		inline static int cachedCount = 0;
+		inline static double buildTime = 0;
+
+		~MeshData();
+		void build(Rsm* rsm);
+	private:
+		bool loadCache(Rsm* rsm);
+		void saveCache(Rsm* rsm, const std::vector<VertexP3T2N3>& verts);
+		void upload(const VertexP3T2N3* verts, std::size_t count);
+	};
 	class RenderInfo
 	{
 	public:
-		gl::VBO<VertexP3T2N3>* vbo;
-		std::vector<VboIndex> indices;
 		glm::mat4 matrix = glm::mat4(1.0f);
 		glm::mat4 matrixSub = glm::mat4(1.0f);
 		std::vector<gl::Texture*> textures; //should this be shared over all RenderInfo with the same RsmMesh?
@@ -55,6 +75,11 @@ public:
 	};
 
 	std::vector<RenderInfo> renderInfo; //TODO: not happy about this one
+	MeshData* meshData = nullptr;
+	Rsm* meshDataRsm = nullptr; //the rsm meshData was taken for
+	int meshDataVersion = -1;
+	unsigned int rsmReloadCount = 0; //reloadCount of the rsm when this renderer was initialized
+	static inline std::map<Rsm*, MeshData*> meshDataCache;
 
 	Rsm* rsm;
 	RswModel* rswModel;
@@ -64,6 +89,7 @@ public:
 
 	float time = -1;
 	bool meshDirty = true;
+	unsigned int poseVersion = 0; //version of the rsm pose that is currently copied into renderInfo
 
 	std::vector<gl::Texture*> textures; //should this be shared over all RsmRenderers with the same Rsm? static map<Rsm, std::vector<Texture*> ???
 	bool matrixCached = false;
@@ -75,12 +101,16 @@ public:
 	~RsmRenderer();
 	void begin();
 	virtual void render();
+	void initMeshData();
+	void releaseMeshData();
 	void initMeshInfo(Rsm::Mesh* mesh, const glm::mat4& matrix = glm::mat4(1.0f));
 	void renderMesh(Rsm::Mesh* mesh, const glm::mat4& matrix, bool selectionPhase = false);
 	
 	virtual bool shouldRender(int phase) { return phase == 0 ? !selected : selected; }
+	virtual bool getBounds(glm::vec3& min, glm::vec3& max) override;
 
 	void setMeshesDirty();
+	static glm::mat4 calcModelMatrix(Rsm* rsm, RswObject* rswObject, Gnd* gnd);
 
 	void setDirty() { this->matrixCached = false; }
 	bool selected = false;
@@ -3,6 +3,7 @@
 #include <browedit/BrowEdit.h>
 #include <browedit/Node.h>
 #include <browedit/util/FileIO.h>
+#include <browedit/util/ByteStream.h>
 #include <browedit/util/Util.h>
 
 #include <iostream>
@@ -16,16 +17,16 @@
 #include <algorithm>
 
 
-void RswLight::load(std::istream* is)
+void RswLight::load(util::ByteReader& file)
 {
 	auto rswObject = node->getComponent<RswObject>();
-	node->name = util::iso_8859_1_to_utf8(util::FileIO::readString(is, 40));
-	is->read(reinterpret_cast<char*>(glm::value_ptr(rswObject->position)), sizeof(float) * 3);
+	node->name = util::iso_8859_1_to_utf8(file.readString(40));
+	file.read(rswObject->position);
 	rswObject->position *= glm::vec3(1, -1, 1);
-	is->read(reinterpret_cast<char*>(todo), sizeof(float) * 10);
+	file.read(todo, sizeof(float) * 10);
 
-	is->read(reinterpret_cast<char*>(glm::value_ptr(color)), sizeof(float) * 3);
-	is->read(reinterpret_cast<char*>(&range), sizeof(float));
+	file.read(color);
+	file.read(range);
 
 	this->cutOff = 0.5f;
 	this->intensity = 1.0f;
@@ -70,16 +71,16 @@ void RswLight::loadExtra(nlohmann::json data)
 }
 
 
-void RswLight::save(std::ofstream& file)
+void RswLight::save(util::ByteWriter& file)
 {
 	auto rswObject = node->getComponent<RswObject>();
-	util::FileIO::writeString(file, util::utf8_to_iso_8859_1(node->name), 40);
+	file.writeString(util::utf8_to_iso_8859_1(node->name), 40);
 
-	file.write(reinterpret_cast<const char*>(glm::value_ptr(rswObject->position * glm::vec3(1, -1, 1))), sizeof(float) * 3);
-	file.write(reinterpret_cast<char*>(todo), sizeof(float) * 10);
+	file.write(glm::value_ptr(rswObject->position * glm::vec3(1, -1, 1)), sizeof(float) * 3);
+	file.write(todo, sizeof(float) * 10);
 
-	file.write(reinterpret_cast<char*>(glm::value_ptr(color)), sizeof(float) * 3);
-	file.write(reinterpret_cast<char*>(&range), sizeof(float));
+	file.write(glm::value_ptr(color), sizeof(float) * 3);
+	file.write(&range, sizeof(float));
 	//todo: custom light properties
 }
 
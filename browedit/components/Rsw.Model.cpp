@@ -4,6 +4,7 @@
 #include <browedit/Node.h>
 #include <browedit/components/RsmRenderer.h>
 #include <browedit/util/FileIO.h>
+#include <browedit/util/ByteStream.h>
 #include <browedit/util/ResourceManager.h>
 
 #include <iostream>
@@ -16,30 +17,28 @@ RswModel::RswModel(RswModel* other) : aabb(other->aabb), animType(other->animTyp
 {
 }
 
-void RswModel::load(std::istream* is, int version, unsigned char buildNumber, bool loadModel)
+void RswModel::load(util::ByteReader& file, int version, unsigned char buildNumber, bool loadModel)
 {
 	auto rswObject = node->getComponent<RswObject>();
 	if (version >= 0x103)
 	{
-		node->name = util::iso_8859_1_to_utf8(util::FileIO::readString(is, 40));
+		node->name = util::iso_8859_1_to_utf8(file.readString(40));
 
-		is->read(reinterpret_cast<char*>(&animType), sizeof(int));
-		is->read(reinterpret_cast<char*>(&animSpeed), sizeof(float));
-		is->read(reinterpret_cast<char*>(&blockType), sizeof(int));
+		file.read(animType);
+		file.read(animSpeed);
+		file.read(blockType);
 	}
 	if (version >= 0x0206 && buildNumber > 161)
-	{
-		unsigned char c = is->get(); // unknown, 0?
-	}
+		file.skip(1); // unknown, 0?
 
-	std::string fileNameRaw = util::FileIO::readString(is, 80);
+	std::string fileNameRaw = file.readString(80);
 	//std::cout << "Model: " << node->name << "\t" << fileNameRaw << std::endl;
 	fileName = util::iso_8859_1_to_utf8(fileNameRaw);
 	assert(fileNameRaw == util::utf8_to_iso_8859_1(fileName));
-	objectName = util::iso_8859_1_to_utf8(util::FileIO::readString(is, 80)); // TODO: Unknown?
-	is->read(reinterpret_cast<char*>(glm::value_ptr(rswObject->position)), sizeof(float) * 3);
-	is->read(reinterpret_cast<char*>(glm::value_ptr(rswObject->rotation)), sizeof(float) * 3);
-	is->read(reinterpret_cast<char*>(glm::value_ptr(rswObject->scale)), sizeof(float) * 3);
+	objectName = util::iso_8859_1_to_utf8(file.readString(80)); // TODO: Unknown?
+	file.read(rswObject->position);
+	file.read(rswObject->rotation);
+	file.read(rswObject->scale);
 	if (loadModel)
 	{
 		node->addComponent(util::ResourceManager<Rsm>::load("data\\model\\" + fileNameRaw));
@@ -64,21 +63,21 @@ void RswModel::loadExtra(nlohmann::json data)
 
 
 
-void RswModel::save(std::ofstream& file, int version)
+void RswModel::save(util::ByteWriter& file, int version)
 {
 	auto rswObject = node->getComponent<RswObject>();
 	if (version >= 0x103)
 	{
-		util::FileIO::writeString(file, util::utf8_to_iso_8859_1(node->name), 40);
-		file.write(reinterpret_cast<char*>(&animType), sizeof(int));
-		file.write(reinterpret_cast<char*>(&animSpeed), sizeof(float));
-		file.write(reinterpret_cast<char*>(&blockType), sizeof(int));
+		file.writeString(util::utf8_to_iso_8859_1(node->name), 40);
+		file.write(&animType, sizeof(int));
+		file.write(&animSpeed, sizeof(float));
+		file.write(&blockType, sizeof(int));
 	}
-	util::FileIO::writeString(file, util::utf8_to_iso_8859_1(fileName), 80);
-	util::FileIO::writeString(file, util::utf8_to_iso_8859_1(objectName), 80); //unknown
-	file.write(reinterpret_cast<char*>(glm::value_ptr(rswObject->position)), sizeof(float) * 3);
-	file.write(reinterpret_cast<char*>(glm::value_ptr(rswObject->rotation)), sizeof(float) * 3);
-	file.write(reinterpret_cast<char*>(glm::value_ptr(rswObject->scale)), sizeof(float) * 3);
+	file.writeString(util::utf8_to_iso_8859_1(fileName), 80);
+	file.writeString(util::utf8_to_iso_8859_1(objectName), 80); //unknown
+	file.write(glm::value_ptr(rswObject->position), sizeof(float) * 3);
+	file.write(glm::value_ptr(rswObject->rotation), sizeof(float) * 3);
+	file.write(glm::value_ptr(rswObject->scale), sizeof(float) * 3);
 }
 
 
@@ -5,6 +5,7 @@
 #include <browedit/components/RsmRenderer.h>
 #include <browedit/components/BillboardRenderer.h>
 #include <browedit/util/FileIO.h>
+#include <browedit/util/ByteStream.h>
 #include <browedit/util/Util.h>
 
 #include <iostream>
@@ -21,39 +22,41 @@ RswObject::RswObject(RswObject* other) : position(other->position), rotation(oth
 {
 }
 
-void RswObject::load(std::istream* is, int version, unsigned char buildNumber, bool loadModel)
+void RswObject::load(util::ByteReader& file, int version, unsigned char buildNumber, bool loadModel)
 {
-	int type;
-	is->read(reinterpret_cast<char*>(&type), sizeof(int));
+	int type = file.read<int>();
 	if (type == 1)
 	{
 //		std::cout << "Loading model" << std::endl;
 		node->addComponent(new RswModel());
 		node->addComponent(new RswModelCollider());
-		node->getComponent<RswModel>()->load(is, version, buildNumber, loadModel);
+		node->getComponent<RswModel>()->load(file, version, buildNumber, loadModel);
 	}
 	else if (type == 2)
 	{
 //		std::cout << "Loading light" << std::endl;
 		node->addComponent(new RswLight());
-		node->getComponent<RswLight>()->load(is);
-		node->addComponent(new BillboardRenderer("data\\light.png", "data\\light_selected.png"));
+		node->getComponent<RswLight>()->load(file);
+		if (loadModel) //no opengl when only the data is loaded
+			node->addComponent(new BillboardRenderer("data\\light.png", "data\\light_selected.png"));
 		node->addComponent(new CubeCollider(5));
 	}
 	else if (type == 3)
 	{
 //		std::cout << "Loading sound" << std::endl;
 		node->addComponent(new RswSound());
-		node->getComponent<RswSound>()->load(is, version);
-		node->addComponent(new BillboardRenderer("data\\sound.png", "data\\sound_selected.png"));
+		node->getComponent<RswSound>()->load(file, version);
+		if (loadModel) //no opengl when only the data is loaded
+			node->addComponent(new BillboardRenderer("data\\sound.png", "data\\sound_selected.png"));
 		node->addComponent(new CubeCollider(5));
 	}
 	else if (type == 4)
 	{
 //		std::cout << "Loading effect" << std::endl;
 		node->addComponent(new RswEffect());
-		node->getComponent<RswEffect>()->load(is);
-		node->addComponent(new BillboardRenderer("data\\effect.png", "data\\effect_selected.png"));
+		node->getComponent<RswEffect>()->load(file);
+		if (loadModel) //no opengl when only the data is loaded
+			node->addComponent(new BillboardRenderer("data\\effect.png", "data\\effect_selected.png"));
 		node->addComponent(new CubeCollider(5));
 	}
 	else
@@ -66,7 +69,7 @@ void RswObject::load(std::istream* is, int version, unsigned char buildNumber, b
 
 
 
-void RswObject::save(std::ofstream& file, int version)
+void RswObject::save(util::ByteWriter& file, int version)
 {
 	RswModel* rswModel = nullptr;
 	RswEffect* rswEffect = nullptr;
@@ -81,7 +84,7 @@ void RswObject::save(std::ofstream& file, int version)
 		type = 3;
 	if (rswEffect = node->getComponent<RswEffect>())
 		type = 4;
-	file.write(reinterpret_cast<char*>(&type), sizeof(int));
+	file.write(&type, sizeof(int));
 	if (rswModel)		rswModel->save(file, version); //meh don't like this if...maybe make this an interface savable
 	if (rswEffect)		rswEffect->save(file);
 	if (rswLight)		rswLight->save(file);
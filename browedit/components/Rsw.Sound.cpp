@@ -3,6 +3,7 @@
 #include <browedit/BrowEdit.h>
 #include <browedit/Node.h>
 #include <browedit/util/FileIO.h>
+#include <browedit/util/ByteStream.h>
 
 #include <iostream>
 #include <fstream>
@@ -11,57 +12,57 @@
 #include <glm/gtc/type_ptr.hpp>
 
 
-void RswSound::load(std::istream* is, int version)
+void RswSound::load(util::ByteReader& file, int version)
 {
 	auto rswObject = node->getComponent<RswObject>();
 
-	node->name = util::iso_8859_1_to_utf8(util::FileIO::readString(is, 80));
+	node->name = util::iso_8859_1_to_utf8(file.readString(80));
 
-	fileName = util::iso_8859_1_to_utf8(util::FileIO::readString(is, 40));
+	fileName = util::iso_8859_1_to_utf8(file.readString(40));
 
-	is->read(reinterpret_cast<char*>(&unknown7), sizeof(float));
-	is->read(reinterpret_cast<char*>(&unknown8), sizeof(float));
-	is->read(reinterpret_cast<char*>(glm::value_ptr(rswObject->rotation)), sizeof(float) * 3);
-	is->read(reinterpret_cast<char*>(glm::value_ptr(rswObject->scale)), sizeof(float) * 3);
+	file.read(unknown7);
+	file.read(unknown8);
+	file.read(rswObject->rotation);
+	file.read(rswObject->scale);
 
-	is->read(reinterpret_cast<char*>(unknown6), 8);
+	file.read(unknown6, 8);
 
-	is->read(reinterpret_cast<char*>(glm::value_ptr(rswObject->position)), sizeof(float) * 3);
+	file.read(rswObject->position);
 
-	is->read(reinterpret_cast<char*>(&vol), sizeof(float));
-	is->read(reinterpret_cast<char*>(&width), sizeof(int));
-	is->read(reinterpret_cast<char*>(&height), sizeof(int));
-	is->read(reinterpret_cast<char*>(&range), sizeof(float));
+	file.read(vol);
+	file.read(width);
+	file.read(height);
+	file.read(range);
 
 	if (version >= 0x0200)
-		is->read(reinterpret_cast<char*>(&cycle), sizeof(float));
+		file.read(cycle);
 }
 
 
 
-void RswSound::save(std::ofstream& file, int version)
+void RswSound::save(util::ByteWriter& file, int version)
 {
 	auto rswObject = node->getComponent<RswObject>();
 
-	util::FileIO::writeString(file, util::utf8_to_iso_8859_1(node->name), 80);
-	util::FileIO::writeString(file, util::utf8_to_iso_8859_1(fileName), 40); //TODO: CHECK IF 80/40 or 40/80
+	file.writeString(util::utf8_to_iso_8859_1(node->name), 80);
+	file.writeString(util::utf8_to_iso_8859_1(fileName), 40); //TODO: CHECK IF 80/40 or 40/80
 
-	file.write(reinterpret_cast<char*>(&unknown7), sizeof(float));
-	file.write(reinterpret_cast<char*>(&unknown8), sizeof(float));
-	file.write(reinterpret_cast<char*>(glm::value_ptr(rswObject->rotation)), sizeof(float) * 3);
-	file.write(reinterpret_cast<char*>(glm::value_ptr(rswObject->scale)), sizeof(float) * 3);
+	file.write(&unknown7, sizeof(float));
+	file.write(&unknown8, sizeof(float));
+	file.write(glm::value_ptr(rswObject->rotation), sizeof(float) * 3);
+	file.write(glm::value_ptr(rswObject->scale), sizeof(float) * 3);
 
-	file.write(reinterpret_cast<char*>(unknown6), 8);
+	file.write(unknown6, 8);
 
-	file.write(reinterpret_cast<char*>(glm::value_ptr(rswObject->position)), sizeof(float) * 3);
+	file.write(glm::value_ptr(rswObject->position), sizeof(float) * 3);
 
-	file.write(reinterpret_cast<char*>(&vol), sizeof(float));
-	file.write(reinterpret_cast<char*>(&width), sizeof(int));
-	file.write(reinterpret_cast<char*>(&height), sizeof(int));
-	file.write(reinterpret_cast<char*>(&range), sizeof(float));
+	file.write(&vol, sizeof(float));
+	file.write(&width, sizeof(int));
+	file.write(&height, sizeof(int));
+	file.write(&range, sizeof(float));
 
 	if (version >= 0x0200)
-		file.write(reinterpret_cast<char*>(&cycle), sizeof(float));
+		file.write(&cycle, sizeof(float));
 }
 
 
@@ -16,12 +16,18 @@
 #include <browedit/Image.h>
 #include <browedit/util/ResourceManager.h>
 #include <browedit/util/FileIO.h>
+#include <browedit/util/ByteStream.h>
+#include <browedit/util/Lua.h>
 #include <browedit/util/Util.h>
+#include <browedit/util/WorkerPool.h>
 #include <browedit/math/Ray.h>
 #include <browedit/Map.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
+#include <mutex>
+#include <functional>
 #include <glm/gtc/type_ptr.hpp>
 #include <browedit/Node.h>
 #include <imGuIZMOquat.h>
@@ -42,12 +48,13 @@ Rsw::~Rsw()
 void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool loadModels, bool loadGnd)
 {
 	std::cout << "Loading " << fileName << std::endl;
-	auto file = util::FileIO::open(fileName);
-	if (!file)
+	std::vector<char> data;
+	if (!util::FileIO::read(fileName, data))
 	{
 		std::cerr << "Could not open file " << fileName << std::endl;
 		return;
 	}
+	util::ByteReader file(data);
 	quadtree = nullptr;
 
 	json lubInfo = json::array();
@@ -62,133 +69,36 @@ void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool l
 		lub = util::FileIO::open("data\\LuaFiles514\\Lua Files\\effecttool\\" + mapName + ".lub");
 	if (lub)
 	{
-		char c = lub->get();
-		lub->seekg(0, std::ios_base::beg);
 		std::string data = "";
-		if (c == 0x1b)
+		char buf[1024];
+		while (!lub->eof())
 		{
-			std::ofstream out("tmp.lub", std::ios_base::binary | std::ios_base::out);
-			char buf[1024];
-			while (!lub->eof())
-			{
-				lub->read(buf, 1024);
-				auto count = lub->gcount();
-				out.write(buf, count);
-			}
-			out.close();
-
-			STARTUPINFO info = { sizeof(info) };
-			PROCESS_INFORMATION processInfo;
-			std::string cmd = browEdit->config.grfEditorPath + "GrfCL.exe -lub .\\tmp.lub .\\tmp.lua";
-
-			if (CreateProcess(nullptr, (LPSTR)cmd.c_str(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &info, &processInfo))
-			{
-				WaitForSingleObject(processInfo.hProcess, INFINITE);
-				CloseHandle(processInfo.hProcess);
-				CloseHandle(processInfo.hThread);
-			}
-			data = "";
-			std::ifstream lua("tmp.lua", std::ios_base::binary | std::ios_base::in);
-			if (lua.is_open())
-			{
-				char buf[1024];
-				while (!lua.eof())
-				{
-					lua.read(buf, 1024);
-					data += std::string(buf, lua.gcount());
-				}
-				lua.close();
-			}
-			std::filesystem::remove("tmp.lub");
-			std::filesystem::remove("tmp.lua");
-		}
-		else //this is a nasty renamed lua file to lub. Shame on you mappers!
-		{
-			char buf[1024];
-			while (!lub->eof())
-			{
-				lub->read(buf, 1024);
-				data += std::string(buf, lub->gcount());
-			}
+			lub->read(buf, 1024);
+			data += std::string(buf, lub->gcount());
 		}
 		delete lub;
-		
-		if (data != "" && data.find("{") != std::string::npos && data.find("version =") != std::string::npos)
+
+		//the lub is either compiled lua 5.1, or a lua file that got renamed to lub
+		try
 		{
-			std::string ver = data;
-			ver = ver.substr(ver.find("version ="));
-			ver = ver.substr(0, ver.find("\n"));
-			if (ver.find("\r"))
-				ver = ver.substr(0, ver.find("\r"));
-			ver = ver.substr(ver.rfind("=")+1);
-			ver = util::trim(ver);
-			lubVersion = std::stoi(ver);
-			//this is a dirty hack to change the main lua array into a json structure for automatic parsing...I'm wondering if it's not easier to just write a lua parser
-			data = data.substr(data.find("{")); // strip beginning;
-			data = util::replace(data, "\r\n", "\n");
-			while (data.find("\t\n") != std::string::npos)//omg mina, clean up your newlines
-				data = util::replace(data, "\t\n", "\n");
-			while (data.find(" \n") != std::string::npos)
-				data = util::replace(data, " \n", "\n");
-			while (data.find("\n\n") != std::string::npos)
-				data = util::replace(data, "\n\n", "\n");
-			data = util::replace(data, "\\", "\\\\");
-			data = util::replace(data, "[[", "\"");
-			data = util::replace(data, "]]", "\"");
-			std::replace(data.begin(), data.end(), '[', '\"');
-			std::replace(data.begin(), data.end(), ']', '\"');
-			data = util::replace(data, "\"\"", "");
-			std::replace(data.begin(), data.end(), '=', ':');
-			data[0] = '[';
-			auto lines = util::split(data, "\n");
-			bool done = false;
-			for (auto i = 0; i < lines.size(); i++)
+			json globals = util::luaToJson(data);
+			bool found = false;
+			for (auto it = globals.begin(); it != globals.end(); it++)
 			{
-				if (lines[i].find("--") != std::string::npos)
-					lines[i] = util::rtrim(lines[i].substr(0, lines[i].find("--")));//remove comments
-				if (lines[i].size() > 2 && lines[i][0] == '\t' && lines[i][1] == '\"')
-				{
-					if (lines[i].find("{") != std::string::npos)
-						lines[i] = lines[i].substr(lines[i].find(":") + 2);
-					else
-						lines[i] = "";
-				}
-				if (lines[i].size() > 3 && lines[i][0] == '\t' && lines[i][1] == '\t' && lines[i][2] != '\t')
+				if (it.key().size() > 8 && it.key().substr(it.key().size() - 8) == "_version" && it.value().is_number())
+					lubVersion = it.value().get<int>();
+				else if (it.value().is_array() && (!found || it.key().find("_emitterInfo") != std::string::npos))
 				{
-					lines[i] = "\t\t\"" + lines[i].substr(2, lines[i].find(" ") - 2) + "\"" + lines[i].substr(lines[i].find(" ") + 1);
-					std::replace(lines[i].begin(), lines[i].end(), '{', '[');
-					std::replace(lines[i].begin(), lines[i].end(), '}', ']');
+					lubInfo = it.value();
+					found = true;
 				}
-				auto trimmed = util::trim(lines[i]); // why you do this to me mina? remove comma at end of list
-				if (i < lines.size() - 1 && trimmed.size() > 0 && trimmed[trimmed.size() - 1] == ',' && (util::trim(lines[i + 1]) == "}," || util::trim(lines[i + 1]) == "}"))
-					lines[i] = lines[i].substr(0, lines[i].rfind(",")) + lines[i].substr(lines[i].rfind(",") + 1);
-
-				if (done)
-					lines[i] = "";
-				if (util::rtrim(lines[i]) == "}")
-					done = true;
-			}
-
-			std::string jsondata = util::combine(lines, "\n");
-			while (jsondata.find("\n\n") != std::string::npos)
-				jsondata = util::replace(jsondata, "\n\n", "\n");
-
-			jsondata = util::trim(jsondata);
-			jsondata[jsondata.length() - 1] = ']';
-
-			try
-			{
-				lubInfo = json::parse(jsondata);
-			}
-			catch (const std::exception& e)
-			{
-				std::cerr << "Error loading json from lub data: " << e.what() << std::endl;
-				std::cout << jsondata << std::endl;
 			}
+			if (!found)
+				std::cerr << "Error loading lub effects: no effect table found" << std::endl;
 		}
-		else
+		catch (const std::exception& e)
 		{
-			std::cerr << "Error loading lua" << std::endl << data << std::endl;
+			std::cerr << "Error loading lub effects: " << e.what() << std::endl;
 		}
 	}
 
@@ -207,61 +117,95 @@ void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool l
 		std::cerr << e.what() << std::endl;
 	}
 
-	char header[4];
-	file->read(header, 4);
-	if (!(header[0] == 'G' || header[1] == 'R' || header[2] == 'S' || header[3] == 'W'))
+	try
 	{
-		std::cerr << "RSW: Error loading rsw: invalid header" << std::endl;
-		delete file;
-		return;
-	}
+		char header[4];
+		file.read(header, 4);
+		if (!(header[0] == 'G' || header[1] == 'R' || header[2] == 'S' || header[3] == 'W'))
+		{
+			std::cerr << "RSW: Error loading rsw: invalid header" << std::endl;
+			return;
+		}
 
-	file->read(reinterpret_cast<char*>(&version), sizeof(short));
-	version = util::swapShort(version);
-	std::cout << std::hex<<"RSW: Version 0x" << version << std::endl <<std::dec;
+		version = util::swapShort(file.read<short>());
+		std::cout << std::hex<<"RSW: Version 0x" << version << std::endl <<std::dec;
 
-	if (version >= 0x0202)
-	{
-		buildNumber = file->get();
-		std::cout << "Build number " << (int)buildNumber << std::endl;
-	}
-	if (version >= 0x0205)
-	{
-		int u;
-		file->read(reinterpret_cast<char*>(&u), sizeof(int));
-		std::cout << "205 unknown value: " << u << std::endl;
-	}
+		if (version >= 0x0202)
+		{
+			buildNumber = file.read<unsigned char>();
+			std::cout << "Build number " << (int)buildNumber << std::endl;
+		}
+		if (version >= 0x0205)
+		{
+			int u = file.read<int>();
+			std::cout << "205 unknown value: " << u << std::endl;
+		}
 
-	iniFile = util::FileIO::readString(file, 40);
-	gndFile = util::FileIO::readString(file, 40);
-	if (version > 0x0104)
-		gatFile = util::FileIO::readString(file, 40);
-	else
-		gatFile = gndFile; //TODO: convert
+		iniFile = file.readString(40);
+		gndFile = file.readString(40);
+		if (version > 0x0104)
+			gatFile = file.readString(40);
+		else
+			gatFile = gndFile; //TODO: convert
 
-	iniFile = util::FileIO::readString(file, 40); // ehh...read inifile twice?
+		iniFile = file.readString(40); // ehh...read inifile twice?
 
-	//version 0x0206
-	if (version < 0x0206)
-	{
-		//TODO: default values
-		if (version >= 0x103)
-			file->read(reinterpret_cast<char*>(&water.height), sizeof(float));
-		if (version >= 0x108)
+		//version 0x0206
+		if (version < 0x0206)
+		{
+			//TODO: default values
+			if (version >= 0x103)
+				file.read(water.height);
+			if (version >= 0x108)
+			{
+				file.read(water.type);
+				file.read(water.amplitude);
+				file.read(water.waveSpeed);
+				file.read(water.wavePitch);
+			}
+			if (version >= 0x109)
+				file.read(water.textureAnimSpeed);
+			else
+			{
+				water.textureAnimSpeed = 100;
+		//		throw "todo";
+			}
+		}
+
+		light.longitude = 45;//TODO: remove the defaults here and put defaults of the water somewhere too
+		light.latitude = 45;
+		light.diffuse = glm::vec3(1, 1, 1);
+		light.ambient = glm::vec3(0.3f, 0.3f, 0.3f);
+		light.intensity = 0.5f;
+
+		if (version >= 0x105)
 		{
-			file->read(reinterpret_cast<char*>(&water.type), sizeof(int));
-			file->read(reinterpret_cast<char*>(&water.amplitude), sizeof(float));
-			file->read(reinterpret_cast<char*>(&water.waveSpeed), sizeof(float));
-			file->read(reinterpret_cast<char*>(&water.wavePitch), sizeof(float));
+			file.read(light.longitude);
+			file.read(light.latitude);
+			file.read(light.diffuse);
+			file.read(light.ambient);
+		}
+		if (version >= 0x107)
+			file.read(light.intensity); //shadowOpacity;
+
+		if (version >= 0x106)
+		{
+			file.read(unknown[0]); //m_groundTop
+			file.read(unknown[1]); //m_groundBottom
+			file.read(unknown[2]); //m_groundLeft
+			file.read(unknown[3]); //m_groundRight
 		}
-		if (version >= 0x109)
-			file->read(reinterpret_cast<char*>(&water.textureAnimSpeed), sizeof(int));
 		else
 		{
-			water.textureAnimSpeed = 100;
-	//		throw "todo";
+			unknown[0] = unknown[2] = -500;
+			unknown[1] = unknown[3] = 500;
 		}
 	}
+	catch (const std::out_of_range& e)
+	{
+		std::cerr << "RSW: Error loading rsw: " << e.what() << std::endl;
+		return;
+	}
 
 	if (loadGnd)
 	{
@@ -278,22 +222,6 @@ void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool l
 	}
 
 
-	light.longitude = 45;//TODO: remove the defaults here and put defaults of the water somewhere too
-	light.latitude = 45;
-	light.diffuse = glm::vec3(1, 1, 1);
-	light.ambient = glm::vec3(0.3f, 0.3f, 0.3f);
-	light.intensity = 0.5f;
-
-	if (version >= 0x105)
-	{
-		file->read(reinterpret_cast<char*>(&light.longitude), sizeof(int));
-		file->read(reinterpret_cast<char*>(&light.latitude), sizeof(int));
-		file->read(reinterpret_cast<char*>(glm::value_ptr(light.diffuse)), sizeof(float) * 3);
-		file->read(reinterpret_cast<char*>(glm::value_ptr(light.ambient)), sizeof(float) * 3);
-	}
-	if (version >= 0x107)
-		file->read(reinterpret_cast<char*>(&light.intensity), sizeof(float)); //shadowOpacity;
-	
 	if (extraProperties.find("mapproperties") != extraProperties.end())
 	{
 		if (extraProperties["mapproperties"].find("lightmapAmbient") != extraProperties["mapproperties"].end())
@@ -333,21 +261,10 @@ void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool l
 			cinematicTracks.push_back(track);
 		}
 	}
-	if (version >= 0x106)
-	{
-		file->read(reinterpret_cast<char*>(&unknown[0]), sizeof(int)); //m_groundTop
-		file->read(reinterpret_cast<char*>(&unknown[1]), sizeof(int)); //m_groundBottom
-		file->read(reinterpret_cast<char*>(&unknown[2]), sizeof(int)); //m_groundLeft
-		file->read(reinterpret_cast<char*>(&unknown[3]), sizeof(int)); //m_groundRight
-	}
-	else
-	{
-		unknown[0] = unknown[2] = -500;
-		unknown[1] = unknown[3] = 500;
-	}
 
-	int objectCount;
-	file->read(reinterpret_cast<char*>(&objectCount), sizeof(int));
+	int objectCount = 0;
+	if (file.remaining() >= sizeof(int))
+		file.read(objectCount);
 	std::cout << "RSW: Loading " << objectCount << " objects" << std::endl;
 
 	std::map<int, json> modelLookup;
@@ -366,7 +283,16 @@ void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool l
 		Node* object = new Node("");
 		auto rswObject = new RswObject();
 		object->addComponent(rswObject);
-		rswObject->load(file, version, buildNumber, loadModels);
+		try
+		{
+			rswObject->load(file, version, buildNumber, loadModels);
+		}
+		catch (const std::out_of_range& e)
+		{
+			std::cerr << "RSW: Error loading object " << i << " of " << objectCount << ": " << e.what() << std::endl;
+			delete object;
+			break;
+		}
 
 		if (object->getComponent<RswLight>() && extraProperties.is_object() && extraProperties["light"].is_array())
 		{
@@ -387,7 +313,8 @@ void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool l
 			if (lubIndex <= lubInfo.size())
 				lubEffect->load(lubInfo[lubIndex]);
 			object->addComponent(lubEffect);
-			object->addComponent(new LubRenderer());
+			if (loadModels) //no opengl when only the data is loaded
+				object->addComponent(new LubRenderer());
 			lubIndex++;
 		}
 
@@ -404,14 +331,8 @@ void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool l
 	}
 
 
-	while (!file->eof())
-	{
-		glm::vec3 p;
-		file->read(reinterpret_cast<char*>(glm::value_ptr(p)), sizeof(float) * 3);
-		if(file->gcount() > 0) //if data is actually read
-			quadtreeFloats.push_back(p);
-	}
-	if (quadtreeFloats.size() > 1)
+	file.readArray(quadtreeFloats, file.remaining() / sizeof(glm::vec3));
+	if (quadtreeFloats.size() >= 1365 * 4) //1365 nodes in the 6 levels of the tree, with 4 vectors each
 	{
 		auto it = quadtreeFloats.cbegin();
 		quadtree = new QuadTreeNode(it);
@@ -419,8 +340,6 @@ void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool l
 	else
 		quadtree = nullptr;//TODO:
 
-	delete file;
-
 	auto cleanLine = [](const std::string& line)
 	{
 		std::string ret = util::trim(line);
@@ -448,39 +367,48 @@ void Rsw::load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool l
 
 
 void Rsw::save(const std::string& fileName, BrowEdit* browEdit)
+{
+	std::map<std::string, std::vector<char>> files;
+	serialize(fileName, browEdit, files);
+	for (const auto& f : files)
+		if (!util::FileIO::writeFileAtomic(f.first, f.second.data(), f.second.size()))
+			std::cerr << "RSW: Unable to write " << f.first << std::endl;
+}
+
+//serializes the rsw, the .extra.json and the lub effects into memory, so the actual writing can be done on another thread
+void Rsw::serialize(const std::string& fileName, BrowEdit* browEdit, std::map<std::string, std::vector<char>>& files)
 {
 	std::cout << "Saving to " << fileName << std::endl;
-	std::ofstream file(fileName.c_str(), std::ios_base::out | std::ios_base::binary);
+	util::ByteWriter file(1024 * 1024);
 	nlohmann::json extraProperties;
 
 	char header[4] = { 'G','R','S','W' };
 	file.write(header, 4);
-	short versionFlipped = util::swapShort(version);
-	file.write(reinterpret_cast<char*>(&versionFlipped), sizeof(short));
+	file.write(util::swapShort(version));
 
 	if (version == 0x0202)
-		file.put(0); // ???
-	util::FileIO::writeString(file, iniFile, 40);
+		file.write((char)0); // ???
+	file.writeString(iniFile, 40);
 
-	util::FileIO::writeString(file, gndFile, 40);
+	file.writeString(gndFile, 40);
 
 	if (version > 0x0104)
 	{
-		util::FileIO::writeString(file, gatFile, 40);
+		file.writeString(gatFile, 40);
 	}
-	util::FileIO::writeString(file, iniFile, 40);
+	file.writeString(iniFile, 40);
 
 	if (version >= 0x103)
-		file.write(reinterpret_cast<char*>(&water.height), sizeof(float));
+		file.write(&water.height, sizeof(float));
 	if (version >= 0x108)
 	{
-		file.write(reinterpret_cast<char*>(&water.type), sizeof(int));
-		file.write(reinterpret_cast<char*>(&water.amplitude), sizeof(float));
-		file.write(reinterpret_cast<char*>(&water.waveSpeed), sizeof(float));
-		file.write(reinterpret_cast<char*>(&water.wavePitch), sizeof(float));
+		file.write(&water.type, sizeof(int));
+		file.write(&water.amplitude, sizeof(float));
+		file.write(&water.waveSpeed, sizeof(float));
+		file.write(&water.wavePitch, sizeof(float));
 	}
 	if (version >= 0x109)
-		file.write(reinterpret_cast<char*>(&water.textureAnimSpeed), sizeof(int));
+		file.write(&water.textureAnimSpeed, sizeof(int));
 	else
 	{
 		water.textureAnimSpeed = 100;
@@ -489,13 +417,13 @@ void Rsw::save(const std::string& fileName, BrowEdit* browEdit)
 
 	if (version >= 0x105)
 	{
-		file.write(reinterpret_cast<char*>(&light.longitude), sizeof(int));
-		file.write(reinterpret_cast<char*>(&light.latitude), sizeof(int));
-		file.write(reinterpret_cast<char*>(glm::value_ptr(light.diffuse)), sizeof(float) * 3);
-		file.write(reinterpret_cast<char*>(glm::value_ptr(light.ambient)), sizeof(float) * 3);
+		file.write(&light.longitude, sizeof(int));
+		file.write(&light.latitude, sizeof(int));
+		file.write(glm::value_ptr(light.diffuse), sizeof(float) * 3);
+		file.write(glm::value_ptr(light.ambient), sizeof(float) * 3);
 	}
 	if (version >= 0x107)
-		file.write(reinterpret_cast<char*>(&light.intensity), sizeof(float));
+		file.write(&light.intensity, sizeof(float));
 
 	extraProperties["light"] = json();
 	extraProperties["mapproperties"]["lightmapAmbient"] = light.lightmapAmbient;
@@ -537,10 +465,10 @@ void Rsw::save(const std::string& fileName, BrowEdit* browEdit)
 
 	if (version >= 0x106)
 	{
-		file.write(reinterpret_cast<char*>(&unknown[0]), sizeof(int));
-		file.write(reinterpret_cast<char*>(&unknown[1]), sizeof(int));
-		file.write(reinterpret_cast<char*>(&unknown[2]), sizeof(int));
-		file.write(reinterpret_cast<char*>(&unknown[3]), sizeof(int));
+		file.write(&unknown[0], sizeof(int));
+		file.write(&unknown[1], sizeof(int));
+		file.write(&unknown[2], sizeof(int));
+		file.write(&unknown[3], sizeof(int));
 	}
 
 	std::vector<Node*> objects;
@@ -550,7 +478,7 @@ void Rsw::save(const std::string& fileName, BrowEdit* browEdit)
 			objects.push_back(n);
 	});
 	int objectCount = (int)objects.size();
-	file.write(reinterpret_cast<char*>(&objectCount), sizeof(int));
+	file.write(&objectCount, sizeof(int));
 	std::vector<LubEffect*> lubEffects;
 	for (auto i = 0; i < objects.size(); i++)
 	{
@@ -575,15 +503,18 @@ void Rsw::save(const std::string& fileName, BrowEdit* browEdit)
 	}
 	quadtree->foreach([&file](QuadTreeNode* n)
 	{
-		file.write(reinterpret_cast<char*>(glm::value_ptr(n->bbox.bounds[1])), sizeof(float) * 3);
-		file.write(reinterpret_cast<char*>(glm::value_ptr(n->bbox.bounds[0])), sizeof(float) * 3);
-		file.write(reinterpret_cast<char*>(glm::value_ptr(n->range[0])), sizeof(float) * 3);
-		file.write(reinterpret_cast<char*>(glm::value_ptr(n->range[1])), sizeof(float) * 3);
+		file.write(glm::value_ptr(n->bbox.bounds[1]), sizeof(float) * 3);
+		file.write(glm::value_ptr(n->bbox.bounds[0]), sizeof(float) * 3);
+		file.write(glm::value_ptr(n->range[0]), sizeof(float) * 3);
+		file.write(glm::value_ptr(n->range[1]), sizeof(float) * 3);
 	});
 
-	std::ofstream extraFile((fileName + ".extra.json").c_str(), std::ios_base::out | std::ios_base::binary);
+	files[fileName] = std::move(file.data);
+
+	std::stringstream extraFile;
 	extraFile << std::setw(2)<<extraProperties;
-	extraFile.close();
+	std::string extraData = extraFile.str();
+	files[fileName + ".extra.json"] = std::vector<char>(extraData.begin(), extraData.end());
 
 	std::string mapName = fileName;
 	if (mapName.find(".rsw") != std::string::npos)
@@ -592,10 +523,12 @@ void Rsw::save(const std::string& fileName, BrowEdit* browEdit)
 		mapName = mapName.substr(mapName.rfind("\\")+1);
 	std::string luaMapName = util::replace(mapName, "@", "");
 	
+	//without an editor (batch mode), the lub goes next to the data directory the map is saved in
+	std::string roPath = browEdit ? browEdit->config.ropath : fileName.substr(0, fileName.find("data\\") == std::string::npos ? 0 : fileName.find("data\\"));
 	if (lubEffects.size() > 0)
 	{
-		std::cout << "Lub effects found, saving to " << browEdit->config.ropath << "data\\luafiles514\\lua files\\effecttool\\" << mapName << ".lub" << std::endl;
-		std::ofstream lubFile((browEdit->config.ropath + "data\\luafiles514\\lua files\\effecttool\\" + mapName + ".lub").c_str(), std::ios_base::out | std::ios_base::binary);
+		std::cout << "Lub effects found, saving to " << roPath << "data\\luafiles514\\lua files\\effecttool\\" << mapName << ".lub" << std::endl;
+		std::stringstream lubFile;
 		lubFile << "_" << luaMapName << "_emitterInfo_version = "<<lubVersion<<".0" << std::endl;
 		lubFile << "_" << luaMapName << "_emitterInfo =" << std::endl;
 		lubFile << "{" << std::endl;
@@ -634,10 +567,11 @@ void Rsw::save(const std::string& fileName, BrowEdit* browEdit)
 			lubFile << std::endl;
 		}
 		lubFile << "}" << std::endl;
-		lubFile.close();
+		std::string lubData = lubFile.str();
+		files[roPath + "data\\luafiles514\\lua files\\effecttool\\" + mapName + ".lub"] = std::vector<char>(lubData.begin(), lubData.end());
 	}
 
-	std::cout << "Done saving" << std::endl;
+	std::cout << "Done serializing rsw" << std::endl;
 }
 
 void Rsw::newMap(const std::string& fileName, int width, int height, Map* map, BrowEdit* browEdit)
@@ -802,69 +736,183 @@ void Rsw::buildImGui(BrowEdit* browEdit)
 
 extern std::vector<std::vector<glm::vec3>> debugPoints;
 
-std::vector<std::vector<glm::vec2>> heights;
-void Rsw::recalculateQuadtree(QuadTreeNode* node)
+//Rasterizes the triangles of a model to the tiles they cover, keeping the lowest and highest point per tile.
+//Only reads from the model, so this can run on worker threads
+static void rasterizeQuadtreeModel(Rsw::QuadTreeHeights::Model& model, Rsm::Mesh* rootMesh, int width, int height)
 {
-	static Gnd* gnd;
-	static Rsw* rsw;
-//	static std::vector<std::vector<glm::vec2>> heights;
-	bool rootNode = false;
-	if (!node)
-	{
-		rootNode = true;
-		node = quadtree;
-		gnd = this->node->getComponent<Gnd>();
-		rsw = this->node->getComponent<Rsw>();
-
-		heights.clear();
-		heights.resize(gnd->width);
-		for (int i = 0; i < gnd->width; i++)
-			heights[i].resize(gnd->height, glm::vec2(rsw->water.height, rsw->water.height));
+	model.tiles.clear();
+	model.min = glm::ivec2(width, height);
+	model.max = glm::ivec2(-1, -1);
+	if (!rootMesh)
+		return;
 
-		debugPoints.clear();
-		debugPoints.resize(2);
+	//bounds of all triangles, in the same order as RswModelCollider::getVerticesWorldSpace
+	std::vector<std::pair<glm::vec3, glm::vec3>> triangles;
+	std::function<void(Rsm::Mesh*)> addMesh;
+	addMesh = [&](Rsm::Mesh* mesh)
+	{
+		if (mesh->index >= 0 && mesh->index < (int)model.matrices.size())
+		{
+			const glm::mat4& matrix = model.matrices[mesh->index];
+			for (const auto& face : mesh->faces)
+			{
+				glm::vec3 verts[3];
+				for (int i = 0; i < 3; i++)
+					verts[i] = matrix * glm::vec4(mesh->vertices[face.vertexIds[i]], 1);
+				math::AABB aabb(std::span<glm::vec3>(verts, 3));
+				triangles.push_back(std::pair<glm::vec3, glm::vec3>(aabb.min, aabb.max));
+				model.min = glm::min(model.min, glm::max(glm::ivec2(0), glm::ivec2((int)glm::floor(aabb.min.x / 10), (int)glm::floor(aabb.min.z / 10))));
+				model.max = glm::max(model.max, glm::min(glm::ivec2(width - 1, height - 1), glm::ivec2((int)glm::ceil(aabb.max.x / 10) - 1, (int)glm::ceil(aabb.max.z / 10) - 1)));
+			}
+		}
+		for (auto child : mesh->children)
+			addMesh(child);
+	};
+	addMesh(rootMesh);
+	if (model.max.x < model.min.x || model.max.y < model.min.y)
+		return;
 
-		this->node->traverse([&](Node* n) {
-			auto rswModel = n->getComponent<RswModel>();
-			auto rsmRenderer = n->getComponent<RsmRenderer>();
-			if (rswModel)
+	//merge the triangles per tile first, in the original order, so applying them to the map gives exactly the same result as applying every triangle
+	glm::ivec2 size = model.max - model.min + 1;
+	std::vector<glm::vec2> local(size.x * size.y);
+	std::vector<char> touched(size.x * size.y, 0);
+	for (const auto& t : triangles)
+	{
+		for (int x = glm::max(model.min.x, (int)glm::floor(t.first.x / 10)); x < glm::min(model.max.x + 1, (int)glm::ceil(t.second.x / 10)); x++)
+			for (int y = glm::max(model.min.y, (int)glm::floor(t.first.z / 10)); y < glm::min(model.max.y + 1, (int)glm::ceil(t.second.z / 10)); y++)
 			{
-				auto collider = n->getComponent<RswModelCollider>();
-				if (collider)
+				int i = (x - model.min.x) * size.y + (y - model.min.y);
+				if (!touched[i])
 				{
-					auto vertices = collider->getVerticesWorldSpace();
-					for (auto i = 0; i < vertices.size(); i += 3)
-					{
-						math::AABB aabb(std::span<glm::vec3>(vertices.begin() + i, 3));
-						for (int x = (int)glm::floor(aabb.min.x / 10); x < (int)glm::ceil(aabb.max.x / 10); x++)
-							for (int y = (int)glm::floor(aabb.min.z / 10); y < (int)glm::ceil(aabb.max.z / 10); y++)
-							{
-								if (x >= 0 && x < gnd->width && y >= 0 && y < gnd->height)
-								{
-									heights[x][y].x = glm::min(heights[x][y].x, aabb.min.y);
-									heights[x][y].y = glm::max(heights[x][y].y, aabb.max.y);
-								}
-							}
-
-					}
+					local[i] = glm::vec2(t.first.y, t.second.y);
+					touched[i] = 1;
+				}
+				else
+				{
+					local[i].x = glm::min(local[i].x, t.first.y);
+					local[i].y = glm::max(local[i].y, t.second.y);
 				}
 			}
-			});
+	}
+	for (int x = 0; x < size.x; x++)
+		for (int y = 0; y < size.y; y++)
+			if (touched[x * size.y + y])
+				model.tiles.push_back(std::pair<int, glm::vec2>((model.min.x + x) * height + model.min.y + y, local[x * size.y + y]));
+}
 
+//Updates the model heights per tile. Only models that moved, changed, got added or removed are rasterized again, and only the tiles they cover are recalculated
+static void updateQuadtreeHeights(Rsw* rsw, Gnd* gnd)
+{
+	auto& qh = rsw->quadtreeHeights;
+	bool full = qh.width != gnd->width || qh.height != gnd->height || memcmp(&qh.waterHeight, &rsw->water.height, sizeof(float)) != 0 || qh.heights.size() != (std::size_t)(gnd->width * gnd->height);
+	qh.width = gnd->width;
+	qh.height = gnd->height;
+	qh.waterHeight = rsw->water.height;
+
+	std::vector<char> dirty;
+	glm::ivec2 dirtyMin(qh.width, qh.height);
+	glm::ivec2 dirtyMax(-1, -1);
+	if (!full)
+		dirty.resize(qh.heights.size(), 0);
+	auto markDirty = [&](const Rsw::QuadTreeHeights::Model& model)
+	{
+		if (full)
+			return;
+		for (const auto& t : model.tiles)
+			dirty[t.first] = 1;
+		dirtyMin = glm::min(dirtyMin, model.min);
+		dirtyMax = glm::max(dirtyMax, model.max);
+	};
 
-#if 0
-		for (auto x = 0; x < heights.size(); x++)
-			for (auto y = 0; y < heights[x].size(); y++)
-			{
-				debugPoints[0].push_back(glm::vec3(10*x, heights[x][y].x, 10 * y));
-				debugPoints[1].push_back(glm::vec3(10 * x, heights[x][y].y, 10 * y));
-			}
-#endif
-	} //end startup
+	std::vector<Rsw::QuadTreeHeights::Model*> models; //in traversal order, the order they have to be applied in
+	std::vector<std::pair<Rsw::QuadTreeHeights::Model*, Rsm::Mesh*>> changed;
+	for (auto& m : qh.models)
+		m.second.used = false;
+	rsw->node->traverse([&](Node* n)
+	{
+		auto rswModel = n->getComponent<RswModel>();
+		auto collider = n->getComponent<RswModelCollider>();
+		if (!rswModel || !collider)
+			return;
+		auto rsm = n->getComponent<Rsm>();
+		auto rsmRenderer = n->getComponent<RsmRenderer>();
+		std::vector<glm::mat4> matrices;
+		if (rsm && rsmRenderer)
+			for (const auto& ri : rsmRenderer->renderInfo)
+				matrices.push_back(rsmRenderer->matrixCache * ri.matrix);
+		else if (rsm && rsm->loaded && rsm->rootMesh) //no renderer in batch mode, use the rest pose
+		{
+			static std::mutex poseMutex; //the rsm can be shared with maps that are processed on other threads
+			glm::mat4 modelMatrix = RsmRenderer::calcModelMatrix(rsm, n->getComponent<RswObject>(), gnd);
+			const std::lock_guard<std::mutex> lock(poseMutex);
+			for (const auto& m : rsm->getPose(0).matrix)
+				matrices.push_back(modelMatrix * m);
+		}
+
+		auto& model = qh.models[n];
+		model.used = true;
+		models.push_back(&model);
+		if (!full && model.rsm == rsm && model.matrices.size() == matrices.size() && (matrices.empty() || memcmp(model.matrices.data(), matrices.data(), sizeof(glm::mat4) * matrices.size()) == 0))
+			return;
+		markDirty(model);
+		model.rsm = rsm;
+		model.matrices = std::move(matrices);
+		changed.push_back(std::pair<Rsw::QuadTreeHeights::Model*, Rsm::Mesh*>(&model, rsm && !model.matrices.empty() ? rsm->rootMesh : nullptr));
+	});
+	for (auto it = qh.models.begin(); it != qh.models.end(); )
+	{
+		if (it->second.used)
+		{
+			it++;
+			continue;
+		}
+		markDirty(it->second);
+		it = qh.models.erase(it);
+	}
+
+	//only a few models are changed when editing, those are not worth waking up the workers for
+	util::WorkerPool::getInstance()->parallelFor((int)changed.size(), [&](int i)
+		{
+			rasterizeQuadtreeModel(*changed[i].first, changed[i].second, qh.width, qh.height);
+		}, std::max(1, (int)changed.size() / 16));
+	for (const auto& c : changed)
+		markDirty(*c.first);
 
+	auto apply = [&](const std::pair<int, glm::vec2>& t)
+	{
+		qh.heights[t.first].x = glm::min(qh.heights[t.first].x, t.second.x);
+		qh.heights[t.first].y = glm::max(qh.heights[t.first].y, t.second.y);
+	};
+	if (full)
+	{
+		qh.heights.assign(qh.width * qh.height, glm::vec2(qh.waterHeight, qh.waterHeight));
+		for (auto model : models)
+			for (const auto& t : model->tiles)
+				apply(t);
+	}
+	else if (dirtyMax.x >= dirtyMin.x && dirtyMax.y >= dirtyMin.y)
+	{
+		for (std::size_t i = 0; i < dirty.size(); i++)
+			if (dirty[i])
+				qh.heights[i] = glm::vec2(qh.waterHeight, qh.waterHeight);
+		for (auto model : models)
+		{
+			if (model->max.x < dirtyMin.x || model->min.x > dirtyMax.x || model->max.y < dirtyMin.y || model->min.y > dirtyMax.y)
+				continue;
+			for (const auto& t : model->tiles)
+				if (dirty[t.first])
+					apply(t);
+		}
+	}
+	std::cout << "Quadtree: rasterized " << changed.size() << " of " << models.size() << " models" << std::endl;
+}
+
+//Calculates the height of a quadtree node from the gnd and the model heights. Children first, as the parents are built from their bounds
+static void calculateQuadtreeNode(Rsw::QuadTreeNode* node, Gnd* gnd, const Rsw::QuadTreeHeights& qh)
+{
 	for (int i = 0; i < 4; i++)
 		if(node->children[i])
-			recalculateQuadtree(node->children[i]);
+			calculateQuadtreeNode(node->children[i], gnd, qh);
 
 	if (!node->children[0]) // leaf
 	{
@@ -881,8 +929,9 @@ void Rsw::recalculateQuadtree(QuadTreeNode* node)
 						node->bbox.min.y = glm::min(gnd->cubes[x][y]->heights[i], node->bbox.min.y);
 						node->bbox.max.y = glm::max(gnd->cubes[x][y]->heights[i], node->bbox.max.y);
 					}
-					node->bbox.min.y = glm::min(-heights[x][heights[x].size() - 1 - y].y, node->bbox.min.y);
-					node->bbox.max.y = glm::max(-heights[x][heights[x].size() - 1 - y].x, node->bbox.max.y);
+					const glm::vec2& h = qh.heights[x * qh.height + qh.height - 1 - y];
+					node->bbox.min.y = glm::min(-h.y, node->bbox.min.y);
+					node->bbox.max.y = glm::max(-h.x, node->bbox.max.y);
 				}
 			}
 		}
@@ -900,12 +949,22 @@ void Rsw::recalculateQuadtree(QuadTreeNode* node)
 
 	node->range[0] = (node->bbox.max - node->bbox.min) / 2.0f;
 	node->range[1] = node->bbox.max - node->range[0];
+}
 
-	if (rootNode)
+void Rsw::recalculateQuadtree(QuadTreeNode* node)
+{
+	auto gnd = this->node->getComponent<Gnd>();
+	if (!gnd)
+		return;
+	if (!node)
 	{
-		heights.clear();
+		node = quadtree;
+		debugPoints.clear();
+		debugPoints.resize(2);
+		updateQuadtreeHeights(this, gnd);
 	}
-
+	if (node && quadtreeHeights.heights.size() == (std::size_t)(gnd->width * gnd->height))
+		calculateQuadtreeNode(node, gnd, quadtreeHeights);
 }
 
 
@@ -5,6 +5,7 @@
 #include "ImguiProps.h"
 #include "Rsm.h"
 #include <string>
+#include <map>
 #include <glm/glm.hpp>
 #include <browedit/util/Util.h>
 #include <browedit/util/Tree.h>
@@ -12,10 +13,12 @@
 #include <json.hpp>
 
 class RsmRenderer;
+class Node;
 class Gnd;
 class Map;
 class BrowEdit;
 namespace gl { class Texture; }
+namespace util { class ByteWriter; class ByteReader; }
 
 class Rsw : public Component, public ImguiProps
 {
@@ -132,6 +135,27 @@ public:
 	int			unknown[4];
 	std::vector<glm::vec3> quadtreeFloats;
 	QuadTreeNode* quadtree = nullptr;
+
+	//lowest and highest model point per tile, kept between quadtree recalculations so only models that changed have to be rasterized again
+	class QuadTreeHeights
+	{
+	public:
+		class Model
+		{
+		public:
+			Rsm* rsm = nullptr;
+			std::vector<glm::mat4> matrices; //world matrix per mesh, used to see if the model changed
+			glm::ivec2 min = glm::ivec2(0); //tile range covered by this model
+			glm::ivec2 max = glm::ivec2(-1);
+			std::vector<std::pair<int, glm::vec2>> tiles; //tile index with the lowest and highest point of this model on that tile
+			bool used = false;
+		};
+		int width = 0;
+		int height = 0;
+		float waterHeight = 0;
+		std::vector<glm::vec2> heights; //x * height + y
+		std::map<Node*, Model> models;
+	} quadtreeHeights;
 	std::map<std::string, std::map<std::string, glm::vec4>> colorPresets;
 
 
@@ -140,6 +164,7 @@ public:
 
 	void load(const std::string& fileName, Map* map, BrowEdit* browEdit, bool loadModels = true, bool loadGnd = true);
 	void save(const std::string& fileName, BrowEdit* browEdit);
+	void serialize(const std::string& fileName, BrowEdit* browEdit, std::map<std::string, std::vector<char>>& files);
 	void newMap(const std::string& fileName, int width, int height, Map* map, BrowEdit* browEdit);
 	void buildImGui(BrowEdit* browEdit) override;
 	void recalculateQuadtree(QuadTreeNode* node = nullptr);
@@ -156,8 +181,8 @@ public:
 
 	RswObject() {}
 	RswObject(RswObject* other);
-	void load(std::istream* is, int version, unsigned char buildNumber, bool loadModel);
-	void save(std::ofstream& file, int version);
+	void load(util::ByteReader& file, int version, unsigned char buildNumber, bool loadModel);
+	void save(util::ByteWriter& file, int version);
 	static void buildImGuiMulti(BrowEdit* browEdit, const std::vector<Node*>&);
 	NLOHMANN_DEFINE_TYPE_INTRUSIVE(RswObject, position, rotation, scale);
 };
@@ -181,9 +206,9 @@ public:
 	RswModel() : aabb(glm::vec3(), glm::vec3()) {}
 	RswModel(const std::string &fileName) : aabb(glm::vec3(), glm::vec3()), animType(0), animSpeed(1), blockType(0), fileName(fileName) {}
 	RswModel(RswModel* other);
-	void load(std::istream* is, int version, unsigned char buildNumber, bool loadModel);
+	void load(util::ByteReader& file, int version, unsigned char buildNumber, bool loadModel);
 	void loadExtra(nlohmann::json data);
-	void save(std::ofstream &file, int version);
+	void save(util::ByteWriter& file, int version);
 	nlohmann::json saveExtra();
 	static void buildImGuiMulti(BrowEdit* browEdit, const std::vector<Node*>&);
 
@@ -231,9 +256,9 @@ public:
 	float realRange();
 
 	RswLight() {}
-	void load(std::istream* is);
+	void load(util::ByteReader& file);
 	void loadExtra(nlohmann::json data);
-	void save(std::ofstream& file);
+	void save(util::ByteWriter& file);
 	nlohmann::json saveExtra();
 	static void buildImGuiMulti(BrowEdit* browEdit, const std::vector<Node*>&);
 	NLOHMANN_DEFINE_TYPE_INTRUSIVE(RswLight, color, enabled, lightType, spotlightWidth, sunMatchRswDirection, direction, range, givesShadow, cutOff, cutOff, intensity, affectShadowMap, affectLightmap, falloff, falloffStyle);
@@ -276,8 +301,8 @@ public:
 	float param4 = 0;
 
 	RswEffect() {}
-	void load(std::istream* is);
-	void save(std::ofstream& file);
+	void load(util::ByteReader& file);
+	void save(util::ByteWriter& file);
 	static void buildImGuiMulti(BrowEdit* browEdit, const std::vector<Node*>&);
 	static inline std::map<int, gl::Texture*> previews;
 	static inline std::map<int, gl::Texture*> previewAnim;
@@ -303,8 +328,8 @@ public:
 	RswSound() {}
 	RswSound(const std::string &fileName) : fileName(fileName) {}
 	void play();
-	void load(std::istream* is, int version);
-	void save(std::ofstream& file, int version);
+	void load(util::ByteReader& file, int version);
+	void save(util::ByteWriter& file, int version);
 	static void buildImGuiMulti(BrowEdit* browEdit, const std::vector<Node*>&);
 	
 	NLOHMANN_DEFINE_TYPE_INTRUSIVE(RswSound, fileName, vol, width, height, range, cycle, unknown6, unknown7, unknown8);
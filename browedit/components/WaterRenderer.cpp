@@ -1,7 +1,9 @@
 #include "WaterRenderer.h"
 #include "Rsw.h"
 #include "Gnd.h"
+#include "GndRenderer.h"
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/Profiler.h>
 #include <browedit/Node.h>
 #include <browedit/shaders/WaterShader.h>
 #include <browedit/gl/Texture.h>
@@ -21,6 +23,9 @@ WaterRenderer::~WaterRenderer()
 {
 	for (auto t : textures)
 		util::ResourceManager<gl::Texture>::unload(t);
+	delete vbo;
+	if (vao != 0)
+		glDeleteVertexArrays(1, &vao);
 }
 
 void WaterRenderer::setDirty()
@@ -28,6 +33,53 @@ void WaterRenderer::setDirty()
 	dirty = true;
 }
 
+//Finds the chunks where the ground is below the highest point of the waves. This uses the bounding boxes of the
+//ground chunks, so it is updated when the ground renderer rebuilds a chunk after the heights change
+void WaterRenderer::updateCoverage()
+{
+	PROFILE_SCOPE("WaterRenderer::updateCoverage");
+	std::vector<glm::ivec2> chunks;
+	float waterTop = -rsw->water.height + glm::abs(rsw->water.amplitude);
+	if (gndRenderer && !gndRenderer->chunks.empty())
+	{
+		for (std::size_t y = 0; y < gndRenderer->chunks.size(); y++)
+		{
+			for (std::size_t x = 0; x < gndRenderer->chunks[y].size(); x++)
+			{
+				auto c = gndRenderer->chunks[y][x];
+				if (c->aabbMin.y < waterTop || c->aabbMin == c->aabbMax)
+					chunks.push_back(glm::ivec2(c->x, gnd->height - CHUNKSIZE - c->y)); //the water rows go the other way than the ground rows
+			}
+		}
+	}
+	else
+	{
+		for (int y = 0; y < gnd->height; y += CHUNKSIZE)
+			for (int x = 0; x < gnd->width; x += CHUNKSIZE)
+				chunks.push_back(glm::ivec2(x, y));
+	}
+
+	if (chunks != visibleChunks || dirty)
+	{
+		visibleChunks = std::move(chunks);
+		if (!vbo)
+		{
+			vbo = new gl::VBO<glm::ivec2>();
+			vbo->memory.setTag("GL water buffers");
+			glGenVertexArrays(1, &vao);
+			glBindVertexArray(vao);
+			vbo->bind();
+			glEnableVertexAttribArray(0);
+			glVertexAttribIPointer(0, 2, GL_INT, sizeof(glm::ivec2), (void*)0);
+			glVertexAttribDivisor(0, 1);
+			glBindVertexArray(0);
+		}
+		vbo->setData(visibleChunks, GL_DYNAMIC_DRAW);
+		vbo->unBind();
+		dirty = false;
+	}
+}
+
 void WaterRenderer::render()
 {
 	if (!this->rsw || dirty)
@@ -37,29 +89,12 @@ void WaterRenderer::render()
 		{
 			reloadTextures();
 		}
-
-		if (!vbo || dirty)
-		{
-			auto gnd = node->getComponent<Gnd>();
-			if(!vbo)
-				vbo = new gl::VBO<VertexP3T2>();
-			std::vector<VertexP3T2> verts;
-			for (int x = 0; x < gnd->width; x++)
-			{
-				for (int y = 0; y < gnd->height; y++)
-				{
-					verts.push_back(VertexP3T2(glm::vec3(10 * x,		0, 10 * (y+1)),	glm::vec2((x % 4) * 0.25f + 0.00f, (y % 4) * 0.25f + 0.00f)));
-					verts.push_back(VertexP3T2(glm::vec3(10 * (x+1),	0, 10 * (y+1)),	glm::vec2((x % 4) * 0.25f + 0.25f, (y % 4) * 0.25f + 0.00f)));
-					verts.push_back(VertexP3T2(glm::vec3(10 * (x+1),	0, 10 * (y+2)), glm::vec2((x % 4) * 0.25f + 0.25f, (y % 4) * 0.25f + 0.25f)));
-					verts.push_back(VertexP3T2(glm::vec3(10 * x,		0, 10 * (y+2)), glm::vec2((x % 4) * 0.25f + 0.00f, (y % 4) * 0.25f + 0.25f)));
-				}
-			}
-			vbo->setData(verts, GL_STATIC_DRAW);
-			dirty = false;
-		}
+		gnd = node->getComponent<Gnd>();
+		gndRenderer = node->getComponent<GndRenderer>();
 	}
-	if (!this->rsw)
+	if (!this->rsw || !this->gnd)
 		return;
+	updateCoverage();
 
 	if (textures.size() == 0)
 		return;
@@ -74,24 +109,33 @@ void WaterRenderer::render()
 	shader->setUniform(WaterShader::Uniforms::wavePitch, rsw->water.wavePitch);
 	shader->setUniform(WaterShader::Uniforms::frameTime, glm::fract(time * 60 / rsw->water.textureAnimSpeed));
 
-	shader->setUniform(WaterShader::Uniforms::fogEnabled, viewFog);
+	shader->setUniform(WaterShader::Uniforms::fogEnabled, renderContext->settings->viewFog);
 	shader->setUniform(WaterShader::Uniforms::fogNear, rsw->fog.nearPlane * 240 * 2.5f);
 	shader->setUniform(WaterShader::Uniforms::fogFar, rsw->fog.farPlane * 240 * 2.5f);
 	shader->setUniform(WaterShader::Uniforms::fogExp, rsw->fog.factor);
 	shader->setUniform(WaterShader::Uniforms::fogColor, rsw->fog.color);
+	shader->setUniform(WaterShader::Uniforms::chunkSize, CHUNKSIZE);
+	shader->setUniform(WaterShader::Uniforms::mapWidth, gnd->width);
+	shader->setUniform(WaterShader::Uniforms::mapHeight, gnd->height);
 
 	glDepthMask(0);
 	glEnable(GL_BLEND);
-	vbo->bind();
 	glActiveTexture(GL_TEXTURE0);
 	textures[((int)(time*60/rsw->water.textureAnimSpeed)) % textures.size()]->bind();
 	glActiveTexture(GL_TEXTURE1);
 	textures[((int)((time*60 / rsw->water.textureAnimSpeed))+1) % textures.size()]->bind();
 	glActiveTexture(GL_TEXTURE0);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(VertexP3T2), (void*)(0 * sizeof(float)));
-	glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(VertexP3T2), (void*)(3 * sizeof(float)));
-	glDrawArrays(GL_QUADS, 0, (int)vbo->size());
+	drawnChunks = (int)visibleChunks.size();
+	if (drawnChunks > 0)
+	{
+		glBindVertexArray(vao);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, CHUNKSIZE * CHUNKSIZE * 6, drawnChunks);
+		glBindVertexArray(0);
+		PROFILE_COUNT("Draw calls", 1);
+		PROFILE_COUNT("Water chunks", drawnChunks);
+		PROFILE_COUNT("Water vertices", drawnChunks * CHUNKSIZE * CHUNKSIZE * 6);
+	}
 
 
 	glDepthMask(1);
@@ -133,10 +177,5 @@ void WaterRenderer::WaterRenderContext::preFrame(const glm::mat4& projectionMatr
 
 	
 
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	glDisableVertexAttribArray(3);
-	glDisableVertexAttribArray(4); //TODO: vao
 }
 
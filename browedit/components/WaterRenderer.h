@@ -13,6 +13,8 @@ namespace gl
 	class Texture;
 }
 class Rsw;
+class Gnd;
+class GndRenderer;
 class WaterShader;
 
 class WaterRenderer : public Renderer
@@ -29,9 +31,15 @@ public:
 
 	std::vector<gl::Texture*> textures;
 	Rsw* rsw;
-	gl::VBO<VertexP3T2>* vbo = nullptr;
+	Gnd* gnd = nullptr;
+	GndRenderer* gndRenderer = nullptr;
+	gl::VBO<glm::ivec2>* vbo = nullptr; //first cell of every chunk that has ground below the water
+	GLuint vao = 0;
+	std::vector<glm::ivec2> visibleChunks;
 	bool dirty = true;
-	bool viewFog = false;
+	int drawnChunks = 0;
+
+	void updateCoverage();
 
 	WaterRenderer();
 	~WaterRenderer();
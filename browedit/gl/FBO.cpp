@@ -1,4 +1,5 @@
 #include "FBO.h"
+#include "Texture.h"
 #include <glm/glm.hpp>
 #include <stb/stb_image_write.h>
 #include <thread>
@@ -67,6 +68,7 @@ namespace gl
 
 			depthTexture = texid[textureCount];
 		}
+		memory.set(textureMemorySize(GL_RGBA, width, height, textureCount) + textureMemorySize(GL_DEPTH_COMPONENT24, width, height, (depth ? 1 : 0) + (hasDepthTexture ? 1 : 0)));
 		unbind();
 		glBindTexture(GL_TEXTURE_2D, 0);
 	}
@@ -87,6 +89,7 @@ namespace gl
 
 		Type textures[] = { buf1, buf2, buf3, buf4 };
 		textureCount = 0;
+		std::size_t size = 0;
 		for (int i = 0; i < 4; i++)
 		{
 			if (textures[i] == None)
@@ -103,6 +106,7 @@ namespace gl
 				glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 				for (int i = 0; i < 6; i++)
 					glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, 0);
+				size += textureMemorySize(GL_R32F, width, height, 6);
 				glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 				textureCount++;
 			}
@@ -118,6 +122,7 @@ namespace gl
 					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
 				else if (textures[i] == Depth)
 					glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
+				size += textureMemorySize(textures[i] == Position ? GL_RGBA16F : (textures[i] == Depth ? GL_R16F : GL_RGBA), width, height);
 
 				textureCount++;
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -160,6 +165,7 @@ namespace gl
 			if (textureCount == 0)
 				glDrawBuffer(GL_NONE); // No color buffer is drawn to.
 		}
+		memory.set(size + textureMemorySize(GL_DEPTH_COMPONENT32, width, height, hasDepthTexture ? 2 : 1));
 		unbind();
 		glBindTexture(GL_TEXTURE_2D, 0);
 	}
@@ -167,7 +173,12 @@ namespace gl
 
 	FBO::~FBO()
 	{
-
+		glDeleteTextures(textureCount, texid);
+		if (depthTexture != 0)
+			glDeleteTextures(1, &depthTexture);
+		if (depthBuffer != 0)
+			glDeleteRenderbuffers(1, &depthBuffer);
+		glDeleteFramebuffers(1, &fboId);
 	}
 
 	void FBO::bind()
@@ -262,6 +273,7 @@ namespace gl
 
 		}
 		glBindTexture(GL_TEXTURE_2D, 0);
+		memory.set(textureMemorySize(GL_RGBA, width, height, textureCount + (depthBuffer != 0 ? 1 : 0) + (depthTexture != 0 ? 1 : 0)));
 
 	}
 
@@ -4,6 +4,7 @@
 #include <functional>
 
 #include <glad/glad.h>
+#include <browedit/util/MemoryTracker.h>
 
 namespace gl
 {
@@ -17,6 +18,7 @@ namespace gl
 	public:
 		GLuint fboId;
 		GLint oldFBO;
+		util::TrackedMemory memory{ "GL framebuffers", util::MemoryTracker::Type::Gpu };
 		enum Type
 		{
 			Color,
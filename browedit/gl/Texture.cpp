@@ -5,10 +5,42 @@
 #include <browedit/util/FileIO.h>
 #include <browedit/util/Util.h>
 #include <iostream>
+#include <algorithm>
 #include <stb/stb_image.h>
 
 namespace gl
 {
+	std::size_t textureMemorySize(GLenum internalFormat, int width, int height, int layers, bool mipmaps)
+	{
+		std::size_t pixelSize = 4;
+		switch (internalFormat)
+		{
+		case GL_R8:
+		case GL_RED:
+			pixelSize = 1;
+			break;
+		case GL_R16F:
+		case GL_RG8:
+		case GL_DEPTH_COMPONENT16:
+			pixelSize = 2;
+			break;
+		case GL_RGBA16F:
+		case GL_RG32F:
+			pixelSize = 8;
+			break;
+		case GL_RGBA32F:
+			pixelSize = 16;
+			break;
+		default: //RGB is padded to 4 bytes, 24 bit depth is stored in 32 bits
+			pixelSize = 4;
+			break;
+		}
+		std::size_t size = pixelSize * width * height * layers;
+		if (mipmaps)
+			size += size / 3;
+		return size;
+	}
+
 	Texture::Texture(const std::string& fileName, bool flipSelection) : fileName(fileName), flipSelection(flipSelection)
 	{
 		ids = nullptr;
@@ -23,6 +55,7 @@ namespace gl
 		glGenTextures(1, &ids[0]);
 		glBindTexture(GL_TEXTURE_2D, ids[0]);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		memory.set(textureMemorySize(GL_RGBA, width, height));
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -46,59 +79,67 @@ namespace gl
 		if (fileName == "")
 			return;
 		tryLoaded = true;
-		int comp;
-		stbi_set_flip_vertically_on_load(flipSelection);
+		Image image;
+		if (!decode(fileName, flipSelection, image))
+		{
+			fingerprint = image.fingerprint;
+			return;
+		}
+		upload(image);
+	}
 
-		std::istream* is = util::FileIO::open(fileName);
-		if (!is)
+	//reads and decodes a texture file, without using GL, so this can run on any thread
+	bool Texture::decode(const std::string& fileName, bool flip, Image& image)
+	{
+		int comp;
+		image.fingerprint = util::FileIO::fingerprint(fileName);
+		std::vector<char> buffer;
+		if (!util::FileIO::read(fileName, buffer))
 		{
 			std::cerr << "Texture: Could not open " << fileName << std::endl;
-			ids = nullptr;
-			return;
+			return false;
 		}
-		is->seekg(0, std::ios_base::end);
-		std::size_t len = is->tellg();
+		std::size_t len = buffer.size();
 		if (len <= 0 || len > 100 * 1024 * 1024)
 		{
 			std::cerr << "Texture: Error opening texture " << fileName << ", file is either empty or too large"<<std::endl;
-			delete is;
-			return;
+			return false;
 		}
-		char* buffer = new char[len];
-		is->seekg(0, std::ios_base::beg);
-		is->read(buffer, len);
-		delete is;
 
-		if (fileName.substr(fileName.size() - 4) == ".gif")
+		unsigned char* decoded = nullptr;
+		bool gif = fileName.substr(fileName.size() - 4) == ".gif";
+		if (gif)
 		{
-			int* delays;
-			auto data = stbi_load_gif_from_memory((stbi_uc*)buffer, (int)len, &delays, &width, &height, &frameCount, &comp, 4);
-			if (ids == nullptr)
-			{
-				ids = new GLuint[frameCount];
-				glGenTextures(frameCount, ids);
-			}
-			for(int frame = 0; frame < frameCount; frame++)
-			{
-				glBindTexture(GL_TEXTURE_2D, ids[frame]);
-				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data+(width*height*4)*frame);
-				glGenerateMipmap(GL_TEXTURE_2D);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-			}
-			stbi_image_free(data);
+			int* delays = nullptr;
+			decoded = stbi_load_gif_from_memory((stbi_uc*)buffer.data(), (int)len, &delays, &image.width, &image.height, &image.frameCount, &comp, 4);
+			stbi_image_free(delays);
 		}
 		else
 		{
-			unsigned char* data = stbi_load_from_memory((stbi_uc*)buffer, (int)len, &width, &height, &comp, 4);
-			if (!data)
-			{
-				std::cerr << "Texture: " << fileName << " could not load; error: " << stbi_failure_reason() << std::endl;
-				return;
-			}
+			image.frameCount = 1;
+			decoded = stbi_load_from_memory((stbi_uc*)buffer.data(), (int)len, &image.width, &image.height, &comp, 4);
+		}
+		if (!decoded)
+		{
+			std::cerr << "Texture: " << fileName << " could not load; error: " << stbi_failure_reason() << std::endl;
+			return false;
+		}
+		int width = image.width;
+		int height = image.height;
+		image.pixels.assign(decoded, decoded + (std::size_t)width * height * 4 * image.frameCount);
+		stbi_image_free(decoded);
+
+		//flipped here instead of with stbi_set_flip_vertically_on_load, as that is shared by all threads
+		if (flip)
+			for (int frame = 0; frame < image.frameCount; frame++)
+				for (int y = 0; y < height / 2; y++)
+					std::swap_ranges(image.pixels.begin() + ((std::size_t)frame * height + y) * width * 4,
+						image.pixels.begin() + ((std::size_t)frame * height + y + 1) * width * 4,
+						image.pixels.begin() + ((std::size_t)frame * height + height - 1 - y) * width * 4);
 
+		if (!gif)
+		{
+			unsigned char* data = image.pixels.data();
 			for (int i = 0; i < 10; i++) //TODO: maybe 10 is a bit too big?
 			{
 				bool changed = false;
@@ -147,25 +188,41 @@ namespace gl
 				if (!changed)
 					break;
 			}
-			if (ids == nullptr)
-			{
-				frameCount = 1;
-				ids = new GLuint[1];
-				glGenTextures(frameCount, ids);
-			}
-			glBindTexture(GL_TEXTURE_2D, ids[0]);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
-			//std::cout << "Texture: loaded " << fileName << std::endl;;
+		}
+		return true;
+	}
+
+	//uploads a decoded image, on the main thread. The texture keeps its GL ids, so everything that uses it sees the new image
+	void Texture::upload(const Image& image)
+	{
+		tryLoaded = true;
+		fingerprint = image.fingerprint;
+		if (ids != nullptr && frameCount != image.frameCount)
+		{
+			glDeleteTextures(frameCount, ids);
+			delete[] ids;
+			ids = nullptr;
+		}
+		width = image.width;
+		height = image.height;
+		frameCount = image.frameCount;
+		if (ids == nullptr)
+		{
+			ids = new GLuint[frameCount];
+			glGenTextures(frameCount, ids);
+		}
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			glBindTexture(GL_TEXTURE_2D, ids[frame]);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data() + ((std::size_t)width * height * 4) * frame);
 			glGenerateMipmap(GL_TEXTURE_2D);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
 		}
-
+		memory.set(textureMemorySize(GL_RGBA, width, height, frameCount, true));
 		loaded = true;
-
 	}
 
 	void Texture::setWrapMode(GLuint mode)
@@ -184,6 +241,7 @@ namespace gl
 	{
 		bind();
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		memory.set(textureMemorySize(GL_RGBA, width, height));
 	}
 
 	GLuint Texture::getAnimatedTextureId()
@@ -3,15 +3,34 @@
 #include <GLFW/glfw3.h>
 #include <string>
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/MemoryTracker.h>
+#include <browedit/util/FileIO.h>
+#include <vector>
 
 namespace gl
 {
+	//bytes used by a texture with this internal format, the way most drivers store it
+	std::size_t textureMemorySize(GLenum internalFormat, int width, int height, int layers = 1, bool mipmaps = false);
+
 	class Texture
 	{
 	private:
 		Texture(const std::string& fileName, bool flipSelection = false);
 		GLuint* ids = nullptr;
 	public:
+		//decoded pixels of a texture file. Decoding doesn't use GL, so it can be done on another thread, and uploaded on the main thread
+		class Image
+		{
+		public:
+			std::vector<unsigned char> pixels; //RGBA, the frames of a gif after each other
+			int width = 0;
+			int height = 0;
+			int frameCount = 1;
+			util::FileIO::Fingerprint fingerprint;
+		};
+		static bool decode(const std::string& fileName, bool flip, Image& image);
+		void upload(const Image& image);
+
 		inline GLuint id() {
 			if (loaded) { return ids[0]; }
 			else { return 0; }
@@ -22,6 +41,8 @@ namespace gl
 		bool tryLoaded = false;
 		bool loaded = false;
 		bool flipSelection;
+		util::FileIO::Fingerprint fingerprint; //of the file when it was loaded, for hot reloading
+		util::TrackedMemory memory{ "GL textures", util::MemoryTracker::Type::Gpu };
 
 		Texture(int width, int height);
 		~Texture();
@@ -0,0 +1,74 @@
+#include "TextureArray.h"
+#include "Texture.h"
+#include <browedit/util/Profiler.h>
+#include <algorithm>
+#include <cmath>
+
+namespace gl
+{
+	TextureArray::TextureArray(int width, int height, int layers) : width(width), height(height), layers(layers)
+	{
+		int levels = (int)std::floor(std::log2(std::max(width, height))) + 1;
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, width, height, layers);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		glGenFramebuffers(2, fbos);
+		memory.set(textureMemorySize(GL_RGBA8, width, height, layers, true));
+	}
+
+	TextureArray::~TextureArray()
+	{
+		glDeleteFramebuffers(2, fbos);
+		glDeleteTextures(1, &id);
+	}
+
+	void TextureArray::bind()
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+	}
+
+	//copies level 0 of the texture into the layer with a blit, so the scaling is done on the GPU
+	void TextureArray::copyLayer(int layer, GLuint texture, int textureWidth, int textureHeight)
+	{
+		GLint oldRead, oldDraw;
+		glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldRead);
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDraw);
+		GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST); //blits are clipped by the scissor
+		glDisable(GL_SCISSOR_TEST);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[0]);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[1]);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, id, 0, layer);
+		glBlitFramebuffer(0, 0, textureWidth, textureHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, oldRead);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDraw);
+		if (scissor)
+			glEnable(GL_SCISSOR_TEST);
+		PROFILE_COUNT("Texture array copies", 1);
+	}
+
+	void TextureArray::fillLayer(int layer, const glm::vec4& color)
+	{
+		GLint oldDraw;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDraw);
+		GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+		glDisable(GL_SCISSOR_TEST);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[1]);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, id, 0, layer);
+		glClearBufferfv(GL_COLOR, 0, &color.x);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDraw);
+		if (scissor)
+			glEnable(GL_SCISSOR_TEST);
+	}
+
+	void TextureArray::generateMipmaps()
+	{
+		bind();
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <browedit/util/MemoryTracker.h>
+
+namespace gl
+{
+	//GL_TEXTURE_2D_ARRAY where all layers have the same size. Layers are filled by copying other textures into them,
+	//which get scaled to the size of the array
+	class TextureArray
+	{
+		GLuint id = 0;
+		GLuint fbos[2] = { 0, 0 };
+	public:
+		int width;
+		int height;
+		int layers;
+		util::TrackedMemory memory{ "GL textures", util::MemoryTracker::Type::Gpu };
+
+		TextureArray(int width, int height, int layers);
+		~TextureArray();
+		void bind();
+		void copyLayer(int layer, GLuint texture, int textureWidth, int textureHeight);
+		void fillLayer(int layer, const glm::vec4& color);
+		void generateMipmaps();
+	};
+}
@@ -2,6 +2,8 @@
 
 #include <glad/glad.h>
 #include <vector>
+#include <browedit/util/Profiler.h>
+#include <browedit/util/MemoryTracker.h>
 
 namespace gl
 {
@@ -19,6 +21,8 @@ namespace gl
 		}
 
 	public:
+		util::TrackedMemory memory{ "GL buffers", util::MemoryTracker::Type::Gpu };
+
 		VBO()
 		{
 			length = 0;
@@ -35,6 +39,9 @@ namespace gl
 			this->length = data.size();
 			bind();
 			glBufferData(GL_ARRAY_BUFFER, sizeof(T) * length, data.data(), usage);
+			memory.set(sizeof(T) * length);
+			PROFILE_COUNT("Buffer uploads", 1);
+			PROFILE_COUNT("Buffer upload bytes", sizeof(T) * length);
 		}
 
 		void setData(std::size_t length, T* data, GLenum usage)
@@ -42,12 +49,17 @@ namespace gl
 			this->length = length;
 			bind();
 			glBufferData(GL_ARRAY_BUFFER, sizeof(T) * length, data, usage);
+			memory.set(sizeof(T) * length);
+			PROFILE_COUNT("Buffer uploads", 1);
+			PROFILE_COUNT("Buffer upload bytes", sizeof(T) * length);
 		}
 
 		void updateData(std::size_t size, int offset, T* data)
 		{
 			bind();
 			glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(T), size * sizeof(T), data);
+			PROFILE_COUNT("Buffer uploads", 1);
+			PROFILE_COUNT("Buffer upload bytes", size * sizeof(T));
 		}
 
 		void bind()
@@ -1,76 +1,70 @@
-#ifndef __VIO_H__
-#define __VIO_H__
+#pragma once
 
-#include <blib/config.h>
+#include <glad/glad.h>
+#include <vector>
+#include <browedit/util/Profiler.h>
+#include <browedit/util/MemoryTracker.h>
 
-#if defined(BLIB_IOS)
-#include <OpenGLES/ES2/gl.h>
-#include <OpenGLES/ES2/glext.h>
-#elif defined(BLIB_ANDROID)
-#include <GLES2/gl2.h>
-#include <GLES2/gl2ext.h>
-#else
-#include <GL/glew.h>
-#endif
-
-#include <blib/util/NotCopyable.h>
-#include <blib/VIO.h>
-
-namespace blib
+namespace gl
 {
-	namespace gl
+	//Index buffer, T should be unsigned char, unsigned short or unsigned int
+	template <class T>
+	class VIO
 	{
-		class VIO : public blib::VIO, public blib::util::NotCopyable
+	private:
+		GLuint vio;
+		std::size_t length;
+		VIO(const VIO& other)
 		{
-        private:
-            // Leuke 'bug'. GLuinit is een simple usinged int. Vergelijken met een -1 why? en ook als contruct?
-			GLuint vio;
-			int length;
-		public:
-			VIO()
-			{
-				length = 0;
-				vio = 0;
-			}
-			~VIO()
-			{
-				if(vio != 0)
-					glDeleteBuffers(1, &vio);
-			}
+			throw "do not copy!";
+		}
 
-			void initGl()
-			{
-				if(vio == 0)
-					glGenBuffers(1, &vio);
-			}
+	public:
+		util::TrackedMemory memory{ "GL buffers", util::MemoryTracker::Type::Gpu };
 
-			void setData(int length, void* data)
-			{
-				this->length = length;
-				bind();
-				glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementSize * length, data, GL_STATIC_DRAW);
-			}
+		VIO()
+		{
+			length = 0;
+			glGenBuffers(1, &vio);
+		}
+		~VIO()
+		{
+			glDeleteBuffers(1, &vio);
+		}
 
+		void setData(const std::vector<T>& data, GLenum usage)
+		{
+			this->length = data.size();
+			bind();
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(T) * length, data.data(), usage);
+			memory.set(sizeof(T) * length);
+			PROFILE_COUNT("Buffer uploads", 1);
+			PROFILE_COUNT("Buffer upload bytes", sizeof(T) * length);
+		}
 
-			void bind()
-			{
-				if(vio == 0)
-					initGl();
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vio);
-			}
+		void bind()
+		{
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vio);
+		}
 
-			void unBind()
-			{
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-			}
+		void unBind()
+		{
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		}
 
-			int getLength()
-			{
-				return length;
-			}
+		std::size_t size()
+		{
+			return length;
+		}
 
-		};
-	}
+		static constexpr GLenum type()
+		{
+			if constexpr (sizeof(T) == 1)
+				return GL_UNSIGNED_BYTE;
+			else if constexpr (sizeof(T) == 2)
+				return GL_UNSIGNED_SHORT;
+			else
+				return GL_UNSIGNED_INT;
+		}
+	};
 }
-
-#endif
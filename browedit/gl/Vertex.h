@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 
 	// A simple structure to store vertices. Can store positions, normals, colors and texture coordinats
 	struct Vertex
@@ -164,4 +165,31 @@
 			set(t, index);
 			set(alpha, index);
 		}
-	};
\ No newline at end of file
+	};
+
+
+	//Compact version of VertexP3T2T2C4N3 with a texture array layer, 32 bytes instead of 60. The texture coordinate is stored as 2 half floats,
+	//the lightmap coordinate as 2 normalized shorts (halfs are not precise enough for the 4096x4096 lightmap atlas),
+	//the color as 4 normalized bytes, the normal as a normalized GL_INT_2_10_10_10_REV and the layer as an integer attribute
+	class VertexP3T2T2C4N3L1Packed
+	{
+	public:
+		float position[3];
+		unsigned int texCoord;
+		unsigned int lightmapCoord;
+		unsigned int color;
+		unsigned int normal;
+		unsigned int layer;
+
+		VertexP3T2T2C4N3L1Packed() {}
+		VertexP3T2T2C4N3L1Packed(const glm::vec3& pos, const glm::vec2& t1, const glm::vec2& t2, const glm::vec4& c1, const glm::vec3& n, unsigned int layer = 0) : layer(layer)
+		{
+			position[0] = pos.x;
+			position[1] = pos.y;
+			position[2] = pos.z;
+			texCoord = glm::packHalf2x16(t1);
+			lightmapCoord = glm::packUnorm2x16(t2);
+			color = glm::packUnorm4x8(c1);
+			normal = glm::packSnorm3x10_1x2(glm::vec4(n, 0.0f));
+		}
+	};
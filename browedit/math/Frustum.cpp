@@ -0,0 +1,50 @@
+#include "Frustum.h"
+#include "AABB.h"
+
+math::Frustum::Frustum()
+{
+}
+
+//Gribb & Hartmann plane extraction, works for both perspective and orthographic matrices
+math::Frustum::Frustum(const glm::mat4& m)
+{
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	glm::vec4 p[6] = {
+		row3 + row0, //left
+		row3 - row0, //right
+		row3 + row1, //bottom
+		row3 - row1, //top
+		row3 + row2, //near
+		row3 - row2, //far
+	};
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(p[i]));
+		planes[i] = Plane(glm::vec3(p[i]) / length, p[i].w / length);
+	}
+}
+
+//conservative test, can return true for boxes just outside of the corners of the frustum
+bool math::Frustum::intersects(const glm::vec3& min, const glm::vec3& max) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		//the corner of the box that is furthest along the normal of the plane
+		glm::vec3 positive(
+			planes[i].normal.x >= 0 ? max.x : min.x,
+			planes[i].normal.y >= 0 ? max.y : min.y,
+			planes[i].normal.z >= 0 ? max.z : min.z);
+		if (glm::dot(planes[i].normal, positive) + planes[i].D < 0)
+			return false;
+	}
+	return true;
+}
+
+bool math::Frustum::intersects(const AABB& aabb) const
+{
+	return intersects(aabb.min, aabb.max);
+}
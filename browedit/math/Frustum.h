@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "Plane.h"
+
+namespace math
+{
+	class AABB;
+
+	//View frustum, with the planes pointing inwards
+	class Frustum
+	{
+	public:
+		Plane planes[6];
+
+		Frustum();
+		Frustum(const glm::mat4& viewProjectionMatrix);
+		bool intersects(const glm::vec3& min, const glm::vec3& max) const;
+		bool intersects(const AABB& aabb) const;
+	};
+}
@@ -25,6 +25,9 @@ public:
 			fogNear,
 			fogFar,
 			fogExp,
+			chunkSize,
+			mapWidth,
+			mapHeight,
 			End
 		};
 	};
@@ -46,6 +49,9 @@ public:
 		bindUniform(Uniforms::fogNear, "fogNear");
 		bindUniform(Uniforms::fogFar, "fogFar");
 		bindUniform(Uniforms::fogExp, "fogExp");
+		bindUniform(Uniforms::chunkSize, "chunkSize");
+		bindUniform(Uniforms::mapWidth, "mapWidth");
+		bindUniform(Uniforms::mapHeight, "mapHeight");
 		
 	}
 };
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace util
+{
+	//Appends raw little-endian data to one contiguous buffer, to avoid the overhead of many small stream writes
+	class ByteWriter
+	{
+	public:
+		std::vector<char> data;
+
+		ByteWriter(std::size_t reserve = 0) { data.reserve(reserve); }
+
+		inline void write(const void* src, std::size_t size)
+		{
+			std::size_t offset = data.size();
+			data.resize(offset + size);
+			if(size > 0)
+				memcpy(data.data() + offset, src, size);
+		}
+		template<class T>
+		inline void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "ByteWriter can only write trivially copyable types");
+			write(&value, sizeof(T));
+		}
+		template<class T>
+		inline void writeArray(const std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "ByteWriter can only write trivially copyable types");
+			write(values.data(), values.size() * sizeof(T));
+		}
+		//writes a fixed length, zero padded string, like util::FileIO::writeString
+		inline void writeString(const std::string& str, std::size_t length)
+		{
+			std::size_t offset = data.size();
+			data.resize(offset + length, 0);
+			if (length > 0)
+				memcpy(data.data() + offset, str.c_str(), std::min(str.size(), length - 1));
+		}
+		//writes a string prefixed with its length, like util::FileIO::readStringDyn expects
+		inline void writeStringDyn(const std::string& str)
+		{
+			write((int)str.size());
+			write(str.data(), str.size());
+		}
+		inline std::size_t size() const { return data.size(); }
+	};
+
+	//Bounds-checked reader over a contiguous block of memory. Does not own the memory. Throws std::out_of_range when reading past the end
+	class ByteReader
+	{
+		const char* begin;
+		const char* end;
+		const char* cur;
+	public:
+		ByteReader(const char* data, std::size_t size) : begin(data), end(data + size), cur(data) {}
+		ByteReader(const std::vector<char>& data) : ByteReader(data.data(), data.size()) {}
+
+		inline void read(void* dest, std::size_t size)
+		{
+			if ((std::size_t)(end - cur) < size)
+				throw std::out_of_range("ByteReader: read past end of buffer");
+			if(size > 0)
+				memcpy(dest, cur, size);
+			cur += size;
+		}
+		template<class T>
+		inline T read()
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "ByteReader can only read trivially copyable types");
+			T value;
+			read(&value, sizeof(T));
+			return value;
+		}
+		template<class T>
+		inline void read(T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "ByteReader can only read trivially copyable types");
+			read(&value, sizeof(T));
+		}
+		template<class T>
+		inline void readArray(std::vector<T>& values, std::size_t count)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "ByteReader can only read trivially copyable types");
+			if (count > remaining() / sizeof(T))
+				throw std::out_of_range("ByteReader: array larger than buffer");
+			values.resize(count);
+			read(values.data(), count * sizeof(T));
+		}
+		//reads a fixed length, zero padded string, like util::FileIO::readString
+		inline std::string readString(std::size_t length)
+		{
+			if ((std::size_t)(end - cur) < length)
+				throw std::out_of_range("ByteReader: read past end of buffer");
+			std::string ret(cur, strnlen(cur, length));
+			cur += length;
+			return ret;
+		}
+		inline std::string readStringDyn()
+		{
+			int length = read<int>();
+			if (length < 0 || (std::size_t)(end - cur) < (std::size_t)length)
+				throw std::out_of_range("ByteReader: read past end of buffer");
+			std::string ret(cur, length);
+			cur += length;
+			return ret;
+		}
+		inline void skip(std::size_t size)
+		{
+			if ((std::size_t)(end - cur) < size)
+				throw std::out_of_range("ByteReader: skip past end of buffer");
+			cur += size;
+		}
+		inline void seek(std::size_t offset)
+		{
+			if (offset > (std::size_t)(end - begin))
+				throw std::out_of_range("ByteReader: seek past end of buffer");
+			cur = begin + offset;
+		}
+		inline const char* ptr() const { return cur; }
+		inline std::size_t tell() const { return cur - begin; }
+		inline std::size_t size() const { return end - begin; }
+		inline std::size_t remaining() const { return end - cur; }
+		inline bool eof() const { return cur >= end; }
+	};
+}
@@ -1,11 +1,14 @@
 #include "Util.h"
 #include "FileIO.h"
+#include "Profiler.h"
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
 #include <algorithm>
+#include <iterator>
+#include <mutex>
 
 
 namespace util
@@ -20,48 +23,262 @@ namespace util
 			delete source;
 		}
 		sources.clear();
+
+		delete index.exchange(nullptr);
+		for (auto i : oldIndices)
+			delete i;
+		oldIndices.clear();
+		std::unique_lock<std::shared_mutex> lock(lateMutex);
+		lateFiles.clear();
+		missingFiles.clear();
+		lateOverrides = false;
 	}
 
-	std::istream* FileIO::open(const std::string& fileName)
+	std::string FileIO::normalizeFileName(std::string fileName)
 	{
-		for (auto& source : sources)
+		for (auto& c : fileName)
 		{
-			if (source->exists(fileName))
-				return source->open(fileName);
+			if (c >= 'A' && c <= 'Z')
+				c = c - 'A' + 'a';
+			else if (c == '/')
+				c = '\\';
 		}
-		return nullptr;
+		std::size_t pos;
+		while ((pos = fileName.find("\\\\")) != std::string::npos)
+			fileName.erase(pos, 1);
+		return fileName;
 	}
-	std::string FileIO::getSrc(const std::string& fileName)
+
+	void FileIO::buildIndex()
 	{
-		for (auto& source : sources)
+		PROFILE_SCOPE("FileIO::buildIndex");
+		auto start = std::chrono::steady_clock::now();
+		auto newIndex = new Index();
+		std::vector<std::pair<std::string, int>> entries;
+		for (auto source : sources)
 		{
-			if (source->exists(fileName))
-				return source->toString();
+			entries.clear();
+			source->listEntries(entries);
+			for (auto& e : entries)
+			{
+				std::string normalized = normalizeFileName(e.first);
+				newIndex->files.push_back(std::pair<std::string, Entry>(normalized, Entry{ source, e.second, normalized == e.first ? "" : e.first }));
+			}
 		}
-		return "No Src: " + fileName;
+		//stable, so when a file is in multiple sources, the first source stays in front
+		std::stable_sort(newIndex->files.begin(), newIndex->files.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+		newIndex->files.erase(std::unique(newIndex->files.begin(), newIndex->files.end(), [](const auto& a, const auto& b) { return a.first == b.first; }), newIndex->files.end());
+		newIndex->lookup.reserve(newIndex->files.size());
+		for (std::size_t i = 0; i < newIndex->files.size(); i++)
+			newIndex->lookup[newIndex->files[i].first] = i;
+
+		auto old = index.exchange(newIndex);
+		if (old)
+			oldIndices.push_back(old);
+		{
+			std::unique_lock<std::shared_mutex> lock(lateMutex);
+			lateFiles.clear();
+			missingFiles.clear();
+			lateOverrides = false;
+		}
+		auto buildTime = std::chrono::steady_clock::now() - start;
+
+		//time some lookups on the new index, to compare a warm lookup with the cold cost of building the index and of asking the sources
+		std::size_t sampleCount = std::min<std::size_t>(newIndex->files.size(), 1000);
+		std::size_t step = sampleCount > 0 ? newIndex->files.size() / sampleCount : 1;
+		Source* source;
+		int entry;
+		start = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < sampleCount; i++)
+			resolve(newIndex->files[i * step].first, source, entry);
+		auto lookupTime = std::chrono::steady_clock::now() - start;
+
+		std::cout << "FileIO: indexed " << newIndex->files.size() << " files from " << sources.size() << " sources in " << std::chrono::duration_cast<std::chrono::milliseconds>(buildTime).count() << "ms";
+		if (sampleCount > 0)
+			std::cout << ", an indexed lookup takes " << std::chrono::duration_cast<std::chrono::nanoseconds>(lookupTime).count() / sampleCount << "ns";
+		std::cout << std::endl;
 	}
 
-	bool FileIO::exists(const std::string& fileName)
+	std::size_t FileIO::priority(const Source* source)
 	{
-		for (auto& source : sources)
-			if (source->exists(fileName))
+		return std::find(sources.begin(), sources.end(), source) - sources.begin();
+	}
+
+	bool FileIO::resolve(const std::string& fileName, Source*& source, int& entry)
+	{
+		std::string normalized = normalizeFileName(fileName);
+		const Entry* indexed = nullptr;
+		auto idx = index.load();
+		if (idx)
+		{
+			auto it = idx->lookup.find(normalized);
+			if (it != idx->lookup.end())
+			{
+				indexed = &idx->files[it->second].second;
+				if (!lateOverrides)
+				{
+					PROFILE_COUNT("FileIO index hits", 1);
+					source = indexed->source;
+					entry = indexed->index;
+					return true;
+				}
+			}
+		}
+		{
+			std::shared_lock<std::shared_mutex> lock(lateMutex);
+			auto it = lateFiles.find(normalized);
+			if (it != lateFiles.end())
+			{
+				source = it->second.source;
+				entry = it->second.index;
 				return true;
+			}
+			if (indexed)
+			{
+				PROFILE_COUNT("FileIO index hits", 1);
+				source = indexed->source;
+				entry = indexed->index;
+				return true;
+			}
+			if (missingFiles.find(normalized) != missingFiles.end() && std::chrono::steady_clock::now() - missingSince < std::chrono::seconds(missingTimeout))
+			{
+				PROFILE_COUNT("FileIO cached misses", 1);
+				return false;
+			}
+		}
+
+		//not in the index, this can be a file that was added later, or a file in a directory that is not indexed, so ask the sources
+		auto start = std::chrono::steady_clock::now();
+		source = nullptr;
+		for (auto s : sources)
+			if (s->exists(fileName))
+			{
+				source = s;
+				break;
+			}
+		PROFILE_COUNT("FileIO source lookups", 1);
+		PROFILE_COUNT("FileIO source lookup time (us)", std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
+		std::unique_lock<std::shared_mutex> lock(lateMutex);
+		if (source)
+		{
+			lateFiles[normalized] = Entry{ source, -1, fileName };
+			entry = -1;
+			return true;
+		}
+		if (missingFiles.empty() || std::chrono::steady_clock::now() - missingSince >= std::chrono::seconds(missingTimeout))
+		{
+			missingFiles.clear();
+			missingSince = std::chrono::steady_clock::now();
+		}
+		missingFiles.insert(normalized);
 		return false;
 	}
 
+	void FileIO::addLateFile(const std::string& fileName, Source* source)
+	{
+		std::string normalized = normalizeFileName(fileName);
+		std::unique_lock<std::shared_mutex> lock(lateMutex);
+		missingFiles.erase(normalized);
+		//a new file only replaces a known one if it comes from a source with a higher priority, like a file written to the data directory over a grf file
+		auto late = lateFiles.find(normalized);
+		if (late != lateFiles.end())
+		{
+			if (priority(source) < priority(late->second.source))
+				late->second = Entry{ source, -1, fileName };
+			return;
+		}
+		auto idx = index.load();
+		if (idx)
+		{
+			auto it = idx->lookup.find(normalized);
+			if (it != idx->lookup.end())
+			{
+				if (priority(source) >= priority(idx->files[it->second].second.source))
+					return;
+				lateOverrides = true;
+			}
+		}
+		lateFiles[normalized] = Entry{ source, -1, fileName };
+	}
+
+	//adds the files that start with prefix, from the index and the files that were added later
+	void FileIO::listIndexed(const std::string& prefix, std::vector<std::string>& files)
+	{
+		auto idx = index.load();
+		if (idx)
+		{
+			auto it = std::lower_bound(idx->files.begin(), idx->files.end(), prefix, [](const auto& a, const std::string& b) { return a.first < b; });
+			for (; it != idx->files.end() && it->first.compare(0, prefix.size(), prefix) == 0; it++)
+				files.push_back(it->second.name.empty() ? it->first : it->second.name);
+		}
+		std::shared_lock<std::shared_mutex> lock(lateMutex);
+		for (auto it = lateFiles.lower_bound(prefix); it != lateFiles.end() && it->first.compare(0, prefix.size(), prefix) == 0; it++)
+			if (!idx || idx->lookup.find(it->first) == idx->lookup.end()) //overrides of indexed files are already listed
+				files.push_back(it->second.name.empty() ? it->first : it->second.name);
+	}
+
+	std::istream* FileIO::open(const std::string& fileName)
+	{
+		Source* source;
+		int entry;
+		if (!resolve(fileName, source, entry))
+			return nullptr;
+		auto stream = source->open(fileName, entry);
+		if (stream && !stream->good()) //the file was removed after it was indexed
+		{
+			delete stream;
+			return nullptr;
+		}
+		return stream;
+	}
+	bool FileIO::read(const std::string& fileName, std::vector<char>& data)
+	{
+		Source* source;
+		int entry;
+		if (!resolve(fileName, source, entry))
+			return false;
+		return source->read(fileName, entry, data);
+	}
+	FileIO::Fingerprint FileIO::fingerprint(const std::string& fileName)
+	{
+		Source* source;
+		int entry;
+		if (!resolve(fileName, source, entry))
+			return Fingerprint();
+		return source->fingerprint(fileName, entry);
+	}
+	std::string FileIO::getSrc(const std::string& fileName)
+	{
+		Source* source;
+		int entry;
+		if (resolve(fileName, source, entry))
+			return source->toString();
+		return "No Src: " + fileName;
+	}
+
+	bool FileIO::exists(const std::string& fileName)
+	{
+		Source* source;
+		int entry;
+		return resolve(fileName, source, entry);
+	}
+
+	//lists all files in this directory and its subdirectories
 	std::vector<std::string> FileIO::listFiles(const std::string& directory)
 	{
 		std::vector<std::string> files;
-		for (auto& source : sources)
-			source->listFiles(directory, files);
+		std::string prefix = normalizeFileName(directory);
+		if (!prefix.empty() && prefix.back() != '\\')
+			prefix += "\\";
+		listIndexed(prefix, files);
 		return files;
 	}
 
 	std::vector<std::string> FileIO::listAllFiles()
 	{
 		std::vector<std::string> files;
-		for (auto& source : sources)
-			source->listAllFiles(files);
+		listIndexed("", files);
 		return files;
 	}
 
@@ -79,6 +296,7 @@ namespace util
 
 	void FileIO::end()
 	{
+		buildIndex();
 		if (rootNode)
 			delete rootNode;
 		std::cout << "FileIO: building tree" << std::endl;
@@ -104,9 +322,21 @@ namespace util
 		std::cout << "FileIO: done building tree" << std::endl;
 	}
 
+	void FileIO::refresh()
+	{
+		buildIndex();
+	}
+
 	void FileIO::reload(const std::string& path)
 	{
-		auto files = listFiles(path);
+		std::vector<std::string> files;
+		for (auto source : sources)
+		{
+			std::size_t first = files.size();
+			source->listFiles(path, files);
+			for (std::size_t i = first; i < files.size(); i++)
+				addLateFile(files[i], source);
+		}
 		std::map<std::string, Node*> cache;
 		for (const auto& file : files)
 		{
@@ -125,6 +355,30 @@ namespace util
 		}
 	}
 
+	void FileIO::fileChanged(const std::string& fileName)
+	{
+		std::string normalized = normalizeFileName(fileName);
+		for (auto source : sources)
+		{
+			auto dirSource = dynamic_cast<DirSource*>(source);
+			if (!dirSource)
+				continue;
+			std::string directory = normalizeFileName(dirSource->getDirectory());
+			std::string relative;
+			if (directory == ".\\" || directory.empty())
+				relative = normalized.find(':') == std::string::npos ? normalized : "";
+			else if (normalized.compare(0, directory.size(), directory) == 0)
+				relative = normalized.substr(directory.size());
+			if (relative.size() > 2 && relative.compare(0, 2, ".\\") == 0)
+				relative = relative.substr(2);
+			if (!relative.empty() && dirSource->exists(relative))
+			{
+				addLateFile(relative, source);
+				return;
+			}
+		}
+	}
+
 	FileIO::Node* FileIO::Node::addFile(const std::string& fileName)
 	{
 		if (fileName.find("\\") == std::string::npos)
@@ -168,18 +422,6 @@ namespace util
 	}
 
 	////////GRF
-	std::string FileIO::GrfSource::sanitizeFileName(std::string fileName)
-	{
-		std::transform(fileName.begin(), fileName.end(), fileName.begin(), ::tolower);
-		std::replace(fileName.begin(), fileName.end(), '/', '\\');
-
-		std::size_t index;
-		while ((index = fileName.find("\\\\")) != std::string::npos)
-			fileName = fileName.substr(0, index) + fileName.substr(index + 1);
-		return fileName;
-	}
-
-
 	FileIO::GrfSource::GrfSource(const std::string& fileName) : grfFile(fileName)
 	{
 		grfFileName = fileName;
@@ -196,12 +438,21 @@ namespace util
 			return;
 		}
 		for (unsigned int i = 0; i < grf->nfiles; i++)
-			lookup[sanitizeFileName(grf->files[i].name)] = i;
+			lookup[normalizeFileName(grf->files[i].name)] = i;
 		std::cout << "GRF: " << lookup.size() << " files loaded" << std::endl;
+		MemoryTracker::addEvictor(this, "GRF cache", [this](std::size_t bytes)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			std::size_t freed = grf_cache_free(grf, bytes);
+			cache.set(cache.get() - std::min(cache.get(), freed));
+			return freed;
+		});
 	}
 
 	void FileIO::GrfSource::close()
 	{
+		MemoryTracker::remove(this);
+		cache.set(0);
 		grf_close(grf);
 		grf = nullptr;
 	}
@@ -210,21 +461,69 @@ namespace util
 	{
 		if (!grf)
 			throw "error";
-		auto it = lookup.find(sanitizeFileName(fileName));
+		auto it = lookup.find(normalizeFileName(fileName));
 		if (it == lookup.end())
 			throw "error";
 
+		return open(fileName, it->second);
+	}
+
+	std::istream* FileIO::GrfSource::open(const std::string& fileName, int entry)
+	{
+		if (!grf || entry < 0 || entry >= (int)grf->nfiles)
+			throw "error";
+		std::lock_guard<std::mutex> lock(mutex);
 		GrfError error;
 		unsigned int size = 0;
-		char* data = (char*)grf_index_get(grf, it->second, &size, &error);
+		bool cached = grf->files[entry].data != nullptr;
+		char* data = (char*)grf_index_get(grf, entry, &size, &error);
+		if (!cached && grf->files[entry].data)
+			cache.set(cache.get() + grf->files[entry].real_len + 1);
 		auto ss = new std::istringstream(std::string(data, size));
-		//todo: check if data should really not be freed
+		//the data is owned by grflib, it's kept until the GRF cache goes over its budget
 		return ss;
 	}
 
+	//copies the data once, straight from grflib. The data can't be handed out directly, the GRF cache can free it while it's being read
+	bool FileIO::GrfSource::read(const std::string& fileName, int entry, std::vector<char>& data)
+	{
+		if (!grf || entry < 0 || entry >= (int)grf->nfiles)
+			return false;
+		std::lock_guard<std::mutex> lock(mutex);
+		GrfError error;
+		unsigned int size = 0;
+		bool cached = grf->files[entry].data != nullptr;
+		char* fileData = (char*)grf_index_get(grf, entry, &size, &error);
+		if (!fileData)
+			return false;
+		if (!cached && grf->files[entry].data)
+			cache.set(cache.get() + grf->files[entry].real_len + 1);
+		data.assign(fileData, fileData + size);
+		return true;
+	}
+
+	//files in a GRF don't change while it's open, but the same name can point to another entry after a refresh
+	FileIO::Fingerprint FileIO::GrfSource::fingerprint(const std::string& fileName, int entry)
+	{
+		Fingerprint ret;
+		if (entry < 0)
+		{
+			auto it = lookup.find(normalizeFileName(fileName));
+			if (it == lookup.end())
+				return ret;
+			entry = it->second;
+		}
+		if (!grf || entry >= (int)grf->nfiles)
+			return ret;
+		ret.source = this;
+		ret.size = grf->files[entry].real_len;
+		ret.stamp = grf->files[entry].pos;
+		return ret;
+	}
+
 	bool FileIO::GrfSource::exists(const std::string& fileName)
 	{
-		return lookup.find(sanitizeFileName(fileName)) != lookup.end();
+		return lookup.find(normalizeFileName(fileName)) != lookup.end();
 	}
 
 	void FileIO::GrfSource::listFiles(const std::string& directory, std::vector<std::string>& files)
@@ -250,6 +549,30 @@ namespace util
 			files.push_back(kv.first);
 	}
 
+	void FileIO::GrfSource::listEntries(std::vector<std::pair<std::string, int>>& entries)
+	{
+		for (const auto& kv : lookup)
+			entries.push_back(kv);
+	}
+
+	bool FileIO::Source::read(const std::string& fileName, int entry, std::vector<char>& data)
+	{
+		auto file = open(fileName, entry);
+		if (!file)
+			return false;
+		data.assign(std::istreambuf_iterator<char>(*file), std::istreambuf_iterator<char>());
+		delete file;
+		return true;
+	}
+
+	void FileIO::Source::listEntries(std::vector<std::pair<std::string, int>>& entries)
+	{
+		std::vector<std::string> files;
+		listAllFiles(files);
+		for (const auto& f : files)
+			entries.push_back(std::pair<std::string, int>(f, -1));
+	}
+
 	std::string FileIO::GrfSource::toString()
 	{
 		return "Grf: " + this->grfFileName;
@@ -269,6 +592,38 @@ namespace util
 		return new std::ifstream(directory + fileName, std::ios_base::in | std::ios_base::binary);
 	}
 
+	bool FileIO::DirSource::read(const std::string& fileName, int entry, std::vector<char>& data)
+	{
+		std::ifstream file(directory + fileName, std::ios_base::in | std::ios_base::binary);
+		if (!file)
+			return false;
+		file.seekg(0, std::ios_base::end);
+		auto length = file.tellg();
+		file.seekg(0, std::ios_base::beg);
+		if (length < 0)
+			return false;
+		data.resize((std::size_t)length);
+		file.read(data.data(), length);
+		data.resize((std::size_t)file.gcount());
+		return true;
+	}
+
+	FileIO::Fingerprint FileIO::DirSource::fingerprint(const std::string& fileName, int entry)
+	{
+		Fingerprint ret;
+		std::error_code ec;
+		auto size = std::filesystem::file_size(directory + fileName, ec);
+		if (ec)
+			return ret;
+		auto time = std::filesystem::last_write_time(directory + fileName, ec);
+		if (ec)
+			return ret;
+		ret.source = this;
+		ret.size = size;
+		ret.stamp = time.time_since_epoch().count();
+		return ret;
+	}
+
 	bool FileIO::DirSource::exists(const std::string& fileName)
 	{
 		if (fileName == "")
@@ -361,6 +716,37 @@ namespace util
 		delete[] buf;
 	}
 
+	bool FileIO::writeFileAtomic(const std::string& fileName, const char* data, std::size_t size)
+	{
+		std::string tmpFileName = fileName + ".tmp";
+		{
+			std::ofstream file(tmpFileName.c_str(), std::ios_base::binary | std::ios_base::out);
+			if (!file.is_open())
+			{
+				std::cerr << "FileIO: Unable to open " << tmpFileName << " for writing" << std::endl;
+				return false;
+			}
+			file.write(data, size);
+			if (!file.good())
+			{
+				std::cerr << "FileIO: Error writing to " << tmpFileName << std::endl;
+				file.close();
+				std::filesystem::remove(tmpFileName);
+				return false;
+			}
+		}
+		std::error_code ec;
+		std::filesystem::rename(tmpFileName, fileName, ec);
+		if (ec)
+		{
+			std::cerr << "FileIO: Unable to move " << tmpFileName << " to " << fileName << ": " << ec.message() << std::endl;
+			std::filesystem::remove(tmpFileName, ec);
+			return false;
+		}
+		fileChanged(fileName);
+		return true;
+	}
+
 	nlohmann::json FileIO::getJson(const std::string& fileName)
 	{
 		nlohmann::json ret;
@@ -5,20 +5,45 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <shared_mutex>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
 #include <grf.h>
+#include <browedit/util/MemoryTracker.h>
 
 namespace util
 {
 	class FileIO
 	{
+	public:
+		//identifies the version of a file, to see if it changed without reading it
+		class Fingerprint
+		{
+		public:
+			const void* source = nullptr; //nullptr when the file could not be found
+			std::uint64_t size = 0;
+			std::int64_t stamp = 0; //modification time for files in a directory, position in the archive for GRFs
+			bool operator==(const Fingerprint& other) const { return source == other.source && size == other.size && stamp == other.stamp; }
+			bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+		};
+	private:
 		class Source
 		{
 		public:
 			virtual bool exists(const std::string& file) = 0;
 			virtual std::istream* open(const std::string& file) = 0;
+			virtual std::istream* open(const std::string& file, int entry) { return open(file); } //entry is the index from listEntries
+			virtual bool read(const std::string& file, int entry, std::vector<char>& data); //reads the whole file into one buffer
+			virtual Fingerprint fingerprint(const std::string& file, int entry) = 0;
 			virtual void close() = 0;
 			virtual void listFiles(const std::string& directory, std::vector<std::string>&) = 0;
 			virtual void listAllFiles(std::vector<std::string>&) = 0;
+			virtual void listEntries(std::vector<std::pair<std::string, int>>& entries);
 			virtual std::string toString() = 0;
 		};
 		class GrfSource : public Source
@@ -28,16 +53,20 @@ namespace util
 			std::string grfFileName;
 			Grf* grf;
 			std::map<std::string, int> lookup;
+			std::mutex mutex; //grflib is not thread safe, and the extracted files can be freed from the main thread
+			TrackedMemory cache{ "GRF cache" }; //grflib keeps every file it extracted in memory
 		public:
 			GrfSource(const std::string& grfFile);
 			bool exists(const std::string& file) override;
 			std::istream* open(const std::string& file) override;
+			std::istream* open(const std::string& file, int entry) override;
+			bool read(const std::string& file, int entry, std::vector<char>& data) override;
+			Fingerprint fingerprint(const std::string& file, int entry) override;
 			void close() override;
 			void listFiles(const std::string& directory, std::vector<std::string>&) override;
 			void listAllFiles(std::vector<std::string>&) override;
+			void listEntries(std::vector<std::pair<std::string, int>>& entries) override;
 			virtual std::string toString() override;
-		private:
-			std::string sanitizeFileName(std::string fileName);
 		};
 		class DirSource : public Source
 		{
@@ -45,8 +74,11 @@ namespace util
 			std::string directory;
 		public:
 			DirSource(const std::string& directory);
+			const std::string& getDirectory() const { return directory; }
 			bool exists(const std::string& file) override;
 			std::istream* open(const std::string& file) override;
+			bool read(const std::string& file, int entry, std::vector<char>& data) override;
+			Fingerprint fingerprint(const std::string& file, int entry) override;
 			void close() override;
 			void listFiles(const std::string& directory, std::vector<std::string>&) override;
 			void listAllFiles(std::vector<std::string>&) override;
@@ -54,6 +86,39 @@ namespace util
 		};
 
 		static std::vector<Source*> sources;
+
+		//Merged index of the files in all sources, so a lookup doesn't have to ask every source.
+		//Built in end() and never changed after that, so it can be read from any thread without locking
+		class Entry
+		{
+		public:
+			Source* source;
+			int index;			//entry in the source, -1 if the source doesn't use it
+			std::string name;	//name as the source lists it, empty when it is the same as the normalized name
+		};
+		class Index
+		{
+		public:
+			std::vector<std::pair<std::string, Entry>> files; //sorted on normalized name
+			std::unordered_map<std::string_view, std::size_t> lookup; //views point into files
+		};
+		static inline std::atomic<const Index*> index = nullptr;
+		static inline std::vector<const Index*> oldIndices; //not freed until the next begin(), other threads might still be reading them
+
+		//Files that were added after the index was built (by reload or by writing them), and names that couldn't be found.
+		//Only used when the index misses or a late file overrides an indexed one, so these have a lock. Missing names are forgotten after a while, as files can be copied in while running
+		static inline std::shared_mutex lateMutex;
+		static inline std::map<std::string, Entry> lateFiles;
+		static inline std::atomic<bool> lateOverrides = false; //a late file replaces an index entry of a lower priority source, so lateFiles has to be checked first
+		static inline std::unordered_set<std::string> missingFiles;
+		static inline std::chrono::steady_clock::time_point missingSince;
+		static constexpr int missingTimeout = 5; //in seconds
+
+		static void buildIndex();
+		static bool resolve(const std::string& fileName, Source*& source, int& entry);
+		static void addLateFile(const std::string& fileName, Source* source);
+		static std::size_t priority(const Source* source); //lower is more important, the order the sources were added in
+		static void listIndexed(const std::string& prefix, std::vector<std::string>& files);
 	public:
 		// initialisation
 		static void begin();
@@ -62,9 +127,14 @@ namespace util
 		static void end();
 
 		static void reload(const std::string&); // to reload a path
+		static void refresh(); // rebuilds the file index from all sources
+		static void fileChanged(const std::string& fileName); // call after writing a file, so it can be found if it's in one of the directories
+		static std::string normalizeFileName(std::string fileName); // lowercase, with single backslashes
 
 		// FileIO for opening from GRF
 		static std::istream* open(const std::string& fileName);
+		static bool read(const std::string& fileName, std::vector<char>& data); // reads a whole file into one buffer, for util::ByteReader
+		static Fingerprint fingerprint(const std::string& fileName); // cheap, doesn't read the file
 		static bool exists(const std::string& fileName);
 		static std::vector<std::string> listFiles(const std::string& directory);
 		static std::vector<std::string> listAllFiles();
@@ -74,6 +144,7 @@ namespace util
 		static std::string readString(std::istream* is, int maxLength, int length = -1);
 		static std::string readStringDyn(std::istream* is);
 		static void writeString(std::ostream& os, const std::string &data, int length);
+		static bool writeFileAtomic(const std::string& fileName, const char* data, std::size_t size); // writes to a temporary file first, then renames it over the destination
 		static nlohmann::json getJson(const std::string& fileName);
 		static std::string getString(const std::string& fileName);
 
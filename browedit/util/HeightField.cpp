@@ -0,0 +1,179 @@
+#include "HeightField.h"
+#include <limits>
+
+namespace util
+{
+	HeightField::HeightField(const std::vector<glm::ivec2>& tiles, const glm::ivec2& mapSize, int border)
+	{
+		min = mapSize;
+		max = glm::ivec2(-1);
+		for (const auto& t : tiles)
+		{
+			min = glm::min(min, t);
+			max = glm::max(max, t);
+		}
+		if (tiles.empty())
+			return;
+		min = glm::max(glm::ivec2(0), min - border);
+		max = glm::min(mapSize - 1, max + border);
+		width = glm::max(0, max.x - min.x + 1);
+		height = glm::max(0, max.y - min.y + 1);
+		mask.resize(width * height, 0);
+		for (const auto& t : tiles)
+			if (inside(t.x, t.y))
+				mask[index(t.x, t.y)] = 1;
+	}
+
+	//adds the left and right neighbour to every value
+	static void boxRows(std::vector<float>& values, std::vector<float>& tmp, int w, int h)
+	{
+		tmp = values;
+		for (int y = 0; y < h; y++)
+		{
+			const float* in = &tmp[y * w];
+			float* out = &values[y * w];
+			for (int x = 1; x < w; x++)
+				out[x] += in[x - 1];
+			for (int x = 0; x < w - 1; x++)
+				out[x] += in[x + 1];
+		}
+	}
+
+	//adds the values above and below to every value
+	static void boxColumns(std::vector<float>& values, std::vector<float>& tmp, int w, int h)
+	{
+		tmp = values;
+		for (int y = 0; y < h; y++)
+		{
+			float* out = &values[y * w];
+			if (y > 0)
+			{
+				const float* in = &tmp[(y - 1) * w];
+				for (int x = 0; x < w; x++)
+					out[x] += in[x];
+			}
+			if (y < h - 1)
+			{
+				const float* in = &tmp[(y + 1) * w];
+				for (int x = 0; x < w; x++)
+					out[x] += in[x];
+			}
+		}
+	}
+
+	void HeightField::smooth(int axis)
+	{
+		if (empty())
+			return;
+		const int pw = width + 1;
+		const int ph = height + 1;
+		//average height of the selected corners at every point of the corner grid, and if there are any
+		std::vector<float> sum(pw * ph, 0.0f);
+		std::vector<float> count(pw * ph, 0.0f);
+		for (int i = 0; i < 4; i++)
+			for (int y = 0; y < height; y++)
+			{
+				const float* h = &heights[i][y * width];
+				const std::uint8_t* m = &mask[y * width];
+				float* s = &sum[(i % 2) + (y + i / 2) * pw];
+				float* c = &count[(i % 2) + (y + i / 2) * pw];
+				for (int x = 0; x < width; x++)
+				{
+					float w = m[x] ? 1.0f : 0.0f;
+					s[x] += h[x] * w;
+					c[x] += w;
+				}
+			}
+		for (int p = 0; p < pw * ph; p++)
+		{
+			bool used = count[p] > 0;
+			sum[p] = used ? sum[p] / count[p] : 0.0f;
+			count[p] = used ? 1.0f : 0.0f;
+		}
+
+		//box filter over the points that have a height, split in a horizontal and vertical pass
+		std::vector<float> tmp;
+		if (axis & 1)
+		{
+			boxRows(sum, tmp, pw, ph);
+			boxRows(count, tmp, pw, ph);
+		}
+		if (axis & 2)
+		{
+			boxColumns(sum, tmp, pw, ph);
+			boxColumns(count, tmp, pw, ph);
+		}
+
+		for (int i = 0; i < 4; i++)
+			for (int y = 0; y < height; y++)
+			{
+				float* h = &heights[i][y * width];
+				const std::uint8_t* m = &mask[y * width];
+				const float* s = &sum[(i % 2) + (y + i / 2) * pw];
+				const float* c = &count[(i % 2) + (y + i / 2) * pw];
+				for (int x = 0; x < width; x++)
+					h[x] = (m[x] && c[x] > 0) ? s[x] / c[x] : h[x];
+			}
+	}
+
+	void HeightField::flatten()
+	{
+		float total = 0;
+		int count = 0;
+		for (int i = 0; i < 4; i++)
+			for (int c = 0; c < width * height; c++)
+				total += mask[c] ? heights[i][c] : 0.0f;
+		for (int c = 0; c < width * height; c++)
+			count += mask[c];
+		if (count == 0)
+			return;
+		float avg = total / (count * 4);
+		for (int i = 0; i < 4; i++)
+			for (int c = 0; c < width * height; c++)
+				heights[i][c] = mask[c] ? avg : heights[i][c];
+	}
+
+	void HeightField::connect(bool high)
+	{
+		if (empty())
+			return;
+		const int pw = width + 1;
+		const int ph = height + 1;
+		std::vector<float> extreme(pw * ph, high ? std::numeric_limits<float>::max() : -std::numeric_limits<float>::max());
+		for (int i = 0; i < 4; i++)
+			for (int y = 0; y < height; y++)
+			{
+				const float* h = &heights[i][y * width];
+				float* e = &extreme[(i % 2) + (y + i / 2) * pw];
+				if (high)
+					for (int x = 0; x < width; x++)
+						e[x] = glm::min(e[x], h[x]);
+				else
+					for (int x = 0; x < width; x++)
+						e[x] = glm::max(e[x], h[x]);
+			}
+		for (int i = 0; i < 4; i++)
+			for (int y = 0; y < height; y++)
+			{
+				float* h = &heights[i][y * width];
+				const std::uint8_t* m = &mask[y * width];
+				const float* e = &extreme[(i % 2) + (y + i / 2) * pw];
+				for (int x = 0; x < width; x++)
+					h[x] = m[x] ? e[x] : h[x];
+			}
+	}
+
+	void HeightField::add(const std::vector<float>& cornerValues, float scale)
+	{
+		const int pw = width + 1;
+		for (int i = 0; i < 4; i++)
+			for (int y = 0; y < height; y++)
+			{
+				float* h = &heights[i][y * width];
+				const std::uint8_t* m = &mask[y * width];
+				const float* v = &cornerValues[(i % 2) + (y + i / 2) * pw];
+				for (int x = 0; x < width; x++)
+					h[x] += m[x] ? v[x] * scale : 0.0f;
+			}
+	}
+}
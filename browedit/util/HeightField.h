@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace util
+{
+	//Flat working copy of a rectangle of terrain, for the height tools. The 4 corner heights of every cell are stored in 4 planes,
+	//in the same order as the cube heights (0 1 / 2 3), and a mask marks the selected cells, so the tools don't have to search the selection.
+	//The kernels loop over whole rows of these planes so they can be vectorized, and only the selected cells are written back
+	class HeightField
+	{
+	public:
+		glm::ivec2 min; //first cell in the map
+		glm::ivec2 max; //last cell in the map, inclusive
+		int width = 0;
+		int height = 0;
+		std::vector<float> heights[4];
+		std::vector<std::uint8_t> mask;
+
+		//covers the bounding rectangle of the tiles, plus a border of unselected cells, clipped to the map
+		HeightField(const std::vector<glm::ivec2>& tiles, const glm::ivec2& mapSize, int border = 0);
+
+		inline bool empty() const { return width <= 0 || height <= 0; }
+		inline bool inside(int x, int y) const { return x >= min.x && x <= max.x && y >= min.y && y <= max.y; }
+		inline int index(int x, int y) const { return (x - min.x) + (y - min.y) * width; }
+		inline bool selected(int x, int y) const { return inside(x, y) && mask[index(x, y)] != 0; }
+
+		//cubes is indexed [x][y], like Gnd::cubes and Gat::cubes
+		template<class T>
+		void read(const std::vector<std::vector<T*>>& cubes)
+		{
+			for (int i = 0; i < 4; i++)
+				heights[i].resize(width * height);
+			for (int y = 0; y < height; y++)
+				for (int x = 0; x < width; x++)
+					for (int i = 0; i < 4; i++)
+						heights[i][x + y * width] = cubes[min.x + x][min.y + y]->heights[i];
+		}
+		template<class T>
+		void write(std::vector<std::vector<T*>>& cubes) const
+		{
+			for (int y = 0; y < height; y++)
+				for (int x = 0; x < width; x++)
+					if (mask[x + y * width])
+						for (int i = 0; i < 4; i++)
+							cubes[min.x + x][min.y + y]->heights[i] = heights[i][x + y * width];
+		}
+
+		//Averages every corner of the selected cells with the corners around it. Bit 1 of axis smooths along x, bit 2 along y
+		void smooth(int axis);
+		//Sets all selected corners to the average height of the selection
+		void flatten();
+		//Sets every selected corner to the highest (or lowest) ground of all corners at the same point, also the ones of unselected cells.
+		//Heights point down, so the highest ground is the lowest value
+		void connect(bool high);
+		//Adds values sampled on the corner grid, which has (width+1)*(height+1) points
+		void add(const std::vector<float>& cornerValues, float scale);
+	};
+}
@@ -0,0 +1,539 @@
+#include "Lua.h"
+#include <browedit/util/ByteStream.h>
+#include <variant>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+namespace util
+{
+	namespace
+	{
+		class LuaTable;
+		using LuaValue = std::variant<std::monostate, bool, double, std::string, std::shared_ptr<LuaTable>>;
+
+		//keeps the entries in the order they are set in, data files are small enough that a linear search is fine
+		class LuaTable
+		{
+		public:
+			std::vector<std::pair<LuaValue, LuaValue>> entries;
+
+			void set(const LuaValue& key, const LuaValue& value)
+			{
+				if (std::holds_alternative<std::monostate>(key))
+					throw std::runtime_error("lua: table index is nil");
+				for (auto& e : entries)
+				{
+					if (e.first == key)
+					{
+						e.second = value;
+						return;
+					}
+				}
+				entries.push_back(std::pair<LuaValue, LuaValue>(key, value));
+			}
+			LuaValue get(const LuaValue& key) const
+			{
+				for (const auto& e : entries)
+					if (e.first == key)
+						return e.second;
+				return LuaValue();
+			}
+		};
+
+		LuaTable& toTable(const LuaValue& value)
+		{
+			auto table = std::get_if<std::shared_ptr<LuaTable>>(&value);
+			if (!table)
+				throw std::runtime_error("lua: attempt to index a non-table value");
+			return **table;
+		}
+
+		double toNumber(const LuaValue& value)
+		{
+			auto number = std::get_if<double>(&value);
+			if (!number)
+				throw std::runtime_error("lua: attempt to perform arithmetic on a non-number value");
+			return *number;
+		}
+
+		nlohmann::json toJson(const LuaValue& value)
+		{
+			if (auto b = std::get_if<bool>(&value))
+				return *b;
+			if (auto d = std::get_if<double>(&value))
+			{
+				if (*d == std::floor(*d) && std::abs(*d) < 9007199254740992.0)
+					return (std::int64_t)*d;
+				return *d;
+			}
+			if (auto s = std::get_if<std::string>(&value))
+				return *s;
+			if (auto t = std::get_if<std::shared_ptr<LuaTable>>(&value))
+			{
+				const auto& entries = (*t)->entries;
+				bool stringKeys = !entries.empty() && std::all_of(entries.begin(), entries.end(), [](const std::pair<LuaValue, LuaValue>& e) { return std::holds_alternative<std::string>(e.first); });
+				if (stringKeys)
+				{
+					nlohmann::json ret = nlohmann::json::object();
+					for (const auto& e : entries)
+						ret[std::get<std::string>(e.first)] = toJson(e.second);
+					return ret;
+				}
+				std::vector<const std::pair<LuaValue, LuaValue>*> numbered;
+				for (const auto& e : entries)
+					if (std::holds_alternative<double>(e.first))
+						numbered.push_back(&e);
+				std::stable_sort(numbered.begin(), numbered.end(), [](auto a, auto b) { return std::get<double>(a->first) < std::get<double>(b->first); });
+				nlohmann::json ret = nlohmann::json::array();
+				for (auto e : numbered)
+					ret.push_back(toJson(e->second));
+				return ret;
+			}
+			return nullptr;
+		}
+
+		//Parses lua source, only global assignments with constant expressions and table constructors
+		class LuaSourceParser
+		{
+			const std::string& src;
+			std::size_t pos = 0;
+			LuaTable& globals;
+
+			[[noreturn]] void error(const std::string& message)
+			{
+				int line = 1 + (int)std::count(src.begin(), src.begin() + std::min(pos, src.size()), '\n');
+				throw std::runtime_error("lua: line " + std::to_string(line) + ": " + message);
+			}
+
+			//returns the level of a long bracket ([[ or [==[) at the current position, or -1 if there is none
+			int longBracketLevel()
+			{
+				if (pos >= src.size() || src[pos] != '[')
+					return -1;
+				std::size_t i = pos + 1;
+				while (i < src.size() && src[i] == '=')
+					i++;
+				if (i < src.size() && src[i] == '[')
+					return (int)(i - pos - 1);
+				return -1;
+			}
+
+			std::string readLongString(int level)
+			{
+				pos += level + 2;
+				if (pos < src.size() && src[pos] == '\r')
+					pos++;
+				if (pos < src.size() && src[pos] == '\n')
+					pos++;
+				std::string close = "]" + std::string(level, '=') + "]";
+				std::size_t end = src.find(close, pos);
+				if (end == std::string::npos)
+					error("unfinished long string");
+				std::string ret = src.substr(pos, end - pos);
+				pos = end + close.size();
+				return ret;
+			}
+
+			void skipWhitespace()
+			{
+				while (pos < src.size())
+				{
+					if (isspace((unsigned char)src[pos]))
+						pos++;
+					else if (src.compare(pos, 2, "--") == 0)
+					{
+						pos += 2;
+						int level = longBracketLevel();
+						if (level >= 0)
+							readLongString(level);
+						else
+							while (pos < src.size() && src[pos] != '\n')
+								pos++;
+					}
+					else
+						break;
+				}
+			}
+
+			bool accept(const char* token)
+			{
+				skipWhitespace();
+				std::size_t length = strlen(token);
+				if (src.compare(pos, length, token) != 0)
+					return false;
+				if (isalpha((unsigned char)token[0]) && pos + length < src.size() && (isalnum((unsigned char)src[pos + length]) || src[pos + length] == '_'))
+					return false; //only a prefix of a longer name
+				pos += length;
+				return true;
+			}
+
+			void expect(const char* token)
+			{
+				if (!accept(token))
+					error(std::string("expected '") + token + "'");
+			}
+
+			bool isNameStart()
+			{
+				skipWhitespace();
+				return pos < src.size() && (isalpha((unsigned char)src[pos]) || src[pos] == '_');
+			}
+
+			std::string readName()
+			{
+				if (!isNameStart())
+					error("expected a name");
+				std::size_t begin = pos;
+				while (pos < src.size() && (isalnum((unsigned char)src[pos]) || src[pos] == '_'))
+					pos++;
+				return src.substr(begin, pos - begin);
+			}
+
+			std::string readQuotedString()
+			{
+				char quote = src[pos++];
+				std::string ret;
+				while (true)
+				{
+					if (pos >= src.size() || src[pos] == '\n')
+						error("unfinished string");
+					char c = src[pos++];
+					if (c == quote)
+						break;
+					if (c != '\\')
+					{
+						ret += c;
+						continue;
+					}
+					if (pos >= src.size())
+						error("unfinished string");
+					c = src[pos++];
+					switch (c)
+					{
+					case 'n':	ret += '\n'; break;
+					case 't':	ret += '\t'; break;
+					case 'r':	ret += '\r'; break;
+					case 'a':	ret += '\a'; break;
+					case 'b':	ret += '\b'; break;
+					case 'f':	ret += '\f'; break;
+					case 'v':	ret += '\v'; break;
+					default:
+						if (isdigit((unsigned char)c))
+						{
+							int value = c - '0';
+							for (int i = 0; i < 2 && pos < src.size() && isdigit((unsigned char)src[pos]); i++)
+								value = value * 10 + (src[pos++] - '0');
+							if (value > 255)
+								error("escape sequence too large");
+							ret += (char)value;
+						}
+						else
+							ret += c; // \\, \", \', and an escaped newline
+					}
+				}
+				return ret;
+			}
+
+			double readNumber()
+			{
+				const char* begin = src.c_str() + pos;
+				char* end = nullptr;
+				double value;
+				if (src.compare(pos, 2, "0x") == 0 || src.compare(pos, 2, "0X") == 0)
+					value = (double)strtoull(begin, &end, 16);
+				else
+					value = strtod(begin, &end);
+				if (end == begin)
+					error("malformed number");
+				pos += end - begin;
+				return value;
+			}
+
+			LuaValue readExpression()
+			{
+				skipWhitespace();
+				if (pos >= src.size())
+					error("unexpected end of file");
+				char c = src[pos];
+				if (accept("-"))
+					return -toNumber(readExpression());
+				if (c == '"' || c == '\'')
+					return readQuotedString();
+				int level = longBracketLevel();
+				if (level >= 0)
+					return readLongString(level);
+				if (c == '{')
+					return readTable();
+				if (isdigit((unsigned char)c) || (c == '.' && pos + 1 < src.size() && isdigit((unsigned char)src[pos + 1])))
+					return readNumber();
+				if (isNameStart())
+				{
+					std::string name = readName();
+					if (name == "nil")
+						return LuaValue();
+					if (name == "true")
+						return true;
+					if (name == "false")
+						return false;
+					return globals.get(name);
+				}
+				error(std::string("unexpected symbol '") + c + "'");
+			}
+
+			LuaValue readTable()
+			{
+				expect("{");
+				auto table = std::make_shared<LuaTable>();
+				int index = 1;
+				while (!accept("}"))
+				{
+					skipWhitespace();
+					if (pos < src.size() && src[pos] == '[' && longBracketLevel() < 0)
+					{
+						pos++;
+						LuaValue key = readExpression();
+						expect("]");
+						expect("=");
+						table->set(key, readExpression());
+					}
+					else if (isNameStart())
+					{
+						std::size_t start = pos;
+						std::string name = readName();
+						skipWhitespace();
+						if (src.compare(pos, 1, "=") == 0 && src.compare(pos, 2, "==") != 0)
+						{
+							pos++;
+							table->set(name, readExpression());
+						}
+						else
+						{
+							pos = start;
+							table->set((double)index++, readExpression());
+						}
+					}
+					else
+						table->set((double)index++, readExpression());
+
+					if (!accept(",") && !accept(";"))
+					{
+						expect("}");
+						break;
+					}
+				}
+				return table;
+			}
+
+		public:
+			LuaSourceParser(const std::string& src, LuaTable& globals) : src(src), globals(globals) {}
+
+			void parse()
+			{
+				if (src.compare(0, 3, "\xEF\xBB\xBF") == 0) //utf8 BOM
+					pos = 3;
+				while (true)
+				{
+					skipWhitespace();
+					if (pos >= src.size())
+						break;
+					if (accept(";"))
+						continue;
+					accept("local");
+					std::string name = readName();
+					expect("=");
+					globals.set(name, readExpression());
+				}
+			}
+		};
+
+		//Reads a lua 5.1 binary chunk, and runs the main function with only the instructions needed to build constant tables.
+		//Everything else (function calls, closures, jumps and loops) is skipped, registers it would have set become nil
+		class LuaBytecodeReader
+		{
+			class Function
+			{
+			public:
+				std::vector<std::uint32_t> code;
+				std::vector<LuaValue> constants;
+				std::vector<int> upvalueCounts; //of the nested functions, CLOSURE is followed by 1 instruction per upvalue
+			};
+
+			ByteReader reader;
+			std::size_t sizeofSizeT = 4;
+			LuaTable& globals;
+
+			std::size_t readSizeT()
+			{
+				if (sizeofSizeT == 8)
+					return (std::size_t)reader.read<std::uint64_t>();
+				return reader.read<std::uint32_t>();
+			}
+
+			std::string readString()
+			{
+				std::size_t length = readSizeT();
+				if (length == 0)
+					return "";
+				std::string ret = reader.readString(length);
+				return ret;
+			}
+
+			int readCount()
+			{
+				int count = reader.read<std::int32_t>();
+				if (count < 0)
+					throw std::runtime_error("lua: negative count in bytecode");
+				return count;
+			}
+
+			int readFunction(Function& f)
+			{
+				readString(); //source
+				reader.skip(4 + 4); //line defined, last line defined
+				int upvalueCount = reader.read<unsigned char>();
+				reader.skip(3); //parameter count, vararg flag, max stack size
+
+				int count = readCount();
+				reader.readArray(f.code, count);
+
+				count = readCount();
+				for (int i = 0; i < count; i++)
+				{
+					char type = reader.read<char>();
+					switch (type)
+					{
+					case 0:	f.constants.push_back(LuaValue()); break;
+					case 1:	f.constants.push_back(reader.read<char>() != 0); break;
+					case 3:	f.constants.push_back(reader.read<double>()); break;
+					case 4:	f.constants.push_back(readString()); break;
+					default:
+						throw std::runtime_error("lua: unknown constant type " + std::to_string((int)type));
+					}
+				}
+
+				count = readCount(); //nested functions are never called, but still have to be read past
+				for (int i = 0; i < count; i++)
+				{
+					Function sub;
+					f.upvalueCounts.push_back(readFunction(sub));
+				}
+
+				reader.skip(readCount() * (std::size_t)4); //line info
+				count = readCount(); //local variables
+				for (int i = 0; i < count; i++)
+				{
+					readString();
+					reader.skip(8);
+				}
+				count = readCount(); //upvalue names
+				for (int i = 0; i < count; i++)
+					readString();
+				return upvalueCount;
+			}
+
+			void run(const Function& f)
+			{
+				std::vector<LuaValue> r(256 + 1);
+				auto constant = [&](int index) -> const LuaValue& { return f.constants.at(index); };
+				auto rk = [&](int x) -> const LuaValue& { return (x & 0x100) ? constant(x & 0xFF) : r.at(x); };
+
+				for (std::size_t pc = 0; pc < f.code.size(); pc++)
+				{
+					std::uint32_t i = f.code[pc];
+					int op = i & 0x3F;
+					int a = (i >> 6) & 0xFF;
+					int c = (i >> 14) & 0x1FF;
+					int b = (i >> 23) & 0x1FF;
+					int bx = (int)(i >> 14);
+					try
+					{
+						switch (op)
+						{
+						case 0: /* MOVE */		r.at(a) = r.at(b); break;
+						case 1: /* LOADK */		r.at(a) = constant(bx); break;
+						case 2: /* LOADBOOL */	r.at(a) = b != 0; if (c) pc++; break;
+						case 3: /* LOADNIL */	for (int j = a; j <= b; j++) r.at(j) = LuaValue(); break;
+						case 5: /* GETGLOBAL */	r.at(a) = globals.get(constant(bx)); break;
+						case 6: /* GETTABLE */	r.at(a) = toTable(r.at(b)).get(rk(c)); break;
+						case 7: /* SETGLOBAL */	globals.set(constant(bx), r.at(a)); break;
+						case 9: /* SETTABLE */	toTable(r.at(a)).set(rk(b), rk(c)); break;
+						case 10: /* NEWTABLE */	r.at(a) = std::make_shared<LuaTable>(); break;
+						case 12: /* ADD */		r.at(a) = toNumber(rk(b)) + toNumber(rk(c)); break;
+						case 13: /* SUB */		r.at(a) = toNumber(rk(b)) - toNumber(rk(c)); break;
+						case 14: /* MUL */		r.at(a) = toNumber(rk(b)) * toNumber(rk(c)); break;
+						case 15: /* DIV */		r.at(a) = toNumber(rk(b)) / toNumber(rk(c)); break;
+						case 16: /* MOD */		r.at(a) = toNumber(rk(b)) - std::floor(toNumber(rk(b)) / toNumber(rk(c))) * toNumber(rk(c)); break;
+						case 17: /* POW */		r.at(a) = std::pow(toNumber(rk(b)), toNumber(rk(c))); break;
+						case 18: /* UNM */		r.at(a) = -toNumber(r.at(b)); break;
+						case 34: /* SETLIST */
+							if (c == 0)
+								c = (int)f.code.at(++pc);
+							//b == 0 means the values come from a function call or vararg, those are not evaluated
+							for (int j = 1; j <= b; j++)
+								toTable(r.at(a)).set((double)((c - 1) * 50 + j), r.at(a + j));
+							break;
+						case 30: /* RETURN */	return;
+						case 36: /* CLOSURE */
+							r.at(a) = LuaValue();
+							pc += f.upvalueCounts.at(bx); //skip the instructions that pass the upvalues
+							break;
+						case 4: /* GETUPVAL */ case 11: /* SELF */ case 19: /* NOT */ case 20: /* LEN */ case 21: /* CONCAT */
+						case 27: /* TESTSET */ case 28: /* CALL */ case 29: /* TAILCALL */ case 37: /* VARARG */
+							r.at(a) = LuaValue(); //result is not evaluated
+							break;
+						default: //jumps, compares, loops and setting upvalues, the code just continues with the next instruction
+							break;
+						}
+					}
+					catch (const std::runtime_error&)
+					{ //indexing or doing math on a value that was not evaluated, like the result of a function
+						if (op != 7 && op != 9 && op != 34 && a < (int)r.size())
+							r[a] = LuaValue();
+					}
+				}
+			}
+
+		public:
+			LuaBytecodeReader(const std::string& data, LuaTable& globals) : reader(data.data(), data.size()), globals(globals) {}
+
+			void parse()
+			{
+				char header[12];
+				reader.read(header, 12);
+				if (memcmp(header, "\x1bLua", 4) != 0 || header[4] != 0x51)
+					throw std::runtime_error("lua: only lua 5.1 bytecode is supported");
+				if (header[5] != 0 || header[6] != 1 || header[7] != 4 || (header[8] != 4 && header[8] != 8) || header[9] != 4 || header[10] != 8 || header[11] != 0)
+					throw std::runtime_error("lua: unsupported bytecode format (needs little endian, 32bit int and double numbers)");
+				sizeofSizeT = header[8];
+				Function main;
+				readFunction(main);
+				run(main);
+			}
+		};
+	}
+
+	nlohmann::json luaToJson(const std::string& data)
+	{
+		LuaTable globals;
+		try
+		{
+			if (!data.empty() && data[0] == 0x1b)
+				LuaBytecodeReader(data, globals).parse();
+			else
+				LuaSourceParser(data, globals).parse();
+		}
+		catch (const std::out_of_range&)
+		{
+			throw std::runtime_error("lua: unexpected end of file");
+		}
+		nlohmann::json ret = nlohmann::json::object();
+		for (const auto& e : globals.entries)
+			if (auto name = std::get_if<std::string>(&e.first))
+				ret[*name] = toJson(e.second);
+		return ret;
+	}
+}
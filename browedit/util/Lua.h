@@ -0,0 +1,13 @@
+#pragma once
+
+#include <json.hpp>
+#include <string>
+
+namespace util
+{
+	//Minimal reader for lua data files, like the lub files in effecttool. Reads both lua source and compiled lua 5.1 bytecode,
+	//but only global assignments of constants and tables, nothing is executed. Returns a json object with all assigned globals.
+	//Tables with only string keys become json objects, other tables become arrays, ordered on their numeric keys.
+	//Throws std::runtime_error if the data can't be read
+	nlohmann::json luaToJson(const std::string& data);
+}
@@ -0,0 +1,196 @@
+#include "MemoryTracker.h"
+#include <mutex>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+
+namespace util
+{
+	class Source
+	{
+	public:
+		const void* owner;
+		const char* tag;
+		MemoryTracker::Type type;
+		std::function<std::size_t()> size;
+	};
+	class Evictor
+	{
+	public:
+		const void* owner;
+		const char* tag;
+		std::function<std::size_t(std::size_t)> evict;
+	};
+
+	static std::mutex mutex;
+	static std::vector<MemoryTracker::Counter*> counters; //never freed, TrackedMemory keeps pointers to them
+	static std::vector<Source> sources;
+	static std::vector<Evictor> evictors;
+	static std::map<std::string, std::int64_t> budgets;
+
+	void MemoryTracker::Counter::add(std::int64_t amount)
+	{
+		std::int64_t newValue = bytes += amount;
+		std::int64_t oldPeak = peak;
+		while (newValue > oldPeak && !peak.compare_exchange_weak(oldPeak, newValue))
+			;
+	}
+
+	MemoryTracker::Counter* MemoryTracker::getCounter(const char* tag, Type type)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto c : counters)
+			if (c->type == type && strcmp(c->tag, tag) == 0)
+				return c;
+		auto c = new Counter(tag, type);
+		counters.push_back(c);
+		return c;
+	}
+
+	void MemoryTracker::addSource(const void* owner, const char* tag, Type type, const std::function<std::size_t()>& size)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		sources.push_back(Source{ owner, tag, type, size });
+	}
+
+	void MemoryTracker::addEvictor(const void* owner, const char* tag, const std::function<std::size_t(std::size_t)>& evict)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		evictors.push_back(Evictor{ owner, tag, evict });
+	}
+
+	void MemoryTracker::remove(const void* owner)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		sources.erase(std::remove_if(sources.begin(), sources.end(), [owner](const Source& s) { return s.owner == owner; }), sources.end());
+		evictors.erase(std::remove_if(evictors.begin(), evictors.end(), [owner](const Evictor& e) { return e.owner == owner; }), evictors.end());
+	}
+
+	void MemoryTracker::setBudget(const std::string& tag, std::int64_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (bytes > 0)
+			budgets[tag] = bytes;
+		else
+			budgets.erase(tag);
+	}
+
+	void MemoryTracker::setBudgets(const std::map<std::string, int>& budgetsInMb)
+	{
+		for (const auto& b : budgetsInMb)
+			setBudget(b.first, (std::int64_t)b.second * 1024 * 1024);
+	}
+
+	//the sources are asked for their size with the lock held, so they can't be removed while they're being called
+	std::vector<MemoryTracker::Usage> MemoryTracker::getUsage()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<std::string, Usage> usage;
+		auto get = [&](const char* tag, Type type) -> Usage&
+		{
+			auto& u = usage[tag];
+			u.tag = tag;
+			u.type = type;
+			return u;
+		};
+		for (auto c : counters)
+		{
+			auto& u = get(c->tag, c->type);
+			u.bytes += c->bytes;
+			u.peak += c->peak;
+			u.count += c->count;
+		}
+		for (const auto& s : sources)
+		{
+			auto& u = get(s.tag, s.type);
+			std::int64_t size = (std::int64_t)s.size();
+			u.bytes += size;
+			u.peak += size;
+			u.count++;
+		}
+		for (const auto& e : evictors)
+			usage[e.tag].evictable = true;
+		for (const auto& b : budgets)
+			if (usage.find(b.first) != usage.end())
+				usage[b.first].budget = b.second;
+
+		std::vector<Usage> ret;
+		for (const auto& u : usage)
+			if (!u.second.tag.empty())
+				ret.push_back(u.second);
+		std::sort(ret.begin(), ret.end(), [](const Usage& a, const Usage& b) { return a.bytes > b.bytes; });
+		return ret;
+	}
+
+	void MemoryTracker::enforceBudgets()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (budgets.empty() || evictors.empty())
+				return;
+		}
+		for (const auto& u : getUsage())
+		{
+			if (u.budget == 0 || u.bytes <= u.budget || !u.evictable)
+				continue;
+			std::vector<Evictor> tagEvictors;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (const auto& e : evictors)
+					if (u.tag == e.tag)
+						tagEvictors.push_back(e);
+			}
+			std::size_t toFree = (std::size_t)(u.bytes - u.budget);
+			std::size_t freed = 0;
+			for (const auto& e : tagEvictors)
+				if (freed < toFree)
+					freed += e.evict(toFree - freed);
+			if (freed > 0)
+				std::cout << "Memory: " << u.tag << " is over its budget, freed " << freed / 1024 << " KB" << std::endl;
+		}
+	}
+
+	nlohmann::json MemoryTracker::toJson()
+	{
+		nlohmann::json ret = nlohmann::json::array();
+		for (const auto& u : getUsage())
+			ret.push_back({ {"tag", u.tag}, {"type", u.type == Type::Gpu ? "gpu" : "cpu"}, {"bytes", u.bytes}, {"peak", u.peak}, {"count", u.count}, {"budget", u.budget} });
+		return ret;
+	}
+
+	void MemoryTracker::dump(std::ostream& os)
+	{
+		std::int64_t total[2] = { 0, 0 };
+		for (const auto& u : getUsage())
+		{
+			os << "Memory: " << std::left << std::setw(24) << u.tag << (u.type == Type::Gpu ? " GPU " : " CPU ") << std::right << std::setw(10) << u.bytes / 1024 << " KB in " << u.count << " allocations";
+			if (u.budget > 0)
+				os << ", budget " << u.budget / 1024 << " KB";
+			os << std::endl;
+			total[u.type == Type::Gpu ? 1 : 0] += u.bytes;
+		}
+		os << "Memory: total " << total[0] / 1024 << " KB CPU, " << total[1] / 1024 << " KB GPU" << std::endl;
+	}
+
+
+	void TrackedMemory::set(std::size_t newBytes)
+	{
+		if ((std::int64_t)newBytes == bytes)
+			return;
+		if (bytes == 0)
+			counter->count++;
+		else if (newBytes == 0)
+			counter->count--;
+		counter->add((std::int64_t)newBytes - bytes);
+		bytes = (std::int64_t)newBytes;
+	}
+
+	void TrackedMemory::setTag(const char* tag)
+	{
+		auto size = bytes;
+		set(0);
+		counter = MemoryTracker::getCounter(tag, counter->type);
+		set((std::size_t)size);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <json.hpp>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <ostream>
+
+namespace util
+{
+	//Keeps track of how much memory the different parts of the editor use, per tag. Memory is reported in 3 ways:
+	// - objects that own a buffer keep a TrackedMemory with its size (textures, vertex buffers, framebuffers)
+	// - objects that know their own size register a source, which is asked for its size when the usage is needed
+	// - caches that can free memory register an evictor, which is called when their tag goes over its budget
+	//Tags are not copied, so they have to be string literals, like the profiler names
+	class MemoryTracker
+	{
+	public:
+		enum class Type
+		{
+			Cpu,
+			Gpu,
+		};
+		class Counter
+		{
+		public:
+			const char* tag;
+			Type type;
+			std::atomic<std::int64_t> bytes = 0;
+			std::atomic<std::int64_t> peak = 0;
+			std::atomic<std::int64_t> count = 0; //amount of allocations
+			Counter(const char* tag, Type type) : tag(tag), type(type) {}
+			void add(std::int64_t amount);
+		};
+		class Usage
+		{
+		public:
+			std::string tag;
+			Type type;
+			std::int64_t bytes = 0;
+			std::int64_t peak = 0;
+			std::int64_t count = 0;
+			std::int64_t budget = 0; //0 for no budget
+			bool evictable = false;
+		};
+
+		static Counter* getCounter(const char* tag, Type type = Type::Cpu);
+		static void addSource(const void* owner, const char* tag, Type type, const std::function<std::size_t()>& size);
+		static void addEvictor(const void* owner, const char* tag, const std::function<std::size_t(std::size_t)>& evict); //evict gets the amount of bytes to free, and returns how much it freed
+		static void remove(const void* owner); //removes all sources and evictors of the owner
+
+		static void setBudget(const std::string& tag, std::int64_t bytes);
+		static void setBudgets(const std::map<std::string, int>& budgetsInMb);
+		static std::vector<Usage> getUsage();
+		static void enforceBudgets(); //call once per frame from the main thread, evictors may free GL objects
+		static nlohmann::json toJson();
+		static void dump(std::ostream& os);
+	};
+
+	//Size of a single allocation, that is added to a counter. When this is copied, the copy starts empty
+	class TrackedMemory
+	{
+		MemoryTracker::Counter* counter;
+		std::int64_t bytes = 0;
+	public:
+		TrackedMemory(const char* tag, MemoryTracker::Type type = MemoryTracker::Type::Cpu) : counter(MemoryTracker::getCounter(tag, type)) {}
+		TrackedMemory(const TrackedMemory& other) : counter(other.counter) {}
+		TrackedMemory& operator=(const TrackedMemory& other) { return *this; }
+		~TrackedMemory() { set(0); }
+		void set(std::size_t bytes);
+		void setTag(const char* tag); //moves the memory to another counter
+		std::size_t get() const { return (std::size_t)bytes; }
+	};
+}
@@ -0,0 +1,215 @@
+#include "Profiler.h"
+#ifdef BROWEDIT_PROFILER
+#include <glad/glad.h>
+#include <json.hpp>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <cstring>
+
+namespace util
+{
+	class OpenZone
+	{
+	public:
+		const char* name;
+		std::int64_t begin;
+	};
+	class GpuZone
+	{
+	public:
+		const char* name;
+		GLuint queries[2];
+		int depth;
+		std::uint64_t frame;
+	};
+
+	static std::mutex mutex;
+	static Profiler::Frame currentFrame;
+	static std::deque<Profiler::Frame> frames;
+	static std::vector<Profiler::Counter*> counters;
+	static std::uint64_t frameIndex = 0;
+	static const auto startTime = std::chrono::steady_clock::now();
+
+	static std::atomic<std::uint32_t> nextThreadId(1);
+	thread_local static std::uint32_t threadId = nextThreadId++;
+	thread_local static std::vector<OpenZone> openZones;
+
+	//GPU zones are only used from the GL thread, so these don't need locking
+	static std::vector<GpuZone> openGpuZones;
+	static std::vector<GpuZone> pendingGpuZones;
+	static std::vector<GLuint> freeQueries;
+	static std::int64_t gpuOffset = 0; //difference between the CPU and GPU clock, in microseconds
+
+	std::int64_t Profiler::now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	//checks which timer queries are done, and adds them to the frame they were issued in. Needs to be locked
+	static void collectGpuZones()
+	{
+		for (auto it = pendingGpuZones.begin(); it != pendingGpuZones.end(); )
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(it->queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+			{
+				it++;
+				continue;
+			}
+			GLuint64 begin, end;
+			glGetQueryObjectui64v(it->queries[0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(it->queries[1], GL_QUERY_RESULT, &end);
+			Profiler::Event e{ it->name, 0, it->depth, (std::int64_t)(begin / 1000) + gpuOffset, (std::int64_t)(end / 1000) + gpuOffset };
+			if (it->frame == currentFrame.index)
+				currentFrame.events.push_back(e);
+			else
+				for (auto& f : frames)
+					if (f.index == it->frame)
+						f.events.push_back(e);
+			freeQueries.push_back(it->queries[0]);
+			freeQueries.push_back(it->queries[1]);
+			it = pendingGpuZones.erase(it);
+		}
+	}
+
+	void Profiler::newFrame()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		collectGpuZones();
+
+		//the GPU timestamps use their own clock, this lines them up with the CPU zones (approximately)
+		GLint64 gpuTime = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+		auto time = now();
+		if (gpuTime != 0)
+			gpuOffset = time - gpuTime / 1000;
+
+		if (!paused && currentFrame.begin != 0)
+		{
+			currentFrame.end = time;
+			for (auto c : counters)
+				currentFrame.counters.push_back(std::pair<const char*, std::int64_t>(c->name, c->value.exchange(0)));
+			frames.push_back(std::move(currentFrame));
+			while (frames.size() > maxFrames)
+				frames.pop_front();
+		}
+		else
+			for (auto c : counters)
+				c->value = 0;
+		currentFrame = Frame();
+		currentFrame.index = ++frameIndex;
+		currentFrame.begin = time;
+	}
+
+	void Profiler::begin(const char* name)
+	{
+		openZones.push_back(OpenZone{ name, now() });
+	}
+
+	void Profiler::end()
+	{
+		if (openZones.empty())
+			return;
+		Event e{ openZones.back().name, threadId, (int)openZones.size() - 1, openZones.back().begin, now() };
+		openZones.pop_back();
+		if (paused)
+			return;
+		std::lock_guard<std::mutex> lock(mutex);
+		currentFrame.events.push_back(e);
+	}
+
+	void Profiler::beginGpu(const char* name)
+	{
+		GpuZone zone{ name, { 0, 0 }, (int)openGpuZones.size(), frameIndex };
+		for (int i = 0; i < 2; i++)
+		{
+			if (freeQueries.empty())
+				glGenQueries(1, &zone.queries[i]);
+			else
+			{
+				zone.queries[i] = freeQueries.back();
+				freeQueries.pop_back();
+			}
+		}
+		glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+		openGpuZones.push_back(zone);
+	}
+
+	void Profiler::endGpu()
+	{
+		if (openGpuZones.empty())
+			return;
+		glQueryCounter(openGpuZones.back().queries[1], GL_TIMESTAMP);
+		pendingGpuZones.push_back(openGpuZones.back());
+		openGpuZones.pop_back();
+	}
+
+	Profiler::Counter* Profiler::getCounter(const char* name)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto c : counters)
+			if (strcmp(c->name, name) == 0)
+				return c;
+		counters.push_back(new Counter(name));
+		return counters.back();
+	}
+
+	std::vector<float> Profiler::getFrameTimes()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::vector<float> ret;
+		ret.reserve(frames.size());
+		for (const auto& f : frames)
+			ret.push_back((f.end - f.begin) / 1000.0f);
+		return ret;
+	}
+
+	bool Profiler::getFrame(std::size_t index, Frame& frame)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (index >= frames.size())
+			return false;
+		frame = frames[index];
+		return true;
+	}
+
+	//Writes the recorded frames in the chrome://tracing / perfetto json format
+	bool Profiler::exportChromeTrace(const std::string& fileName)
+	{
+		nlohmann::json events = nlohmann::json::array();
+		std::set<std::uint32_t> threads;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto& f : frames)
+			{
+				events.push_back({ {"name", "Frame " + std::to_string(f.index)}, {"cat", "frame"}, {"ph", "X"}, {"ts", f.begin}, {"dur", f.end - f.begin}, {"pid", 1}, {"tid", 1000} });
+				for (const auto& e : f.events)
+				{
+					events.push_back({ {"name", e.name}, {"cat", e.threadId == 0 ? "gpu" : "cpu"}, {"ph", "X"}, {"ts", e.begin}, {"dur", e.end - e.begin}, {"pid", 1}, {"tid", e.threadId} });
+					threads.insert(e.threadId);
+				}
+				for (const auto& c : f.counters)
+					events.push_back({ {"name", c.first}, {"ph", "C"}, {"ts", f.begin}, {"pid", 1}, {"args", { {"value", c.second} } } });
+			}
+		}
+		events.push_back({ {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", 1000}, {"args", { {"name", "Frames"} } } });
+		for (auto t : threads)
+			events.push_back({ {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", t}, {"args", { {"name", t == 0 ? std::string("GPU") : "Thread " + std::to_string(t)} } } });
+
+		std::ofstream file(fileName.c_str(), std::ios_base::out | std::ios_base::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "Profiler: Unable to write " << fileName << std::endl;
+			return false;
+		}
+		file << nlohmann::json{ {"traceEvents", events}, {"displayTimeUnit", "ms"} };
+		std::cout << "Profiler: Exported " << events.size() << " events to " << fileName << std::endl;
+		return true;
+	}
+}
+#endif
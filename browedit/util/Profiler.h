@@ -0,0 +1,87 @@
+#pragma once
+
+//Remove this define to compile the profiler out completely, all PROFILE_ macros will be empty
+#define BROWEDIT_PROFILER
+
+#ifdef BROWEDIT_PROFILER
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+namespace util
+{
+	//Frame based profiler. CPU zones can be opened from any thread, GPU zones only from the thread with the GL context.
+	//Names are not copied, so they have to be string literals (or otherwise live for the lifetime of the program)
+	class Profiler
+	{
+	public:
+		class Event
+		{
+		public:
+			const char* name;
+			std::uint32_t threadId; //0 is the GPU
+			int depth;
+			std::int64_t begin; //in microseconds since startup
+			std::int64_t end;
+		};
+		class Counter
+		{
+		public:
+			const char* name;
+			std::atomic<std::int64_t> value = 0;
+			Counter(const char* name) : name(name) {}
+		};
+		class Frame
+		{
+		public:
+			std::uint64_t index = 0;
+			std::int64_t begin = 0;
+			std::int64_t end = 0;
+			std::vector<Event> events;
+			std::vector<std::pair<const char*, std::int64_t>> counters;
+		};
+
+		inline static bool paused = false;
+		inline static std::size_t maxFrames = 300;
+
+		static void newFrame();
+		static void begin(const char* name);
+		static void end();
+		static void beginGpu(const char* name);
+		static void endGpu();
+		static Counter* getCounter(const char* name);
+
+		static std::int64_t now();
+		static std::vector<float> getFrameTimes();
+		static bool getFrame(std::size_t index, Frame& frame);
+		static bool exportChromeTrace(const std::string& fileName);
+	};
+
+	class ProfileScope
+	{
+	public:
+		ProfileScope(const char* name) { Profiler::begin(name); }
+		~ProfileScope() { Profiler::end(); }
+	};
+
+	class GpuProfileScope
+	{
+	public:
+		GpuProfileScope(const char* name) { Profiler::beginGpu(name); }
+		~GpuProfileScope() { Profiler::endGpu(); }
+	};
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_FRAME() util::Profiler::newFrame()
+#define PROFILE_SCOPE(name) util::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) util::GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+#define PROFILE_COUNT(name, amount) do { static util::Profiler::Counter* profileCounter = util::Profiler::getCounter(name); profileCounter->value += (amount); } while(false)
+#else
+#define PROFILE_FRAME()
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_COUNT(name, amount)
+#endif
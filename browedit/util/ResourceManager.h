@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <iostream>
 #include <mutex>
 
@@ -65,12 +66,32 @@ namespace util
 			return ret;
 		}
 
+		//adds a reference to every loaded resource in one pass, so they stay loaded until they are given to unloadAll
+		static std::vector<T*> loadAll()
+		{
+			const std::lock_guard<std::mutex> lock(loadMutex);
+			std::vector<T*> ret;
+			ret.reserve(resmap.size() + resources.size());
+			for (auto& it : resmap)
+			{
+				it.second.second++;
+				ret.push_back(it.second.first);
+			}
+			for (auto& res : resources)
+			{
+				res.second++;
+				ret.push_back(res.first);
+			}
+			return ret;
+		}
+
 		static std::size_t count()
 		{
 			return resources.size() + resmap.size();
 		}
 		static void unload(T* res)
 		{
+			const std::lock_guard<std::mutex> lock(loadMutex);
 			for (auto kv = resmap.begin(); kv != resmap.end(); kv++)
 			{
 				if (kv->second.first == res)
@@ -101,6 +122,46 @@ namespace util
 			}
 			std::cout << "Unloading resource, could not find it in the resource map!" << std::endl;
 		}
+		//removes one reference from each of the resources, walking the map once instead of once per resource
+		static void unloadAll(const std::set<T*>& res)
+		{
+			const std::lock_guard<std::mutex> lock(loadMutex);
+			std::size_t found = 0;
+			for (auto kv = resmap.begin(); kv != resmap.end();)
+			{
+				if (res.find(kv->second.first) == res.end())
+				{
+					kv++;
+					continue;
+				}
+				found++;
+				if (--kv->second.second == 0)
+				{
+					delete kv->second.first;
+					kv = resmap.erase(kv);
+				}
+				else
+					kv++;
+			}
+			for (auto v = resources.begin(); v != resources.end();)
+			{
+				if (res.find(v->first) == res.end())
+				{
+					v++;
+					continue;
+				}
+				found++;
+				if (--v->second == 0)
+				{
+					delete v->first;
+					v = resources.erase(v);
+				}
+				else
+					v++;
+			}
+			if (found != res.size())
+				std::cout << "Unloading resources, could not find " << (res.size() - found) << " of them in the resource map!" << std::endl;
+		}
 	};
 
 //	template<class T>
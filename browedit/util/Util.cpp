@@ -11,6 +11,7 @@
 #include <imgui_internal.h>
 #include <iostream>
 #include <ShlObj_core.h>
+#include <zlib.h>
 
 #include <browedit/Map.h>
 #include <browedit/BrowEdit.h>
@@ -131,6 +132,96 @@ namespace util
 		return orig;
 	}
 
+	static const char* base64Chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string base64Encode(const char* data, std::size_t size)
+	{
+		std::string ret;
+		ret.reserve(((size + 2) / 3) * 4);
+		const unsigned char* d = (const unsigned char*)data;
+		std::size_t i = 0;
+		for (; i + 2 < size; i += 3)
+		{
+			unsigned int v = (d[i] << 16) | (d[i + 1] << 8) | d[i + 2];
+			ret.push_back(base64Chars[(v >> 18) & 63]);
+			ret.push_back(base64Chars[(v >> 12) & 63]);
+			ret.push_back(base64Chars[(v >> 6) & 63]);
+			ret.push_back(base64Chars[v & 63]);
+		}
+		if (i < size)
+		{
+			unsigned int v = d[i] << 16;
+			if (i + 1 < size)
+				v |= d[i + 1] << 8;
+			ret.push_back(base64Chars[(v >> 18) & 63]);
+			ret.push_back(base64Chars[(v >> 12) & 63]);
+			ret.push_back(i + 1 < size ? base64Chars[(v >> 6) & 63] : '=');
+			ret.push_back('=');
+		}
+		return ret;
+	}
+
+	std::vector<char> base64Decode(const std::string& str)
+	{
+		static int lookup[256] = { -2 };
+		if (lookup[0] == -2)
+		{
+			for (int i = 0; i < 256; i++)
+				lookup[i] = -1;
+			for (int i = 0; i < 64; i++)
+				lookup[(unsigned char)base64Chars[i]] = i;
+		}
+		std::vector<char> ret;
+		ret.reserve(str.size() / 4 * 3);
+		unsigned int v = 0;
+		int bits = 0;
+		for (unsigned char c : str)
+		{
+			if (c == '=')
+				break;
+			int l = lookup[c];
+			if (l == -1)
+				continue; //skip whitespace and newlines that might be added by other programs
+			v = (v << 6) | l;
+			bits += 6;
+			if (bits >= 8)
+			{
+				bits -= 8;
+				ret.push_back((char)((v >> bits) & 0xff));
+			}
+		}
+		return ret;
+	}
+
+	std::vector<char> compress(const char* data, std::size_t size, int level)
+	{
+		uLongf len = compressBound((uLong)size);
+		std::vector<char> ret(len);
+		if (compress2((Bytef*)ret.data(), &len, (const Bytef*)data, (uLong)size, level) != Z_OK)
+			throw std::runtime_error("Error compressing data");
+		ret.resize(len);
+		return ret;
+	}
+
+	std::vector<char> decompress(const char* data, std::size_t size, std::size_t uncompressedSize)
+	{
+		uLongf len = (uLongf)uncompressedSize;
+		std::vector<char> ret(uncompressedSize);
+		if (uncompress((Bytef*)ret.data(), &len, (const Bytef*)data, (uLong)size) != Z_OK || len != uncompressedSize)
+			throw std::runtime_error("Error decompressing data");
+		return ret;
+	}
+
+	std::uint64_t hash(const char* data, std::size_t size)
+	{
+		std::uint64_t ret = 14695981039346656037ull;
+		for (std::size_t i = 0; i < size; i++)
+		{
+			ret ^= (unsigned char)data[i];
+			ret *= 1099511628211ull;
+		}
+		return ret;
+	}
 
 
 	bool ColorEdit3(BrowEdit* browEdit, Map* map, Node* node, const char* label, glm::vec3* ptr, const std::string& action)
@@ -7,6 +7,7 @@ class Node;
 #include <glm/glm.hpp>
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <imgui.h>
 
 namespace util
@@ -39,6 +40,12 @@ namespace util
 		return ltrim(rtrim(s));
 	}
 
+	std::string base64Encode(const char* data, std::size_t size);
+	std::vector<char> base64Decode(const std::string& str);
+	std::vector<char> compress(const char* data, std::size_t size, int level = 6);
+	std::vector<char> decompress(const char* data, std::size_t size, std::size_t uncompressedSize);
+	std::uint64_t hash(const char* data, std::size_t size); //64 bit FNV-1a, for cache keys
+
 	std::string SaveAsDialog(const std::string& fileName, const char* filter = "All\0*.*\0");
 	std::string SelectPathDialog(std::string path);
 
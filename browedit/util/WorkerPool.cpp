@@ -0,0 +1,81 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+namespace util
+{
+	WorkerPool::WorkerPool()
+	{
+		int count = (int)std::max(1u, std::thread::hardware_concurrency()) - 1;
+		for (int i = 0; i < count; i++)
+			threads.push_back(std::thread(&WorkerPool::workerLoop, this));
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& t : threads)
+			t.join();
+	}
+
+	void WorkerPool::work()
+	{
+		for (int i; (i = next++) < jobSize;)
+			(*job)(i);
+	}
+
+	void WorkerPool::workerLoop()
+	{
+		unsigned int joined = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			wake.wait(lock, [&]() { return stopping || (wanted > 0 && joined != generation); });
+			if (stopping)
+				return;
+			joined = generation; //join every loop at most once
+			wanted--;
+			busy++;
+			lock.unlock();
+			work();
+			lock.lock();
+			if (--busy == 0)
+				done.notify_all();
+		}
+	}
+
+	void WorkerPool::parallelFor(int count, const std::function<void(int)>& func, int maxThreads)
+	{
+		if (count <= 0)
+			return;
+		int helpers = std::min((int)threads.size(), count - 1);
+		if (maxThreads > 0)
+			helpers = std::min(helpers, maxThreads - 1);
+		if (helpers <= 0 || !runMutex.try_lock())
+		{
+			for (int i = 0; i < count; i++)
+				func(i);
+			return;
+		}
+		std::lock_guard<std::mutex> runLock(runMutex, std::adopt_lock);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &func;
+			jobSize = count;
+			next = 0;
+			wanted = helpers;
+			generation++;
+		}
+		wake.notify_all();
+		work();
+
+		//workers that didn't wake up yet are not needed anymore, wait for the ones that are still working
+		std::unique_lock<std::mutex> lock(mutex);
+		wanted = 0;
+		done.wait(lock, [&]() { return busy == 0; });
+		job = nullptr;
+	}
+}
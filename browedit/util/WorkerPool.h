@@ -0,0 +1,40 @@
+#pragma once
+
+#include <browedit/util/Singleton.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace util
+{
+	//Worker threads that are started once and reused, so short parallel loops don't pay for starting threads every time.
+	//The calling thread helps with the work, and parallelFor only returns when all items are done.
+	//Only one loop runs at a time, a parallelFor that is started while another one runs (or from inside one) runs on the calling thread
+	class WorkerPool : public Singleton<WorkerPool>
+	{
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::mutex runMutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		const std::function<void(int)>* job = nullptr;
+		int jobSize = 0;
+		std::atomic<int> next = 0;
+		int wanted = 0; //amount of workers that can still join the current loop
+		int busy = 0; //amount of workers working on the current loop
+		unsigned int generation = 0;
+		bool stopping = false;
+
+		void workerLoop();
+		void work();
+	public:
+		WorkerPool();
+		~WorkerPool();
+		//calls func for every index in [0, count), spread over at most maxThreads threads (including the calling thread), 0 for all threads
+		void parallelFor(int count, const std::function<void(int)>& func, int maxThreads = 0);
+		int threadCount() const { return (int)threads.size() + 1; }
+	};
+}
@@ -22,6 +22,12 @@ void BrowEdit::showLightmapSettingsWindow()
 		auto rsw = lightmapper->map->rootNode->getComponent<Rsw>();
 		auto& settings = rsw->lightmapSettings;
 		ImGui::DragInt("Quality", &settings.quality, 1, 1, 10);
+		ImGui::Checkbox("Adaptive Supersampling", &config.lightmapperAdaptive);
+		if (config.lightmapperAdaptive)
+		{
+			ImGui::DragFloat("Max Error", &config.lightmapperMaxError, 0.1f, 0.0f, 64.0f);
+			ImGui::Checkbox("Compare with full supersampling", &config.lightmapperCompare);
+		}
 		ImGui::Checkbox("Shadows", &settings.shadows);
 		ImGui::Checkbox("Debug Points", &lightmapper->buildDebugPoints);
 		ImGui::Checkbox("Height Edit Mode Selection Only", &settings.heightSelectionOnly);
@@ -0,0 +1,97 @@
+#include <Windows.h>
+#include <browedit/BrowEdit.h>
+#include <browedit/Config.h>
+#include <browedit/util/MemoryTracker.h>
+#include <browedit/util/Util.h>
+
+#include <imgui.h>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+static std::string formatSize(std::int64_t bytes)
+{
+	char buf[32];
+	if (bytes >= 1024 * 1024)
+		snprintf(buf, sizeof(buf), "%.1f MB", bytes / (1024.0 * 1024.0));
+	else
+		snprintf(buf, sizeof(buf), "%.1f KB", bytes / 1024.0);
+	return buf;
+}
+
+void BrowEdit::showMemoryWindow()
+{
+	if (!ImGui::Begin("Memory", &windowData.memoryVisible))
+	{
+		ImGui::End();
+		return;
+	}
+	auto usage = util::MemoryTracker::getUsage();
+
+	if (ImGui::Button("Print to console"))
+		util::MemoryTracker::dump(std::cout);
+	ImGui::SameLine();
+	if (ImGui::Button("Save report"))
+	{
+		std::string fileName = util::SaveAsDialog("memory.json", "Json\0*.json\0");
+		if (fileName != "")
+		{
+			if (fileName.size() < 5 || fileName.substr(fileName.size() - 5) != ".json")
+				fileName += ".json";
+			std::ofstream(fileName) << util::MemoryTracker::toJson().dump(2);
+		}
+	}
+
+	std::int64_t total[2] = { 0, 0 };
+	for (const auto& u : usage)
+		total[u.type == util::MemoryTracker::Type::Gpu ? 1 : 0] += u.bytes;
+	ImGui::Text("Total: %s CPU, %s GPU", formatSize(total[0]).c_str(), formatSize(total[1]).c_str());
+
+	if (ImGui::BeginTable("Memory", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Tag");
+		ImGui::TableSetupColumn("Type");
+		ImGui::TableSetupColumn("Size");
+		ImGui::TableSetupColumn("Peak");
+		ImGui::TableSetupColumn("Allocations");
+		ImGui::TableSetupColumn("Budget (MB)");
+		ImGui::TableHeadersRow();
+		for (const auto& u : usage)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", u.tag.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", u.type == util::MemoryTracker::Type::Gpu ? "GPU" : "CPU");
+			ImGui::TableNextColumn();
+			if (u.budget > 0 && u.bytes > u.budget)
+				ImGui::TextColored(ImVec4(1, 0.4f, 0.4f, 1), "%s", formatSize(u.bytes).c_str());
+			else
+				ImGui::Text("%s", formatSize(u.bytes).c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", formatSize(u.peak).c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%lld", (long long)u.count);
+			ImGui::TableNextColumn();
+			if (u.evictable) //only caches can be kept under a budget
+			{
+				int budget = (int)(u.budget / (1024 * 1024));
+				ImGui::PushID(u.tag.c_str());
+				ImGui::SetNextItemWidth(-1);
+				if (ImGui::InputInt("##budget", &budget, 16, 128, ImGuiInputTextFlags_EnterReturnsTrue))
+				{
+					budget = std::max(0, budget);
+					if (budget > 0)
+						config.memoryBudgets[u.tag] = budget;
+					else
+						config.memoryBudgets.erase(u.tag);
+					util::MemoryTracker::setBudget(u.tag, (std::int64_t)budget * 1024 * 1024);
+					config.save();
+				}
+				ImGui::PopID();
+			}
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
@@ -106,6 +106,10 @@ void BrowEdit::menuBar()
 		}			
 		if (ImGui::MenuItem("Demo Window", nullptr, windowData.demoWindowVisible))
 			windowData.demoWindowVisible = !windowData.demoWindowVisible;
+		if (ImGui::MenuItem("Profiler", nullptr, windowData.profilerVisible))
+			windowData.profilerVisible = !windowData.profilerVisible;
+		if (ImGui::MenuItem("Memory", nullptr, windowData.memoryVisible))
+			windowData.memoryVisible = !windowData.memoryVisible;
 		hotkeyMenuItem("Reload Textures", HotkeyAction::Global_ReloadTextures);
 		hotkeyMenuItem("Reload Models", HotkeyAction::Global_ReloadModels);
 		ImGui::EndMenu();
@@ -12,6 +12,7 @@
 #include <browedit/util/Util.h>
 #include <browedit/util/FileIO.h>
 #include <browedit/util/ResourceManager.h>
+#include <browedit/util/MemoryTracker.h>
 #include <browedit/actions/GroupAction.h>
 #include <browedit/actions/SelectAction.h>
 #include <browedit/actions/ModelChangeAction.h>
@@ -20,6 +21,7 @@
 #include <misc/cpp/imgui_stdlib.h>
 #include <thread>
 #include <iostream>
+#include <algorithm>
 
 //TODO: this file is a mess
 
@@ -31,14 +33,21 @@ public:
 	NodeRenderContext nodeRenderContext;
 	float rotation = 0;
 	BrowEdit* browEdit;
+	int lastUsed = 0; //imgui frame this thumbnail was last shown in
 
 	ObjectWindowObject(const std::string& fileName, BrowEdit* browEdit) : browEdit(browEdit)
 	{
 		fbo = new gl::FBO((int)browEdit->config.thumbnailSize.x, (int)browEdit->config.thumbnailSize.y, true); //TODO: resolution?
+		fbo->memory.setTag("GL object thumbnails");
 		node = new Node();
 		node->addComponent(util::ResourceManager<Rsm>::load(fileName));
 		node->addComponent(new RsmRenderer());
 	}
+	~ObjectWindowObject()
+	{
+		delete fbo;
+		delete node;
+	}
 
 	void draw()
 	{
@@ -60,7 +69,7 @@ public:
 		float ratio = fbo->getWidth() / (float)fbo->getHeight();
 		nodeRenderContext.projectionMatrix = glm::perspective(glm::radians(45.0f), ratio, 0.1f, 5000.0f);
 		nodeRenderContext.viewMatrix = glm::lookAt(glm::vec3(0.0f, -distance, -distance), glm::vec3(0.0f, rsm->bbrange.y, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		RsmRenderer::RsmRenderContext::getInstance()->viewLighting = false;
+		nodeRenderContext.settings.viewLighting = false;
 		node->getComponent<RsmRenderer>()->matrixCache = glm::rotate(glm::mat4(1.0f), glm::radians(rotation), glm::vec3(0, 1, 0));
 		NodeRenderer::render(node, nodeRenderContext);
 		fbo->unbind();
@@ -68,6 +77,26 @@ public:
 };
 std::map<std::string, ObjectWindowObject*> objectWindowObjects;
 
+//thumbnails are drawn again when they are scrolled back into view, so the ones that haven't been shown for the longest time can be thrown away
+static std::size_t evictObjectWindowObjects(std::size_t bytes)
+{
+	std::vector<std::pair<int, std::string>> unused;
+	for (const auto& o : objectWindowObjects)
+		if (o.second->lastUsed < ImGui::GetFrameCount() - 1)
+			unused.push_back(std::pair<int, std::string>(o.second->lastUsed, o.first));
+	std::sort(unused.begin(), unused.end());
+	std::size_t freed = 0;
+	for (const auto& u : unused)
+	{
+		if (freed >= bytes)
+			break;
+		freed += objectWindowObjects[u.second]->fbo->memory.get();
+		delete objectWindowObjects[u.second];
+		objectWindowObjects.erase(u.second);
+	}
+	return freed;
+}
+
 void BrowEdit::showObjectWindow()
 {
 	if (!ImGui::Begin("Object Picker", &windowData.objectWindowVisible))
@@ -76,6 +105,10 @@ void BrowEdit::showObjectWindow()
 		return;
 	}
 	static bool verticalLayout = ImGui::GetContentRegionAvail().x < 300;
+	static bool evictorAdded = false;
+	if (!evictorAdded)
+		util::MemoryTracker::addEvictor(&objectWindowObjects, "GL object thumbnails", evictObjectWindowObjects);
+	evictorAdded = true;
 
 	static std::string filter;
 	ImGui::SetNextItemWidth(ImGui::GetWindowSize().x * 0.65f - 50);
@@ -260,6 +293,7 @@ void BrowEdit::showObjectWindow()
 						it = objectWindowObjects.find(path);
 						it->second->draw();
 					}
+					it->second->lastUsed = ImGui::GetFrameCount();
 					texture = (ImTextureID)(long long)it->second->fbo->texid[0];
 				}
 				else if (path.substr(path.size() - 4) == ".wav")
@@ -5,59 +5,129 @@
 #include <browedit/components/Rsw.h>
 #include <browedit/components/Gnd.h>
 #include <browedit/HotkeyRegistry.h>
+#include <browedit/util/Profiler.h>
+#include <unordered_set>
+#include <map>
 
-
-void BrowEdit::showObjectTree()
+//Flattened version of the node tree of a map. It is only rebuilt when nodes are added, moved or removed,
+//so drawing the window only costs the rows that are on screen
+class ObjectTree
 {
-	ImGui::Begin("Objects");
-	ImGui::PushFont(font);
-	for (auto m : maps)
+public:
+	enum Type
+	{
+		None,
+		Model,
+		Effect,
+		Sound,
+		Light,
+	};
+	class Row
 	{
-		buildObjectTree(m->rootNode, m);
+	public:
+		Node* node;
+		int depth;
+		int end; //index after the last row under this one, to skip closed nodes
+		Type type;
+	};
+	Node* rootNode = nullptr;
+	int version = -1;
+	std::vector<Row> rows;
+	std::vector<int> visibleRows;
+	std::unordered_set<Node*> closed;
+
+	std::vector<Node*> selection; //copy of map->selectedNodes, to see when selectionSet has to be updated
+	std::unordered_set<Node*> selectionSet;
+
+	void update(Map* map)
+	{
+		if (rootNode != map->rootNode || version != map->rootNode->structureVersion)
+		{
+			PROFILE_SCOPE("ObjectTree rebuild");
+			rootNode = map->rootNode;
+			version = map->rootNode->structureVersion;
+			rows.clear();
+			addRows(rootNode, 0);
+			std::unordered_set<Node*> stillClosed; //forget nodes that were removed
+			for (const auto& r : rows)
+				if (closed.find(r.node) != closed.end())
+					stillClosed.insert(r.node);
+			closed = std::move(stillClosed);
+			updateVisibleRows();
+		}
+		if (selection != map->selectedNodes)
+		{
+			selection = map->selectedNodes;
+			selectionSet = std::unordered_set<Node*>(selection.begin(), selection.end());
+		}
 	}
-	ImGui::PopFont();
 
-	ImGui::End();
-}
+	void addRows(Node* node, int depth)
+	{
+		Type type = None;
+		if (node->children.empty()) //same priority as the old tree, the last component that matches wins
+		{
+			if (node->getComponent<RswModel>()) type = Model;
+			if (node->getComponent<RswEffect>()) type = Effect;
+			if (node->getComponent<RswSound>()) type = Sound;
+			if (node->getComponent<RswLight>()) type = Light;
+		}
+		std::size_t index = rows.size();
+		rows.push_back(Row{ node, depth, 0, type });
+		for (auto c : node->children)
+			addRows(c, depth + 1);
+		rows[index].end = (int)rows.size();
+	}
 
+	void updateVisibleRows()
+	{
+		visibleRows.clear();
+		for (int i = 0; i < (int)rows.size(); )
+		{
+			visibleRows.push_back(i);
+			if (closed.find(rows[i].node) != closed.end())
+				i = rows[i].end;
+			else
+				i++;
+		}
+	}
+};
+static std::map<Map*, ObjectTree> objectTrees;
 
-void BrowEdit::buildObjectTree(Node* node, Map* map)
+static void drawObjectTreeRow(BrowEdit* browEdit, Map* map, ObjectTree& tree, const ObjectTree::Row& row, const ImVec4* colors)
 {
+	Node* node = row.node;
+	bool selected = tree.selectionSet.find(node) != tree.selectionSet.end();
+	ImGui::SetCursorPosX(ImGui::GetCursorPosX() + row.depth * ImGui::GetStyle().IndentSpacing);
 	if (node->children.size() > 0)
 	{
-		int flags = ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_OpenOnDoubleClick;
-		if (std::find(map->selectedNodes.begin(), map->selectedNodes.end(), node) != map->selectedNodes.end())
+		int flags = ImGuiTreeNodeFlags_OpenOnDoubleClick | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+		if (selected)
 			flags |= ImGuiTreeNodeFlags_Selected;
-		bool opened = ImGui::TreeNodeEx(node->name.c_str(), flags);
+		bool wasOpen = tree.closed.find(node) == tree.closed.end();
+		ImGui::SetNextItemOpen(wasOpen);
+		bool opened = ImGui::TreeNodeEx(node, flags, "%s", node->name.c_str());
 		if (ImGui::IsItemClicked())
 		{
-			map->doAction(new SelectAction(map, node, false, false), this);
+			map->doAction(new SelectAction(map, node, false, false), browEdit);
 		}
-		if (opened)
+		if (opened != wasOpen)
 		{
-			for (auto n : node->children)
-				buildObjectTree(n, map);
-			ImGui::TreePop();
+			if (opened)
+				tree.closed.erase(node);
+			else
+				tree.closed.insert(node);
+			tree.updateVisibleRows();
 		}
 	}
 	else
 	{
 		int flags = ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
-		if (std::find(map->selectedNodes.begin(), map->selectedNodes.end(), node) != map->selectedNodes.end())
+		if (selected)
 			flags |= ImGuiTreeNodeFlags_Selected;
 
-
-		ImVec4 textColor = ImGui::GetStyleColorVec4(ImGuiCol_Text);
-		float h, s, v;
-		ImGui::ColorConvertRGBtoHSV(textColor.x, textColor.y, textColor.z, h, s, v);
-		if (node->getComponent<RswModel>()) { h = 0;		s = glm::min(1.0f, s + 0.5f);	v = glm::min(1.0f, v + 0.5f); }
-		if (node->getComponent<RswEffect>()) { h = 0.25f;	s = glm::min(1.0f, s + 0.5f);	v = glm::min(1.0f, v + 0.5f); }
-		if (node->getComponent<RswSound>()) { h = 0.5f;	s = glm::min(1.0f, s + 0.5f);	v = glm::min(1.0f, v + 0.5f); }
-		if (node->getComponent<RswLight>()) { h = 0.75f;	s = glm::min(1.0f, s + 0.5f);	v = glm::min(1.0f, v + 0.5f); }
-		ImGui::ColorConvertHSVtoRGB(h, s, v, textColor.x, textColor.y, textColor.z);
-
-		ImGui::PushStyleColor(ImGuiCol_Text, textColor);
-		bool opened = ImGui::TreeNodeEx(node->name.c_str(), flags);
+		ImGui::PushStyleColor(ImGuiCol_Text, colors[row.type]);
+		ImGui::TreeNodeEx(node, flags, "%s", node->name.c_str());
 		ImGui::PopStyleColor();
 
 		if (ImGui::IsItemClicked() && ImGui::IsMouseDoubleClicked(0))
@@ -67,11 +137,62 @@ void BrowEdit::buildObjectTree(Node* node, Map* map)
 		if (ImGui::IsItemClicked())
 		{
 			bool ctrl = ImGui::GetIO().KeyCtrl;
-			bool selected = std::find(map->selectedNodes.begin(), map->selectedNodes.end(), node) != map->selectedNodes.end();
-			map->doAction(new SelectAction(map, node, ctrl, ctrl && selected), this);
+			map->doAction(new SelectAction(map, node, ctrl, ctrl && selected), browEdit);
 		}
 	}
 }
 
+void BrowEdit::showObjectTree()
+{
+	ImGui::Begin("Objects");
+	ImGui::PushFont(font);
+
+	for (auto it = objectTrees.begin(); it != objectTrees.end(); )
+	{
+		if (std::find(maps.begin(), maps.end(), it->first) == maps.end())
+			it = objectTrees.erase(it);
+		else
+			it++;
+	}
 
+	ImVec4 colors[5];
+	colors[ObjectTree::None] = ImGui::GetStyleColorVec4(ImGuiCol_Text);
+	float h, s, v;
+	ImGui::ColorConvertRGBtoHSV(colors[0].x, colors[0].y, colors[0].z, h, s, v);
+	for (int i = 1; i < 5; i++)
+	{
+		colors[i] = colors[0];
+		ImGui::ColorConvertHSVtoRGB((i - 1) * 0.25f, glm::min(1.0f, s + 0.5f), glm::min(1.0f, v + 0.5f), colors[i].x, colors[i].y, colors[i].z);
+	}
 
+	int rowCount = 0;
+	for (auto m : maps)
+	{
+		auto& tree = objectTrees[m];
+		tree.update(m);
+		rowCount += (int)tree.visibleRows.size();
+	}
+
+	//all maps are in 1 clipper, so only the rows on screen are drawn
+	ImGuiListClipper clipper;
+	clipper.Begin(rowCount);
+	while (clipper.Step())
+	{
+		std::size_t mapIndex = 0;
+		int first = 0;
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+		{
+			while (mapIndex < maps.size() && i - first >= (int)objectTrees[maps[mapIndex]].visibleRows.size())
+				first += (int)objectTrees[maps[mapIndex++]].visibleRows.size();
+			if (mapIndex >= maps.size()) //a node was closed while drawing
+				break;
+			Map* map = maps[mapIndex];
+			auto& tree = objectTrees[map];
+			drawObjectTreeRow(this, map, tree, tree.rows[tree.visibleRows[i - first]], colors);
+		}
+	}
+	clipper.End();
+	ImGui::PopFont();
+
+	ImGui::End();
+}
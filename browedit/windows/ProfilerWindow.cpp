@@ -0,0 +1,187 @@
+#include <Windows.h>
+#include <browedit/BrowEdit.h>
+#include <browedit/util/Profiler.h>
+#include <browedit/util/Util.h>
+
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include <imgui.h>
+#include <imgui_internal.h>
+
+#include <map>
+#include <set>
+#include <algorithm>
+
+#ifdef BROWEDIT_PROFILER
+static ImU32 zoneColor(const char* name)
+{
+	std::size_t hash = std::hash<std::string_view>()(name);
+	return ImColor::HSV((hash % 360) / 360.0f, 0.5f, 0.7f);
+}
+
+void BrowEdit::showProfilerWindow()
+{
+	if (!ImGui::Begin("Profiler", &windowData.profilerVisible))
+	{
+		ImGui::End();
+		return;
+	}
+	static int selectedFrame = -1; //-1 is always the last frame
+	static float zoom = 1.0f;
+
+	ImGui::Checkbox("Pause", &util::Profiler::paused);
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome trace"))
+	{
+		std::string fileName = util::SaveAsDialog("trace.json", "Json\0*.json\0");
+		if (fileName != "")
+		{
+			if (fileName.size() < 5 || fileName.substr(fileName.size() - 5) != ".json")
+				fileName += ".json";
+			util::Profiler::exportChromeTrace(fileName);
+		}
+	}
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(100);
+	ImGui::DragFloat("Zoom", &zoom, 0.05f, 1.0f, 100.0f);
+
+	auto frameTimes = util::Profiler::getFrameTimes();
+	if (frameTimes.empty())
+	{
+		ImGui::Text("No frames recorded yet");
+		ImGui::End();
+		return;
+	}
+	if (selectedFrame >= (int)frameTimes.size())
+		selectedFrame = -1;
+	int frameIndex = selectedFrame == -1 ? (int)frameTimes.size() - 1 : selectedFrame;
+
+	ImGui::PlotHistogram("##frames", frameTimes.data(), (int)frameTimes.size(), 0, nullptr, 0, 50.0f, ImVec2(ImGui::GetContentRegionAvail().x, 60));
+	if (ImGui::IsItemHovered())
+	{
+		float fraction = (ImGui::GetIO().MousePos.x - ImGui::GetItemRectMin().x) / ImGui::GetItemRectSize().x;
+		int hovered = glm::clamp((int)(fraction * frameTimes.size()), 0, (int)frameTimes.size() - 1);
+		ImGui::SetTooltip("Frame time: %.2f ms\nClick to inspect this frame", frameTimes[hovered]);
+		if (ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+		{
+			selectedFrame = hovered;
+			util::Profiler::paused = true;
+		}
+	}
+	if (selectedFrame != -1)
+	{
+		ImGui::SameLine();
+		if (ImGui::Button("Follow last frame"))
+		{
+			selectedFrame = -1;
+			util::Profiler::paused = false;
+		}
+	}
+
+	util::Profiler::Frame frame;
+	if (!util::Profiler::getFrame(frameIndex, frame))
+	{
+		ImGui::End();
+		return;
+	}
+	ImGui::Text("Frame %llu: %.2f ms", (unsigned long long)frame.index, (frame.end - frame.begin) / 1000.0f);
+
+	//timeline, 1 lane per thread with GPU zones on top, nested zones are stacked below each other
+	std::set<std::uint32_t> threads;
+	std::map<std::uint32_t, int> laneDepth;
+	for (const auto& e : frame.events)
+	{
+		threads.insert(e.threadId);
+		laneDepth[e.threadId] = glm::max(laneDepth[e.threadId], e.depth + 1);
+	}
+	const float rowHeight = ImGui::GetTextLineHeight() + 4;
+	float timelineHeight = 0;
+	for (auto t : threads)
+		timelineHeight += (laneDepth[t] + 1) * rowHeight;
+
+	ImGui::BeginChild("Timeline", ImVec2(0, glm::min(timelineHeight + 20, 400.0f)), true, ImGuiWindowFlags_HorizontalScrollbar);
+	float width = ImGui::GetContentRegionAvail().x * zoom;
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float frameDuration = (float)glm::max<std::int64_t>(frame.end - frame.begin, 1);
+	float y = 0;
+	for (auto t : threads)
+	{
+		drawList->AddText(origin + ImVec2(ImGui::GetScrollX(), y), ImGui::GetColorU32(ImGuiCol_TextDisabled), t == 0 ? "GPU" : ("Thread " + std::to_string(t)).c_str());
+		y += rowHeight;
+		for (const auto& e : frame.events)
+		{
+			if (e.threadId != t)
+				continue;
+			float x1 = glm::max(0.0f, (e.begin - frame.begin) / frameDuration) * width;
+			float x2 = glm::min(1.0f, (e.end - frame.begin) / frameDuration) * width;
+			if (x2 < x1 + 1)
+				x2 = x1 + 1;
+			ImVec2 min = origin + ImVec2(x1, y + e.depth * rowHeight);
+			ImVec2 max = origin + ImVec2(x2, y + (e.depth + 1) * rowHeight - 1);
+			drawList->AddRectFilled(min, max, zoneColor(e.name));
+			if (x2 - x1 > ImGui::CalcTextSize(e.name).x + 4)
+				drawList->AddText(min + ImVec2(2, 2), IM_COL32_WHITE, e.name);
+			if (ImGui::IsMouseHoveringRect(min, max) && ImGui::IsWindowHovered())
+				ImGui::SetTooltip("%s\n%.3f ms", e.name, (e.end - e.begin) / 1000.0f);
+		}
+		y += laneDepth[t] * rowHeight;
+	}
+	ImGui::Dummy(ImVec2(width, y));
+	ImGui::EndChild();
+
+	//totals per zone, to quickly see what is taking the most time
+	if (ImGui::BeginTable("Zones", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingStretchProp, ImVec2(0, 200)))
+	{
+		std::map<std::string, std::pair<std::int64_t, int>> totals;
+		for (const auto& e : frame.events)
+		{
+			auto& total = totals[(e.threadId == 0 ? "GPU: " : "") + std::string(e.name)];
+			total.first += e.end - e.begin;
+			total.second++;
+		}
+		std::vector<std::pair<std::string, std::pair<std::int64_t, int>>> sorted(totals.begin(), totals.end());
+		std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.first > b.second.first; });
+
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Zone");
+		ImGui::TableSetupColumn("Total (ms)");
+		ImGui::TableSetupColumn("Calls");
+		ImGui::TableHeadersRow();
+		for (const auto& t : sorted)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", t.first.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", t.second.first / 1000.0f);
+			ImGui::TableNextColumn();
+			ImGui::Text("%d", t.second.second);
+		}
+		ImGui::EndTable();
+	}
+
+	if (ImGui::BeginTable("Counters", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Counter");
+		ImGui::TableSetupColumn("Value");
+		ImGui::TableHeadersRow();
+		for (const auto& c : frame.counters)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", c.first);
+			ImGui::TableNextColumn();
+			ImGui::Text("%lld", (long long)c.second);
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+#else
+void BrowEdit::showProfilerWindow()
+{
+	if (ImGui::Begin("Profiler", &windowData.profilerVisible))
+		ImGui::Text("The profiler is disabled in this build");
+	ImGui::End();
+}
+#endif
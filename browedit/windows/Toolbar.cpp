@@ -6,6 +6,7 @@
 #include <browedit/Map.h>
 #include <browedit/components/Gnd.h>
 #include <browedit/components/Rsw.h>
+#include <browedit/components/GndRenderer.h>
 #include <browedit/util/ResourceManager.h>
 #include <browedit/gl/Texture.h>
 #include <browedit/Node.h>
@@ -199,6 +200,18 @@ void BrowEdit::toolbar()
 			ImGui::RenderFrame(bb.Min, bb.Max, 0, true, ImGui::GetStyle().FrameRounding);
 
 			ImGui::Text(txt);
+			auto gndRenderer = activeMapView->map->rootNode->getComponent<GndRenderer>();
+			if (gndRenderer && ImGui::IsItemHovered())
+			{
+				const auto& stats = gndRenderer->lastRebuild;
+				ImGui::SetTooltip("Ground mesh: %zu KB\nLast chunk rebuild: %d chunks in %.2f ms\nPer chunk: %.3f ms, %zu bytes\nChunks drawn: %d, culled: %d\nObjects drawn: %d, culled: %d",
+					gndRenderer->chunkBytes() / 1024,
+					stats.chunkCount, stats.wallTime,
+					stats.chunkCount > 0 ? stats.cpuTime / stats.chunkCount : 0.0f,
+					stats.chunkCount > 0 ? stats.bytes / stats.chunkCount : (std::size_t)0,
+					activeMapView->nodeRenderContext.stats.visibleChunks, activeMapView->nodeRenderContext.stats.culledChunks,
+					activeMapView->nodeRenderContext.visibleCount, activeMapView->nodeRenderContext.culledCount);
+			}
 		}
 	}
 	ImGui::PopStyleVar();
@@ -1,15 +1,17 @@
 #version 420
 
 uniform sampler2D s_texture;
+uniform sampler2D s_textureSelected;
 uniform vec4 color = vec4(1,1,1,1);
 in vec2 texCoord;
+flat in float selected;
 out vec4 fragColor;
 
 
 
 void main()
 {
-	vec4 outColor = texture2D(s_texture, texCoord);
+	vec4 outColor = selected > 0.5 ? texture2D(s_textureSelected, texCoord) : texture2D(s_texture, texCoord);
 	outColor *= color;
 	if(outColor.a < 0.1)
 		discard;
@@ -2,18 +2,20 @@
 
 layout (location = 0) in vec3 a_position;
 layout (location = 1) in vec2 a_texture;
+layout (location = 2) in vec3 a_center; //per billboard
+layout (location = 3) in float a_selected; //per billboard
 
 uniform mat4 projectionMatrix;
 uniform mat4 cameraMatrix;
-uniform mat4 modelMatrix;
-uniform float selection;
 
 out vec2 texCoord;
+flat out float selected;
 
 void main()
 {
 	texCoord = a_texture;
-	vec4 billboarded = projectionMatrix * (cameraMatrix * modelMatrix) * vec4(0.0,0.0,0.0,1.0);
+	selected = a_selected;
+	vec4 billboarded = projectionMatrix * cameraMatrix * vec4(a_center,1.0);
 	billboarded.xy += (projectionMatrix * vec4(a_position.x, a_position.y,0.0,1.0)).xy;
 	gl_Position = billboarded;
-}
\ No newline at end of file
+}
@@ -1,6 +1,6 @@
 #version 420
 
-uniform sampler2D s_texture;
+uniform sampler2DArray s_texture;
 uniform sampler2D s_lighting;
 
 uniform vec3 lightDiffuse;
@@ -23,25 +23,34 @@ in vec2 texCoord;
 in vec2 texCoord2;
 in vec3 normal;
 in vec4 color;
+flat in uint layer;
 
 out vec4 fragColor;
 //out vec4 fragSelection;
 
 void main()
 {
+	vec4 texColor = texture(s_texture, vec3(texCoord, layer)); //before the texture variable hides the function
 	vec4 texture = vec4(1,1,1,1);
 
-	vec4 texColor = texture2D(s_texture, texCoord);
-	texture = mix(vec4(1,1,1,texColor.a), texColor, viewTextures);
+	//tiles without texture are white, without colors or lightmap
+	bool emptyTile = layer == 65535u;
+
+	if(!emptyTile)
+		texture = mix(vec4(1,1,1,texColor.a), texColor, viewTextures);
 	if(texture.a < 0.1)
 		discard;
 
-	texture.rgb *= max(color, colorToggle).rgb;
-	texture.rgb *= max(texture2D(s_lighting, texCoord2).a, shadowMapToggle);
+	if(!emptyTile)
+	{
+		texture.rgb *= max(color, colorToggle).rgb;
+		texture.rgb *= max(texture2D(s_lighting, texCoord2).a, shadowMapToggle);
+	}
 
 
 	texture.rgb *= max((max(0.0, dot(normal, vec3(-1,-1,1)*lightDirection)) * lightDiffuse + lightIntensity * lightAmbient), lightToggle);
-	texture += clamp(vec4(texture2D(s_lighting, texCoord2).rgb,1.0), 0.0, 1.0) * lightColorToggle;
+	if(!emptyTile)
+		texture += clamp(vec4(texture2D(s_lighting, texCoord2).rgb,1.0), 0.0, 1.0) * lightColorToggle;
 
 	if(fogEnabled)
 	{
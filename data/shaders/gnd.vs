@@ -5,6 +5,7 @@ layout (location = 1) in vec2 a_texture;
 layout (location = 2) in vec2 a_texture2;
 layout (location = 3) in vec4 a_color;
 layout (location = 4) in vec3 a_normal;
+layout (location = 5) in uint a_layer;
 
 uniform mat4 projectionMatrix;
 uniform mat4 modelViewMatrix;
@@ -13,6 +14,7 @@ out vec2 texCoord;
 out vec2 texCoord2;
 out vec3 normal;
 out vec4 color;
+flat out uint layer;
 
 void main()
 {
@@ -20,5 +22,6 @@ void main()
 	texCoord2 = a_texture2;
 	normal = a_normal;
 	color = a_color;
+	layer = a_layer;
 	gl_Position = projectionMatrix * modelViewMatrix * vec4(a_position,1);
 }
\ No newline at end of file
@@ -1,13 +1,16 @@
 #version 420
 
-layout (location = 0) in vec3 a_position;
-layout (location = 1) in vec2 a_texcoord;
+//the grid is made from gl_VertexID, every instance is a chunk of chunkSize x chunkSize cells with 6 vertices per cell
+layout (location = 0) in ivec2 a_chunk; //first cell of the chunk
 //layout (location = 2) in vec3 a_normal;
 
 uniform mat4 modelMatrix = mat4(1.0);
 uniform mat4 viewMatrix = mat4(1.0);
 uniform mat4 projectionMatrix = mat4(1.0);
 
+uniform int chunkSize = 16;
+uniform int mapWidth;
+uniform int mapHeight;
 
 uniform float waterHeight;
 uniform float amplitude = 1;
@@ -18,16 +21,24 @@ uniform float time;
 //out vec3 normal;
 out vec2 texCoord;
 
+const ivec2 corners[6] = ivec2[6](ivec2(0,0), ivec2(1,0), ivec2(1,1), ivec2(0,0), ivec2(1,1), ivec2(0,1));
+
 void main()
 {
-	mat3 normalMatrix = mat3(viewMatrix * modelMatrix);
-	normalMatrix = transpose(inverse(normalMatrix));
-	texCoord = a_texcoord;
-//	normal = normalMatrix * a_normal;
+	ivec2 cell = a_chunk + ivec2((gl_VertexID / 6) % chunkSize, (gl_VertexID / 6) / chunkSize);
+	if(cell.x < 0 || cell.y < 0 || cell.x >= mapWidth || cell.y >= mapHeight)
+	{ //outside of the map, all vertices of the cell end up on the same spot so nothing is drawn
+		gl_Position = vec4(0,0,-2,1);
+		texCoord = vec2(0);
+		return;
+	}
+	ivec2 corner = corners[gl_VertexID % 6];
+	vec3 position = vec3(10 * (cell.x + corner.x), 0, 10 * (cell.y + corner.y + 1));
+	texCoord = vec2(cell % 4) * 0.25 + vec2(corner) * 0.25;
 
 	float height = waterHeight;
-	height += amplitude*cos(radians((waveSpeed*16.6667*time)+(a_position.x-a_position.z)*.1*wavePitch));
+	height += amplitude*cos(radians((waveSpeed*16.6667*time)+(position.x-position.z)*.1*wavePitch));
 
 
-	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(vec3(a_position.x, height, a_position.z),1);
+	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(vec3(position.x, height, position.z),1);
 }
\ No newline at end of file
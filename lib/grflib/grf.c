@@ -45,6 +45,17 @@
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 GRFEXTERN_BEGIN
 
 /* Headers */
@@ -706,14 +717,464 @@ GRF_find_unused (Grf *grf, uint32_t len)
 #endif /* 0 too */
 
 
+/* Thin wrappers around the native threading primitives, used by
+ * grf_put_many() to compress on several threads
+ */
+#ifdef _WIN32
+typedef HANDLE GRF_Thread;
+typedef CRITICAL_SECTION GRF_Mutex;
+typedef CONDITION_VARIABLE GRF_Cond;
+# define GRF_THREADPROC DWORD WINAPI
+# define GRF_THREADRET 0
+# define GRF_MutexInit(m) InitializeCriticalSection(m)
+# define GRF_MutexFree(m) DeleteCriticalSection(m)
+# define GRF_MutexLock(m) EnterCriticalSection(m)
+# define GRF_MutexUnlock(m) LeaveCriticalSection(m)
+# define GRF_CondInit(c) InitializeConditionVariable(c)
+# define GRF_CondFree(c)
+# define GRF_CondWait(c,m) SleepConditionVariableCS(c,m,INFINITE)
+# define GRF_CondBroadcast(c) WakeAllConditionVariable(c)
+# define GRF_ThreadStart(t,func,arg) ((*(t)=CreateThread(NULL,0,func,arg,0,NULL))!=NULL)
+# define GRF_ThreadJoin(t) (WaitForSingleObject(t,INFINITE), CloseHandle(t))
+# define GRF_Truncate(f,len) _chsize_s(_fileno(f),len)
+#else
+typedef pthread_t GRF_Thread;
+typedef pthread_mutex_t GRF_Mutex;
+typedef pthread_cond_t GRF_Cond;
+# define GRF_THREADPROC void *
+# define GRF_THREADRET NULL
+# define GRF_MutexInit(m) pthread_mutex_init(m,NULL)
+# define GRF_MutexFree(m) pthread_mutex_destroy(m)
+# define GRF_MutexLock(m) pthread_mutex_lock(m)
+# define GRF_MutexUnlock(m) pthread_mutex_unlock(m)
+# define GRF_CondInit(c) pthread_cond_init(c,NULL)
+# define GRF_CondFree(c) pthread_cond_destroy(c)
+# define GRF_CondWait(c,m) pthread_cond_wait(c,m)
+# define GRF_CondBroadcast(c) pthread_cond_broadcast(c)
+# define GRF_ThreadStart(t,func,arg) (pthread_create(t,NULL,func,arg)==0)
+# define GRF_ThreadJoin(t) pthread_join(t,NULL)
+# define GRF_Truncate(f,len) ftruncate(fileno(f),len)
+#endif
+
+/** Size of the blocks entries are split in when compressing.
+ * Each block is a separate job, so large files are compressed on several threads too
+ */
+#define GRF_PUT_BLOCKLEN	0x100000
+/** Number of compressed blocks that may wait in memory to be written */
+#define GRF_PUT_AHEAD		4
+/** Size of the deflate window, blocks are primed with this much of the data before them */
+#define GRF_PUT_DICTLEN		0x8000
+
+/** Private structure for a block of an entry that is being compressed */
+typedef struct {
+	const uint8_t *data;	/**< Uncompressed data of this block */
+	uint32_t len;		/**< Length of the uncompressed data */
+	uint32_t dictlen;	/**< Amount of data before GrfPutBlock::data to use as dictionary */
+	int last;		/**< Set for the last block of an entry, which ends the deflate stream */
+
+	uint8_t *out;		/**< Compressed data, raw deflate */
+	uint32_t outlen;	/**< Length of the compressed data */
+	uLong adler;		/**< Adler-32 checksum of the uncompressed data */
+	int z;			/**< zlib return value */
+	int done;		/**< Set when the block is compressed */
+} GrfPutBlock;
+
+/** Private structure shared by the threads compressing for grf_put_many() */
+typedef struct {
+	GrfPutBlock *blocks;
+	uint32_t nblocks;
+	uint32_t next;		/**< Next block to be compressed */
+	uint32_t written;	/**< Number of blocks written to disk so far */
+	uint32_t ahead;		/**< Maximum number of blocks compressed ahead of GrfPutQueue::written */
+	int abort;		/**< Set when the writer failed, the workers stop */
+
+	GRF_Mutex mutex;
+	GRF_Cond cond;
+} GrfPutQueue;
+
+
+/** Private function to get the number of processors, used as default thread count */
+static uint32_t
+GRF_CpuCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (uint32_t) n : 1;
+#endif
+}
+
+
+/** Private function to compress a single block.
+ *
+ * Blocks are compressed as raw deflate data, flushed to a byte boundary,
+ * so the blocks of an entry can simply be concatenated into a single stream.
+ * The result is stored in the block itself.
+ *
+ * @param b Block to compress
+ */
+static void
+GRF_DeflateBlock(GrfPutBlock *b)
+{
+	z_stream zs;
+	uLong bound;
+
+	b->adler = adler32(adler32(0L, Z_NULL, 0), (const Bytef*) b->data, b->len);
+
+	memset(&zs, 0, sizeof(zs));
+	if ((b->z = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY)) != Z_OK)
+		return;
+
+	/* Prime with the end of the previous block, so splitting the entry costs
+	 * (next to) nothing in compression ratio
+	 */
+	if (b->dictlen && (b->z = deflateSetDictionary(&zs, (const Bytef*) b->data - b->dictlen, b->dictlen)) != Z_OK) {
+		deflateEnd(&zs);
+		return;
+	}
+
+	/* Room for the empty stored block of the sync flush */
+	bound = deflateBound(&zs, b->len) + 16;
+	if ((b->out = (uint8_t*) malloc(bound)) == NULL) {
+		deflateEnd(&zs);
+		b->z = Z_MEM_ERROR;
+		return;
+	}
+
+	zs.next_in = (Bytef*) b->data;
+	zs.avail_in = b->len;
+	zs.next_out = b->out;
+	zs.avail_out = bound;
+	b->z = deflate(&zs, b->last ? Z_FINISH : Z_SYNC_FLUSH);
+	if (zs.avail_in == 0 && b->z == (b->last ? Z_STREAM_END : Z_OK))
+		b->z = Z_OK;
+	else if (b->z == Z_OK || b->z == Z_STREAM_END)
+		b->z = Z_BUF_ERROR;
+	b->outlen = (uint32_t) (bound - zs.avail_out);
+	deflateEnd(&zs);
+}
+
+
+/** Private function to take the next block from the queue and compress it.
+ *
+ * @warning Must be called with GrfPutQueue::mutex locked, and returns with it locked
+ */
+static void
+GRF_CompressNext(GrfPutQueue *q)
+{
+	GrfPutBlock *b = &q->blocks[q->next++];
+
+	GRF_MutexUnlock(&q->mutex);
+	GRF_DeflateBlock(b);
+	GRF_MutexLock(&q->mutex);
+
+	b->done = 1;
+	GRF_CondBroadcast(&q->cond);
+}
+
+
+/** Private function to check if the next block in the queue may be compressed */
+#define GRF_CanCompress(q) (!(q)->abort && (q)->next < (q)->nblocks && (q)->next < (q)->written + (q)->ahead)
+
+
+/** Private thread function compressing blocks until the queue is empty */
+static GRF_THREADPROC
+GRF_PutWorker(void *arg)
+{
+	GrfPutQueue *q = (GrfPutQueue*) arg;
+
+	GRF_MutexLock(&q->mutex);
+	while (!q->abort && q->next < q->nblocks) {
+		/* Don't run too far ahead of the writer, the compressed blocks
+		 * stay in memory until they are written
+		 */
+		if (GRF_CanCompress(q))
+			GRF_CompressNext(q);
+		else
+			GRF_CondWait(&q->cond, &q->mutex);
+	}
+	GRF_MutexUnlock(&q->mutex);
+	return GRF_THREADRET;
+}
+
+
+/** Private function to compress entries and write them to the archive.
+ *
+ * Entries are split into blocks that are compressed on a pool of threads,
+ * and written in the order they are given, as soon as they are done. The
+ * output doesn't depend on the amount of threads.
+ *
+ * @param grf     Archive to write to
+ * @param count   Number of entries
+ * @param data    Uncompressed data of each entry
+ * @param lens    Length of each entry
+ * @param pos     [out] Position of each entry in the archive
+ * @param zlens   [out] Compressed length of each entry
+ * @param threads Number of threads to compress with, 0 to use one per processor
+ * @param offset  [in,out] Position to start writing at, is set to the end of the written data
+ * @param error   Pointer to a GrfError structure for error reporting
+ * @return 0 on success, 1 on error
+ */
+static int
+GRF_WriteEntries(Grf *grf, uint32_t count, const void **data, const uint32_t *lens, __int64 *pos, uint32_t *zlens, uint32_t threads, __int64 *offset, GrfError *error)
+{
+	static const uint8_t zheader[2] = { 0x78, 0x9C };
+	GrfPutQueue q;
+	GrfPutBlock *b;
+	GRF_Thread *pool = NULL;
+	uint32_t i, j, k, nthreads = 0, zlen;
+	uint8_t trailer[4];
+	uLong adler;
+	int ret = 1;
+
+	/* Split the entries in blocks */
+	memset(&q, 0, sizeof(q));
+	for (i = 0; i < count; i++)
+		q.nblocks += (lens[i] + GRF_PUT_BLOCKLEN - 1) / GRF_PUT_BLOCKLEN;
+	if (q.nblocks && (q.blocks = (GrfPutBlock*) calloc(q.nblocks, sizeof(GrfPutBlock))) == NULL) {
+		GRF_SETERR(error,GE_ERRNO,calloc);
+		return 1;
+	}
+	for (i = k = 0; i < count; i++)
+		for (j = 0; j < lens[i]; j += GRF_PUT_BLOCKLEN, k++) {
+			q.blocks[k].data = (const uint8_t*) data[i] + j;
+			q.blocks[k].len = lens[i] - j < GRF_PUT_BLOCKLEN ? lens[i] - j : GRF_PUT_BLOCKLEN;
+			q.blocks[k].dictlen = j < GRF_PUT_DICTLEN ? j : GRF_PUT_DICTLEN;
+			q.blocks[k].last = j + GRF_PUT_BLOCKLEN >= lens[i];
+		}
+
+	if (threads == 0)
+		threads = GRF_CpuCount();
+	if (threads > q.nblocks)
+		threads = q.nblocks;
+	q.ahead = threads * GRF_PUT_AHEAD;
+	GRF_MutexInit(&q.mutex);
+	GRF_CondInit(&q.cond);
+
+	/* The calling thread writes, and helps compressing when it has to wait.
+	 * So if starting threads fails, this still works with fewer threads
+	 */
+	if (threads > 1 && (pool = (GRF_Thread*) malloc(sizeof(GRF_Thread) * (threads - 1))) != NULL)
+		for (; nthreads < threads - 1; nthreads++)
+			if (!GRF_ThreadStart(&pool[nthreads], GRF_PutWorker, &q))
+				break;
+
+	if (_fseeki64(grf->f, *offset, SEEK_SET)) {
+		GRF_SETERR(error,GE_ERRNO,fseek);
+		goto grf_writeentries_cleanup;
+	}
+
+	for (i = k = 0; i < count; i++) {
+		pos[i] = *offset;
+		zlens[i] = 0;
+		if (lens[i] == 0)
+			continue;
+
+		/* Blocks are raw deflate, so wrap them in a zlib stream ourselves */
+		if (!fwrite(zheader, sizeof(zheader), 1, grf->f)) {
+			GRF_SETERR(error,GE_ERRNO,fwrite);
+			goto grf_writeentries_cleanup;
+		}
+		zlen = sizeof(zheader);
+		adler = adler32(0L, Z_NULL, 0);
+
+		do {
+			b = &q.blocks[k];
+
+			/* Wait for the block, compressing other blocks meanwhile */
+			GRF_MutexLock(&q.mutex);
+			while (!b->done) {
+				if (GRF_CanCompress(&q))
+					GRF_CompressNext(&q);
+				else
+					GRF_CondWait(&q.cond, &q.mutex);
+			}
+			GRF_MutexUnlock(&q.mutex);
+
+			if (b->z != Z_OK) {
+				GRF_SETERR_2(error,GE_ZLIB,deflate,(ssize_t)b->z);
+				goto grf_writeentries_cleanup;
+			}
+			if ((uint64_t) zlen + b->outlen + sizeof(trailer) > 0xFFFFFFFFU) {
+				GRF_SETERR(error,GE_NSUP,GRF_WriteEntries);
+				goto grf_writeentries_cleanup;
+			}
+			if (b->outlen && !fwrite(b->out, b->outlen, 1, grf->f)) {
+				GRF_SETERR(error,GE_ERRNO,fwrite);
+				goto grf_writeentries_cleanup;
+			}
+			zlen += b->outlen;
+			adler = adler32_combine(adler, b->adler, b->len);
+
+			/* Done with this block, let the workers continue */
+			free(b->out);
+			b->out = NULL;
+			GRF_MutexLock(&q.mutex);
+			q.written++;
+			GRF_CondBroadcast(&q.cond);
+			GRF_MutexUnlock(&q.mutex);
+		} while (!q.blocks[k++].last);
+
+		/* Adler-32 of the uncompressed data, big endian */
+		trailer[0] = (uint8_t) (adler >> 24);
+		trailer[1] = (uint8_t) (adler >> 16);
+		trailer[2] = (uint8_t) (adler >> 8);
+		trailer[3] = (uint8_t) adler;
+		if (!fwrite(trailer, sizeof(trailer), 1, grf->f)) {
+			GRF_SETERR(error,GE_ERRNO,fwrite);
+			goto grf_writeentries_cleanup;
+		}
+		zlens[i] = zlen + sizeof(trailer);
+		*offset += zlens[i];
+	}
+	ret = 0;
+
+grf_writeentries_cleanup:
+	GRF_MutexLock(&q.mutex);
+	q.abort = 1;
+	GRF_CondBroadcast(&q.cond);
+	GRF_MutexUnlock(&q.mutex);
+	for (i = 0; i < nthreads; i++)
+		GRF_ThreadJoin(pool[i]);
+	free(pool);
+
+	for (k = 0; k < q.nblocks; k++)
+		free(q.blocks[k].out);
+	free(q.blocks);
+	GRF_CondFree(&q.cond);
+	GRF_MutexFree(&q.mutex);
+	return ret;
+}
+
+
+/** Private function to write the file table and header of a version 0x200 archive.
+ *
+ * The table is written at offset, and the file is truncated after it.
+ * The header is written last, so the archive stays readable with the old table
+ * until the new one is completely written.
+ *
+ * @param grf    Archive to write
+ * @param offset Position to write the file table at
+ * @param error  Pointer to a GrfError structure for error reporting
+ * @return 0 on success, 1 on error
+ */
+static int
+GRF_WriteTable(Grf *grf, __int64 offset, GrfError *error)
+{
+	uint32_t i, len, tablelen = 0, header[4], sizes[2];
+	uLongf zlen;
+	uint8_t *table, *p;
+	char *zbuf;
+	int z;
+
+	/* The table stores 32 bit offsets */
+	if (offset - (__int64) GRF_HEADER_FULL_LEN > 0xFFFFFFFFLL) {
+		GRF_SETERR(error,GE_NSUP,GRF_WriteTable);
+		return 1;
+	}
+
+	/* Build the file table, the reverse of GRF_readVer2_info() */
+	for (i = 0; i < grf->nfiles; i++)
+		tablelen += (uint32_t) strlen(grf->files[i].name) + 1 + 0x11;
+	if ((table = (uint8_t*) malloc(tablelen + 1)) == NULL) {
+		GRF_SETERR(error,GE_ERRNO,malloc);
+		return 1;
+	}
+	for (i = 0, p = table; i < grf->nfiles; i++) {
+		len = (uint32_t) strlen(grf->files[i].name) + 1;
+		memcpy(p, grf->files[i].name, len);
+		p += len;
+		header[0] = ToLittleEndian32(grf->files[i].compressed_len);
+		header[1] = ToLittleEndian32(grf->files[i].compressed_len_aligned);
+		header[2] = ToLittleEndian32(grf->files[i].real_len);
+		header[3] = ToLittleEndian32(grf->files[i].pos >= (__int64) GRF_HEADER_FULL_LEN ? (uint32_t) (grf->files[i].pos - GRF_HEADER_FULL_LEN) : 0);
+		memcpy(p, header, 0xC);
+		p[0xC] = grf->files[i].flags;
+		memcpy(p + 0xD, &header[3], 4);
+		p += 0x11;
+	}
+
+	/* Compress it */
+	zlen = compressBound(tablelen);
+	if ((zbuf = (char*) malloc(zlen)) == NULL) {
+		free(table);
+		GRF_SETERR(error,GE_ERRNO,malloc);
+		return 1;
+	}
+	if ((z = compress2((Bytef*) zbuf, &zlen, (const Bytef*) table, tablelen, Z_BEST_COMPRESSION)) != Z_OK) {
+		free(table);
+		free(zbuf);
+		GRF_SETERR_2(error,GE_ZLIB,compress2,(ssize_t)z);
+		return 1;
+	}
+	free(table);
+
+	/* Write the table, and cut off whatever was after it */
+	sizes[0] = ToLittleEndian32((uint32_t) zlen);
+	sizes[1] = ToLittleEndian32(tablelen);
+	if (_fseeki64(grf->f, offset, SEEK_SET)) {
+		free(zbuf);
+		GRF_SETERR(error,GE_ERRNO,fseek);
+		return 1;
+	}
+	if (!fwrite(sizes, sizeof(sizes), 1, grf->f) || !fwrite(zbuf, zlen, 1, grf->f) || fflush(grf->f)) {
+		free(zbuf);
+		GRF_SETERR(error,GE_ERRNO,fwrite);
+		return 1;
+	}
+	free(zbuf);
+	grf->len = offset + sizeof(sizes) + zlen;
+	if (GRF_Truncate(grf->f, grf->len)) {
+		GRF_SETERR(error,GE_ERRNO,GRF_Truncate);
+		return 1;
+	}
+
+	/* And finally point the header to it */
+	header[0] = ToLittleEndian32((uint32_t) (offset - GRF_HEADER_FULL_LEN));
+	header[1] = 0;
+	header[2] = ToLittleEndian32(grf->nfiles + 7);
+	header[3] = ToLittleEndian32(0x200);
+	if (_fseeki64(grf->f, GRF_HEADER_MID_LEN, SEEK_SET)) {
+		GRF_SETERR(error,GE_ERRNO,fseek);
+		return 1;
+	}
+	if (!fwrite(header, sizeof(header), 1, grf->f) || fflush(grf->f)) {
+		GRF_SETERR(error,GE_ERRNO,fwrite);
+		return 1;
+	}
+	return 0;
+}
+
+
+/** Private function to find the end of the data in an archive.
+ *
+ * @return Position right after the last entry, or after the old file table if that is further
+ */
+static __int64
+GRF_DataEnd(Grf *grf)
+{
+	__int64 end = grf->len > (__int64) GRF_HEADER_FULL_LEN ? grf->len : (__int64) GRF_HEADER_FULL_LEN;
+	uint32_t i;
+
+	for (i = 0; i < grf->nfiles; i++)
+		if (!GRFFILE_IS_DIR(grf->files[i]) && grf->files[i].pos > 0 &&
+		  grf->files[i].pos + grf->files[i].compressed_len_aligned > end)
+			end = grf->files[i].pos + grf->files[i].compressed_len_aligned;
+	return end;
+}
+
+
 /********************
  * Public Functions *
  ********************/
 
 /** Open or create a GRF file and read its contents.
  *
- * If the file is created, a valid header is produced. It is updated when file is closed
- * using grf_close() or when grf_callback_flush() is called.
+ * If the file is created, a valid header is produced. It is updated
+ * when grf_flush() or grf_put_many() is called.
  *
  * @see GrfOpenCallback, grf_open
  *
@@ -778,6 +1239,7 @@ grf_callback_open (const char *fname, const char *mode, GrfError *error, GrfOpen
 			return NULL;
 		}
 		/* storing "compressed" length into zlen */
+		zlen = zlenmax;
 		if ((z=compress((Bytef*)zbuf, &zlen, (const Bytef*)buf, 0))!=Z_OK) {
 			GRF_SETERR_2(error,GE_ZLIB,compress,(ssize_t)z);  /* NOTE: uint => ssize_t /-signed-/ => uintptr* conversion */
 			return NULL;
@@ -1065,6 +1527,43 @@ grf_index_get (Grf *grf, uint32_t index, uint32_t *size, GrfError *error)
 }
 
 
+/*! \brief Check if the data of a file is only a copy of what is stored in the archive
+ *
+ * Files that were added or replaced but not flushed yet have no position,
+ * their data is the only copy.
+ */
+#define GRFFILE_IS_CACHED(f) (((f).flags & GRFFILE_FLAG_FILE) && (f).data && (f).pos != 0)
+
+/*! \brief Free files kept in memory by grf_index_get()
+ *
+ * grf_index_get() keeps every file it extracted in memory, so reading the
+ * file again doesn't have to decompress it again. This frees them, except
+ * files that were added or replaced and not flushed yet.
+ * Pointers returned by grf_index_get() for the freed files become invalid.
+ *
+ * \param grf Pointer to a Grf structure, as returned by grf_callback_open()
+ * \param bytes Amount of bytes to free, 0 to free everything
+ * \return The amount of bytes that were freed
+ */
+GRFEXPORT size_t
+grf_cache_free(Grf *grf, size_t bytes)
+{
+	size_t freed = 0;
+	uint32_t i;
+
+	if (!grf || grf->type!=GRF_TYPE_GRF)
+		return 0;
+	for (i = 0; i < grf->nfiles && (bytes == 0 || freed < bytes); i++) {
+		if (!GRFFILE_IS_CACHED(grf->files[i]))
+			continue;
+		freed += grf->files[i].real_len + 1;
+		free(grf->files[i].data);
+		grf->files[i].data = NULL;
+	}
+	return freed;
+}
+
+
 /*! \brief Retrieve the compressed block of a file (pointed to by its index)
  *
  * \sa grf_get_z
@@ -1543,8 +2042,8 @@ grf_index_replace(Grf *grf, uint32_t index, const void *data, uint32_t len, uint
 		/* Update old info */
 		gf->real_len=len;
 
-		/* These will be set with grf_callback_flush() when the data is compressed,
-		 * encrypted, and written
+		/* These will be set with grf_flush() when the data is compressed
+		 * and written
 		 */
 		gf->compressed_len=/*0;*/
 		gf->compressed_len_aligned=/*0;*/
@@ -1633,7 +2132,7 @@ grf_put(Grf *grf, const char *name, const void *data, uint32_t len, uint8_t flag
 	++grf->nfiles;
 	/* reusing code from grf_index_replace();
 	 * Setting the rest of the information (about compression)
-	 * has to be taken care of by grf_callback_flush()
+	 * has to be taken care of by grf_flush()
 	 */
 	if (0==grf_index_replace(grf,grf->nfiles-1,data,len,flags,error)) {
 		--grf->nfiles;
@@ -1646,6 +2145,164 @@ grf_put(Grf *grf, const char *name, const void *data, uint32_t len, uint8_t flag
 
 
 
+/*! \brief Add or replace many files at once, and save the archive.
+ *
+ * The files are compressed on several threads and appended to the archive in the
+ * order they are given, so the result is the same regardless of the thread count.
+ * Files added earlier with grf_put() are written too, and the file table is saved,
+ * so this also makes changes from grf_del() permanent.
+ * The data of replaced files stays in the archive as unused space until grf_repak().
+ *
+ * \note Only version 0x200 archives can be written. Files are stored compressed, but
+ *	never encrypted.
+ *
+ * \param grf Pointer to a Grf structure, as returned by grf_callback_open()
+ * \param count Number of files to add
+ * \param names Names of the destination files inside the GRF
+ * \param data Data of each file. Only needs to stay valid during this call
+ * \param lens Length of each file
+ * \param threads Number of threads to compress with, 0 to use one per processor
+ * \param error Pointer to a GrfError structure for error reporting
+ * \return The number of files successfully added
+ */
+GRFEXPORT int
+grf_put_many(Grf *grf, uint32_t count, const char **names, const void **data, const uint32_t *lens, uint32_t threads, GrfError *error)
+{
+	uint32_t i, j, total, npending = 0, index;
+	const void **wdata;
+	uint32_t *wlens, *zlens;
+	__int64 *pos, offset;
+	GrfFile *gf, *realloc_files;
+
+	/* Check our arguments */
+	if (!grf || (count > 0 && (!names || !data || !lens))) {
+		GRF_SETERR(error,GE_BADARGS,grf_put_many);
+		return 0;
+	}
+	if (grf->allowWrite == 0) {
+		GRF_SETERR(error,GE_BADMODE,grf_put_many);
+		return 0;
+	}
+	if (grf->version != 0x200) {
+		GRF_SETERR(error,GE_NSUP,grf_put_many);
+		return 0;
+	}
+	for (i = 0; i < count; i++)
+		if (!names[i] || strlen(names[i]) + 1 >= GRF_NAMELEN || (!data[i] && lens[i] > 0)) {
+			GRF_SETERR(error,GE_BADARGS,grf_put_many);
+			return 0;
+		}
+
+	/* Files from grf_put() only live in memory until now */
+	for (i = 0; i < grf->nfiles; i++)
+		if ((grf->files[i].flags & GRFFILE_FLAG_FILE) && grf->files[i].pos == 0 && grf->files[i].data)
+			npending++;
+
+	/* Everything that will be written: first the files given, then the pending ones */
+	total = count + npending;
+	wdata = (const void**) malloc(sizeof(void*) * (total + 1));
+	wlens = (uint32_t*) malloc(sizeof(uint32_t) * (total + 1));
+	zlens = (uint32_t*) malloc(sizeof(uint32_t) * (total + 1));
+	pos = (__int64*) malloc(sizeof(__int64) * (total + 1));
+	if (!wdata || !wlens || !zlens || !pos) {
+		free((void*) wdata);
+		free(wlens);
+		free(zlens);
+		free(pos);
+		GRF_SETERR(error,GE_ERRNO,malloc);
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		wdata[i] = data[i];
+		wlens[i] = lens[i];
+	}
+	for (i = 0, j = count; i < grf->nfiles; i++)
+		if ((grf->files[i].flags & GRFFILE_FLAG_FILE) && grf->files[i].pos == 0 && grf->files[i].data) {
+			wdata[j] = grf->files[i].data;
+			wlens[j++] = grf->files[i].real_len;
+		}
+
+	/* Make room for the new entries up front, so nothing can fail after writing */
+	if (count && (realloc_files = (GrfFile*) realloc(grf->files, (grf->nfiles + count) * sizeof(GrfFile))) == NULL) {
+		free((void*) wdata);
+		free(wlens);
+		free(zlens);
+		free(pos);
+		GRF_SETERR(error,GE_ERRNO,realloc);
+		return 0;
+	}
+	else if (count)
+		grf->files = realloc_files;
+
+	/* Append the data after everything that is in the archive now, so the
+	 * old file table stays valid until the new one is written
+	 */
+	offset = GRF_DataEnd(grf);
+	if (GRF_WriteEntries(grf, total, wdata, wlens, pos, zlens, threads, &offset, error)) {
+		free((void*) wdata);
+		free(wlens);
+		free(zlens);
+		free(pos);
+		return 0;
+	}
+
+	/* Update the index */
+	for (i = 0, j = count; i < grf->nfiles; i++)
+		if ((grf->files[i].flags & GRFFILE_FLAG_FILE) && grf->files[i].pos == 0 && grf->files[i].data) {
+			grf->files[i].flags = GRFFILE_FLAG_FILE;
+			grf->files[i].compressed_len = grf->files[i].compressed_len_aligned = zlens[j];
+			grf->files[i].pos = pos[j++];
+		}
+	for (i = 0; i < count; i++) {
+		if ((gf = grf_find(grf, names[i], &index)) != NULL) {
+			free(gf->data);
+			gf->data = NULL;
+		}
+		else {
+			gf = &grf->files[grf->nfiles++];
+			memset(gf, 0x00, sizeof(GrfFile));
+			strcpy(gf->name, names[i]);
+			gf->hash = GRF_NameHash(names[i]);
+		}
+		gf->flags = GRFFILE_FLAG_FILE;
+		gf->real_len = lens[i];
+		gf->compressed_len = gf->compressed_len_aligned = zlens[i];
+		gf->pos = pos[i];
+	}
+	free((void*) wdata);
+	free(wlens);
+	free(zlens);
+	free(pos);
+
+	if (GRF_WriteTable(grf, offset, error))
+		return 0;
+
+	GRF_SETERR(error,GE_SUCCESS,grf_put_many);
+	return (int) count;
+}
+
+
+/*! \brief Save changes made with grf_put(), grf_replace() and grf_del() to the archive.
+ *
+ * \sa grf_put_many
+ *
+ * \param grf Pointer to a Grf structure, as returned by grf_callback_open()
+ * \param error Pointer to a GrfError structure for error reporting
+ * \return 1 on success, 0 if an error occurred
+ */
+GRFEXPORT int
+grf_flush(Grf *grf, GrfError *error)
+{
+	GrfError err;
+
+	if (!error)
+		error = &err;
+	error->type = GE_SUCCESS;
+	grf_put_many(grf, 0, NULL, NULL, NULL, 0, error);
+	return error->type == GE_SUCCESS;
+}
+
+
 /** Save and close a GRF file, and free allocated memory.
  *
  * @param grf The Grf variable to close.
@@ -1697,19 +2354,127 @@ grf_free(Grf *grf)
 }
 
 
+/** Private structure to sort the entries of an archive on their position */
+typedef struct {
+	__int64 pos;
+	uint32_t index;
+} GrfRepakEntry;
+
+/** Private qsort() callback for GrfRepakEntry */
+static int
+GRF_RepakSort(const void *a, const void *b)
+{
+	const GrfRepakEntry *e1 = (const GrfRepakEntry*) a, *e2 = (const GrfRepakEntry*) b;
+	return e1->pos < e2->pos ? -1 : (e1->pos > e2->pos ? 1 : 0);
+}
+
 /** Completely restructure a GRF archive.
+ *
+ * Removes all unused space from the archive. Entries are copied as they are
+ * stored, without decompressing or decrypting them, in the order they are in
+ * the original archive.
+ *
+ * @note Only version 0x200 archives can be repacked
  *
  * @param grf    Filename of the original GRF
  * @param tmpgrf Filename to use temporarily while restructuring
  * @param error  Pointer to a GrfErrorType struct/enum for error reporting
- * @return 0 if an error occurred, 1 if repacking failed
+ * @return 0 if an error occurred, 1 if repacking succeeded
  */
 GRFEXPORT int
 grf_repak(const char *grf, const char *tmpgrf, GrfError *error)
 {
-	/** @todo Write this code! */
-	GRF_SETERR(error,GE_NOTIMPLEMENTED,grf_repak);
-	return 0;
+	Grf *src, *dst;
+	GrfRepakEntry *order;
+	GrfFile *gf;
+	char *buf = NULL, *realloc_buf;
+	uint32_t i, n = 0, buflen = 0;
+	__int64 offset = GRF_HEADER_FULL_LEN;
+
+	if (!grf || !tmpgrf) {
+		GRF_SETERR(error,GE_BADARGS,grf_repak);
+		return 0;
+	}
+	if ((src = grf_open(grf, "rb", error)) == NULL)
+		return 0;
+	if (src->version != 0x200) {
+		grf_free(src);
+		GRF_SETERR(error,GE_NSUP,grf_repak);
+		return 0;
+	}
+	if ((dst = grf_open(tmpgrf, "w+b", error)) == NULL) {
+		grf_free(src);
+		return 0;
+	}
+
+	/* The new archive gets the same index, only the positions change */
+	if ((order = (GrfRepakEntry*) malloc(sizeof(GrfRepakEntry) * (src->nfiles + 1))) == NULL ||
+	  (src->nfiles && (dst->files = (GrfFile*) malloc(sizeof(GrfFile) * src->nfiles)) == NULL)) {
+		free(order);
+		grf_free(src);
+		grf_free(dst);
+		GRF_SETERR(error,GE_ERRNO,malloc);
+		return 0;
+	}
+	dst->nfiles = src->nfiles;
+	for (i = 0; i < src->nfiles; i++) {
+		dst->files[i] = src->files[i];
+		dst->files[i].data = NULL;
+		if (!GRFFILE_IS_DIR(src->files[i]) && src->files[i].compressed_len_aligned > 0) {
+			order[n].pos = src->files[i].pos;
+			order[n++].index = i;
+		}
+	}
+
+	/* Copy in the order of the original, so both archives are read and written sequentially */
+	qsort(order, n, sizeof(GrfRepakEntry), GRF_RepakSort);
+	for (i = 0; i < n; i++) {
+		gf = &dst->files[order[i].index];
+		if (gf->compressed_len_aligned > buflen) {
+			if ((realloc_buf = (char*) realloc(buf, gf->compressed_len_aligned)) == NULL) {
+				GRF_SETERR(error,GE_ERRNO,realloc);
+				break;
+			}
+			buf = realloc_buf;
+			buflen = gf->compressed_len_aligned;
+		}
+		if (_fseeki64(src->f, gf->pos, SEEK_SET) || _fseeki64(dst->f, offset, SEEK_SET)) {
+			GRF_SETERR(error,GE_ERRNO,fseek);
+			break;
+		}
+		if (!fread(buf, gf->compressed_len_aligned, 1, src->f)) {
+			if (feof(src->f))
+				GRF_SETERR(error,GE_CORRUPTED,grf_repak);
+			else
+				GRF_SETERR(error,GE_ERRNO,fread);
+			break;
+		}
+		if (!fwrite(buf, gf->compressed_len_aligned, 1, dst->f)) {
+			GRF_SETERR(error,GE_ERRNO,fwrite);
+			break;
+		}
+		gf->pos = offset;
+		offset += gf->compressed_len_aligned;
+	}
+	free(buf);
+	free(order);
+	grf_free(src);
+
+	if (i < n || GRF_WriteTable(dst, offset, error)) {
+		grf_free(dst);
+		remove(tmpgrf);
+		return 0;
+	}
+	grf_free(dst);
+
+	/* Replace the original */
+	if (remove(grf) || rename(tmpgrf, grf)) {
+		GRF_SETERR(error,GE_ERRNO,rename);
+		return 0;
+	}
+
+	GRF_SETERR(error,GE_SUCCESS,grf_repak);
+	return 1;
 }
 
 
@@ -80,6 +80,9 @@ GRFEXPORT void *grf_index_chunk_get (Grf *grf, uint32_t index, char *buf, uint32
 GRFEXPORT int grf_extract (Grf *grf, const char *grfname, const char *file, GrfError *error);
 GRFEXPORT int grf_index_extract (Grf *grf, uint32_t index, const char *file, GrfError *error);
 
+/* Freeing extracted files */
+GRFEXPORT size_t grf_cache_free(Grf *grf, size_t bytes);
+
 /* GRF modification functions */
 GRFEXPORT int grf_del(Grf *grf, const char *fname, GrfError *error);
 GRFEXPORT int grf_index_del(Grf *grf, uint32_t index, GrfError *error);
@@ -88,6 +91,10 @@ GRFEXPORT int grf_replace(Grf *grf, const char *name, const void *data, uint32_t
 GRFEXPORT int grf_index_replace(Grf *grf, uint32_t index, const void *data, uint32_t len, uint8_t flags, GrfError *error);
 
 GRFEXPORT int grf_put(Grf *grf, const char *name, const void *data, uint32_t len, uint8_t flags, GrfError *error);
+GRFEXPORT int grf_put_many(Grf *grf, uint32_t count, const char **names, const void **data, const uint32_t *lens, uint32_t threads, GrfError *error);
+
+/* Saving */
+GRFEXPORT int grf_flush(Grf *grf, GrfError *error);
 
 GRFEXPORT int grf_repak(const char *grf, const char *tmpgrf, GrfError *error);
 
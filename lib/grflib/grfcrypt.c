@@ -209,134 +209,217 @@ static const uint8_t BitMap[0x08] = {
 * Private Functions *
 ********************/
 
-/** Private DES function to permutate a block.
- *
- * @warning block and table aren't checked for length or validity
+/* Tables combining the bitwise tables above, so a block can be processed
+ * with a handful of lookups instead of testing every bit. They are built
+ * from the tables above by DES_BuildTables, so the results stay bit-exact.
+ * Blocks are kept as two 32-bit halves, with byte 0 in the high bits.
+ */
+static uint32_t DES_IPTable[8][0x100][2];	/** IP, per input byte */
+static uint32_t DES_IPInvTable[8][0x100][2];	/** IP^-1, per input byte */
+static uint32_t DES_ETable[4][0x100][2];	/** E, per byte of R, in the top 6 bits of every output byte */
+static uint32_t DES_SPTable[8][0x40];		/** S functions followed by P */
+
+/* The tables are built once, before the first block is processed. Different
+ * GRFs can be decrypted on different threads, so this uses the system's
+ * run-once functions instead of a flag.
+ */
+#if defined(_WIN32) && !defined(__MINGW32__)
+static INIT_ONCE DES_TablesOnce = INIT_ONCE_STATIC_INIT;
+#else
+#include <pthread.h>
+static pthread_once_t DES_TablesOnce = PTHREAD_ONCE_INIT;
+#endif
+
+
+/** Private DES function to build a per-byte permutation table
  *
- * @param block A 64-bit block of data to be encrypted/decrypted
- * @param table One of DES_IP or DES_IP_INV, to select initial or final
- *		permutation of the block
- * @return A duplicate pointer to the block parameter
+ * @param out Table to fill, indexed by input byte number and value
+ * @param table One of DES_IP or DES_IP_INV
  */
-static uint8_t *
-DES_Permutation(uint8_t *block, const uint8_t *table)
+static void
+DES_BuildPermutationTable(uint32_t out[8][0x100][2], const uint8_t *table)
 {
-	uint8_t tmpblock[8],tmp;
-	uint32_t i;
+	uint32_t i,value;
+	uint8_t tmp;
 
-	memset(tmpblock,0,8);
+	memset(out,0,sizeof(uint32_t)*8*0x100*2);
 	for(i=0;i<0x40;i++) {
 		tmp=table[i]-1;
-		if (block[tmp>>3]&BitMap[tmp&7])
-			tmpblock[i>>3]|=BitMap[i&7];
+		for(value=0;value<0x100;value++)
+			if (value&BitMap[tmp&7])
+				out[tmp>>3][value][i>>5]|=0x80000000u>>(i&0x1F);
 	}
-	memcpy(block,tmpblock,8);
-
-	return block;
 }
 
 
-/** Private function to process a block after its been permutated
+/** Private DES function to build the lookup tables
  *
- * @warning block and ks aren't checked for length or validity
- *
- * @param block 8-byte block in memory to be DES crypted
- * @param ks 8-byte keyschedule to use (one of 16 in an array)
- * @return A duplicate pointer of block
+ * @note Only called through DES_InitTables
  */
-static uint8_t *
-DES_RawProcessBlock(uint8_t *block, const uint8_t *ks)
+static void
+DES_BuildTables(void)
 {
-	uint32_t i,tmp;
-	uint8_t tmpblock[2][8];
+	uint32_t i,j,value,tmp;
+	uint8_t sblock[4];
 
-	memset(tmpblock[0],0,8);
-	/* Use E to expand R from block into tmpblock */
+	DES_BuildPermutationTable(DES_IPTable, DES_IP);
+	DES_BuildPermutationTable(DES_IPInvTable, DES_IP_INV);
+
+	/* E reads bits 0x20-0x3F of the block, which are the 4 bytes of R */
+	memset(DES_ETable,0,sizeof(DES_ETable));
 	for(i=0;i<0x30;i++) {
 		tmp=DES_E[i]+0x1F;
-		if (block[tmp>>3]&BitMap[tmp&7])
-			tmpblock[0][i/6]|=BitMap[i%6];
+		j=(i/6)*8+(i%6);	/* output bit, the low 2 bits of every byte stay empty */
+		for(value=0;value<0x100;value++)
+			if (value&BitMap[tmp&7])
+				DES_ETable[(tmp>>3)-4][value][j>>5]|=0x80000000u>>(j&0x1F);
 	}
 
-	/* bitwise XOR the keyschedule against the expanded block */
-	for(i=0;i<8;i++)
-		tmpblock[0][i]^=ks[i];
-
-	memset(tmpblock[1],0,8);
-	/* Run the S functions */
+	/* Run every S function output through P, S(i) fills nibble i */
 	for(i=0;i<8;i++) {
-		if (i%2)
-			tmpblock[1][i>>1]+=DES_S(i)[tmpblock[0][i]>>2];
-		else
-			tmpblock[1][i>>1]=DES_S(i)[tmpblock[0][i]>>2]<<4;
+		for(value=0;value<0x40;value++) {
+			memset(sblock,0,4);
+			sblock[i>>1]=(i%2) ? DES_S(i)[value] : DES_S(i)[value]<<4;
+			DES_SPTable[i][value]=0;
+			for(j=0;j<0x20;j++) {
+				tmp=DES_P[j]-1;
+				if (sblock[tmp>>3]&BitMap[tmp&7])
+					DES_SPTable[i][value]|=0x80000000u>>j;
+			}
+		}
 	}
+}
 
-	memset(tmpblock[0],0,8);
-	/* Run the P function against the output of the S functions */
-	for(i=0;i<0x20;i++) {
-		tmp=DES_P[i]-1;
-		if (tmpblock[1][tmp>>3]&BitMap[tmp&7])
-			tmpblock[0][i>>3]|=BitMap[i&7];
-	}
 
-	/* XOR the 32 bit converted R against the old L */
-	block[0]^=tmpblock[0][0];
-	block[1]^=tmpblock[0][1];
-	block[2]^=tmpblock[0][2];
-	block[3]^=tmpblock[0][3];
+#if defined(_WIN32) && !defined(__MINGW32__)
+static BOOL CALLBACK
+DES_BuildTablesOnce(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+	DES_BuildTables();
+	return TRUE;
+}
+#endif
+
+
+/** Private DES function to make sure the lookup tables are built
+ *
+ * Safe to call from multiple threads, the tables are built by the first
+ *	call and the other calls wait until they are done
+ */
+static void
+DES_InitTables(void)
+{
+#if defined(_WIN32) && !defined(__MINGW32__)
+	InitOnceExecuteOnce(&DES_TablesOnce, DES_BuildTablesOnce, NULL, NULL);
+#else
+	pthread_once(&DES_TablesOnce, DES_BuildTables);
+#endif
+}
+
+
+/** Private DES function to convert a key schedule to 32-bit halves
+ *
+ * @param out Array of 16 pairs to store the key schedule in
+ * @param ks 0x80-byte key schedule
+ */
+static void
+DES_LoadKeySchedule(uint32_t out[0x10][2], const char *ks)
+{
+	uint32_t i;
+	const uint8_t *k=(const uint8_t *)ks;
 
-	return block;
+	for(i=0;i<0x10;i++,k+=8) {
+		out[i][0]=((uint32_t)k[0]<<24)|((uint32_t)k[1]<<16)|((uint32_t)k[2]<<8)|k[3];
+		out[i][1]=((uint32_t)k[4]<<24)|((uint32_t)k[5]<<16)|((uint32_t)k[6]<<8)|k[7];
+	}
 }
 
 
-/** Private DES function to property process a block of data
+/** Private DES function to process a block of data
  *
- * Calls DES_Permutation and DES_RawProcessBlock to
- *	appropriately encrypt or decrypt an 8-byte block of data
+ * Runs the initial permutation, the rounds and the final permutation
+ *	using the tables built by DES_BuildTables
  *
  * @warning Memory is not checked to be valid or of proper length
  *
  * @param rounds Number of times to process the block (GRF always uses 1)
  * @param dst Location in memory to store the processed block of data
  * @param src Location in memory to retrieve the unprocessed block of data
- * @param ks 0x80-byte key schedule to process the data against
+ * @param ks Key schedule, as loaded by DES_LoadKeySchedule
  * @param dir Direction the processing is going, one of GRFCRYPT_DECRYPT
  *		or GRFCRYPT_ENCRYPT
  */
 static uint8_t *
-DES_ProcessBlock(uint8_t rounds, uint8_t *dst, const uint8_t *src, const char *ks, uint8_t dir)
+DES_ProcessBlock(uint8_t rounds, uint8_t *dst, const uint8_t *src, uint32_t ks[0x10][2], uint8_t dir)
 {
-	uint32_t i;
-	uint8_t tmp[4];
-
-	/* Copy src to dst */
-	memcpy(dst, src, 8);
+	uint32_t i,l,r,tmp,e0,e1;
+	const uint32_t *k;
 
 	/* Run the initial permutation */
-	DES_Permutation(dst, DES_IP);
-
-	if (rounds>0) {
-		for(i=0;i<rounds;i++) {
-			DES_RawProcessBlock(dst,(uint8_t*)ks+(dir==GRFCRYPT_DECRYPT? 0xF-i:i)*8);
-
-			/* Swap L and R */
-			memcpy(tmp,dst,4);
-			memcpy(dst,dst+4,4);
-			memcpy(dst+4,tmp,4);
-		}
+	l=DES_IPTable[0][src[0]][0]|DES_IPTable[1][src[1]][0]|DES_IPTable[2][src[2]][0]|DES_IPTable[3][src[3]][0]|
+		DES_IPTable[4][src[4]][0]|DES_IPTable[5][src[5]][0]|DES_IPTable[6][src[6]][0]|DES_IPTable[7][src[7]][0];
+	r=DES_IPTable[0][src[0]][1]|DES_IPTable[1][src[1]][1]|DES_IPTable[2][src[2]][1]|DES_IPTable[3][src[3]][1]|
+		DES_IPTable[4][src[4]][1]|DES_IPTable[5][src[5]][1]|DES_IPTable[6][src[6]][1]|DES_IPTable[7][src[7]][1];
+
+	for(i=0;i<rounds;i++) {
+		k=ks[dir==GRFCRYPT_DECRYPT? 0xF-i:i];
+
+		/* Use E to expand R, and XOR the keyschedule against it */
+		e0=(DES_ETable[0][r>>24][0]|DES_ETable[1][(r>>16)&0xFF][0]|DES_ETable[2][(r>>8)&0xFF][0]|DES_ETable[3][r&0xFF][0])^k[0];
+		e1=(DES_ETable[0][r>>24][1]|DES_ETable[1][(r>>16)&0xFF][1]|DES_ETable[2][(r>>8)&0xFF][1]|DES_ETable[3][r&0xFF][1])^k[1];
+
+		/* Run the S and P functions, and XOR the result against L */
+		l^=DES_SPTable[0][e0>>26]|DES_SPTable[1][(e0>>18)&0x3F]|DES_SPTable[2][(e0>>10)&0x3F]|DES_SPTable[3][(e0>>2)&0x3F]|
+			DES_SPTable[4][e1>>26]|DES_SPTable[5][(e1>>18)&0x3F]|DES_SPTable[6][(e1>>10)&0x3F]|DES_SPTable[7][(e1>>2)&0x3F];
+
+		/* Swap L and R */
+		tmp=l;
+		l=r;
+		r=tmp;
 	}
 	/* Swap L and R a final time */
-	memcpy(tmp,dst,4);
-	memcpy(dst,dst+4,4);
-	memcpy(dst+4,tmp,4);
+	tmp=l;
+	l=r;
+	r=tmp;
 
 	/* Run the final permutation */
-	DES_Permutation(dst, DES_IP_INV);
+	for(i=0;i<8;i++)
+		dst[i]=(uint8_t)(i<4 ? l>>(24-i*8) : r>>(56-i*8));
+	l=DES_IPInvTable[0][dst[0]][0]|DES_IPInvTable[1][dst[1]][0]|DES_IPInvTable[2][dst[2]][0]|DES_IPInvTable[3][dst[3]][0]|
+		DES_IPInvTable[4][dst[4]][0]|DES_IPInvTable[5][dst[5]][0]|DES_IPInvTable[6][dst[6]][0]|DES_IPInvTable[7][dst[7]][0];
+	r=DES_IPInvTable[0][dst[0]][1]|DES_IPInvTable[1][dst[1]][1]|DES_IPInvTable[2][dst[2]][1]|DES_IPInvTable[3][dst[3]][1]|
+		DES_IPInvTable[4][dst[4]][1]|DES_IPInvTable[5][dst[5]][1]|DES_IPInvTable[6][dst[6]][1]|DES_IPInvTable[7][dst[7]][1];
+	for(i=0;i<8;i++)
+		dst[i]=(uint8_t)(i<4 ? l>>(24-i*8) : r>>(56-i*8));
 
 	return dst;
 }
 
 
+/** Private DES function to process a run of consecutive blocks
+ *
+ * Loads the key schedule once for the whole run, so the tables stay
+ *	hot in the cache while the blocks are processed
+ *
+ * @param dst Location in memory to store the processed blocks
+ * @param src Location in memory to retrieve the unprocessed blocks
+ * @param count Number of 8-byte blocks to process
+ * @param ks 0x80-byte key schedule to process the data against
+ * @param dir Direction of processing (GRFCRYPT_DECRYPT or GRFCRYPT_ENCRYPT)
+ */
+static void
+DES_ProcessBlocks(uint8_t *dst, const uint8_t *src, uint32_t count, const char *ks, uint8_t dir)
+{
+	uint32_t i;
+	uint32_t keys[0x10][2];
+
+	DES_InitTables();
+	DES_LoadKeySchedule(keys, ks);
+	for(i=0;i<count;i++,dst+=8,src+=8)
+		DES_ProcessBlock(1, dst, src, keys, dir);
+}
+
+
 /********************
  * Public Functions *
  ********************/
@@ -454,14 +537,9 @@ DES_CreateKeySchedule(char *ks, const char *key)
 char *
 DES_Process(char *dst, const char *src, uint32_t len, const char *ks, uint8_t dir)
 {
-	uint32_t i;
-	char *orig;
-
-	orig=dst;
-	for(i=0;i<len/8;i++,dst+=8,src+=8)
-		DES_ProcessBlock(1, (uint8_t *)dst, (const uint8_t *)src, ks, dir);
+	DES_ProcessBlocks((uint8_t *)dst, (const uint8_t *)src, len/8, ks, dir);
 
-	return orig;
+	return dst;
 }
 
 
@@ -530,8 +608,9 @@ GRF_Process(char *dst, const char *src, uint32_t len, uint8_t flags, uint32_t di
 char *
 GRF_MixedProcess(char *dst, const char *src, uint32_t len, uint8_t cycle, const char *ks, uint8_t dir)
 {
-	uint32_t i;
+	uint32_t i,blocks;
 	uint8_t j,tmp;
+	uint32_t keys[0x10][2];
 	char *orig;
 
 	orig=dst;
@@ -546,12 +625,18 @@ GRF_MixedProcess(char *dst, const char *src, uint32_t len, uint8_t cycle, const
 	else
 		cycle+=0xF;
 
-	for(i=j=0;i<(len/8);i++,dst+=8,src+=8) {
-		/* Check if its one of the first 0x14, or if its evenly
-		 * divisible by cycle
-		 */
-		if (i<0x14 || !(i%cycle))
-			DES_ProcessBlock(1,(uint8_t *)dst, (const uint8_t *)src, ks, dir);
+	/* The first 0x14 blocks are always processed */
+	blocks=len/8;
+	i=(blocks<0x14) ? blocks : 0x14;
+	DES_ProcessBlocks((uint8_t *)dst, (const uint8_t *)src, i, ks, dir);
+	dst+=i*8;
+	src+=i*8;
+
+	DES_LoadKeySchedule(keys, ks);
+	for(j=0;i<blocks;i++,dst+=8,src+=8) {
+		/* Check if its evenly divisible by cycle */
+		if (!(i%cycle))
+			DES_ProcessBlock(1,(uint8_t *)dst, (const uint8_t *)src, keys, dir);
 		else {
 			/* Check if its time to modify byte order */
 			if (j==7) {